@@ -0,0 +1,67 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <chrono>
+#include <algorithm>
+
+// Host stand-in for the Arduino core, enough for the display modules
+// (Display.h and what it includes) to build on Linux. See TFT_eSPI.h.
+//
+// millis()/micros() follow the host's monotonic clock plus an offset that
+// hostAdvanceMs() moves forward, so tests can step rate-limited code (e.g.
+// the heatmap refresh) without sleeping.
+
+#define PROGMEM
+#define IRAM_ATTR
+
+using std::min;
+using std::max;
+
+template<class T, class L, class H>
+T constrain(T v, L lo, H hi) { return v < lo ? lo : (v > hi ? hi : v); }
+
+inline uint64_t& hostClockOffsetUs() {
+    static uint64_t offset = 0;
+    return offset;
+}
+
+inline void hostAdvanceMs(uint32_t ms) { hostClockOffsetUs() += (uint64_t)ms * 1000; }
+
+inline uint64_t hostMicros64() {
+    using namespace std::chrono;
+    static const steady_clock::time_point start = steady_clock::now();
+    return duration_cast<microseconds>(steady_clock::now() - start).count() + hostClockOffsetUs();
+}
+
+inline unsigned long micros() { return (unsigned long)(uint32_t)hostMicros64(); }
+inline unsigned long millis() { return (unsigned long)(uint32_t)(hostMicros64() / 1000); }
+
+inline bool psramFound() { return true; }
+inline void* ps_malloc(size_t n) { return malloc(n); }
+
+// Serial goes to stdout; hostQuiet silences it (benchmarks)
+inline bool& hostQuiet() {
+    static bool quiet = false;
+    return quiet;
+}
+
+struct HostSerial {
+    void begin(unsigned long) {}
+    size_t printf(const char* fmt, ...) {
+        if(hostQuiet()) return 0;
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vprintf(fmt, ap);
+        va_end(ap);
+        return n > 0 ? n : 0;
+    }
+    size_t print(const char* s) { return hostQuiet() ? 0 : ::printf("%s", s); }
+    size_t println(const char* s = "") { return hostQuiet() ? 0 : ::printf("%s\n", s); }
+};
+
+inline HostSerial Serial;
@@ -0,0 +1,27 @@
+#pragma once
+#include <stdint.h>
+
+// Host stand-in for PNGdec: nothing decodes, so DisplayManager::showLogo()
+// takes its fallback path. Pages, the renders under test, don't use images.
+
+#define PNG_SUCCESS 0
+#define PNG_UNSUPPORTED_FEATURE 5
+#define PNG_RGB565_BIG_ENDIAN 1
+
+struct PNGDRAW {
+    void* pUser;
+    int x, y;
+    int iWidth;
+};
+
+typedef int (*PNG_DRAW_CALLBACK)(PNGDRAW*);
+
+class PNG {
+public:
+    int openRAM(uint8_t*, int, PNG_DRAW_CALLBACK) { return PNG_UNSUPPORTED_FEATURE; }
+    int decode(void*, int) { return PNG_UNSUPPORTED_FEATURE; }
+    void close() {}
+    int getWidth() { return 0; }
+    int getHeight() { return 0; }
+    void getLineAsRGB565(PNGDRAW*, uint16_t*, int, uint32_t) {}
+};
@@ -0,0 +1,339 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "HostFont.h"
+
+// Host backend for the part of the TFT_eSPI API the display code uses, over
+// an in-memory RGB565 panel. Lets DisplayManager and its layers, atlases,
+// chart and heatmap run unchanged on Linux, for render benchmarks
+// (tools/render_bench.cpp) and golden-image tests (test/test_render).
+//
+// The panel counts what the ST7789 would have been sent: every address
+// window costs CASET + RASET + RAMWR (11 bytes) plus 2 bytes per pixel, and
+// writecommand()/writedata() a byte each. Text is sent as TFT_eSPI does: one
+// window per character cell with a background colour, one per run of
+// foreground pixels without. Vertical scrolling (VSCRDEF/VSCSAD, used by
+// StripChart) is applied when the panel is read back.
+//
+// Glyphs come from HostFont.h, not TFT_eSPI's fonts: see there.
+
+#ifndef TFT_WIDTH
+#define TFT_WIDTH  240
+#endif
+#ifndef TFT_HEIGHT
+#define TFT_HEIGHT 320
+#endif
+
+#define TL_DATUM 0
+#define TC_DATUM 1
+#define TR_DATUM 2
+#define ML_DATUM 3
+#define MC_DATUM 4
+#define MR_DATUM 5
+#define BL_DATUM 6
+#define BC_DATUM 7
+#define BR_DATUM 8
+
+#define TFT_BLACK       0x0000
+#define TFT_NAVY        0x000F
+#define TFT_DARKGREEN   0x03E0
+#define TFT_DARKCYAN    0x03EF
+#define TFT_MAROON      0x7800
+#define TFT_PURPLE      0x780F
+#define TFT_OLIVE       0x7BE0
+#define TFT_LIGHTGREY   0xD69A
+#define TFT_DARKGREY    0x7BEF
+#define TFT_BLUE        0x001F
+#define TFT_GREEN       0x07E0
+#define TFT_CYAN        0x07FF
+#define TFT_RED         0xF800
+#define TFT_MAGENTA     0xF81F
+#define TFT_YELLOW      0xFFE0
+#define TFT_WHITE       0xFFFF
+#define TFT_ORANGE      0xFDA0
+#define TFT_GREENYELLOW 0xB7E0
+#define TFT_PINK        0xFE19
+#define TFT_BROWN       0x9A60
+#define TFT_GOLD        0xFEA0
+#define TFT_SILVER      0xC618
+#define TFT_SKYBLUE     0x867D
+#define TFT_VIOLET      0x915C
+
+#define PSRAM_ENABLE 3
+
+#define TFT_VSCRDEF 0x33
+#define TFT_VSCSAD  0x37
+
+// What the panel would have been sent since the last resetStats()
+struct TftStats {
+    uint64_t pixels = 0;
+    uint64_t bytes = 0;       // SPI bytes, commands and addresses included
+    uint32_t windows = 0;     // Address windows opened
+    uint32_t commands = 0;    // writecommand() calls
+};
+
+class TFT_eSPI {
+public:
+    static const int WINDOW_BYTES = 11;  // CASET + 4, RASET + 4, RAMWR
+
+    TFT_eSPI(int16_t w = TFT_WIDTH, int16_t h = TFT_HEIGHT) : width_(w), height_(h) {}
+    virtual ~TFT_eSPI() { if(panel) free(buf); }
+    TFT_eSPI(const TFT_eSPI&) = delete;
+    TFT_eSPI& operator=(const TFT_eSPI&) = delete;
+
+    void init() {
+        if(!buf) buf = (uint16_t*)calloc((size_t)width_ * height_, 2);
+        panel = true;
+        scrollTop = 0;
+        scrollHeight = height_;
+        scrollStart = 0;
+    }
+    void setRotation(uint8_t) {}
+    bool initDMA(bool = false) { return true; }
+    void dmaWait() {}
+    void startWrite() {}
+    void endWrite() {}
+
+    int16_t width() const { return width_; }
+    int16_t height() const { return height_; }
+
+    // === Drawing ===
+    void fillScreen(uint32_t color) { fillRect(0, 0, width_, height_, color); }
+
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+        window(x, y, w, h, nullptr, color);
+    }
+
+    void drawPixel(int32_t x, int32_t y, uint32_t color) { fillRect(x, y, 1, 1, color); }
+    void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) { fillRect(x, y, w, 1, color); }
+    void drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color) { fillRect(x, y, 1, h, color); }
+
+    // `data` in sprite byte order (big-endian RGB565), as TFT_eSPI sends it
+    void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t* data) {
+        window(x, y, w, h, data, 0);
+    }
+    void pushImageDMA(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t* data, uint16_t* = nullptr) {
+        window(x, y, w, h, data, 0);
+    }
+
+    void writecommand(uint8_t c) {
+        stats_.bytes++;
+        stats_.commands++;
+        command = c;
+        argCount = 0;
+    }
+
+    void writedata(uint8_t d) {
+        stats_.bytes++;
+        if(argCount < sizeof(args)) args[argCount++] = d;
+        if(command == TFT_VSCRDEF && argCount == 6) {
+            scrollTop = (args[0] << 8) | args[1];
+            scrollHeight = (args[2] << 8) | args[3];
+        } else if(command == TFT_VSCSAD && argCount == 2) {
+            scrollStart = (args[0] << 8) | args[1];
+        }
+    }
+
+    // === Text ===
+    void setTextColor(uint16_t fg) { textFg = textBg = fg; }  // Transparent background
+    void setTextColor(uint16_t fg, uint16_t bg, bool = false) { textFg = fg; textBg = bg; }
+    void setTextDatum(uint8_t d) { datum = d; }
+
+    int16_t fontHeight(int16_t font) const { return hostFont(font).height; }
+
+    int16_t textWidth(const char* s, uint8_t font) const {
+        const HostFontMetrics& m = hostFont(font);
+        int16_t w = 0;
+        for(; *s; s++) w += hostNarrowChar(*s) ? m.narrow : m.advance;
+        return w;
+    }
+
+    int16_t drawString(const char* s, int32_t x, int32_t y, uint8_t font) {
+        const HostFontMetrics& m = hostFont(font);
+        int16_t w = textWidth(s, font);
+        switch(datum % 3) {
+            case 1: x -= w / 2; break;
+            case 2: x -= w; break;
+        }
+        switch(datum / 3) {
+            case 1: y -= m.height / 2; break;
+            case 2: y -= m.height; break;
+        }
+        for(; *s; s++) x += drawChar(*s, x, y, m);
+        return w;
+    }
+
+    int16_t drawNumber(long n, int32_t x, int32_t y, uint8_t font) {
+        char s[16];
+        snprintf(s, sizeof(s), "%ld", n);
+        return drawString(s, x, y, font);
+    }
+
+    int16_t drawFloat(float v, uint8_t dp, int32_t x, int32_t y, uint8_t font) {
+        char s[24];
+        snprintf(s, sizeof(s), "%.*f", dp > 7 ? 7 : dp, v);
+        return drawString(s, x, y, font);
+    }
+
+    // === Host side ===
+    const TftStats& stats() const { return stats_; }
+    void resetStats() { stats_ = TftStats(); }
+
+    // Pixel as seen on the panel, scrolling applied (native RGB565)
+    uint16_t readPixel(int32_t x, int32_t y) const {
+        if(!buf || x < 0 || y < 0 || x >= width_ || y >= height_) return 0;
+        if(panel && scrollHeight > 0 && y >= scrollTop && y < scrollTop + scrollHeight) {
+            y = scrollTop + ((y - scrollTop) + (scrollStart - scrollTop) + scrollHeight) % scrollHeight;
+        }
+        uint16_t c = buf[(size_t)y * width_ + x];
+        return panel ? c : swap(c);
+    }
+
+    // FNV-1a over the visible pixels, for golden tests
+    uint64_t checksum() const {
+        uint64_t h = 0xcbf29ce484222325ULL;
+        for(int32_t y=0; y<height_; y++) {
+            for(int32_t x=0; x<width_; x++) {
+                uint16_t c = readPixel(x, y);
+                h = (h ^ (c & 0xFF)) * 0x100000001b3ULL;
+                h = (h ^ (c >> 8)) * 0x100000001b3ULL;
+            }
+        }
+        return h;
+    }
+
+    // Binary PPM (P6), 8 bits per channel
+    bool writePPM(const char* path) const {
+        FILE* f = fopen(path, "wb");
+        if(!f) return false;
+        fprintf(f, "P6\n%d %d\n255\n", width_, height_);
+        for(int32_t y=0; y<height_; y++) {
+            for(int32_t x=0; x<width_; x++) {
+                uint16_t c = readPixel(x, y);
+                uint8_t rgb[3] = {
+                    (uint8_t)(((c >> 11) & 0x1F) * 255 / 31),
+                    (uint8_t)(((c >> 5) & 0x3F) * 255 / 63),
+                    (uint8_t)((c & 0x1F) * 255 / 31),
+                };
+                fwrite(rgb, 1, 3, f);
+            }
+        }
+        return fclose(f) == 0;
+    }
+
+protected:
+    uint16_t* buf = nullptr;    // Panel: native RGB565. Sprite: byte swapped.
+    int16_t width_, height_;
+    bool panel = false;
+
+    static uint16_t swap(uint16_t c) { return (c >> 8) | (c << 8); }
+
+    // Clipped write of a w x h block: `data` (sprite byte order), or a fill
+    void window(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t* data, uint16_t fill) {
+        if(!buf) return;
+        int32_t sx = 0, sy = 0, stride = w;
+        if(x < 0) { sx = -x; w += x; x = 0; }
+        if(y < 0) { sy = -y; h += y; y = 0; }
+        if(x + w > width_) w = width_ - x;
+        if(y + h > height_) h = height_ - y;
+        if(w <= 0 || h <= 0) return;
+
+        if(panel) {
+            stats_.windows++;
+            stats_.pixels += (uint64_t)w * h;
+            stats_.bytes += WINDOW_BYTES + (uint64_t)w * h * 2;
+        }
+        uint16_t f = panel ? fill : swap(fill);
+        for(int32_t r=0; r<h; r++) {
+            uint16_t* dst = buf + (size_t)(y + r) * width_ + x;
+            if(!data) {
+                for(int32_t i=0; i<w; i++) dst[i] = f;
+            } else {
+                const uint16_t* src = data + (size_t)(sy + r) * stride + sx;
+                for(int32_t i=0; i<w; i++) dst[i] = panel ? swap(src[i]) : src[i];
+            }
+        }
+    }
+
+private:
+    TftStats stats_;
+    uint16_t textFg = TFT_WHITE, textBg = TFT_WHITE;
+    uint8_t datum = TL_DATUM;
+    uint8_t command = 0;
+    uint8_t args[8] = {};
+    uint8_t argCount = 0;
+    int32_t scrollTop = 0, scrollHeight = 0, scrollStart = 0;
+
+    // One character cell at x, y (top left); returns its width
+    int16_t drawChar(char c, int32_t x, int32_t y, const HostFontMetrics& m) {
+        bool narrow = hostNarrowChar(c);
+        int16_t cellW = narrow ? m.narrow : m.advance;
+        int16_t gw = narrow ? cellW - (cellW + 3) / 4 : m.glyphW;
+        int16_t gx = (cellW - gw) / 2;
+        const uint8_t* g = hostGlyph(c);
+
+        // Scaled glyph; narrow characters keep the middle three columns
+        auto lit = [&](int px, int py) {
+            if(px < gx || px >= gx + gw || py < m.top || py >= m.top + m.glyphH) return false;
+            int col = narrow ? 1 + (px - gx) * 3 / gw : (px - gx) * 5 / gw;
+            int row = (py - m.top) * 7 / m.glyphH;
+            return ((g[col] >> row) & 1) != 0;
+        };
+
+        if(textBg != textFg) {
+            // Whole cell in one window, like TFT_eSPI with a background colour
+            uint16_t* cell = (uint16_t*)malloc((size_t)cellW * m.height * 2);
+            if(!cell) return cellW;
+            for(int py=0; py<m.height; py++) {
+                for(int px=0; px<cellW; px++) {
+                    cell[py * cellW + px] = swap(lit(px, py) ? textFg : textBg);
+                }
+            }
+            window(x, y, cellW, m.height, cell, 0);
+            free(cell);
+        } else {
+            for(int py=0; py<m.height; py++) {
+                for(int px=0; px<cellW; ) {
+                    if(!lit(px, py)) { px++; continue; }
+                    int run = px;
+                    while(run < cellW && lit(run, py)) run++;
+                    window(x + px, y + py, run - px, 1, nullptr, textFg);
+                    px = run;
+                }
+            }
+        }
+        return cellW;
+    }
+};
+
+// Off-screen 16-bit canvas; draws with the same API, counts nothing
+class TFT_eSprite : public TFT_eSPI {
+public:
+    explicit TFT_eSprite(TFT_eSPI*) : TFT_eSPI(0, 0) {}
+    ~TFT_eSprite() { deleteSprite(); }
+
+    void setColorDepth(int8_t) {}
+    void setAttribute(uint8_t, uint8_t) {}
+
+    void* createSprite(int16_t w, int16_t h, uint8_t = 1) {
+        deleteSprite();
+        buf = (uint16_t*)calloc((size_t)w * h, 2);
+        if(buf) {
+            width_ = w;
+            height_ = h;
+        }
+        return buf;
+    }
+
+    void deleteSprite() {
+        free(buf);
+        buf = nullptr;
+        width_ = height_ = 0;
+    }
+
+    bool created() const { return buf != nullptr; }
+    void* getPointer() { return buf; }
+    void fillSprite(uint32_t color) { fillRect(0, 0, width_, height_, color); }
+};
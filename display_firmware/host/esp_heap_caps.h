@@ -0,0 +1,8 @@
+#pragma once
+#include <stdlib.h>
+
+// Host stand-in: every capability is plain heap (see Arduino.h)
+#define MALLOC_CAP_DMA    (1 << 3)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+
+inline void* heap_caps_malloc(size_t n, uint32_t) { return malloc(n); }
@@ -0,0 +1,183 @@
+#pragma once
+#include <stdint.h>
+#include <math.h>
+#include "Config.h"
+
+// Pack internal resistance and open-circuit voltage from Volt (113) and
+// Current (119), by least squares of V = OCV - R * I over a sliding window
+// of V/I pairs. Fixed storage, O(1) per sample:
+//  - A Current sample pairs with the latest Volt sample if it is at most
+//    PAIR_MS old (and vice versa), each sample used once.
+//  - The window keeps raw integer pairs and exact int64 running sums, so
+//    sliding never accumulates rounding drift.
+//  - The fit is only taken when the window spans enough current
+//    (MIN_SPREAD_A) and explains the voltage (MIN_R2). Cruising at constant
+//    current keeps the last good fit instead of an ill-conditioned one.
+//
+// Sag events: the voltage drops more than SAG_ENTER x OCV below the fitted
+// OCV for at least SAG_MIN_MS. The event ends when the sag recovers below
+// SAG_EXIT x OCV.
+class BatteryEstimator {
+public:
+    static const int WINDOW = 256;                 // Pairs, ~25 s at 10 Hz
+    static const int MIN_PAIRS = 64;
+    static const uint32_t PAIR_MS = 150;
+    static constexpr float MIN_SPREAD_A = 8.0f;    // Std dev of I in the window
+    static constexpr float MIN_R2 = 0.6f;
+    static constexpr float SAG_ENTER = 0.08f;      // Of OCV
+    static constexpr float SAG_EXIT = 0.04f;
+    static const uint32_t SAG_MIN_MS = 300;
+
+    struct Fit {
+        bool valid;
+        float ohms;
+        float ocv;    // V at zero current
+        float r2;
+        uint32_t ms;  // When it was taken
+    };
+
+    struct SagStats {
+        uint32_t count;
+        float worstV;          // Largest sag below OCV
+        float minV;            // Lowest pack voltage during a sag
+        uint32_t lastMs;       // Duration of the last finished event
+    };
+
+    BatteryEstimator() {
+        kV = TARGET_FIELDS[fieldIndex(ADDR_VOLT)].k;
+        bV = TARGET_FIELDS[fieldIndex(ADDR_VOLT)].b;
+        kI = TARGET_FIELDS[fieldIndex(ADDR_CURRENT)].k;
+        bI = TARGET_FIELDS[fieldIndex(ADDR_CURRENT)].b;
+        reset();
+    }
+
+    void reset() {
+        n = head = 0;
+        sx = sy = sxx = sxy = syy = 0;
+        haveV = haveI = false;
+        current = Fit{false, 0, 0, 0, 0};
+        resetSags();
+    }
+
+    void resetSags() {
+        sag = SagStats{0, 0, 0, 0};
+        sagState = SAG_NONE;
+    }
+
+    // One wire sample (raw, as decoded). Returns true if a pair entered the window.
+    bool onSample(uint16_t address, int32_t raw, uint32_t ms) {
+        if(address == ADDR_VOLT) {
+            vRaw = raw; vMs = ms; haveV = true;
+            trackSag(ms);
+            if(haveI && ms - iMs <= PAIR_MS) return pair();
+        } else if(address == ADDR_CURRENT) {
+            iRaw = raw; iMs = ms; haveI = true;
+            if(haveV && ms - vMs <= PAIR_MS) return pair();
+        }
+        return false;
+    }
+
+    const Fit& fit() const { return current; }
+    const SagStats& sags() const { return sag; }
+    bool inSag() const { return sagState == SAG_ACTIVE; }
+    int pairs() const { return n; }
+
+private:
+    enum SagState : uint8_t { SAG_NONE, SAG_PENDING, SAG_ACTIVE };
+
+    float kV, bV, kI, bI;
+    int32_t winI[WINDOW];
+    int32_t winV[WINDOW];
+    int n, head;
+    int64_t sx, sy, sxx, sxy, syy;
+
+    int32_t vRaw = 0, iRaw = 0;
+    uint32_t vMs = 0, iMs = 0;
+    bool haveV, haveI;
+
+    Fit current;
+    SagStats sag;
+    SagState sagState;
+    uint32_t sagStartMs = 0;
+
+    bool pair() {
+        // Consume both samples
+        haveV = haveI = false;
+        uint32_t ms = vMs > iMs ? vMs : iMs;
+
+        if(n == WINDOW) {
+            int32_t ox = winI[head], oy = winV[head];
+            sx -= ox; sy -= oy;
+            sxx -= (int64_t)ox * ox; sxy -= (int64_t)ox * oy; syy -= (int64_t)oy * oy;
+        } else {
+            n++;
+        }
+        winI[head] = iRaw;
+        winV[head] = vRaw;
+        head = (head + 1) % WINDOW;
+        sx += iRaw; sy += vRaw;
+        sxx += (int64_t)iRaw * iRaw; sxy += (int64_t)iRaw * vRaw; syy += (int64_t)vRaw * vRaw;
+
+        if(n >= MIN_PAIRS) solve(ms);
+        return true;
+    }
+
+    void solve(uint32_t ms) {
+        // Centred moments times n^2, exact in int64
+        int64_t dxx = (int64_t)n * sxx - sx * sx;
+        int64_t dxy = (int64_t)n * sxy - sx * sy;
+        int64_t dyy = (int64_t)n * syy - sy * sy;
+        if(dxx <= 0 || dyy <= 0) return;
+
+        // Current spread: sqrt(dxx) / n raw units
+        float spread = (float)sqrt((double)dxx) / n / kI;
+        if(spread < MIN_SPREAD_A) return;
+
+        double slope = (double)dxy / dxx;              // Raw V per raw I
+        double r2 = (double)dxy * dxy / ((double)dxx * dyy);
+        double ohms = -slope * kI / kV;
+        if(r2 < MIN_R2 || ohms <= 0) return;
+
+        double intercept = ((double)sy - slope * sx) / n; // Raw V at raw I = 0
+        double ocvRaw = intercept + slope * bI;            // ... at zero amps
+        current.valid = true;
+        current.ohms = (float)ohms;
+        current.ocv = (float)((ocvRaw - bV) / kV);
+        current.r2 = (float)r2;
+        current.ms = ms;
+    }
+
+    void trackSag(uint32_t ms) {
+        if(!current.valid) return;
+        float v = (vRaw - bV) / kV;
+        float drop = current.ocv - v;
+
+        switch(sagState) {
+            case SAG_NONE:
+                if(drop > SAG_ENTER * current.ocv) {
+                    sagState = SAG_PENDING;
+                    sagStartMs = ms;
+                }
+                break;
+            case SAG_PENDING:
+                if(drop <= SAG_ENTER * current.ocv) {
+                    sagState = SAG_NONE;
+                } else if(ms - sagStartMs >= SAG_MIN_MS) {
+                    sagState = SAG_ACTIVE;
+                    sag.count++;
+                    if(sag.count == 1 || v < sag.minV) sag.minV = v;
+                    if(drop > sag.worstV) sag.worstV = drop;
+                }
+                break;
+            case SAG_ACTIVE:
+                if(drop < SAG_EXIT * current.ocv) {
+                    sagState = SAG_NONE;
+                    sag.lastMs = ms - sagStartMs;
+                } else {
+                    if(v < sag.minV) sag.minV = v;
+                    if(drop > sag.worstV) sag.worstV = drop;
+                }
+                break;
+        }
+    }
+};
@@ -0,0 +1,105 @@
+#pragma once
+#include <Arduino.h>
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include "BatteryEstimator.h"
+#include "Protocol.h"
+#include "VehicleState.h"
+
+// Reference resistance: the mean of the first PACK_REF_FITS good fits loop()
+// sees on this pack, kept in NVS. Later fits are shown as a percentage of it; a rise past
+// PACK_R_WARN_PCT is the early pack-health warning.
+#define PACK_REF_FITS    600
+#define PACK_R_WARN_PCT  150
+
+// Target glue for BatteryEstimator: feeds it from the notify callback, and
+// from loop() publishes the fit and the sag statistics as virtual fields,
+// keeps the reference in NVS and logs sag events and the resistance warning
+// on Serial. The notify callback does nothing but the estimator update.
+class BatteryService {
+public:
+    void init(VehicleState* out) {
+        state = out;
+        prefs.begin("battery", false);
+        refOhms = prefs.getFloat("ref", 0.0f);
+    }
+
+    // From the BLE notify callback
+    void onSample(const Protocol::ParsedData& data) {
+        if(data.address != ADDR_VOLT && data.address != ADDR_CURRENT) return;
+        portENTER_CRITICAL(&lock);
+        est.onSample(data.address, data.raw, millis());
+        portEXIT_CRITICAL(&lock);
+    }
+
+    // From loop(): publish what changed since the last pass
+    void service() {
+        portENTER_CRITICAL(&lock);
+        BatteryEstimator::Fit fit = est.fit();
+        BatteryEstimator::SagStats sags = est.sags();
+        bool sagging = est.inSag();
+        portEXIT_CRITICAL(&lock);
+
+        if(fit.valid && fit.ms != lastFitMs) {
+            lastFitMs = fit.ms;
+            onFit(fit);
+        }
+        if(sags.count != lastSagCount || sagging != wasSagging) {
+            if(wasSagging && !sagging) {
+                Serial.printf("Sag: %.1f V worst, %lu ms\n", sags.worstV, (unsigned long)sags.lastMs);
+            }
+            lastSagCount = sags.count;
+            wasSagging = sagging;
+            state->update(VF_SAG_COUNT, (float)sags.count);
+            state->update(VF_SAG_MAX, sags.worstV);
+        }
+    }
+
+    // From loop(), new trip: sag statistics restart; the fit and the reference stay
+    void resetSags() {
+        portENTER_CRITICAL(&lock);
+        est.resetSags();
+        portEXIT_CRITICAL(&lock);
+        lastSagCount = 0;
+        wasSagging = false;
+        state->update(VF_SAG_COUNT, 0.0f);
+        state->update(VF_SAG_MAX, 0.0f);
+    }
+
+private:
+    BatteryEstimator est;
+    VehicleState* state = nullptr;
+    Preferences prefs;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+    uint32_t lastFitMs = 0;
+    uint32_t lastSagCount = 0;
+    bool wasSagging = false;
+
+    float refOhms = 0;
+    double refSum = 0;
+    uint32_t refFits = 0;
+    bool warned = false;
+
+    void onFit(const BatteryEstimator::Fit& fit) {
+        if(refOhms <= 0) {
+            refSum += fit.ohms;
+            if(++refFits == PACK_REF_FITS) {
+                refOhms = (float)(refSum / refFits);
+                prefs.putFloat("ref", refOhms);
+                Serial.printf("Pack reference resistance: %.1f mOhm\n", refOhms * 1000.0f);
+            }
+        }
+
+        state->update(VF_PACK_OCV, fit.ocv);
+        state->update(VF_PACK_R, fit.ohms * 1000.0f);
+        if(refOhms > 0) {
+            float pct = fit.ohms / refOhms * 100.0f;
+            state->update(VF_PACK_R_REF, pct);
+            if(pct >= PACK_R_WARN_PCT && !warned) {
+                warned = true;
+                Serial.printf("Pack warning: resistance %.0f%% of reference\n", pct);
+            }
+        }
+    }
+};
@@ -1,8 +1,23 @@
 #pragma once
 #include <NimBLEDevice.h>
-#include "Protocol.h"
+#include <atomic>
+#include "Config.h"
+#include "Transport.h"
 
-class BleClientManager {
+// Scan duty cycle, set by the power manager
+enum ScanDuty : uint8_t {
+    SCAN_FAST,   // Interval 45 ms, window 15 ms: quickest (re)connect
+    SCAN_DUTY,   // Window 60 ms every 1 s while searching
+    SCAN_BURST,  // Continuous, for the short bursts of the parked cycle
+};
+
+// NimBLE transport: scans for the controller, connects and subscribes to its
+// notify characteristic. Protocol sequencing lives in ControllerSession.
+//
+// The scan callback runs on the NimBLE host task and only records the match
+// (found()); loop() connects with connectFound(), so the status line is
+// drawn from one task.
+class BleClientManager : public Transport {
 public:
     bool isConnected = false;
     bool isScanning = false;
@@ -10,34 +25,74 @@ public:
     NimBLERemoteService* pService = nullptr;
     NimBLERemoteCharacteristic* pWriteChar = nullptr;
     NimBLERemoteCharacteristic* pNotifyChar = nullptr;
-
-    typedef std::function<void(uint16_t addr, float val)> DataCallback;
-    DataCallback onDataReceived;
+    uint8_t peerMac[6] = {}; // Controller address, NimBLE native (LSB first) order
 
     void init() {
         NimBLEDevice::init("HarvTech-Display");
         NimBLEDevice::setPower(ESP_PWR_LVL_P9);
     }
 
-    void startScan() {
+    // Scan for `seconds` (0 = until stopped) with the current duty cycle
+    void startScan(uint32_t seconds = 0) {
         if(isConnected) return;
         auto pScan = NimBLEDevice::getScan();
-        pScan->setInterval(45);
-        pScan->setWindow(15);
+        if(pScan->isScanning()) pScan->stop();
+        switch(scanDuty) {
+            case SCAN_FAST:  pScan->setInterval(45);   pScan->setWindow(15); break;
+            case SCAN_DUTY:  pScan->setInterval(1000); pScan->setWindow(60); break;
+            case SCAN_BURST: pScan->setInterval(100);  pScan->setWindow(100); break;
+        }
         pScan->setActiveScan(true);
-        pScan->start(0, scanEndedCB);
+        pScan->start(seconds, scanEndedCB);
         isScanning = true;
     }
 
+    void stopScan() {
+        NimBLEDevice::getScan()->stop();
+        isScanning = false;
+    }
+
+    // Applies to a running scan immediately
+    void setScanDuty(ScanDuty duty) {
+        if(duty == scanDuty) return;
+        scanDuty = duty;
+        if(isScanning && !isConnected) startScan();
+    }
+
     static void scanEndedCB(NimBLEScanResults results) {
         // restart scan in main loop if needed
+        if(instance) instance->isScanning = false;
     }
 
-    bool connectToServer(NimBLEAdvertisedDevice* device) {
+    // Scan callback: stop scanning, remember the controller for loop()
+    void found(NimBLEAdvertisedDevice* device) {
+        stopScan();
+        target = device->getAddress();
+        targetFound = true;
+    }
+
+    bool hasFound() const { return targetFound; }
+
+    // From loop(), after found(); blocks for the connection and discovery
+    bool connectFound() {
+        if(!targetFound.exchange(false)) return false;
+        return connectToServer(target);
+    }
+
+    // Clears isConnected so loop() can rescan
+    class ClientCallbacks : public NimBLEClientCallbacks {
+        void onDisconnect(NimBLEClient* client) {
+            if(instance) instance->isConnected = false;
+        }
+    };
+
+    bool connectToServer(const NimBLEAddress& address) {
         pClient = NimBLEDevice::createClient();
+        pClient->setClientCallbacks(new ClientCallbacks(), true);
         
-        if(pClient->connect(device)) {
+        if(pClient->connect(address)) {
             isConnected = true;
+            memcpy(peerMac, pClient->getPeerAddress().getNative(), 6);
             
             // Discover Service
             pService = pClient->getService(SERVICE_UUID);
@@ -56,45 +111,31 @@ public:
         return false;
     }
 
-    void configureDataStream() {
-        if(!pWriteChar) return;
-
-        // 1. Stop Upload
-        auto stopCmd = Protocol::createControlCommand(CMD_STOP_UPLOAD);
-        pWriteChar->writeValue(stopCmd, false);
-        delay(200);
-
-        // 2. Clear Data
-        auto clearCmd = Protocol::createControlCommand(CMD_CLEAR_DATA);
-        pWriteChar->writeValue(clearCmd, false);
-        delay(200);
-
-        // 3. Setup Channels
-        for(int i=0; i<NUM_FIELDS; i++) {
-            auto setupCmd = Protocol::createChannelSetupCommand(
-                TARGET_FIELDS[i].address, 
-                TARGET_FIELDS[i].size
-            );
-            pWriteChar->writeValue(setupCmd, false);
-            delay(50);
-        }
-        delay(100);
+    void disconnect() override {
+        if(pClient && isConnected) pClient->disconnect();
+    }
+
+    bool connected() const override { return isConnected; }
 
-        // 4. Start Upload
-        auto startCmd = Protocol::createControlCommand(CMD_START_UPLOAD);
-        pWriteChar->writeValue(startCmd, false);
+    bool send(const uint8_t* data, size_t length) override {
+        if(!isConnected || !pWriteChar) return false;
+        return pWriteChar->writeValue(data, length, false);
     }
 
+    const uint8_t* peer() const override { return peerMac; }
+
     static void notifyCallback(NimBLERemoteCharacteristic* pChar, uint8_t* pData, size_t length, bool isNotify) {
-        Protocol::ParsedData data = Protocol::parsePacket(pData, length);
-        if(data.valid && instance && instance->onDataReceived) {
-            instance->onDataReceived(data.address, data.value);
-        }
+        if(instance) instance->deliver(pData, length);
     }
     
     // Singleton access helper
     static BleClientManager* instance;
     BleClientManager() { instance = this; }
+
+private:
+    ScanDuty scanDuty = SCAN_FAST;
+    NimBLEAddress target;
+    std::atomic<bool> targetFound{false};
 };
 
 BleClientManager* BleClientManager::instance = nullptr;
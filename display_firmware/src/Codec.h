@@ -0,0 +1,200 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Streaming time-series codecs for raw telemetry samples. Portable, no
+// allocation; every coder is a few words of state, so one per field is cheap.
+//
+// Byte oriented (fast, used by the trip log and serial export):
+//   DeltaOfDelta  timestamps: (t[n] - t[n-1]) - (t[n-1] - t[n-2]), zigzag
+//                 varint. A field streamed at a fixed rate costs 1 byte.
+//   DeltaValue    values: zigzag varint of v[n] - v[n-1].
+//
+// Bit oriented (slower; a repeated value costs 1 bit, so it wins on fields
+// that mostly hold still, while DeltaValue wins on fields that count up and
+// down - compare both with tools/codec_bench on real trips):
+//   XorValue      Gorilla-style: v[n] ^ v[n-1]; '0' if equal, otherwise the
+//                 meaningful bits, reusing the previous leading/trailing zero
+//                 window when they fit.
+//
+// Encoders and decoders share the state classes: encode() and decode() both
+// advance the same prediction, so a decoder is just a second instance.
+
+namespace codec {
+
+inline uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+inline int32_t unzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+// Wrapping difference and sum, defined for every int32 pair
+inline int32_t wrapSub(int32_t a, int32_t b) { return (int32_t)((uint32_t)a - (uint32_t)b); }
+inline int32_t wrapAdd(int32_t a, int32_t b) { return (int32_t)((uint32_t)a + (uint32_t)b); }
+
+// Up to 5 bytes. Returns the bytes written.
+inline size_t putVarint(uint8_t* out, uint32_t v) {
+    size_t n = 0;
+    while(v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+// Reads at p[pos], stopping at end. False on truncation or an overlong value.
+inline bool getVarint(const uint8_t* p, size_t end, size_t& pos, uint32_t& v) {
+    v = 0;
+    for(int shift=0; shift<35; shift+=7) {
+        if(pos >= end) return false;
+        uint8_t b = p[pos++];
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if(!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+const size_t MAX_VARINT = 5;
+
+} // namespace codec
+
+class DeltaOfDelta {
+public:
+    void reset(uint32_t t0 = 0) { prev = t0; prevDelta = 0; }
+
+    // Zigzagged delta-of-delta of t; varint it
+    uint32_t encode(uint32_t t) {
+        int32_t delta = (int32_t)(t - prev);
+        uint32_t z = codec::zigzag(codec::wrapSub(delta, prevDelta));
+        prev = t;
+        prevDelta = delta;
+        return z;
+    }
+
+    uint32_t decode(uint32_t z) {
+        int32_t delta = codec::wrapAdd(prevDelta, codec::unzigzag(z));
+        prev += (uint32_t)delta;
+        prevDelta = delta;
+        return prev;
+    }
+
+private:
+    uint32_t prev = 0;
+    int32_t prevDelta = 0;
+};
+
+class DeltaValue {
+public:
+    void reset(int32_t v0 = 0) { prev = v0; }
+
+    uint32_t encode(int32_t v) {
+        uint32_t z = codec::zigzag(codec::wrapSub(v, prev));
+        prev = v;
+        return z;
+    }
+
+    int32_t decode(uint32_t z) {
+        prev = codec::wrapAdd(prev, codec::unzigzag(z));
+        return prev;
+    }
+
+private:
+    int32_t prev = 0;
+};
+
+// MSB-first bit stream over a caller's buffer
+class BitWriter {
+public:
+    BitWriter(uint8_t* buffer, size_t capacity) : buf(buffer), cap(capacity) {}
+
+    // Append the low n bits of v (n <= 32). False once the buffer is full.
+    bool write(uint32_t v, int n) {
+        for(int i=n-1; i>=0; i--) {
+            size_t byte = bits >> 3;
+            if(byte >= cap) return false;
+            uint8_t mask = 0x80 >> (bits & 7);
+            if((v >> i) & 1) buf[byte] |= mask;
+            else buf[byte] &= ~mask;
+            bits++;
+        }
+        return true;
+    }
+
+    size_t bitCount() const { return bits; }
+    size_t bytes() const { return (bits + 7) >> 3; }
+
+private:
+    uint8_t* buf;
+    size_t cap;
+    size_t bits = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* buffer, size_t length) : buf(buffer), lenBits(length * 8) {}
+
+    bool read(int n, uint32_t& v) {
+        if(bits + n > lenBits) return false;
+        v = 0;
+        for(int i=0; i<n; i++) {
+            v = (v << 1) | ((buf[bits >> 3] >> (7 - (bits & 7))) & 1);
+            bits++;
+        }
+        return true;
+    }
+
+private:
+    const uint8_t* buf;
+    size_t lenBits;
+    size_t bits = 0;
+};
+
+class XorValue {
+public:
+    void reset(uint32_t v0 = 0) { prev = v0; leading = 0xFF; trailing = 0; }
+
+    bool encode(BitWriter& out, uint32_t v) {
+        uint32_t x = v ^ prev;
+        prev = v;
+        if(x == 0) return out.write(0, 1);
+
+        uint8_t lz = clz(x), tz = ctz(x);
+        if(leading != 0xFF && lz >= leading && tz >= trailing) {
+            // Fits the previous window
+            return out.write(0b10, 2) && out.write(x >> trailing, 32 - leading - trailing);
+        }
+        leading = lz;
+        trailing = tz;
+        int len = 32 - leading - trailing; // 1..32, stored as len - 1
+        return out.write(0b11, 2) && out.write(leading, 5) && out.write(len - 1, 5) &&
+               out.write(x >> trailing, len);
+    }
+
+    bool decode(BitReader& in, uint32_t& v) {
+        uint32_t flag, x;
+        if(!in.read(1, flag)) return false;
+        if(flag == 0) {
+            v = prev;
+            return true;
+        }
+        if(!in.read(1, flag)) return false;
+        if(flag == 1) {
+            uint32_t lz, len;
+            if(!in.read(5, lz) || !in.read(5, len)) return false;
+            if(lz + len + 1 > 32) return false;
+            leading = lz;
+            trailing = 32 - lz - (len + 1);
+        }
+        if(leading == 0xFF) return false;
+        if(!in.read(32 - leading - trailing, x)) return false;
+        prev ^= x << trailing;
+        v = prev;
+        return true;
+    }
+
+private:
+    uint32_t prev = 0;
+    uint8_t leading = 0xFF; // 0xFF = no window yet
+    uint8_t trailing = 0;
+
+    static uint8_t clz(uint32_t x) { return (uint8_t)__builtin_clz(x); }
+    static uint8_t ctz(uint32_t x) { return (uint8_t)__builtin_ctz(x); }
+};
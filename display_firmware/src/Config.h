@@ -1,11 +1,19 @@
 #pragma once
-#include <Arduino.h>
+#include <stdint.h>
 
 // BLE UUIDs
 #define SERVICE_UUID        "0000FFE0-0000-1000-8000-00805F9B34FB"
 #define NOTIFY_CHAR_UUID    "0000FFE2-0000-1000-8000-00805F9B34FB"
 #define WRITE_CHAR_UUID     "0000FFE1-0000-1000-8000-00805F9B34FB"
 
+// Relay service the display offers to phones (see RelayService.h)
+#define RELAY_SERVICE_UUID  "6E7A0001-4A3B-4C21-9D5E-2F8B1C0D3E4F"
+#define RELAY_DATA_UUID     "6E7A0002-4A3B-4C21-9D5E-2F8B1C0D3E4F" // Notify: sample batches
+#define RELAY_SCHEMA_UUID   "6E7A0003-4A3B-4C21-9D5E-2F8B1C0D3E4F" // Read: slot -> address
+#define RELAY_RATE_UUID     "6E7A0004-4A3B-4C21-9D5E-2F8B1C0D3E4F" // Read/write: u16 batch period, ms
+#define RELAY_CMD_UUID      "6E7A0005-4A3B-4C21-9D5E-2F8B1C0D3E4F" // Write: command for the controller
+#define RELAY_RESP_UUID     "6E7A0006-4A3B-4C21-9D5E-2F8B1C0D3E4F" // Notify: controller answers
+
 // Addresses
 #define ADDR_CONTROL          11
 #define ADDR_TIME_CHANNEL     12
@@ -20,6 +28,39 @@
 #define PIN_BTN_BRIGHT       5  // Button 2: Toggle Brightness
 #define PIN_BTN_RECONNECT    6  // Button 3: Reconnect
 
+// Button bits in input event masks
+#define BTN_VIEW             (1 << 0)
+#define BTN_BRIGHT           (1 << 1)
+#define BTN_RECONNECT        (1 << 2)
+#define BTN_TOUCH            (1 << 3)  // Gesture from the touch panel
+
+// Touch controller (CST328) wiring; override with -D for other board revisions
+#ifndef PIN_TOUCH_SDA
+#define PIN_TOUCH_SDA        1
+#endif
+#ifndef PIN_TOUCH_SCL
+#define PIN_TOUCH_SCL        3
+#endif
+#ifndef PIN_TOUCH_RST
+#define PIN_TOUCH_RST        2
+#endif
+#ifndef PIN_TOUCH_INT
+#define PIN_TOUCH_INT        7
+#endif
+
+// Field addresses used by name in the firmware
+#define ADDR_SPEED            24
+#define ADDR_SOC              26
+#define ADDR_RPM              105
+#define ADDR_VOLT             113
+#define ADDR_POWER            115
+#define ADDR_CURRENT          119
+#define ADDR_THROTTLE         220
+#define ADDR_TEMP             222
+#define ADDR_MOTOR_TEMP       223
+#define ADDR_PHASE_CURRENT    224
+#define ADDR_ERROR            239
+
 // Data Field Configuration
 struct DataFieldConfig {
     uint16_t address;
@@ -43,3 +84,124 @@ const DataFieldConfig TARGET_FIELDS[] = {
 };
 
 const int NUM_FIELDS = sizeof(TARGET_FIELDS) / sizeof(TARGET_FIELDS[0]);
+
+// Virtual fields: values derived on the device, published into VehicleState
+// and bound to widgets like wire fields. Protocol addresses are 13 bits, so
+// addresses from 0x2000 up never collide with them.
+#define VF_WH_USED            0x2000  // Wh drawn from the pack this trip
+#define VF_WH_REGEN           0x2001  // Wh returned by regeneration
+#define VF_DISTANCE           0x2002  // km
+#define VF_WH_PER_KM          0x2003  // Net Wh / km
+#define VF_AVG_SPEED          0x2004  // km/h over moving time
+#define VF_PEAK_POWER         0x2005  // kW
+#define VF_RANGE              0x2006  // Estimated remaining km
+#define VF_RANGE_LO           0x2007  // Lower edge of the range band
+#define VF_RANGE_HI           0x2008  // Upper edge of the range band
+#define VF_PACK_OCV           0x2009  // Fitted open-circuit voltage, V
+#define VF_PACK_R             0x200A  // Fitted internal resistance, mOhm
+#define VF_PACK_R_REF         0x200B  // Resistance as % of the pack's reference
+#define VF_SAG_COUNT          0x200C  // Sag events this trip
+#define VF_SAG_MAX            0x200D  // Worst sag below OCV this trip, V
+#define VF_TEMP_60            0x200E  // Minutes with the controller at >= 60 C
+#define VF_TEMP_80            0x200F  // ... >= 80 C
+#define VF_TEMP_100           0x2010  // ... >= 100 C
+
+struct VirtualFieldConfig {
+    uint16_t address;
+    const char* name;
+    const char* unit;
+};
+
+const VirtualFieldConfig VIRTUAL_FIELDS[] = {
+    {VF_WH_USED,    "WhUsed",  "Wh"},
+    {VF_WH_REGEN,   "WhRegen", "Wh"},
+    {VF_DISTANCE,   "Dist",    "km"},
+    {VF_WH_PER_KM,  "Wh/km",   "Wh/km"},
+    {VF_AVG_SPEED,  "AvgSpd",  "km/h"},
+    {VF_PEAK_POWER, "PeakPwr", "kW"},
+    {VF_RANGE,      "Range",   "km"},
+    {VF_RANGE_LO,   "RangeLo", "km"},
+    {VF_RANGE_HI,   "RangeHi", "km"},
+    {VF_PACK_OCV,   "OCV",     "V"},
+    {VF_PACK_R,     "PackR",   "mOhm"},
+    {VF_PACK_R_REF, "R/Ref",   "%"},
+    {VF_SAG_COUNT,  "Sags",    ""},
+    {VF_SAG_MAX,    "SagMax",  "V"},
+    {VF_TEMP_60,    "T>60",    "min"},
+    {VF_TEMP_80,    "T>80",    "min"},
+    {VF_TEMP_100,   "T>100",   "min"},
+};
+
+const int NUM_VIRTUAL_FIELDS = sizeof(VIRTUAL_FIELDS) / sizeof(VIRTUAL_FIELDS[0]);
+
+// Polled registers: read on demand with plain read commands instead of being
+// streamed (see RegisterPoller.h), each at its own period. Rarely changing
+// diagnostics that would waste stream bandwidth.
+struct PolledRegisterConfig {
+    uint16_t address;
+    uint8_t size;        // 1, 2 or 4 bytes
+    bool isSigned;
+    float k;
+    float b;
+    uint16_t periodMs;
+    const char* name;
+    const char* unit;
+};
+
+const PolledRegisterConfig POLLED_REGISTERS[] = {
+    {ADDR_ERROR,         4, false, 1.0f,   0.0f,  1000, "Error",  ""},  // Fault bits
+    {ADDR_MOTOR_TEMP,    1, true,  1.0f,   40.0f, 5000, "MotorT", "C"},
+    {ADDR_PHASE_CURRENT, 2, true,  33.03f, 0.0f,  2000, "PhaseA", "A"},
+};
+
+const int NUM_POLLED = sizeof(POLLED_REGISTERS) / sizeof(POLLED_REGISTERS[0]);
+
+// Controller configuration backed up and restored by ParamEngine.h. The
+// address space is byte addressed (a u16 at 113 ends at 114), so a range is
+// a start address and a byte count. Ranges must not include the control
+// registers (11, 12) or the live data block (20 and up to ADDR_ERROR).
+struct ParamRange {
+    uint16_t start;
+    uint16_t length;
+};
+
+const ParamRange PARAM_RANGES[] = {
+    {0x0100, 0x0100},   // Configuration block
+};
+
+const int NUM_PARAM_RANGES = sizeof(PARAM_RANGES) / sizeof(PARAM_RANGES[0]);
+
+// Wire fields take slots [0, NUM_FIELDS), virtual fields follow, then polled registers
+const int NUM_SLOTS = NUM_FIELDS + NUM_VIRTUAL_FIELDS + NUM_POLLED;
+const int FIRST_POLLED_SLOT = NUM_FIELDS + NUM_VIRTUAL_FIELDS;
+
+// Slot of a field address (TARGET_FIELDS, VIRTUAL_FIELDS, then
+// POLLED_REGISTERS), -1 if not monitored
+inline int fieldIndex(uint16_t address) {
+    for(int i=0; i<NUM_FIELDS; i++) {
+        if(TARGET_FIELDS[i].address == address) return i;
+    }
+    for(int i=0; i<NUM_VIRTUAL_FIELDS; i++) {
+        if(VIRTUAL_FIELDS[i].address == address) return NUM_FIELDS + i;
+    }
+    for(int i=0; i<NUM_POLLED; i++) {
+        if(POLLED_REGISTERS[i].address == address) return FIRST_POLLED_SLOT + i;
+    }
+    return -1;
+}
+
+// Field address of a slot, 0 if out of range
+inline uint16_t fieldAddress(int slot) {
+    if(slot < 0 || slot >= NUM_SLOTS) return 0;
+    if(slot < NUM_FIELDS) return TARGET_FIELDS[slot].address;
+    if(slot < FIRST_POLLED_SLOT) return VIRTUAL_FIELDS[slot - NUM_FIELDS].address;
+    return POLLED_REGISTERS[slot - FIRST_POLLED_SLOT].address;
+}
+
+// Short name of a slot, for logs
+inline const char* fieldName(int slot) {
+    if(slot < 0 || slot >= NUM_SLOTS) return "?";
+    if(slot < NUM_FIELDS) return TARGET_FIELDS[slot].name;
+    if(slot < FIRST_POLLED_SLOT) return VIRTUAL_FIELDS[slot - NUM_FIELDS].name;
+    return POLLED_REGISTERS[slot - FIRST_POLLED_SLOT].name;
+}
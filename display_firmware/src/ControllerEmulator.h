@@ -0,0 +1,130 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <functional>
+#include "Config.h"
+
+// Scripted stand-in for a CJPOWER controller, for LoopbackTransport.
+// Portable. Implements the side of the protocol the display uses:
+//   write 11         stop (0) / start (1) upload, clear channels (255)
+//   write 12         add a time-data channel: [AddrLow][AddrHigh][Size]
+//   read             [AddrLow][AddrHigh|0x80][Size] -> answer with the Read,
+//                    Resp and (for more than one register) Multi flags
+//   other writes     stored in the register file
+// While uploading, each round sends one packet per channel. Rounds are due
+// every periodUs; `script` updates the register file before each round.
+class ControllerEmulator {
+public:
+    static const int MAX_CHANNELS = 16;
+    static const size_t MEMORY = 0x2000;
+
+    typedef std::function<void(const uint8_t* data, size_t length)> OutFn;
+    OutFn out;   // Packets to the display
+
+    std::function<void(uint64_t us, ControllerEmulator& emu)> script;
+    uint32_t periodUs = 20000;   // 50 rounds/s, about what the BLE link carries
+
+    uint8_t mem[MEMORY] = {};
+
+    // Statistics
+    uint32_t commands = 0;
+    uint32_t rounds = 0;
+    uint32_t packetsOut = 0;
+    uint32_t missed = 0;     // Rounds skipped by run()
+
+    bool uploading() const { return upload; }
+    int channels() const { return numChannels; }
+    uint16_t channelAddress(int i) const { return chan[i].address; }
+
+    // Little-endian register value, `size` bytes
+    void set(uint16_t address, int32_t raw, uint8_t size) {
+        for(int i=0; i<size && address + i < (int)MEMORY; i++) mem[address + i] = (uint32_t)raw >> (8 * i);
+    }
+
+    void onCommand(const uint8_t* cmd, size_t len) {
+        if(len < 2) return;
+        commands++;
+        uint16_t address = ((cmd[1] & 0x1F) << 8) | cmd[0];
+        if(address >= MEMORY) return;
+
+        if(cmd[1] & 0x80) {
+            if(len < 3) return;
+            uint8_t size = cmd[2];
+            if(size > 18) size = 18; // One 20-byte notification
+            if(address + size > MEMORY) return;
+            uint8_t pkt[20] = {cmd[0], (uint8_t)(cmd[1] | 0x20 | (size > 4 ? 0x40 : 0))};
+            memcpy(pkt + 2, mem + address, size);
+            emit(pkt, 2 + size);
+            return;
+        }
+
+        const uint8_t* data = cmd + 2;
+        size_t n = len - 2;
+        if(address == ADDR_CONTROL && n >= 1) {
+            if(data[0] == CMD_STOP_UPLOAD) upload = false;
+            else if(data[0] == CMD_START_UPLOAD) upload = true;
+            else if(data[0] == CMD_CLEAR_DATA) numChannels = 0;
+        } else if(address == ADDR_TIME_CHANNEL && n >= 3) {
+            // Stream channels are 1, 2 or 4 byte registers inside memory
+            uint16_t field = data[0] | ((data[1] & 0x1F) << 8);
+            uint8_t size = data[2];
+            bool valid = (size == 1 || size == 2 || size == 4) && field + size <= MEMORY;
+            if(valid && numChannels < MAX_CHANNELS) chan[numChannels++] = Channel{field, size};
+        } else {
+            for(size_t i=0; i<n && address + i < MEMORY; i++) mem[address + i] = data[i];
+        }
+    }
+
+    // Send every round due by `us`, at most `maxRounds` of them: a caller
+    // that fell further behind skips the rest (counted in `missed`) instead
+    // of bursting. Returns the number sent.
+    uint32_t run(uint64_t us, uint32_t maxRounds = UINT32_MAX) {
+        if(!upload) {
+            nextUs = us;
+            return 0;
+        }
+        uint32_t n = 0;
+        while(us >= nextUs) {
+            if(n == maxRounds) {
+                uint64_t behind = (us - nextUs) / periodUs + 1;
+                missed += behind;
+                nextUs += behind * periodUs;
+                break;
+            }
+            round(nextUs);
+            nextUs += periodUs;
+            n++;
+        }
+        return n;
+    }
+
+    // One upload round now, regardless of the period
+    void round(uint64_t us) {
+        if(script) script(us, *this);
+        for(int i=0; i<numChannels; i++) {
+            uint8_t pkt[2 + 4];
+            pkt[0] = chan[i].address & 0xFF;
+            pkt[1] = (chan[i].address >> 8) & 0x1F;
+            memcpy(pkt + 2, mem + chan[i].address, chan[i].size);
+            emit(pkt, 2 + chan[i].size);
+        }
+        rounds++;
+    }
+
+private:
+    struct Channel {
+        uint16_t address;
+        uint8_t size;
+    };
+
+    Channel chan[MAX_CHANNELS];
+    int numChannels = 0;
+    bool upload = false;
+    uint64_t nextUs = 0;
+
+    void emit(const uint8_t* p, size_t n) {
+        packetsOut++;
+        if(out) out(p, n);
+    }
+};
@@ -0,0 +1,133 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "Protocol.h"
+#include "Transport.h"
+
+// Protocol sequencing above a Transport: the upload setup after connecting,
+// splitting incoming packets into stream samples and everything else, and
+// the command path for the services that talk to the controller (poller,
+// parameter engine, phone relay). Portable, so the whole path from packet
+// to sample runs on the host over a LoopbackTransport.
+//
+// The setup is stepped from service() instead of sleeping between
+// commands, so neither loop() nor a transport callback blocks while the
+// controller takes its time.
+class ControllerSession {
+public:
+    // Spacing the controller needs after each setup command
+    static const uint32_t STOP_GAP_MS = 200;
+    static const uint32_t CLEAR_GAP_MS = 200;
+    static const uint32_t CHANNEL_GAP_MS = 50;
+    static const uint32_t START_GAP_MS = 100;   // After the last channel
+
+    typedef std::function<void(const Protocol::ParsedData& data)> DataCallback;
+    typedef std::function<void(const uint8_t* data, size_t length)> PacketCallback;
+
+    DataCallback onDataReceived;   // Stream samples, in the transport's context
+    PacketCallback onOtherPacket;  // Read answers, acks
+    PacketCallback onPacket;       // Every packet as it arrived, before parsing (trace capture)
+    std::function<void()> onStreaming; // Setup done, from service()
+
+    // Statistics, written in the transport's context
+    std::atomic<uint32_t> packets{0};
+    std::atomic<uint32_t> samples{0};
+
+    void attach(Transport* t) {
+        transport = t;
+        t->setReceiver([this](const uint8_t* data, size_t length) { receive(data, length); });
+    }
+
+    Transport* link() const { return transport; }
+
+    bool isConnected() const { return transport && transport->connected(); }
+
+    bool isStreaming() const { return streaming && isConnected(); }
+
+    bool isConfiguring() const { return step >= 0; }
+
+    // Setup commands still to go out, tens of ms apart
+    bool isSendingSetup() const { return step >= 0 && step <= 2 + NUM_FIELDS; }
+
+    bool sendCommand(const uint8_t* cmd, size_t length) {
+        return isConnected() && transport->send(cmd, length);
+    }
+
+    // Connected: stop, clear, set up the TARGET_FIELDS channels, start.
+    // Streaming once the setup is sent and the link counts as connected.
+    void configure(uint32_t ms) {
+        step = 0;
+        nextAt = ms;
+        streaming = false;
+    }
+
+    // From loop(): next setup command when due
+    void service(uint32_t ms) {
+        if(step < 0) return;
+        if(!transport || !transport->canSend()) {
+            step = -1; // Lost the link mid-setup; configure() again on reconnect
+            return;
+        }
+        if(step <= 2 + NUM_FIELDS) sendStep(ms);
+        // A link without a handshake is up once the controller streams
+        if(step > 2 + NUM_FIELDS && isConnected()) {
+            step = -1;
+            streaming = true;
+            if(onStreaming) onStreaming();
+        }
+    }
+
+    void disconnect() {
+        step = -1;
+        streaming = false;
+        if(transport) transport->disconnect();
+    }
+
+    // Every packet from the controller
+    void receive(const uint8_t* data, size_t length) {
+        packets++;
+        if(onPacket) onPacket(data, length);
+        TRACE_BEGIN(TR_PARSE, 0);
+        Protocol::ParsedData parsed = Protocol::parsePacket(data, length);
+        TRACE_END(TR_PARSE, parsed.valid ? parsed.slot + 1 : 0);
+        if(parsed.valid) {
+            samples++;
+            if(onDataReceived) onDataReceived(parsed);
+        } else if(onOtherPacket) {
+            onOtherPacket(data, length);
+        }
+    }
+
+private:
+    Transport* transport = nullptr;
+    int step = -1;          // Next setup command, -1 = none in progress
+    uint32_t nextAt = 0;
+    bool streaming = false;
+
+    void sendStep(uint32_t ms) {
+        if((int32_t)(ms - nextAt) < 0) return;
+
+        std::vector<uint8_t> cmd;
+        uint32_t gap;
+        if(step == 0) {
+            cmd = Protocol::createControlCommand(CMD_STOP_UPLOAD);
+            gap = STOP_GAP_MS;
+        } else if(step == 1) {
+            cmd = Protocol::createControlCommand(CMD_CLEAR_DATA);
+            gap = CLEAR_GAP_MS;
+        } else if(step < 2 + NUM_FIELDS) {
+            const DataFieldConfig& f = TARGET_FIELDS[step - 2];
+            cmd = Protocol::createChannelSetupCommand(f.address, f.size);
+            gap = step == 1 + NUM_FIELDS ? CHANNEL_GAP_MS + START_GAP_MS : CHANNEL_GAP_MS;
+        } else {
+            cmd = Protocol::createControlCommand(CMD_START_UPLOAD);
+            gap = 0;
+        }
+        transport->send(cmd.data(), cmd.size());
+        nextAt = ms + gap;
+        step++;
+    }
+};
@@ -2,6 +2,18 @@
 #include <TFT_eSPI.h>
 #include <PNGdec.h>
 #include "Images.h"
+#include "Layout.h"
+#include "VehicleState.h"
+#include "PageLayers.h"
+#include "GlyphAtlas.h"
+#include "StripChart.h"
+#include "HeatmapView.h"
+#include "LatencyView.h"
+
+// Page switches (layer blit + widget overlay) must fit in one 60 Hz frame
+#define PAGE_SWITCH_BUDGET_US 16667
+
+PNG png; // PNG Decoder (global so pngDraw can reach it)
 
 // Callback must be static or global
 int pngDraw(PNGDRAW *pDraw) {
@@ -19,33 +31,73 @@ public:
     TFT_eSPI tft = TFT_eSPI(); // Make Public for callback access
 private:
     TFT_eSprite sprite = TFT_eSprite(&tft);
-    PNG png; // PNG Decoder
 
-    int currentPage = 0; // 0=Grid, 1=Big Speed
-    bool highBrightness = true;
+    int currentPage = 0; // Index into PAGES
+
+    // Per-widget render state for the current page (avoids flicker)
+    bool widgetDrawn[MAX_WIDGETS_PER_PAGE] = {};
+    int32_t lastShown[MAX_WIDGETS_PER_PAGE] = {};
+    float lastValue[MAX_WIDGETS_PER_PAGE] = {};
+
+    // Last status line, redrawn when returning to a page that shows it
+    char statusText[32] = "";
+    uint16_t statusColor = TFT_WHITE;
+
+    // Cached static backgrounds; screenPage is the layer on the panel (-1 = unknown)
+    PageLayers layers;
+    int screenPage = -1;
+
+    // Digit atlases and the cells currently shown by each atlas widget
+    GlyphAtlas atlas;
+    char shownCells[MAX_WIDGETS_PER_PAGE][MAX_CELLS] = {};
+    uint16_t shownColor[MAX_WIDGETS_PER_PAGE] = {};
+    bool cellsValid[MAX_WIDGETS_PER_PAGE] = {};
+
+    // Hardware-scrolled strip chart for pages with a ChartDef
+    StripChart chart;
+    const History* history = nullptr;
+
+    // Widget colour per slot set by alarm rules, 0 = the widget's own
+    uint16_t fieldColor[VehicleState::MAX_SLOTS] = {};
+
+    // Operating-point heatmap for pages with a HeatmapDef
+    HeatmapView heatmap;
+    const OperatingMap* opmap = nullptr;
+
+    // Notify-to-pixel latency, measured when a probe is attached
+    LatencyView latencyView;
+    LatencyProbe* latency = nullptr;
+
+public:
+    // Page-switch latency, measured from button handling to last widget drawn
+    uint32_t lastSwitchUs = 0;
+    uint32_t maxSwitchUs = 0;
 
-    // Cache values to avoid flicker
-    int lastSpeed = -1;
-    int lastSoC = -1;
-    int lastRPM = -1;
-    float lastVolt = -1;
-    float lastThrottle = -1;
+    // Digit cells pushed from the atlas since boot
+    uint32_t cellBlits = 0;
 
 public:
     void init() {
         tft.init();
         tft.setRotation(0); // Portrait 240x320
         tft.fillScreen(TFT_BLACK);
-        
-        // Turn on Backlight
-        pinMode(TFT_BL, OUTPUT);
-        digitalWrite(TFT_BL, HIGH);
+        tft.initDMA();
+
+        // Render every page's static layer once
+        if(layers.init(tft)) {
+            Serial.println("Page layers cached in PSRAM");
+        } else {
+            Serial.println("Page layers unavailable, drawing statics directly");
+        }
+        atlas.build(tft);
 
+        // Backlight is driven by PowerManager
         // Don't draw Static UI yet, let main call showLogo first
     }
     
     void showLogo() {
         tft.fillScreen(TFT_BLACK);
+        screenPage = -1;
         
         // img_app_icon is defined in Images.h
         // Name in script was: img_app_icon => actually based on filename 'ic_launcher.png'
@@ -69,155 +121,221 @@ public:
     }
     // ... rest of methods
     
-    void toggleBrightness() {
-        highBrightness = !highBrightness;
-        // Simple PWM or just Digital toggle if BL pin allows
-        // Assuming BL pin is PWM capable, typically default HIGH/LOW is simplest.
-        // For PWM we need ledcSetup (ESP32). Let's stick to simple High/Low, or simulate dimming with alpha if not supported? 
-        // No, standard is PWM on BL pin.
-        // Let's us simple analogWrite equivalent in Arduino ESP32 context:
-        analogWrite(TFT_BL, highBrightness ? 255 : 50);
+    int page() const { return currentPage; }
+
+    void nextPage(const VehicleState& state) {
+        showPage((currentPage + 1) % NUM_PAGES, state);
     }
-    
-    void nextPage() {
-        currentPage++;
-        if(currentPage > 1) currentPage = 0;
-        
-        // Full Redraw
-        tft.fillScreen(TFT_BLACK);
-        lastSpeed = -1; lastSoC = -1; lastRPM = -1; // Force redraw of values
-        
-        if(currentPage == 0) {
-            drawStaticUI();
+
+    void prevPage(const VehicleState& state) {
+        showPage((currentPage + NUM_PAGES - 1) % NUM_PAGES, state);
+    }
+
+    // Switch page and draw it completely from the model in the same frame
+    void showPage(int page, const VehicleState& state) {
+        uint32_t t0 = micros();
+
+        currentPage = page;
+        drawPage();
+        render(state, 0xFFFFFFFF);
+
+        lastSwitchUs = micros() - t0;
+        if(lastSwitchUs > maxSwitchUs) maxSwitchUs = lastSwitchUs;
+        if(lastSwitchUs > PAGE_SWITCH_BUDGET_US) {
+            Serial.printf("Page switch took %lu us (budget %d us)\n",
+                          (unsigned long)lastSwitchUs, PAGE_SWITCH_BUDGET_US);
+        }
+    }
+
+    // Static background of the current page, then invalidate widgets
+    void drawPage() {
+        const PageDef& page = PAGES[currentPage];
+
+        // Layers assume an unscrolled panel
+        chart.end(tft);
+        heatmap.end();
+        latencyView.end();
+
+        if(layers.available()) {
+            layers.blit(tft, currentPage, screenPage);
         } else {
-            // Page 1 Static
-            tft.setTextColor(TFT_GREEN, TFT_BLACK);
-            tft.setTextDatum(MC_DATUM);
-            tft.drawString("SPEED", 120, 40, 4);
+            tft.fillScreen(TFT_BLACK);
+            drawStatics(tft, page);
+        }
+        screenPage = currentPage;
+
+        for(int i=0; i<MAX_WIDGETS_PER_PAGE; i++) {
+            widgetDrawn[i] = false;
+            cellsValid[i] = false;
         }
+        if(page.showStatus) drawStatus();
+        if(page.chart && history) chart.begin(tft, page.chart, *history);
+        if(page.heatmap && opmap) heatmap.begin(tft, page.heatmap, opmap);
+        if(page.latency && latency) latencyView.begin(tft, page.latency, latency);
     }
 
-    void drawStaticUI() {
-        tft.setTextColor(TFT_WHITE, TFT_BLACK);
-        tft.setTextDatum(MC_DATUM);
-        
-        // Header
-        tft.fillRect(0, 0, 240, 40, TFT_NAVY);
-        tft.drawString("HarvTech", 120, 20, 4);
+    // History source for chart pages
+    void attachHistory(const History* h) {
+        history = h;
+    }
 
-        // Labels
-        tft.setTextDatum(TL_DATUM);
-        tft.setTextColor(TFT_SILVER);
-        tft.drawString("SoC %", 20, 60, 2);
-        tft.drawString("Throttle V", 140, 60, 2);
-        
-        tft.drawString("SPEED km/h", 70, 120, 2);
+    // A new history sample was taken: one more chart line if a chart is shown
+    void onHistorySample() {
+        if(history) chart.append(tft, *history);
+    }
 
-        tft.drawString("RPM", 20, 220, 2);
-        tft.drawString("VOLTAGE", 140, 220, 2);
-        
-        // Extra Metrics Row
-        tft.drawString("PWR", 20, 280, 2);
-        tft.drawString("CUR", 100, 280, 2);
-        tft.drawString("TMP", 180, 280, 2);
+    // Operating map source for heatmap pages
+    void attachMap(const OperatingMap* m) {
+        opmap = m;
+    }
+
+    // From loop(): recolour changed heatmap cells if one is shown (rate limited)
+    void refreshHeatmap() {
+        heatmap.refresh(tft);
+    }
+
+    // Latency probe fed by render(), shown by pages with a LatencyDef
+    void attachLatency(LatencyProbe* p) {
+        latency = p;
+    }
+
+    // From loop(): update the latency table if one is shown (rate limited)
+    void refreshLatency() {
+        latencyView.refresh(tft);
+    }
+
+    // Override the colour of every widget bound to a slot (0 = back to the
+    // widget's own); widgets on screen are redrawn by the next render()
+    void setFieldColor(int slot, uint16_t color) {
+        if(slot < 0 || slot >= VehicleState::MAX_SLOTS || fieldColor[slot] == color) return;
+        fieldColor[slot] = color;
+        const PageDef& page = PAGES[currentPage];
+        for(int i=0; i<page.numWidgets; i++) {
+            if(fieldIndex(page.widgets[i].field) == slot) widgetDrawn[i] = false;
+        }
+    }
+
+    void drawStaticUI() {
+        drawPage();
     }
     
     void updateStatus(const char* status, uint16_t color) {
-        if(currentPage != 0) return; // Only show status on Grid
-        tft.fillRect(0, 305, 240, 15, TFT_BLACK);
-        tft.setTextColor(color, TFT_BLACK);
-        tft.setTextDatum(BC_DATUM);
-        tft.drawString(status, 120, 320, 2);
+        strncpy(statusText, status, sizeof(statusText) - 1);
+        statusColor = color;
+        if(PAGES[currentPage].showStatus) drawStatus(); // Only show status on Grid
     }
 
-    void updateSpeed(float speed) {
-        int val = (int)speed;
-        if(val == lastSpeed) return;
-        lastSpeed = val;
-        
-        if(currentPage == 0) {
-            // Speed is central large Text
-            tft.setTextColor(TFT_GREEN, TFT_BLACK);
-            tft.setTextDatum(MC_DATUM);
-            tft.fillRect(40, 140, 160, 60, TFT_BLACK);
-            tft.drawNumber(val, 120, 170, 7);
-        } else {
-            // Big Page
-            tft.setTextColor(TFT_GREEN, TFT_BLACK);
-            tft.setTextDatum(MC_DATUM);
-            tft.fillRect(0, 80, 240, 160, TFT_BLACK);
-            tft.drawNumber(val, 120, 160, 8); // Largest font
+    // Draw the current page from the model. Widgets whose slot changed, and any
+    // not yet drawn since the last page switch, are (re)drawn; unchanged values
+    // are skipped by drawWidget(). A slot that turned invalid is blanked.
+    void render(const VehicleState& state, uint32_t dirty) {
+        const PageDef& page = PAGES[currentPage];
+        if(latency) latency->beginPass(dirty);
+        for(int i=0; i<page.numWidgets; i++) {
+            int slot = fieldIndex(page.widgets[i].field);
+            if(!state.isValid(slot)) {
+                if(widgetDrawn[i] && (dirty & (1UL << slot))) clearWidget(i);
+                continue;
+            }
+            if(widgetDrawn[i] && !(dirty & (1UL << slot))) continue;
+            drawWidget(i, state.value(slot));
         }
+        if(latency) latency->endPass();
     }
 
-    void updateSoC(int soc) {
-        if((currentPage != 0) || (soc == lastSoC)) return;
-        lastSoC = soc;
-        
-        uint16_t color = (soc > 20) ? TFT_ORANGE : TFT_RED;
-        tft.setTextColor(color, TFT_BLACK);
-        tft.setTextDatum(TL_DATUM);
-        tft.fillRect(20, 80, 80, 30, TFT_BLACK);
-        tft.drawNumber(soc, 20, 80, 4);
+private:
+    void drawStatus() {
+        tft.fillRect(0, STATUS_Y, 240, STATUS_H, TFT_BLACK);
+        tft.setTextColor(statusColor, TFT_BLACK);
+        tft.setTextDatum(BC_DATUM);
+        tft.drawString(statusText, 120, 320, 2);
     }
 
-    void updateThrottle(float v) {
-        if((currentPage != 0) || (abs(v - lastThrottle) < 0.1)) return;
-        lastThrottle = v;
-        
-        tft.setTextColor(TFT_RED, TFT_BLACK);
-        tft.setTextDatum(TL_DATUM);
-        tft.fillRect(140, 80, 80, 30, TFT_BLACK);
-        tft.drawFloat(v, 1, 140, 80, 4);
+    // Value as it will appear on screen, so sub-resolution noise never causes a redraw
+    static int32_t quantise(float value, uint8_t decimals) {
+        if(decimals == 0) return (int32_t)value;
+        float scale = 1.0f;
+        for(int i=0; i<decimals; i++) scale *= 10.0f;
+        return (int32_t)lroundf(value * scale);
     }
 
-    void updateRPM(int rpm) {
-        if((currentPage != 0) || (rpm == lastRPM)) return;
-        lastRPM = rpm;
+    void drawWidget(int idx, float value) {
+        const WidgetDef& w = PAGES[currentPage].widgets[idx];
+        int32_t q = quantise(value, w.decimals);
 
-        tft.setTextColor(TFT_SKYBLUE, TFT_BLACK);
-        tft.setTextDatum(TL_DATUM);
-        tft.fillRect(20, 240, 100, 25, TFT_BLACK);
-        tft.drawNumber(rpm, 20, 240, 4);
-    }
+        // Skip unchanged widgets: same displayed value, or change below threshold
+        if(widgetDrawn[idx]) {
+            if(q == lastShown[idx]) return;
+            if(fabsf(value - lastValue[idx]) < w.threshold) return;
+        }
+        widgetDrawn[idx] = true;
+        lastShown[idx] = q;
+        lastValue[idx] = value;
 
-    void updateVoltage(float volt) {
-        if((currentPage != 0) || (abs(volt - lastVolt) < 0.5)) return;
-        lastVolt = volt;
-        
-        tft.setTextColor(TFT_YELLOW, TFT_BLACK);
-        tft.setTextDatum(TL_DATUM);
-        tft.fillRect(140, 240, 100, 25, TFT_BLACK);
-        tft.drawFloat(volt, 1, 140, 240, 4);
-    }
-    
-    // New Metrics
-    void updatePower(float kw) {
-        if(currentPage != 0) return;
-        tft.setTextColor(TFT_ORANGE, TFT_BLACK);
-        tft.setTextDatum(TL_DATUM);
-        tft.fillRect(20, 295, 60, 15, TFT_BLACK);
-        tft.drawFloat(kw, 1, 20, 295, 2);
+        int slot = fieldIndex(w.field);
+        TRACE_BEGIN(TR_WIDGET, slot);
+        uint16_t color = fieldColor[slot] ? fieldColor[slot] : w.color;
+
+        int atlasIdx = (w.cells > 0) ? atlas.find(w.font, color) : -1;
+        if(atlasIdx >= 0) {
+            drawCells(idx, w, atlasIdx, q, color);
+            TRACE_END(TR_WIDGET, 0);
+            if(latency) latency->onShown(slot, micros());
+            return;
+        }
+
+        int16_t x = w.x, y = w.y;
+        if(w.datum == MC_DATUM) {
+            x = w.x + w.w / 2;
+            y = w.y + w.h / 2;
+        }
+
+        cellsValid[idx] = false; // Cells drawn later must repaint the whole row
+        tft.setTextColor(color, TFT_BLACK);
+        tft.setTextDatum(w.datum);
+        tft.fillRect(w.x, w.y, w.w, w.h, TFT_BLACK);
+        if(w.decimals == 0) {
+            tft.drawNumber(q, x, y, w.font);
+        } else {
+            tft.drawFloat(value, w.decimals, x, y, w.font);
+        }
+        TRACE_END(TR_WIDGET, 0);
+        if(latency) latency->onShown(slot, micros());
     }
-    
-    void updateCurrent(float amps) {
-        if(currentPage != 0) return;
-        tft.setTextColor(TFT_MAGENTA, TFT_BLACK);
-        tft.setTextDatum(TL_DATUM);
-        tft.fillRect(100, 295, 60, 15, TFT_BLACK);
-        tft.drawFloat(amps, 0, 100, 295, 2);
+
+    // Back to the empty page layer; the next value draws in full
+    void clearWidget(int idx) {
+        const WidgetDef& w = PAGES[currentPage].widgets[idx];
+        tft.fillRect(w.x, w.y, w.w, w.h, TFT_BLACK);
+        widgetDrawn[idx] = false;
+        cellsValid[idx] = false;
     }
-    
-    void updateTemp(int temp) {
-        if(currentPage != 0) return;
-        tft.setTextColor(TFT_WHITE, TFT_BLACK);
-        tft.setTextDatum(TL_DATUM);
-        tft.fillRect(180, 295, 40, 15, TFT_BLACK);
-        tft.drawNumber(temp, 180, 295, 2);
+
+    // Atlas path: format into fixed cells and push only the ones that changed.
+    // The area under the cells is already black from the page layer.
+    void drawCells(int idx, const WidgetDef& w, int atlasIdx, int32_t q, uint16_t color) {
+        const GlyphAtlas::Atlas& a = atlas.get(atlasIdx);
+        int n = GlyphAtlas::cellCount(w);
+        char text[MAX_CELLS];
+        GlyphAtlas::format(q, w.decimals, w.cells, text);
+
+        int16_t x = w.x, y = w.y;
+        if(w.datum == MC_DATUM) {
+            x = w.x + (w.w - atlas.rowWidth(atlasIdx, w)) / 2;
+            y = w.y + (w.h - a.h) / 2;
+        }
+
+        // First draw on this page, or colour change: every cell
+        bool force = !cellsValid[idx] || shownColor[idx] != color;
+        cellsValid[idx] = true;
+        shownColor[idx] = color;
+        cellBlits += atlas.draw(tft, atlasIdx, x, y, text, shownCells[idx], n, force);
     }
-    
+
+public:
     void showButtonHelp() {
         tft.fillScreen(TFT_BLACK);
+        screenPage = -1;
         tft.setTextColor(TFT_WHITE, TFT_BLACK);
         tft.setTextDatum(MC_DATUM);
         
@@ -232,6 +350,9 @@ public:
         
         tft.setTextColor(TFT_CYAN);
         tft.drawString("Btn 3: Reconnect", 20, 200, 2);
+
+        tft.setTextColor(TFT_LIGHTGREY);
+        tft.drawString("Btn 1+2: USB stream", 20, 250, 2);
         
         tft.setTextColor(TFT_SILVER);
         tft.setTextDatum(BC_DATUM);
@@ -0,0 +1,211 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+
+// Binary event trace, for finding where a UI stutter comes from: BLE
+// callbacks, parsing, widget draws, SPI pushes or blocking waits.
+//
+// Build with -D TRACE_EVENTS=1; without it every TRACE_* macro compiles to
+// nothing. Each core records into its own ring of EVENT_RING_SIZE 8-byte
+// events (cycle counter, id and phase, one 16-bit argument), reserving its
+// slot with a single atomic add, so tasks and ISRs preempting each other on
+// a core never block or tear an event. The rings keep the latest events;
+// a dump (TraceDump.h) freezes them and prints them to Serial as
+// text lines, which tools/trace_chrome turns into Chrome / Perfetto trace
+// JSON.
+//
+// Portable: the rings and the dump line format run on the host
+// (test/test_events). Cycle counts are 32-bit, so consecutive events of a
+// core more than 2^31 cycles apart (~9 s at 240 MHz) are placed wrongly;
+// the counters stop in light sleep, so trace with the panel awake.
+
+#ifndef TRACE_EVENTS
+#define TRACE_EVENTS 0
+#endif
+
+#define EVENT_RING_SIZE     2048   // Per core, a power of two
+#define EVENT_CORES         2
+#define EVENT_DUMP_VERSION  1
+
+enum TraceId : uint16_t {
+    TR_NOTIFY = 1,  // Packet from the controller link (arg: length)
+    TR_PARSE,       // Protocol::parsePacket (arg: slot + 1, 0 = not a sample)
+    TR_WIDGET,      // One widget drawn (arg: slot)
+    TR_SPI,         // Pixels pushed to the panel (arg: pixels / 16)
+    TR_RENDER,      // DisplayManager::render() pass (arg: dirty slots)
+    TR_WAIT,        // loop() waiting for events
+    TR_DELAY,       // A blocking delay() (arg: ms)
+    TR_BUTTON,      // Input event (arg: type << 8 | buttons)
+    TR_LINK,        // Controller link down (arg 0) or up (1)
+    TR_STALL,       // loop() pass over the stall threshold (arg: ms)
+    TR_COUNT
+};
+
+inline const char* traceName(uint16_t id) {
+    static const char* const NAMES[TR_COUNT] = {
+        "?", "notify", "parse", "widget", "spi", "render", "wait", "delay", "button", "link", "stall",
+    };
+    return id < TR_COUNT ? NAMES[id] : "?";
+}
+
+enum TracePhase : uint8_t {
+    TRACE_BEGIN_PHASE,
+    TRACE_END_PHASE,
+    TRACE_INSTANT_PHASE,
+};
+
+struct TraceEvent {
+    uint32_t cycles;
+    uint16_t id;        // TraceId << 2 | TracePhase
+    uint16_t arg;
+
+    TraceId name() const { return (TraceId)(id >> 2); }
+    TracePhase phase() const { return (TracePhase)(id & 3); }
+};
+
+class EventTrace {
+public:
+    void record(int core, uint32_t cycles, TraceId id, TracePhase phase, uint16_t arg) {
+        if(!enabled.load(std::memory_order_relaxed)) return;
+        Ring& r = rings[core & (EVENT_CORES - 1)];
+        uint32_t i = r.head.fetch_add(1, std::memory_order_relaxed);
+        TraceEvent& e = r.events[i & (EVENT_RING_SIZE - 1)];
+        e.cycles = cycles;
+        e.id = (uint16_t)(id << 2 | phase);
+        e.arg = arg;
+    }
+
+    // Stop recording, e.g. for a dump; events already in flight may still land
+    void freeze() { enabled.store(false); }
+
+    // Empty the rings and record again
+    void restart() {
+        for(int c=0; c<EVENT_CORES; c++) rings[c].head.store(0);
+        enabled.store(true);
+    }
+
+    bool isEnabled() const { return enabled.load(); }
+
+    // Events of a core in the ring, oldest first
+    uint32_t count(int core) const {
+        uint32_t h = rings[core].head.load();
+        return h < EVENT_RING_SIZE ? h : EVENT_RING_SIZE;
+    }
+
+    // Recorded since restart(), overwritten ones included
+    uint32_t total(int core) const { return rings[core].head.load(); }
+
+    const TraceEvent& at(int core, uint32_t i) const {
+        uint32_t h = rings[core].head.load();
+        uint32_t first = h < EVENT_RING_SIZE ? 0 : h - EVENT_RING_SIZE;
+        return rings[core].events[(first + i) & (EVENT_RING_SIZE - 1)];
+    }
+
+private:
+    struct Ring {
+        std::atomic<uint32_t> head{0};
+        TraceEvent events[EVENT_RING_SIZE];
+    };
+
+    Ring rings[EVENT_CORES];
+    std::atomic<bool> enabled{true};
+};
+
+// Dump lines, one fact each, so debug prints interleaved on the same port
+// cost only the lines they break:
+//   TR H <version> <cpu MHz>           dump header
+//   TR S <core> <cycles> <us>          a core's cycle counter at esp_timer time us
+//   TR E <core> <cycles> <id> <arg>    one event, hex fields
+//   TR Z <core> <events> <total>       end of a core's events
+namespace tracedump {
+
+inline int header(char* out, size_t size, uint32_t mhz) {
+    return snprintf(out, size, "TR H %d %lu", EVENT_DUMP_VERSION, (unsigned long)mhz);
+}
+
+inline int sync(char* out, size_t size, int core, uint32_t cycles, uint64_t us) {
+    return snprintf(out, size, "TR S %d %08lx %llu", core, (unsigned long)cycles, (unsigned long long)us);
+}
+
+inline int event(char* out, size_t size, int core, const TraceEvent& e) {
+    return snprintf(out, size, "TR E %d %08lx %04x %04x", core, (unsigned long)e.cycles, e.id, e.arg);
+}
+
+inline int end(char* out, size_t size, int core, uint32_t events, uint32_t total) {
+    return snprintf(out, size, "TR Z %d %lu %lu", core, (unsigned long)events, (unsigned long)total);
+}
+
+struct Line {
+    char kind;          // 'H', 'S', 'E', 'Z'; 0 if not a dump line
+    int core;
+    uint32_t a;         // H: version, S/E: cycles, Z: events
+    uint64_t b;         // H: MHz, S: us, Z: total
+    TraceEvent event;
+};
+
+inline Line parse(const char* s) {
+    Line l = {};
+    const char* p = strstr(s, "TR ");
+    if(!p) return l;
+    char kind = p[3];
+    unsigned long a = 0, id = 0, arg = 0;
+    unsigned long long b = 0;
+    int core = 0;
+    switch(kind) {
+        case 'H':
+            if(sscanf(p + 4, "%lu %llu", &a, &b) != 2) return l;
+            break;
+        case 'S':
+            if(sscanf(p + 4, "%d %lx %llu", &core, &a, &b) != 3) return l;
+            break;
+        case 'E':
+            if(sscanf(p + 4, "%d %lx %lx %lx", &core, &a, &id, &arg) != 4) return l;
+            l.event.cycles = a;
+            l.event.id = id;
+            l.event.arg = arg;
+            break;
+        case 'Z':
+            if(sscanf(p + 4, "%d %lu %llu", &core, &a, &b) != 3) return l;
+            break;
+        default:
+            return l;
+    }
+    if(core < 0 || core >= EVENT_CORES) return l;
+    l.kind = kind;
+    l.core = core;
+    l.a = a;
+    l.b = b;
+    return l;
+}
+
+} // namespace tracedump
+
+#if TRACE_EVENTS
+#if defined(ARDUINO_ARCH_ESP32)
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+inline uint32_t traceCycles() { return ESP.getCycleCount(); }
+inline int traceCore() { return xPortGetCoreID(); }
+#else
+#include <chrono>
+inline uint32_t traceCycles() {  // Host: nanoseconds, a 1000 MHz "CPU"
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+inline int traceCore() { return 0; }
+#endif
+
+extern EventTrace eventTrace;
+
+#define TRACE_BEGIN(id, arg)   eventTrace.record(traceCore(), traceCycles(), id, TRACE_BEGIN_PHASE, arg)
+#define TRACE_END(id, arg)     eventTrace.record(traceCore(), traceCycles(), id, TRACE_END_PHASE, arg)
+#define TRACE_INSTANT(id, arg) eventTrace.record(traceCore(), traceCycles(), id, TRACE_INSTANT_PHASE, arg)
+#else
+#define TRACE_BEGIN(id, arg)   ((void)0)
+#define TRACE_END(id, arg)     ((void)0)
+#define TRACE_INSTANT(id, arg) ((void)0)
+#endif
@@ -0,0 +1,55 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+// Events consumed by loop(). Inputs (buttons, touch) post gesture events,
+// the BLE callback posts a coalesced EV_DATA when the vehicle state changes.
+enum AppEventType : uint8_t {
+    EV_DATA,          // Vehicle state has dirty slots
+    EV_PRESS,         // Button pressed alone (buttons = one bit), see Input.h
+    EV_RELEASE,       // Button released
+    EV_LONG_PRESS,    // Button held for LONG_PRESS_MS
+    EV_DOUBLE_PRESS,  // Second press within DOUBLE_PRESS_MS of a release
+    EV_CHORD,         // Buttons pressed together, on the first release (buttons = mask)
+    EV_TAP,           // Touch gestures (buttons = BTN_TOUCH)
+    EV_SWIPE_LEFT,
+    EV_SWIPE_RIGHT,
+};
+
+struct AppEvent {
+    AppEventType type;
+    uint8_t buttons;  // BTN_* mask
+    int64_t edgeUs;   // esp_timer time of the originating GPIO edge
+};
+
+class EventQueue {
+public:
+    void init(size_t depth = 32) {
+        queue = xQueueCreate(depth, sizeof(AppEvent));
+    }
+
+    // Non-blocking; drops the event if the queue is full
+    bool post(const AppEvent& ev) {
+        return xQueueSend(queue, &ev, 0) == pdTRUE;
+    }
+
+    // At most one EV_DATA is queued at a time, however fast samples arrive
+    void notifyData() {
+        if(dataPending.exchange(true)) return;
+        AppEvent ev = {EV_DATA, 0, 0};
+        if(!post(ev)) dataPending = false;
+    }
+
+    // Block until an event arrives or `timeout` expires
+    bool wait(AppEvent& ev, TickType_t timeout) {
+        if(xQueueReceive(queue, &ev, timeout) != pdTRUE) return false;
+        if(ev.type == EV_DATA) dataPending = false;
+        return true;
+    }
+
+private:
+    QueueHandle_t queue = nullptr;
+    std::atomic<bool> dataPending{false};
+};
@@ -0,0 +1,184 @@
+#pragma once
+#include <TFT_eSPI.h>
+#include "Layout.h"
+#include "Rules.h"
+#include "EventTrace.h"
+
+// Pre-rendered digit atlases for numeric widgets.
+// For every (font, colour) pair used by a widget with cells > 0, the glyphs
+// 0-9 '.' '-' and blank are rasterised once at boot. Values are formatted with
+// integer fixed-point arithmetic into fixed character cells, and only cells
+// whose character changed are pushed to the panel.
+//
+// Digits, '-' and blank share one (tabular) cell width; '.' has its own
+// narrower cell. Because the decimal point always sits at the same position
+// for a widget, every cell keeps a fixed x position.
+
+#define MAX_ATLASES 12
+#define MAX_CELLS   8
+#define NUM_GLYPHS  13 // 0-9 . - blank
+
+class GlyphAtlas {
+public:
+    struct Atlas {
+        uint8_t font;
+        uint16_t color;
+        int16_t digitW;
+        int16_t dotW;
+        int16_t h;
+        uint16_t* pixels;                 // Glyphs back to back, sprite byte order
+        uint32_t offset[NUM_GLYPHS];      // Start of each glyph in pixels
+    };
+
+    // Build an atlas for every font/colour pair referenced by PAGES, and for
+    // the colours the built-in rules give their fields. Colours from other
+    // rule sets fall back to text rendering.
+    void build(TFT_eSPI& tft) {
+        for(int p=0; p<NUM_PAGES; p++) {
+            for(int i=0; i<PAGES[p].numWidgets; i++) {
+                const WidgetDef& w = PAGES[p].widgets[i];
+                if(w.cells == 0) continue;
+                add(tft, w.font, w.color);
+                for(int r=0; r<NUM_DEFAULT_RULES; r++) {
+                    const Rule& rule = DEFAULT_RULES[r];
+                    if(rule.field == w.field && (rule.actions & RULE_COLOR)) add(tft, w.font, rule.color);
+                }
+            }
+        }
+    }
+
+    // Index of the atlas for font/colour, -1 if none
+    int find(uint8_t font, uint16_t color) const {
+        for(int i=0; i<count; i++) {
+            if(atlases[i].font == font && atlases[i].color == color) return i;
+        }
+        return -1;
+    }
+
+    const Atlas& get(int idx) const { return atlases[idx]; }
+
+    // Number of cells for a widget: integer cells, plus point and decimals
+    static int cellCount(const WidgetDef& w) {
+        return w.cells + (w.decimals ? w.decimals + 1 : 0);
+    }
+
+    // Total width in pixels of a widget's cell row
+    int rowWidth(int idx, const WidgetDef& w) const {
+        const Atlas& a = atlases[idx];
+        return w.cells * a.digitW + (w.decimals ? w.decimals * a.digitW + a.dotW : 0);
+    }
+
+    // Fixed-point formatter. `q` is the value scaled by 10^decimals. Writes
+    // cellCount() characters, right aligned and blank padded. On overflow every
+    // digit cell shows '-'.
+    static void format(int32_t q, uint8_t decimals, uint8_t intCells, char* out) {
+        int n = intCells + (decimals ? decimals + 1 : 0);
+        bool neg = q < 0;
+        uint32_t mag = neg ? (uint32_t)(-(int64_t)q) : (uint32_t)q;
+        int pos = n - 1;
+
+        for(int d=0; d<decimals; d++) {
+            out[pos--] = '0' + (mag % 10);
+            mag /= 10;
+        }
+        if(decimals) out[pos--] = '.';
+
+        // At least one integer digit ("0.5")
+        bool overflow = false;
+        do {
+            if(pos < 0) { overflow = true; break; }
+            out[pos--] = '0' + (mag % 10);
+            mag /= 10;
+        } while(mag > 0);
+
+        if(!overflow && neg) {
+            if(pos < 0) overflow = true;
+            else out[pos--] = '-';
+        }
+
+        if(overflow) {
+            for(int i=0; i<n; i++) {
+                if(out[i] != '.') out[i] = '-';
+            }
+            return;
+        }
+        while(pos >= 0) out[pos--] = ' ';
+    }
+
+    // Push the cells of `text` that differ from `last` (all when force), then
+    // remember them. Returns the number of cells blitted.
+    int draw(TFT_eSPI& tft, int idx, int16_t x, int16_t y, const char* text,
+             char* last, int n, bool force) const {
+        const Atlas& a = atlases[idx];
+        int blits = 0;
+        for(int i=0; i<n; i++) {
+            int16_t w = (text[i] == '.') ? a.dotW : a.digitW;
+            if(force || text[i] != last[i]) {
+                TRACE_BEGIN(TR_SPI, w * a.h / 16);
+                tft.pushImage(x, y, w, a.h, a.pixels + a.offset[glyphIndex(text[i])]);
+                TRACE_END(TR_SPI, 0);
+                last[i] = text[i];
+                blits++;
+            }
+            x += w;
+        }
+        return blits;
+    }
+
+private:
+    Atlas atlases[MAX_ATLASES] = {};
+    int count = 0;
+
+    static int glyphIndex(char c) {
+        if(c >= '0' && c <= '9') return c - '0';
+        if(c == '.') return 10;
+        if(c == '-') return 11;
+        return 12;
+    }
+
+    void add(TFT_eSPI& tft, uint8_t font, uint16_t color) {
+        if(find(font, color) >= 0 || count >= MAX_ATLASES) return;
+
+        Atlas& a = atlases[count];
+        a.font = font;
+        a.color = color;
+        a.h = tft.fontHeight(font);
+        a.digitW = tft.textWidth("-", font);
+        for(char c='0'; c<='9'; c++) {
+            char s[2] = {c, 0};
+            int16_t w = tft.textWidth(s, font);
+            if(w > a.digitW) a.digitW = w;
+        }
+        a.dotW = tft.textWidth(".", font);
+
+        uint32_t total = (uint32_t)(NUM_GLYPHS - 1) * a.digitW * a.h + (uint32_t)a.dotW * a.h;
+        a.pixels = (uint16_t*)(psramFound() ? ps_malloc(total * 2) : malloc(total * 2));
+        if(!a.pixels) return;
+
+        // Rasterise each glyph once into a scratch sprite and keep its pixels
+        TFT_eSprite glyph(&tft);
+        glyph.setColorDepth(16);
+        uint32_t offset = 0;
+        const char chars[NUM_GLYPHS] = {'0','1','2','3','4','5','6','7','8','9','.','-',' '};
+        for(int g=0; g<NUM_GLYPHS; g++) {
+            int16_t w = (chars[g] == '.') ? a.dotW : a.digitW;
+            if(!glyph.createSprite(w, a.h)) {
+                free(a.pixels);
+                a.pixels = nullptr;
+                return;
+            }
+            glyph.fillSprite(TFT_BLACK);
+            if(chars[g] != ' ') {
+                char s[2] = {chars[g], 0};
+                glyph.setTextColor(color, TFT_BLACK);
+                glyph.setTextDatum(TC_DATUM);
+                glyph.drawString(s, w / 2, 0, font);
+            }
+            memcpy(a.pixels + offset, glyph.getPointer(), (size_t)w * a.h * 2);
+            a.offset[g] = offset;
+            offset += (uint32_t)w * a.h;
+            glyph.deleteSprite();
+        }
+        count++;
+    }
+};
@@ -0,0 +1,84 @@
+#pragma once
+#include <TFT_eSPI.h>
+#include <math.h>
+#include "Layout.h"
+#include "OperatingMap.h"
+#include "EventTrace.h"
+
+#define HEATMAP_REFRESH_MS 1000
+
+// Heatmap of an OperatingMap: RPM left to right, power bottom to top.
+// Cell colour is a log scale of its time relative to the busiest cell, so
+// rarely visited corners stay visible next to the cruise point. Only cells
+// whose colour changed are redrawn on refresh.
+//
+// The map is read without a lock while the notify callback updates it:
+// counters are aligned 32-bit words, so a refresh may be one sample behind
+// but never sees a torn value.
+class HeatmapView {
+public:
+    void begin(TFT_eSPI& tft, const HeatmapDef* def, const OperatingMap* src) {
+        heat = def;
+        map = src;
+        for(int i=0; i<CELLS; i++) shown[i] = 0xFF;
+        draw(tft);
+        lastRefresh = millis();
+    }
+
+    void end() { heat = nullptr; }
+
+    bool active() const { return heat != nullptr; }
+
+    // From loop(), rate limited
+    void refresh(TFT_eSPI& tft) {
+        if(!heat || millis() - lastRefresh < HEATMAP_REFRESH_MS) return;
+        lastRefresh = millis();
+        draw(tft);
+    }
+
+private:
+    static const int CELLS = OPMAP_RPM_BINS * OPMAP_PWR_BINS;
+    static const int LEVELS = 8;
+
+    const HeatmapDef* heat = nullptr;
+    const OperatingMap* map = nullptr;
+    uint8_t shown[CELLS];   // Level on screen per cell, 0xFF = not drawn
+    uint32_t lastRefresh = 0;
+
+    static uint16_t levelColor(int level) {
+        static const uint16_t RAMP[LEVELS] = {
+            TFT_BLACK, TFT_NAVY, TFT_BLUE, TFT_CYAN, TFT_GREEN, TFT_YELLOW, TFT_ORANGE, TFT_RED,
+        };
+        return RAMP[level];
+    }
+
+    void draw(TFT_eSPI& tft) {
+        const OperatingTotals& t = map->get();
+        uint32_t peak = 0;
+        for(int p=0; p<OPMAP_PWR_BINS; p++) {
+            for(int r=0; r<OPMAP_RPM_BINS; r++) {
+                if(t.cells[p][r] > peak) peak = t.cells[p][r];
+            }
+        }
+        float scale = peak > 0 ? (LEVELS - 1 - 0.001f) / log1pf((float)peak) : 0;
+
+        int cw = heat->w / OPMAP_RPM_BINS, ch = heat->h / OPMAP_PWR_BINS;
+        TRACE_BEGIN(TR_SPI, 0);
+        tft.startWrite();
+        for(int p=0; p<OPMAP_PWR_BINS; p++) {
+            for(int r=0; r<OPMAP_RPM_BINS; r++) {
+                uint32_t v = t.cells[p][r];
+                uint8_t level = v ? 1 + (uint8_t)(log1pf((float)v) * scale) : 0;
+                if(level >= LEVELS) level = LEVELS - 1;
+                int i = p * OPMAP_RPM_BINS + r;
+                if(shown[i] == level) continue;
+                shown[i] = level;
+                // Power bin 0 at the bottom; 1 px gap between cells
+                int y = heat->y + (OPMAP_PWR_BINS - 1 - p) * ch;
+                tft.fillRect(heat->x + r * cw, y, cw - 1, ch - 1, levelColor(level));
+            }
+        }
+        tft.endWrite();
+        TRACE_END(TR_SPI, 0);
+    }
+};
@@ -0,0 +1,67 @@
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+#include "VehicleState.h"
+
+// Fixed-size ring buffer. N must be a power of two.
+template<typename T, size_t N>
+class RingBuffer {
+    static_assert((N & (N - 1)) == 0, "RingBuffer size must be a power of two");
+public:
+    void push(const T& v) {
+        data[head & (N - 1)] = v;
+        head++;
+    }
+
+    size_t size() const { return head < N ? head : N; }
+    static constexpr size_t capacity() { return N; }
+
+    // i = 0 is the oldest retained element
+    const T& at(size_t i) const {
+        return data[(head - size() + i) & (N - 1)];
+    }
+
+    // i = 0 is the newest element
+    const T& back(size_t i = 0) const {
+        return data[(head - 1 - i) & (N - 1)];
+    }
+
+    void clear() { head = 0; }
+
+private:
+    T data[N] = {};
+    size_t head = 0;
+};
+
+// Sample every HISTORY_PERIOD_MS; HISTORY_LEN samples per field
+#define HISTORY_PERIOD_MS 250
+#define HISTORY_LEN       256
+
+// Per-field history of the vehicle state at a fixed sample period.
+// Fields with no value yet are stored as NAN.
+class History {
+public:
+    // Take a sample if the period elapsed. Returns true when one was taken.
+    bool sample(const VehicleState& state, unsigned long now) {
+        if(count > 0 && now - lastSample < HISTORY_PERIOD_MS) return false;
+        lastSample = now;
+        count++;
+
+        for(int i=0; i<NUM_FIELDS; i++) {
+            fields[i].push(state.isValid(i) ? state.value(i) : NAN);
+        }
+        return true;
+    }
+
+    const RingBuffer<float, HISTORY_LEN>& field(int slot) const {
+        return fields[slot];
+    }
+
+    uint32_t samples() const { return count; }
+    unsigned long lastSampleTime() const { return lastSample; }
+
+private:
+    RingBuffer<float, HISTORY_LEN> fields[NUM_FIELDS];
+    unsigned long lastSample = 0;
+    uint32_t count = 0;
+};
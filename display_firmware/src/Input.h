@@ -1,65 +1,238 @@
 #pragma once
 #include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <freertos/timers.h>
+#include "Config.h"
+#include "Events.h"
 
-class Button {
-private:
-    uint8_t pin;
-    bool lastState = false;
-    unsigned long lastDebounceTime = 0;
-    unsigned long debounceDelay = 50;
+#define DEBOUNCE_MS      20
+#define LONG_PRESS_MS    800
+#define DOUBLE_PRESS_MS  350
+#define CHORD_WINDOW_MS  60     // Presses this close together start a chord
+#define NUM_BUTTONS      3
 
+// Interrupt-driven buttons.
+// A CHANGE interrupt on each pin reports the first edge of a bounce burst
+// immediately (leading-edge debounce) and locks that pin for DEBOUNCE_MS with
+// a FreeRTOS timer. When the lock expires the pin is sampled once more, so a
+// release that happened inside the lockout is not lost.
+// Raw edges go to a small input task which turns them into press, release,
+// long-press, double-press and chord events on the application EventQueue.
+//
+// A press is held back for CHORD_WINDOW_MS: if another button goes down
+// within it, the buttons form a chord and none of them reports a press,
+// release or long press. Buttons pressed while a chord is held join it, and
+// the chord is reported once, with all its buttons, when the first of them
+// is released, so a three-button chord never passes through a two-button
+// one. A button pressed after the window while another is held is a press
+// of its own.
+class ButtonInput {
 public:
-    Button(uint8_t p) : pin(p) {}
+    void init(EventQueue* out) {
+        events = out;
+        rawQueue = xQueueCreate(16, sizeof(RawEdge));
+
+        for(int i=0; i<NUM_BUTTONS; i++) {
+            // High Level Output module -> Active High
+            // Use PULLDOWN to keep it LOW when not pressed
+            pinMode(PINS[i], INPUT_PULLDOWN);
+            stable[i] = digitalRead(PINS[i]);
+            debounce[i] = xTimerCreate("debounce", pdMS_TO_TICKS(DEBOUNCE_MS), pdFALSE,
+                                       (void*)(intptr_t)i, debounceExpired);
+        }
 
-    void init() {
-        // High Level Output module -> Active High
-        // Use PULLDOWN to keep it LOW when not pressed
-        pinMode(pin, INPUT_PULLDOWN);
+        xTaskCreatePinnedToCore(inputTask, "input", 3072, this, 5, &task, 1);
+
+        for(int i=0; i<NUM_BUTTONS; i++) {
+            attachInterruptArg(digitalPinToInterrupt(PINS[i]), edgeIsr, (void*)(intptr_t)i, CHANGE);
+        }
     }
 
-    // Returns true only on Rising Edge (Press)
-    bool isPressed() {
-        int reading = digitalRead(pin);
-        bool pressed = false;
+    // Buttons currently held (BTN_* mask)
+    uint8_t held() const { return heldMask; }
+
+    static ButtonInput* instance;
+    ButtonInput() { instance = this; }
+
+private:
+    static constexpr uint8_t PINS[NUM_BUTTONS] = {PIN_BTN_VIEW, PIN_BTN_BRIGHT, PIN_BTN_RECONNECT};
+
+    struct RawEdge {
+        uint8_t button;
+        uint8_t level;
+        int64_t us;
+    };
+
+    EventQueue* events = nullptr;
+    QueueHandle_t rawQueue = nullptr;
+    TaskHandle_t task = nullptr;
+    TimerHandle_t debounce[NUM_BUTTONS] = {};
+    volatile bool locked[NUM_BUTTONS] = {};
+
+    // Owned by the input task
+    uint8_t stable[NUM_BUTTONS] = {};
+    uint8_t heldMask = 0;
+    uint8_t pendingMask = 0;               // Pressed inside the chord window, not reported yet
+    int64_t windowUs = 0;                  // Start of the chord window
+    uint8_t chordMask = 0;                 // Buttons consumed by an active chord
+    bool chordSent = false;                // Chord reported, members still held
+    int64_t pressUs[NUM_BUTTONS] = {};
+    int64_t releaseUs[NUM_BUTTONS] = {};
+    bool longFired[NUM_BUTTONS] = {};
 
-        if (reading != lastState) {
-            lastDebounceTime = millis();
+    static void IRAM_ATTR edgeIsr(void* arg) {
+        int i = (intptr_t)arg;
+        ButtonInput* self = instance;
+        if(self->locked[i]) return;
+        self->locked[i] = true;
+
+        RawEdge edge = {(uint8_t)i, (uint8_t)digitalRead(PINS[i]), esp_timer_get_time()};
+        BaseType_t woken = pdFALSE;
+        xQueueSendFromISR(self->rawQueue, &edge, &woken);
+        xTimerResetFromISR(self->debounce[i], &woken);
+        if(woken) portYIELD_FROM_ISR();
+    }
+
+    // Timer service task: lockout over, catch any transition that happened inside it.
+    // Unlocked before the read, so an edge after it reaches edgeIsr and re-arms
+    // this timer; onEdge() drops a re-sample at the level it already has.
+    static void debounceExpired(TimerHandle_t timer) {
+        int i = (intptr_t)pvTimerGetTimerID(timer);
+        ButtonInput* self = instance;
+        self->locked[i] = false;
+        RawEdge edge = {(uint8_t)i, (uint8_t)digitalRead(PINS[i]), esp_timer_get_time()};
+        xQueueSend(self->rawQueue, &edge, 0);
+    }
+
+    static void inputTask(void* arg) {
+        ButtonInput* self = (ButtonInput*)arg;
+        for(;;) {
+            RawEdge edge;
+            if(xQueueReceive(self->rawQueue, &edge, self->ticksToDeadline()) == pdTRUE) {
+                self->onEdge(edge);
+            }
+            self->checkTimers();
         }
+    }
+
+    void emit(AppEventType type, uint8_t buttons, int64_t edgeUs) {
+        AppEvent ev = {type, buttons, edgeUs};
+        events->post(ev);
+    }
+
+    void onEdge(const RawEdge& edge) {
+        int i = edge.button;
+        if(edge.level == stable[i]) return; // Bounce or re-sample with no change
+        stable[i] = edge.level;
+        uint8_t bit = 1 << i;
 
-        if ((millis() - lastDebounceTime) > debounceDelay) {
-            // Whatever the reading is at, it's been there for longer than the debounce delay,
-            // so take it as the actual current state:
-            // But we store 'state' implicitly.
-            
-            // Actually, simplified debounce for rising edge:
-            // If stable HIGH and previously was LOW (tracked externally or simple check?)
-            // Let's implement simple state tracking inside logic:
-             return false; // Handled below in update() pattern if needed, but for simple poling:
+        if(edge.level == HIGH) {
+            heldMask |= bit;
+            pressUs[i] = edge.us;
+            longFired[i] = false;
+
+            if(chordSent) {
+                // Reported chord still partly held: this press is a new one
+                chordMask &= ~bit;
+                if(!(heldMask & chordMask)) {
+                    chordMask = 0;
+                    chordSent = false;
+                }
+            }
+            if(chordMask && !chordSent) {
+                chordMask |= bit;   // Joins the chord being held
+            } else if(pendingMask) {
+                chordMask = pendingMask | bit;
+                pendingMask = 0;
+            } else {
+                pendingMask = bit;
+                windowUs = edge.us;
+            }
+        } else {
+            heldMask &= ~bit;
+            if(chordMask & bit) {
+                // Chord members produce no individual release
+                if(!chordSent) emit(EV_CHORD, chordMask, edge.us);
+                chordSent = true;
+                if(!(heldMask & chordMask)) {
+                    chordMask = 0;
+                    chordSent = false;
+                }
+                return;
+            }
+            if(pendingMask & bit) flushPress(); // A tap shorter than the window
+            emit(EV_RELEASE, bit, edge.us);
+            releaseUs[i] = longFired[i] ? 0 : edge.us;
         }
-        
-        lastState = reading;
-        return false;
     }
-    
-    // Simple stateful check helper
-    bool state = false;
-    bool checkPressed() {
-        bool reading = digitalRead(pin); // HIGH = Pressed
-        bool result = false;
-
-        if (reading != lastState) {
-            lastDebounceTime = millis();
+
+    // The chord window closed on a single button: report its press
+    void flushPress() {
+        int i = __builtin_ctz(pendingMask);
+        uint8_t bit = pendingMask;
+        pendingMask = 0;
+        emit(EV_PRESS, bit, pressUs[i]);
+        if(releaseUs[i] && pressUs[i] - releaseUs[i] < DOUBLE_PRESS_MS * 1000LL) {
+            emit(EV_DOUBLE_PRESS, bit, pressUs[i]);
+            releaseUs[i] = 0; // A third press starts a new pair
         }
+    }
 
-        if ((millis() - lastDebounceTime) > debounceDelay) {
-            if (reading != state) {
-                state = reading;
-                if (state == HIGH) {
-                    result = true;
-                }
+    // Ticks until the chord window closes or the earliest long press, or forever
+    TickType_t ticksToDeadline() const {
+        int64_t now = esp_timer_get_time();
+        int64_t wait = -1;
+        if(pendingMask) {
+            wait = windowUs + CHORD_WINDOW_MS * 1000LL - now;
+            if(wait < 0) wait = 0;
+        }
+        for(int i=0; i<NUM_BUTTONS; i++) {
+            if(!(heldMask & (1 << i)) || longFired[i] || (chordMask & (1 << i))) continue;
+            int64_t left = pressUs[i] + LONG_PRESS_MS * 1000LL - now;
+            if(left < 0) left = 0;
+            if(wait < 0 || left < wait) wait = left;
+        }
+        if(wait < 0) return portMAX_DELAY;
+        return pdMS_TO_TICKS(wait / 1000) + 1;
+    }
+
+    void checkTimers() {
+        int64_t now = esp_timer_get_time();
+        if(pendingMask && now - windowUs >= CHORD_WINDOW_MS * 1000LL) flushPress();
+        for(int i=0; i<NUM_BUTTONS; i++) {
+            if(!(heldMask & (1 << i)) || longFired[i] || (chordMask & (1 << i)) || (pendingMask & (1 << i))) continue;
+            if(now - pressUs[i] >= LONG_PRESS_MS * 1000LL) {
+                longFired[i] = true;
+                emit(EV_LONG_PRESS, 1 << i, pressUs[i]);
             }
         }
-        lastState = reading;
-        return result;
     }
 };
+
+constexpr uint8_t ButtonInput::PINS[NUM_BUTTONS];
+ButtonInput* ButtonInput::instance = nullptr;
+
+// Print each handled input's latency to Serial (-D INPUT_LATENCY_LOG=1)
+#ifndef INPUT_LATENCY_LOG
+#define INPUT_LATENCY_LOG 0
+#endif
+
+// Edge-to-handler latency of input events, in microseconds
+struct InputLatency {
+    uint32_t count = 0;
+    int64_t last = 0;
+    int64_t max = 0;
+    int64_t total = 0;
+
+    void record(int64_t edgeUs) {
+        last = esp_timer_get_time() - edgeUs;
+        if(last > max) max = last;
+        total += last;
+        count++;
+    }
+
+    int64_t average() const { return count ? total / count : 0; }
+};
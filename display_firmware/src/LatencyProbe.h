@@ -0,0 +1,117 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include "Config.h"
+
+#ifndef LATENCY_PROBE
+#define LATENCY_PROBE 0
+#endif
+
+#define LATENCY_BINS  80    // 4 per octave from 8 us: up to ~2 s
+
+// Latency histogram with bins a quarter octave wide, so a percentile is
+// within 25% of the true value at any scale. Max is exact.
+struct LatencyHistogram {
+    uint32_t bins[LATENCY_BINS] = {};
+    uint32_t count = 0;
+    uint32_t maxUs = 0;
+
+    // Bins 0-7 are 1 us wide; from 8 us on, each octave has four
+    static int binOf(uint32_t us) {
+        if(us < 8) return us;
+        int octave = 31 - __builtin_clz(us);
+        int bin = 8 + (octave - 3) * 4 + ((us >> (octave - 2)) & 3);
+        return bin < LATENCY_BINS ? bin : LATENCY_BINS - 1;
+    }
+
+    static uint32_t lowerUs(int bin) {
+        if(bin < 8) return bin;
+        int octave = 3 + (bin - 8) / 4;
+        return (uint32_t)(4 + (bin - 8) % 4) << (octave - 2);
+    }
+
+    void add(uint32_t us) {
+        bins[binOf(us)]++;
+        count++;
+        if(us > maxUs) maxUs = us;
+    }
+
+    // Upper edge of the bin holding the p-th sample (p in 0..1), at most max
+    uint32_t percentile(float p) const {
+        if(!count) return 0;
+        uint32_t rank = (uint32_t)(p * count + 0.999f);
+        if(rank < 1) rank = 1;
+        uint32_t seen = 0;
+        for(int b=0; b<LATENCY_BINS; b++) {
+            seen += bins[b];
+            if(seen >= rank) {
+                uint32_t upper = b + 1 < LATENCY_BINS ? lowerUs(b + 1) - 1 : maxUs;
+                return upper < maxUs ? upper : maxUs;
+            }
+        }
+        return maxUs;
+    }
+};
+
+// Notification-to-pixel latency per wire field: from the notify carrying a
+// sample to the end of the SPI transfer that put its widget on the panel.
+// Portable (test/test_latency); the firmware builds it with -D LATENCY_PROBE=1.
+//
+// tag() runs in the link's context as samples arrive and keeps the arrival
+// time of the latest one per slot. render() takes the tags of the dirty
+// slots at the start of a pass (beginPass), each widget drawn for one of
+// them adds a latency (onShown), and the rest are dropped at the end of the
+// pass (endPass): values that did not change on screen, or fields not on
+// the current page. A slot whose samples arrive faster than passes run is
+// measured from its latest sample, the one whose value is drawn.
+//
+// Widgets push their pixels with blocking SPI writes, so the transfer is
+// complete when drawWidget() returns. For a scope, `edge` is called with
+// true when a sample of `probeSlot` arrives and false once it is shown or
+// dropped; the pulse then spans the first arrival since the last draw.
+class LatencyProbe {
+public:
+    LatencyHistogram fields[NUM_FIELDS];
+    uint32_t dropped = 0;       // Tags taken by a pass but not drawn
+
+    int probeSlot = -1;
+    void (*edge)(bool high) = nullptr;
+
+    // Link context: a sample of `slot` arrived at `us`
+    void tag(int slot, uint32_t us) {
+        if(slot < 0 || slot >= NUM_FIELDS) return;
+        arrival[slot].store(us ? us : 1, std::memory_order_relaxed);
+        if(slot == probeSlot && edge) edge(true);
+    }
+
+    void beginPass(uint32_t dirty) {
+        for(int s=0; s<NUM_FIELDS; s++) {
+            pending[s] = (dirty & (1UL << s)) ? arrival[s].exchange(0, std::memory_order_relaxed) : 0;
+        }
+    }
+
+    void onShown(int slot, uint32_t us) {
+        if(slot < 0 || slot >= NUM_FIELDS || !pending[slot]) return;
+        fields[slot].add(us - pending[slot]);
+        pending[slot] = 0;
+        if(slot == probeSlot && edge) edge(false);
+    }
+
+    void endPass() {
+        for(int s=0; s<NUM_FIELDS; s++) {
+            if(!pending[s]) continue;
+            pending[s] = 0;
+            dropped++;
+            if(s == probeSlot && edge) edge(false);
+        }
+    }
+
+    void reset() {
+        for(int s=0; s<NUM_FIELDS; s++) fields[s] = LatencyHistogram();
+        dropped = 0;
+    }
+
+private:
+    std::atomic<uint32_t> arrival[NUM_FIELDS] = {};
+    uint32_t pending[NUM_FIELDS] = {};
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include <Arduino.h>
+#include "Display.h"
+#include "LatencyProbe.h"
+#include "Protocol.h"
+
+#define LATENCY_REPORT_MS  10000
+
+// Scope pin: high when a sample of LATENCY_PROBE_SLOT arrives, low once its
+// widget is on the panel (LatencyProbe.h). -1 = no pin.
+#ifndef LATENCY_PROBE_PIN
+#define LATENCY_PROBE_PIN  -1
+#endif
+#ifndef LATENCY_PROBE_SLOT
+#define LATENCY_PROBE_SLOT 0        // Speed
+#endif
+
+// Notify-to-pixel latency measurement, built with -D LATENCY_PROBE=1: feeds
+// the probe from the session callbacks, shows it on the Latency page and
+// prints it to Serial every LATENCY_REPORT_MS. Figures are since boot; a
+// long press of VIEW on the Latency page clears them.
+class LatencyService {
+public:
+    void init(DisplayManager* display) {
+        display->attachLatency(&probe);
+#if LATENCY_PROBE_PIN >= 0
+        pinMode(LATENCY_PROBE_PIN, OUTPUT);
+        digitalWrite(LATENCY_PROBE_PIN, LOW);
+        probe.probeSlot = LATENCY_PROBE_SLOT;
+        probe.edge = [](bool high) { digitalWrite(LATENCY_PROBE_PIN, high ? HIGH : LOW); };
+#endif
+    }
+
+    // Link context, before parsing: the notify arrived
+    void onPacket() { packetUs = micros(); }
+
+    // Link context: the sample it carried
+    void onSample(const Protocol::ParsedData& data) { probe.tag(data.slot, packetUs); }
+
+    void reset() {
+        probe.reset();
+        Serial.println("Latency: cleared");
+    }
+
+    // From loop()
+    void service() {
+        if(millis() - lastReport < LATENCY_REPORT_MS) return;
+        lastReport = millis();
+        Serial.printf("Latency notify to pixel, ms (%lu unchanged):\n", (unsigned long)probe.dropped);
+        for(int s=0; s<NUM_FIELDS; s++) {
+            const LatencyHistogram& h = probe.fields[s];
+            if(!h.count) continue;
+            char p50[12], p99[12], max[12];
+            LatencyView::formatMs(p50, sizeof(p50), h.percentile(0.5f), true);
+            LatencyView::formatMs(p99, sizeof(p99), h.percentile(0.99f), true);
+            LatencyView::formatMs(max, sizeof(max), h.maxUs, true);
+            Serial.printf("  %-8s %7lu x  p50 %6s  p99 %6s  max %6s\n", fieldName(s), (unsigned long)h.count, p50,
+                          p99, max);
+        }
+    }
+
+private:
+    LatencyProbe probe;
+    volatile uint32_t packetUs = 0;
+    uint32_t lastReport = 0;
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include <TFT_eSPI.h>
+#include <stdio.h>
+#include <string.h>
+#include "Layout.h"
+#include "LatencyProbe.h"
+
+#define LATENCY_REFRESH_MS 1000
+
+// Table of a LatencyProbe: p50, p99 and max per wire field, in ms. Rows
+// whose text changed are redrawn on refresh, so the table itself adds little
+// SPI traffic to what it measures.
+class LatencyView {
+public:
+    void begin(TFT_eSPI& tft, const LatencyDef* def, const LatencyProbe* src) {
+        table = def;
+        probe = src;
+        for(int i=0; i<ROWS; i++) shown[i][0] = 0;
+        draw(tft);
+        lastRefresh = millis();
+    }
+
+    void end() { table = nullptr; }
+
+    bool active() const { return table != nullptr; }
+
+    // From loop(), rate limited
+    void refresh(TFT_eSPI& tft) {
+        if(!table || millis() - lastRefresh < LATENCY_REFRESH_MS) return;
+        lastRefresh = millis();
+        draw(tft);
+    }
+
+    // "12.3" for 12345 us, "-" for no samples
+    static void formatMs(char* out, size_t size, uint32_t us, bool any) {
+        if(!any) snprintf(out, size, "-");
+        else snprintf(out, size, "%lu.%lu", (unsigned long)(us / 1000), (unsigned long)(us % 1000 / 100));
+    }
+
+private:
+    static const int ROWS = LATENCY_ROWS;
+
+    const LatencyDef* table = nullptr;
+    const LatencyProbe* probe = nullptr;
+    char shown[ROWS][48];
+    uint32_t lastRefresh = 0;
+
+    void draw(TFT_eSPI& tft) {
+        if(!probe) return;
+        tft.startWrite();
+        for(int r=0; r<ROWS; r++) {
+            char text[48];
+            if(r < NUM_FIELDS) {
+                const LatencyHistogram& h = probe->fields[r];
+                char p50[12], p99[12], max[12];
+                formatMs(p50, sizeof(p50), h.percentile(0.5f), h.count);
+                formatMs(p99, sizeof(p99), h.percentile(0.99f), h.count);
+                formatMs(max, sizeof(max), h.maxUs, h.count);
+                snprintf(text, sizeof(text), "%s|%s|%s|%s", fieldName(r), p50, p99, max);
+            } else {
+                snprintf(text, sizeof(text), "%lu unchanged", (unsigned long)probe->dropped);
+            }
+            if(!strcmp(text, shown[r])) continue;
+            strcpy(shown[r], text);
+
+            int16_t y = table->y + r * table->rowH;
+            tft.fillRect(table->x, y, table->w, table->rowH - 2, TFT_BLACK);
+            tft.setTextColor(r < NUM_FIELDS ? TFT_WHITE : TFT_SILVER, TFT_BLACK);
+            // Columns right-aligned under the page's P50 / P99 / MAX labels
+            static const int16_t RIGHT[] = {0, 122, 176, 232};
+            char* cell = text;
+            for(int c=0; c<4 && cell; c++) {
+                char* bar = r < NUM_FIELDS ? strchr(cell, '|') : nullptr;
+                if(bar) *bar = 0;
+                tft.setTextDatum(c ? TR_DATUM : TL_DATUM);
+                tft.drawString(cell, c ? table->x + RIGHT[c] : table->x, y, 2);
+                cell = bar ? bar + 1 : nullptr;
+            }
+        }
+        tft.endWrite();
+    }
+};
@@ -0,0 +1,267 @@
+#pragma once
+#include <TFT_eSPI.h>
+#include "Config.h"
+
+// Declarative page layouts.
+// Each page is a table of static elements (bars, labels) plus a table of value
+// widgets bound to a field address. DisplayManager walks these tables, so adding
+// a page or a field is a matter of adding rows here, not writing a new updateX().
+
+#define ARRAY_LEN(a) (sizeof(a) / sizeof((a)[0]))
+
+// Upper bound used to size per-widget render state in DisplayManager
+#define MAX_WIDGETS_PER_PAGE 16
+
+enum StaticKind : uint8_t {
+    STATIC_FILL, // Filled rectangle (x, y, w, h)
+    STATIC_TEXT  // Text anchored at (x, y) using datum
+};
+
+struct StaticDef {
+    StaticKind kind;
+    int16_t x, y, w, h;
+    uint8_t font;
+    uint8_t datum;
+    uint16_t color;
+    uint16_t bg;      // Same as color = transparent text background
+    const char* text;
+};
+
+constexpr StaticDef FILL(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    return StaticDef{STATIC_FILL, x, y, w, h, 0, TL_DATUM, color, color, nullptr};
+}
+
+constexpr StaticDef LABEL(const char* text, int16_t x, int16_t y, uint8_t font,
+                          uint16_t color, uint8_t datum = TL_DATUM) {
+    return StaticDef{STATIC_TEXT, x, y, 0, 0, font, datum, color, color, text};
+}
+
+constexpr StaticDef TITLE(const char* text, int16_t x, int16_t y, uint8_t font,
+                          uint16_t color, uint16_t bg, uint8_t datum = MC_DATUM) {
+    return StaticDef{STATIC_TEXT, x, y, 0, 0, font, datum, color, bg, text};
+}
+
+struct WidgetDef {
+    uint16_t field;      // Bound field address (see TARGET_FIELDS)
+    int16_t x, y, w, h;  // Area cleared before each redraw
+    uint8_t font;
+    uint8_t datum;       // TL_DATUM draws at (x, y), MC_DATUM at the centre of the area
+    uint16_t color;
+    uint8_t cells;       // Integer digit cells (incl. sign) drawn from the glyph atlas, 0 = text rendering
+    uint8_t decimals;    // Formatter: 0 = integer (truncated), n = fixed point with n decimals
+    float threshold;     // Minimum change before redrawing (0 = any visible change)
+};
+
+constexpr WidgetDef WIDGET(uint16_t field, int16_t x, int16_t y, int16_t w, int16_t h,
+                           uint8_t font, uint8_t datum, uint16_t color, uint8_t cells,
+                           uint8_t decimals = 0, float threshold = 0.0f) {
+    return WidgetDef{field, x, y, w, h, font, datum, color, cells, decimals, threshold};
+}
+
+// One plotted field of a strip chart, scaled from [min, max] to the chart width
+struct TraceDef {
+    uint16_t field;
+    uint16_t color;
+    float min;
+    float max;
+};
+
+// Strip chart scrolled by the panel. Rows [top, top + height) form the
+// hardware scroll area; each history sample adds one line at its bottom.
+struct ChartDef {
+    const TraceDef* traces;
+    uint8_t numTraces;
+    int16_t top;
+    int16_t height;
+};
+
+// Operating-point heatmap area (see HeatmapView.h), divided evenly into the
+// map's RPM x power bins
+struct HeatmapDef {
+    int16_t x, y, w, h;
+};
+
+// Latency table (see LatencyView.h): a row per wire field from y down, then
+// the unchanged count
+#define LATENCY_ROWS (NUM_FIELDS + 1)
+
+struct LatencyDef {
+    int16_t x, y, w;
+    int16_t rowH;
+};
+
+struct PageDef {
+    const char* name;
+    const StaticDef* statics;
+    uint8_t numStatics;
+    const WidgetDef* widgets;
+    uint8_t numWidgets;
+    bool showStatus;     // Status line at the bottom of the screen
+    const ChartDef* chart; // Optional strip chart
+    const HeatmapDef* heatmap; // Optional operating-point heatmap
+    const LatencyDef* latency; // Optional notify-to-pixel latency table
+};
+
+// ===== Page 0: Grid =====
+constexpr StaticDef GRID_STATICS[] = {
+    FILL(0, 0, 240, 40, TFT_NAVY),
+    TITLE("HarvTech", 120, 20, 4, TFT_WHITE, TFT_NAVY),
+
+    LABEL("SoC %",      20,  60,  2, TFT_SILVER),
+    LABEL("Throttle V", 140, 60,  2, TFT_SILVER),
+    LABEL("SPEED km/h", 70,  120, 2, TFT_SILVER),
+    LABEL("RPM",        20,  220, 2, TFT_SILVER),
+    LABEL("VOLTAGE",    140, 220, 2, TFT_SILVER),
+
+    // Extra Metrics Row
+    LABEL("PWR", 20,  280, 2, TFT_SILVER),
+    LABEL("CUR", 100, 280, 2, TFT_SILVER),
+    LABEL("TMP", 180, 280, 2, TFT_SILVER),
+};
+
+constexpr WidgetDef GRID_WIDGETS[] = {
+    //     field  x    y    w    h    font datum      color        cells dec thresh
+    WIDGET(24,    40,  140, 160, 60,  7,   MC_DATUM, TFT_GREEN,   3),               // Speed
+    WIDGET(26,    20,  80,  80,  30,  4,   TL_DATUM, TFT_ORANGE,  3),               // SoC (alarm colour: Rules.h)
+    WIDGET(220,   140, 80,  80,  30,  4,   TL_DATUM, TFT_RED,     1,    1,  0.1f),   // Throttle
+    WIDGET(105,   20,  240, 100, 25,  4,   TL_DATUM, TFT_SKYBLUE, 5),               // RPM
+    WIDGET(113,   140, 240, 100, 25,  4,   TL_DATUM, TFT_YELLOW,  3,    1,  0.5f),   // Voltage
+    WIDGET(115,   20,  295, 60,  15,  2,   TL_DATUM, TFT_ORANGE,  3,    1),          // Power
+    WIDGET(119,   100, 295, 60,  15,  2,   TL_DATUM, TFT_MAGENTA, 4,    0),          // Current
+    WIDGET(222,   180, 295, 40,  15,  2,   TL_DATUM, TFT_WHITE,   3),               // Temp
+};
+
+// ===== Page 1: Big Speed =====
+constexpr StaticDef SPEED_STATICS[] = {
+    LABEL("SPEED", 120, 40, 4, TFT_GREEN, MC_DATUM),
+    LABEL("RANGE km", 20,  262, 2, TFT_SILVER),
+    LABEL("LO",       170, 252, 2, TFT_SILVER),
+    LABEL("HI",       170, 274, 2, TFT_SILVER),
+};
+
+constexpr WidgetDef SPEED_WIDGETS[] = {
+    WIDGET(24, 0, 80, 240, 160, 8, MC_DATUM, TFT_GREEN, 3),
+    // Range estimate and its band (see RangeEstimator.h)
+    WIDGET(VF_RANGE,    100, 255, 60, 28, 4, TL_DATUM, TFT_YELLOW, 3, 0, 1.0f),
+    WIDGET(VF_RANGE_LO, 195, 252, 40, 16, 2, TL_DATUM, TFT_WHITE,  3, 0, 1.0f),
+    WIDGET(VF_RANGE_HI, 195, 274, 40, 16, 2, TL_DATUM, TFT_WHITE,  3, 0, 1.0f),
+};
+
+// ===== Page 2: Trend chart =====
+constexpr StaticDef CHART_STATICS[] = {
+    FILL(0, 0, 240, 40, TFT_NAVY),
+    TITLE("TRENDS", 120, 20, 4, TFT_WHITE, TFT_NAVY),
+
+    // Legend with full-scale ranges
+    LABEL("SPD 0-80",   4,   292, 2, TFT_GREEN),
+    LABEL("KW -5/15",   84,  292, 2, TFT_ORANGE),
+    LABEL("A -50/150",  164, 292, 2, TFT_MAGENTA),
+};
+
+constexpr TraceDef CHART_TRACES[] = {
+    {24,  TFT_GREEN,    0.0f,  80.0f}, // Speed
+    {115, TFT_ORANGE,  -5.0f,  15.0f}, // Power
+    {119, TFT_MAGENTA, -50.0f, 150.0f}, // Current
+};
+
+constexpr ChartDef TREND_CHART = {CHART_TRACES, ARRAY_LEN(CHART_TRACES), 40, 248};
+
+// ===== Page 3: Trip computer (virtual fields, see TripComputer.h) =====
+constexpr StaticDef TRIP_STATICS[] = {
+    FILL(0, 0, 240, 40, TFT_NAVY),
+    TITLE("TRIP", 120, 20, 4, TFT_WHITE, TFT_NAVY),
+
+    LABEL("USED Wh",   20, 62,  2, TFT_SILVER),
+    LABEL("REGEN Wh",  20, 102, 2, TFT_SILVER),
+    LABEL("DIST km",   20, 142, 2, TFT_SILVER),
+    LABEL("Wh/km",     20, 182, 2, TFT_SILVER),
+    LABEL("AVG km/h",  20, 222, 2, TFT_SILVER),
+    LABEL("PEAK kW",   20, 262, 2, TFT_SILVER),
+};
+
+constexpr WidgetDef TRIP_WIDGETS[] = {
+    //     field          x    y    w    h   font datum     color        cells dec thresh
+    WIDGET(VF_WH_USED,    120, 55,  110, 28, 4,   TL_DATUM, TFT_ORANGE,  5,    0,  1.0f),
+    WIDGET(VF_WH_REGEN,   120, 95,  110, 28, 4,   TL_DATUM, TFT_SKYBLUE, 5,    0,  1.0f),
+    WIDGET(VF_DISTANCE,   120, 135, 110, 28, 4,   TL_DATUM, TFT_YELLOW,  3,    1,  0.1f),
+    WIDGET(VF_WH_PER_KM,  120, 175, 110, 28, 4,   TL_DATUM, TFT_ORANGE,  4,    0,  1.0f),
+    WIDGET(VF_AVG_SPEED,  120, 215, 110, 28, 4,   TL_DATUM, TFT_YELLOW,  3,    1,  0.1f),
+    WIDGET(VF_PEAK_POWER, 120, 255, 110, 28, 4,   TL_DATUM, TFT_RED,     3,    1,  0.1f),
+};
+
+// ===== Page 4: Pack health (see BatteryEstimator.h) =====
+constexpr StaticDef PACK_STATICS[] = {
+    FILL(0, 0, 240, 40, TFT_NAVY),
+    TITLE("PACK", 120, 20, 4, TFT_WHITE, TFT_NAVY),
+
+    LABEL("OCV V",     20, 62,  2, TFT_SILVER),
+    LABEL("R mOhm",    20, 102, 2, TFT_SILVER),
+    LABEL("R % REF",   20, 142, 2, TFT_SILVER),
+    LABEL("SAGS",      20, 182, 2, TFT_SILVER),
+    LABEL("MAX SAG V", 20, 222, 2, TFT_SILVER),
+};
+
+constexpr WidgetDef PACK_WIDGETS[] = {
+    //     field          x    y    w    h   font datum     color        cells dec thresh
+    WIDGET(VF_PACK_OCV,   120, 55,  110, 28, 4,   TL_DATUM, TFT_YELLOW,  3,    1,  0.1f),
+    WIDGET(VF_PACK_R,     120, 95,  110, 28, 4,   TL_DATUM, TFT_ORANGE,  4,    0,  1.0f),
+    WIDGET(VF_PACK_R_REF, 120, 135, 110, 28, 4,   TL_DATUM, TFT_RED,     3,    0,  1.0f),
+    WIDGET(VF_SAG_COUNT,  120, 175, 110, 28, 4,   TL_DATUM, TFT_SKYBLUE, 4),
+    WIDGET(VF_SAG_MAX,    120, 215, 110, 28, 4,   TL_DATUM, TFT_ORANGE,  3,    1,  0.1f),
+};
+
+// ===== Page 5: Motor operating map (see OperatingMap.h) =====
+constexpr StaticDef MAP_STATICS[] = {
+    FILL(0, 0, 240, 40, TFT_NAVY),
+    TITLE("MOTOR MAP", 120, 20, 4, TFT_WHITE, TFT_NAVY),
+
+    LABEL("12",   2,   48,  2, TFT_SILVER),  // kW, top edge of the map
+    LABEL("0",    2,   197, 2, TFT_SILVER),  // kW, zero line
+    LABEL("-4",   2,   242, 2, TFT_SILVER),
+    LABEL("kW",   2,   110, 2, TFT_SILVER),
+    LABEL("0",    28,  258, 2, TFT_SILVER),  // rpm
+    LABEL("RPM",  132, 258, 2, TFT_SILVER, TC_DATUM),
+    LABEL("8000", 236, 258, 2, TFT_SILVER, TR_DATUM),
+
+    LABEL(">60C min",  4,   280, 2, TFT_SILVER),
+    LABEL(">80C min",  84,  280, 2, TFT_SILVER),
+    LABEL(">100C min", 164, 280, 2, TFT_SILVER),
+};
+
+constexpr WidgetDef MAP_WIDGETS[] = {
+    WIDGET(VF_TEMP_60,  4,   298, 70, 16, 2, TL_DATUM, TFT_WHITE, 4, 0, 1.0f),
+    WIDGET(VF_TEMP_80,  84,  298, 70, 16, 2, TL_DATUM, TFT_WHITE, 4, 0, 1.0f),
+    WIDGET(VF_TEMP_100, 164, 298, 70, 16, 2, TL_DATUM, TFT_WHITE, 4, 0, 1.0f),
+};
+
+// 16 x 13 px cells: RPM bins of 500 across, 1 kW power bins up from -4 kW
+constexpr HeatmapDef MOTOR_MAP = {28, 48, 208, 208};
+
+#if LATENCY_PROBE
+// ===== Page 6: Notify-to-pixel latency, -D LATENCY_PROBE=1 builds only =====
+constexpr StaticDef LATENCY_STATICS[] = {
+    FILL(0, 0, 240, 40, TFT_NAVY),
+    TITLE("LATENCY ms", 120, 20, 4, TFT_WHITE, TFT_NAVY),
+
+    LABEL("FIELD", 4,   50, 2, TFT_SILVER),
+    LABEL("P50",   126, 50, 2, TFT_SILVER, TR_DATUM),
+    LABEL("P99",   180, 50, 2, TFT_SILVER, TR_DATUM),
+    LABEL("MAX",   236, 50, 2, TFT_SILVER, TR_DATUM),
+};
+
+constexpr LatencyDef LATENCY_TABLE = {4, 72, 232, 22};
+#endif
+
+constexpr PageDef PAGES[] = {
+    {"Grid",  GRID_STATICS,  ARRAY_LEN(GRID_STATICS),  GRID_WIDGETS,  ARRAY_LEN(GRID_WIDGETS),  true,  nullptr,      nullptr,    nullptr},
+    {"Speed", SPEED_STATICS, ARRAY_LEN(SPEED_STATICS), SPEED_WIDGETS, ARRAY_LEN(SPEED_WIDGETS), false, nullptr,      nullptr,    nullptr},
+    {"Chart", CHART_STATICS, ARRAY_LEN(CHART_STATICS), nullptr,       0,                        false, &TREND_CHART, nullptr,    nullptr},
+    {"Trip",  TRIP_STATICS,  ARRAY_LEN(TRIP_STATICS),  TRIP_WIDGETS,  ARRAY_LEN(TRIP_WIDGETS),  true,  nullptr,      nullptr,    nullptr},
+    {"Pack",  PACK_STATICS,  ARRAY_LEN(PACK_STATICS),  PACK_WIDGETS,  ARRAY_LEN(PACK_WIDGETS),  true,  nullptr,      nullptr,    nullptr},
+    {"Map",   MAP_STATICS,   ARRAY_LEN(MAP_STATICS),   MAP_WIDGETS,   ARRAY_LEN(MAP_WIDGETS),   false, nullptr,      &MOTOR_MAP, nullptr},
+#if LATENCY_PROBE
+    {"Latency", LATENCY_STATICS, ARRAY_LEN(LATENCY_STATICS), nullptr, 0,                        true,  nullptr,      nullptr,    &LATENCY_TABLE},
+#endif
+};
+
+const int NUM_PAGES = ARRAY_LEN(PAGES);
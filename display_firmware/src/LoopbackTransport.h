@@ -0,0 +1,62 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "ControllerEmulator.h"
+#include "SpscRing.h"
+#include "Transport.h"
+
+// In-process transport to a ControllerEmulator. Portable: runs the session
+// and everything above it on the host, at any rate.
+//
+// Commands reach the emulator synchronously; its packets are queued and
+// delivered by poll(), so a receiver never runs inside the send() that
+// caused it, as with a real link. A full queue drops (and counts) packets.
+class LoopbackTransport : public Transport {
+public:
+    uint32_t dropped = 0;
+
+    explicit LoopbackTransport(ControllerEmulator& e) : emu(e) {
+        emu.out = [this](const uint8_t* data, size_t length) { enqueue(data, length); };
+    }
+
+    void connect() { up = true; }
+
+    bool connected() const override { return up; }
+
+    bool send(const uint8_t* data, size_t length) override {
+        if(!up) return false;
+        emu.onCommand(data, length);
+        return true;
+    }
+
+    void disconnect() override { up = false; }
+
+    // Deliver queued packets; returns how many
+    size_t poll() {
+        size_t n = 0;
+        Packet p;
+        while(queue.pop(p)) {
+            if(up) deliver(p.data, p.len);
+            n++;
+        }
+        return n;
+    }
+
+private:
+    struct Packet {
+        uint8_t len;
+        uint8_t data[20];
+    };
+
+    ControllerEmulator& emu;
+    SpscRing<Packet, 1024> queue;
+    bool up = false;
+
+    void enqueue(const uint8_t* data, size_t length) {
+        Packet p;
+        p.len = length < sizeof(p.data) ? length : sizeof(p.data);
+        memcpy(p.data, data, p.len);
+        if(!queue.push(p)) dropped++;
+    }
+};
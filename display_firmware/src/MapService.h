@@ -0,0 +1,75 @@
+#pragma once
+#include <Arduino.h>
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include "OperatingMap.h"
+#include "Protocol.h"
+#include "VehicleState.h"
+
+// The map blob is ~1 KB (~35 NVS entries), so it is saved less often than
+// the trip totals: every OPMAP_SAVE_MS while riding, and on disconnect. A
+// 20 KB NVS partition then erases a page every ~20 minutes of riding. A
+// power cut loses at most OPMAP_SAVE_MS of map time.
+#define OPMAP_SAVE_MS 300000UL
+
+static const uint16_t OPMAP_TEMP_FIELDS[OPMAP_TEMP_LEVELS] = {VF_TEMP_60, VF_TEMP_80, VF_TEMP_100};
+
+// Target glue for OperatingMap: feeds it from the notify callback, publishes
+// the time above each temperature threshold and keeps the map in NVS across
+// rides. The heatmap page reads the map directly (see HeatmapView.h).
+class MapService {
+public:
+    void init(VehicleState* out) {
+        state = out;
+        prefs.begin("opmap", false);
+        static OperatingTotals saved; // 1 KB, off the loop task's stack
+        if(prefs.getBytes("map", &saved, sizeof(saved)) == sizeof(saved)) {
+            opmap.restore(saved);
+        }
+        publish();
+    }
+
+    // From the BLE notify callback
+    void onSample(const Protocol::ParsedData& data) {
+        portENTER_CRITICAL(&lock);
+        bool changed = opmap.onSample(data.address, data.value, millis());
+        portEXIT_CRITICAL(&lock);
+        if(changed) {
+            dirty = true;
+            if(data.address == ADDR_TEMP) publish();
+        }
+    }
+
+    // From loop(): periodic save
+    void service() {
+        if(dirty && millis() - lastSave >= OPMAP_SAVE_MS) save();
+    }
+
+    void save() {
+        if(!dirty) return;
+        static OperatingTotals snapshot;
+        portENTER_CRITICAL(&lock);
+        snapshot = opmap.get();
+        portEXIT_CRITICAL(&lock);
+        prefs.putBytes("map", &snapshot, sizeof(snapshot));
+        lastSave = millis();
+        dirty = false;
+    }
+
+    const OperatingMap& map() const { return opmap; }
+
+private:
+    OperatingMap opmap;
+    VehicleState* state = nullptr;
+    Preferences prefs;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    volatile bool dirty = false;
+    uint32_t lastSave = 0;
+
+    void publish() {
+        const OperatingTotals& t = opmap.get();
+        for(int i=0; i<OPMAP_TEMP_LEVELS; i++) {
+            state->update(OPMAP_TEMP_FIELDS[i], OperatingMap::ticksToMinutes(t.tempAbove[i]));
+        }
+    }
+};
@@ -0,0 +1,131 @@
+#pragma once
+#include <stdint.h>
+#include "Config.h"
+
+// Motor operating-point map: time spent in each RPM x Power cell, plus time
+// with the controller above each temperature threshold. Fixed size, O(1) per
+// sample, accumulated across rides.
+//
+// Time is attributed to the cell of the latest RPM (105) and Power (115)
+// values, advanced on every sample of either; temperature time the same way
+// from Temp (222). Gaps longer than MAX_GAP_MS (link lost, parked) are not
+// counted. Counters are in ticks of TICK_MS: 32 bits hold over 13 years per
+// cell, and the sub-tick remainder carries into the next interval so no
+// time is lost to rounding.
+
+#define OPMAP_RPM_BINS    16
+#define OPMAP_RPM_STEP    500       // rpm per bin, from 0
+#define OPMAP_PWR_BINS    16
+#define OPMAP_PWR_MIN     -4.0f     // kW, lower edge of bin 0
+#define OPMAP_PWR_STEP    1.0f      // kW per bin
+#define OPMAP_TEMP_LEVELS 3
+
+const float OPMAP_TEMP_C[OPMAP_TEMP_LEVELS] = {60.0f, 80.0f, 100.0f};
+
+// Persisted state. Plain data, saved as one blob.
+struct OperatingTotals {
+    uint32_t version;
+    uint32_t cells[OPMAP_PWR_BINS][OPMAP_RPM_BINS]; // [power][rpm], ticks
+    uint32_t tempAbove[OPMAP_TEMP_LEVELS];          // Ticks
+    uint32_t total;                                  // Ticks in any cell
+};
+
+#define OPMAP_VERSION 1
+
+class OperatingMap {
+public:
+    static const uint32_t TICK_MS = 100;
+    static const uint32_t MAX_GAP_MS = 2000;
+
+    OperatingMap() { reset(); }
+
+    void reset() {
+        totals = OperatingTotals();
+        totals.version = OPMAP_VERSION;
+        rpmValid = pwrValid = tempValid = false;
+        pointMs = tempMs = 0;
+        pointCarry = tempCarry = 0;
+    }
+
+    // Continue from saved totals. Returns false (and resets) on a version mismatch.
+    bool restore(const OperatingTotals& saved) {
+        reset();
+        if(saved.version != OPMAP_VERSION) return false;
+        totals = saved;
+        return true;
+    }
+
+    // One wire sample. Returns true if a counter advanced.
+    bool onSample(uint16_t address, float value, uint32_t ms) {
+        switch(address) {
+            case ADDR_RPM:
+            case ADDR_POWER: {
+                bool counted = false;
+                if(rpmValid && pwrValid) counted = advancePoint(ms);
+                if(address == ADDR_RPM) { rpm = value; rpmValid = true; }
+                else { kw = value; pwrValid = true; }
+                pointMs = ms;
+                return counted;
+            }
+
+            case ADDR_TEMP: {
+                bool counted = false;
+                if(tempValid) counted = advanceTemp(ms);
+                temp = value;
+                tempValid = true;
+                tempMs = ms;
+                return counted;
+            }
+        }
+        return false;
+    }
+
+    const OperatingTotals& get() const { return totals; }
+
+    static int rpmBin(float rpm) {
+        int b = (int)(rpm / OPMAP_RPM_STEP);
+        return b < 0 ? 0 : (b >= OPMAP_RPM_BINS ? OPMAP_RPM_BINS - 1 : b);
+    }
+
+    static int powerBin(float kw) {
+        float f = (kw - OPMAP_PWR_MIN) / OPMAP_PWR_STEP;
+        int b = f < 0 ? 0 : (int)f;
+        return b >= OPMAP_PWR_BINS ? OPMAP_PWR_BINS - 1 : b;
+    }
+
+    static float ticksToMinutes(uint32_t ticks) { return ticks * (TICK_MS / 60000.0f); }
+
+private:
+    OperatingTotals totals;
+    float rpm = 0, kw = 0, temp = 0;
+    bool rpmValid, pwrValid, tempValid;
+    uint32_t pointMs, tempMs;
+    uint32_t pointCarry, tempCarry; // Sub-tick remainders, ms
+
+    // Whole ticks in (ms - from) plus the carried remainder; false across a gap
+    static bool ticks(uint32_t from, uint32_t ms, uint32_t& carry, uint32_t& out) {
+        uint32_t dt = ms - from;
+        if(dt > MAX_GAP_MS) return false;
+        dt += carry;
+        out = dt / TICK_MS;
+        carry = dt % TICK_MS;
+        return out > 0;
+    }
+
+    bool advancePoint(uint32_t ms) {
+        uint32_t t;
+        if(!ticks(pointMs, ms, pointCarry, t)) return false;
+        totals.cells[powerBin(kw)][rpmBin(rpm)] += t;
+        totals.total += t;
+        return true;
+    }
+
+    bool advanceTemp(uint32_t ms) {
+        uint32_t t;
+        if(!ticks(tempMs, ms, tempCarry, t)) return false;
+        for(int i=0; i<OPMAP_TEMP_LEVELS; i++) {
+            if(temp >= OPMAP_TEMP_C[i]) totals.tempAbove[i] += t;
+        }
+        return true;
+    }
+};
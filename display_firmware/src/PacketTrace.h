@@ -0,0 +1,116 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "Codec.h"
+
+// Packet trace format: the raw packets a controller link delivered, with
+// their arrival times, for replaying a ride through the firmware
+// (TraceReplay.h). Captured on the device by TraceCapture.h, written on
+// the host by tools/trace_replay. Portable (test/test_trace).
+//
+// Header, 8 bytes little endian:
+//   0  u16 magic "PT"      3  u8  reserved
+//   2  u8  version         4  u32 millis() when the capture started
+//
+// Then one record per event, to the end of the file:
+//   varint  us since the previous record (the first: since capture start)
+//   u8      length: 1..TRACE_MAX_PACKET = a packet of that many bytes,
+//           0 = link event, followed by one byte (1 up, 0 down)
+//   packet  as the transport delivered it, [AddrLow][AddrHigh|flags][data]
+//
+// A capture cut short by power loss ends in a partial record, which the
+// reader reports as the end of the trace.
+
+#define TRACE_MAGIC        0x5450
+#define TRACE_VERSION      1
+#define TRACE_HEADER_SIZE  8
+#define TRACE_MAX_PACKET   20      // One BLE notification
+#define TRACE_MAX_RECORD   (codec::MAX_VARINT + 2 + TRACE_MAX_PACKET)
+
+struct TraceRecord {
+    uint64_t us;                // Since capture start
+    uint8_t length;             // 0 = link event
+    bool up;                    // Link events: link came up
+    uint8_t data[TRACE_MAX_PACKET];
+};
+
+class PacketTraceWriter {
+public:
+    // Header into out (TRACE_HEADER_SIZE bytes); times restart at 0
+    size_t header(uint8_t* out, uint32_t startMs) {
+        lastUs = 0;
+        out[0] = TRACE_MAGIC & 0xFF;
+        out[1] = TRACE_MAGIC >> 8;
+        out[2] = TRACE_VERSION;
+        out[3] = 0;
+        for(int i=0; i<4; i++) out[4 + i] = startMs >> (8 * i);
+        return TRACE_HEADER_SIZE;
+    }
+
+    // One packet at `us` since capture start, at most TRACE_MAX_RECORD
+    // bytes into out. 0 if the packet is empty or too long for the format.
+    size_t packet(uint8_t* out, uint64_t us, const uint8_t* data, size_t length) {
+        if(length == 0 || length > TRACE_MAX_PACKET) return 0;
+        size_t n = time(out, us);
+        out[n++] = length;
+        memcpy(out + n, data, length);
+        return n + length;
+    }
+
+    size_t link(uint8_t* out, uint64_t us, bool up) {
+        size_t n = time(out, us);
+        out[n++] = 0;
+        out[n++] = up ? 1 : 0;
+        return n;
+    }
+
+private:
+    uint64_t lastUs = 0;
+
+    // Gaps beyond a varint (~71 min) are clamped; the trace just gets shorter
+    size_t time(uint8_t* out, uint64_t us) {
+        uint64_t dt = us > lastUs ? us - lastUs : 0;
+        if(dt > UINT32_MAX) dt = UINT32_MAX;
+        lastUs = us;
+        return codec::putVarint(out, (uint32_t)dt);
+    }
+};
+
+class PacketTraceReader {
+public:
+    // Check the header; false if p does not start a trace this reader knows
+    bool header(const uint8_t* p, size_t avail) {
+        if(avail < TRACE_HEADER_SIZE) return false;
+        if((p[0] | (p[1] << 8)) != TRACE_MAGIC || p[2] != TRACE_VERSION) return false;
+        startMs = p[4] | (p[5] << 8) | (p[6] << 16) | ((uint32_t)p[7] << 24);
+        us = 0;
+        return true;
+    }
+
+    // Decode the record at p. Returns the bytes it took, 0 if it is not
+    // complete within avail (read more, or the trace ends here), -1 if it
+    // is malformed.
+    int next(const uint8_t* p, size_t avail, TraceRecord& r) {
+        size_t pos = 0;
+        uint32_t dt;
+        if(!codec::getVarint(p, avail, pos, dt)) return avail >= codec::MAX_VARINT ? -1 : 0;
+        if(pos >= avail) return 0;
+        uint8_t length = p[pos++];
+        if(length > TRACE_MAX_PACKET) return -1;
+        size_t body = length ? length : 1;
+        if(pos + body > avail) return 0;
+
+        r.us = us + dt;
+        r.length = length;
+        r.up = length == 0 && p[pos] != 0;
+        if(length) memcpy(r.data, p + pos, length);
+        us = r.us;
+        return (int)(pos + body);
+    }
+
+    uint32_t startMs = 0;
+
+private:
+    uint64_t us = 0;
+};
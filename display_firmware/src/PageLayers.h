@@ -0,0 +1,145 @@
+#pragma once
+#include <TFT_eSPI.h>
+#include <esp_heap_caps.h>
+#include "Layout.h"
+#include "EventTrace.h"
+
+// Pre-rendered static page backgrounds.
+// At boot every page's statics (header bar, labels, titles) are rendered once
+// into a full-screen 16-bit sprite in PSRAM. A page switch then streams that
+// layer to the panel with DMA instead of clearing and re-rasterising text.
+//
+// The SPI master cannot DMA straight out of PSRAM on this core, so the layer is
+// sent in bands through two small internal DMA buffers: while one band is on
+// the wire the next is copied into the other buffer.
+//
+// Bands that are identical in the outgoing and incoming layer and hold no
+// dynamic content on the outgoing page are skipped entirely.
+
+#define LAYER_BAND_ROWS 16
+#define LAYER_BANDS     (TFT_HEIGHT / LAYER_BAND_ROWS)
+
+// Status line area shared by pages with showStatus
+#define STATUS_Y 305
+#define STATUS_H 15
+
+static_assert(LAYER_BANDS <= 32, "Band masks are 32 bits");
+
+// Render a page's static elements onto any TFT_eSPI target (panel or sprite)
+inline void drawStatics(TFT_eSPI& gfx, const PageDef& page) {
+    for(int i=0; i<page.numStatics; i++) {
+        const StaticDef& s = page.statics[i];
+        if(s.kind == STATIC_FILL) {
+            gfx.fillRect(s.x, s.y, s.w, s.h, s.color);
+        } else {
+            gfx.setTextColor(s.color, s.bg);
+            gfx.setTextDatum(s.datum);
+            gfx.drawString(s.text, s.x, s.y, s.font);
+        }
+    }
+}
+
+class PageLayers {
+public:
+    // Allocate and render all layers. Returns false (and draws directly
+    // afterwards) if PSRAM or DMA buffers are unavailable.
+    bool init(TFT_eSPI& tft) {
+        if(!psramFound()) return false;
+
+        for(int b=0; b<2; b++) {
+            bounce[b] = (uint16_t*)heap_caps_malloc(BAND_PIXELS * 2, MALLOC_CAP_DMA);
+            if(!bounce[b]) return false;
+        }
+
+        for(int p=0; p<NUM_PAGES; p++) {
+            layers[p] = new TFT_eSprite(&tft);
+            layers[p]->setColorDepth(16);
+            layers[p]->setAttribute(PSRAM_ENABLE, 1);
+            if(!layers[p]->createSprite(TFT_WIDTH, TFT_HEIGHT)) return false;
+
+            layers[p]->fillSprite(TFT_BLACK);
+            drawStatics(*layers[p], PAGES[p]);
+            dynamicBands[p] = computeDynamicBands(PAGES[p]);
+        }
+
+        // Identical-band masks for every page pair, so switches never compare PSRAM
+        for(int from=0; from<NUM_PAGES; from++) {
+            for(int to=0; to<NUM_PAGES; to++) {
+                sameBands[from][to] = compareBands(from, to);
+            }
+        }
+
+        ready = true;
+        return true;
+    }
+
+    bool available() const { return ready; }
+
+    // Send `page`'s layer to the panel. `fromPage` is the page currently on
+    // screen, or -1 if the screen content is unknown (forces every band).
+    void blit(TFT_eSPI& tft, int page, int fromPage) {
+        uint32_t skip = 0;
+        if(fromPage >= 0) {
+            skip = sameBands[fromPage][page] & ~dynamicBands[fromPage];
+        }
+
+        const uint16_t* src = (const uint16_t*)layers[page]->getPointer();
+        int buf = 0;
+
+        TRACE_BEGIN(TR_SPI, (LAYER_BANDS - __builtin_popcount(skip)) * BAND_PIXELS / 16);
+        tft.startWrite();
+        for(int b=0; b<LAYER_BANDS; b++) {
+            if(skip & (1UL << b)) continue;
+            tft.pushImageDMA(0, b * LAYER_BAND_ROWS, TFT_WIDTH, LAYER_BAND_ROWS,
+                             (uint16_t*)(src + b * BAND_PIXELS), bounce[buf]);
+            buf ^= 1;
+        }
+        tft.dmaWait();
+        tft.endWrite();
+        TRACE_END(TR_SPI, 0);
+    }
+
+private:
+    static const int BAND_PIXELS = TFT_WIDTH * LAYER_BAND_ROWS;
+
+    TFT_eSprite* layers[NUM_PAGES] = {};
+    uint16_t* bounce[2] = {};
+    uint32_t dynamicBands[NUM_PAGES] = {};
+    uint32_t sameBands[NUM_PAGES][NUM_PAGES] = {};
+    bool ready = false;
+
+    static uint32_t bandsCovering(int y, int h) {
+        uint32_t mask = 0;
+        for(int b = y / LAYER_BAND_ROWS; b <= (y + h - 1) / LAYER_BAND_ROWS && b < LAYER_BANDS; b++) {
+            mask |= 1UL << b;
+        }
+        return mask;
+    }
+
+    // Bands a page draws into at runtime (widgets, status line, chart,
+    // heatmap, latency table)
+    static uint32_t computeDynamicBands(const PageDef& page) {
+        uint32_t mask = 0;
+        for(int i=0; i<page.numWidgets; i++) {
+            mask |= bandsCovering(page.widgets[i].y, page.widgets[i].h);
+        }
+        if(page.showStatus) mask |= bandsCovering(STATUS_Y, STATUS_H);
+        if(page.chart) mask |= bandsCovering(page.chart->top, page.chart->height);
+        if(page.heatmap) mask |= bandsCovering(page.heatmap->y, page.heatmap->h);
+        if(page.latency) mask |= bandsCovering(page.latency->y, LATENCY_ROWS * page.latency->rowH);
+        return mask;
+    }
+
+    uint32_t compareBands(int a, int b) {
+        const uint16_t* pa = (const uint16_t*)layers[a]->getPointer();
+        const uint16_t* pb = (const uint16_t*)layers[b]->getPointer();
+        uint32_t mask = 0;
+        for(int band=0; band<LAYER_BANDS; band++) {
+            size_t offset = band * BAND_PIXELS;
+            if(memcmp(pa + offset, pb + offset, BAND_PIXELS * 2) == 0) {
+                mask |= 1UL << band;
+            }
+        }
+        return mask;
+    }
+};
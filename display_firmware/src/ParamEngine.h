@@ -0,0 +1,303 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <functional>
+#include "ParamImage.h"
+
+// Reads and writes the controller's parameter ranges without blocking.
+//
+// Backup reads every range into an image. Restore reads the controller,
+// diffs it against a reference image, writes back only the bytes that
+// differ and reads those back to verify, rewriting up to MAX_PASSES times.
+//
+// Reads ask for CHUNK bytes at a time, WINDOW of them in flight, so the
+// round trips overlap instead of adding up. Controllers that answer a
+// multi-byte read in one go set the Multi flag (0x40); ones that answer
+// with a single register are asked again for the rest of the chunk at
+// once. Whatever arrives is kept per byte, so a reply covering more or
+// less than was asked for is fine. Writes are commands without response,
+// spaced by WRITE_GAP_MS.
+//
+// Everything runs from service() and onPacket(), both in loop(); the target
+// glue passes packets over from the notify callback.
+class ParamEngine {
+public:
+    static const int CHUNK = 16;              // 2 + 16 bytes fit a 20-byte notification
+    static const int WINDOW = 4;              // Reads in flight
+    static const uint32_t TIMEOUT_MS = 400;
+    static const int MAX_TRIES = 4;           // Reads of a chunk without progress
+    static const uint32_t WRITE_GAP_MS = 20;
+    static const int MERGE_GAP = 3;           // Unchanged bytes bridged by one write
+    static const int MAX_PASSES = 2;          // Write + verify rounds
+    static const int MAX_SPANS = PARAM_IMAGE_MAX / CHUNK + PARAM_MAX_RANGES;
+
+    enum Phase : uint8_t { IDLE, READING, WRITING, VERIFYING, DONE, FAILED };
+
+    typedef std::function<void(const uint8_t* cmd, size_t len)> SendFn;
+    SendFn send;
+
+    // Statistics for the last job
+    uint32_t reads = 0;
+    uint32_t writes = 0;
+    uint32_t timeouts = 0;
+    uint32_t multiResponses = 0;
+    uint32_t changedBytes = 0;   // Restore: bytes that differed from the reference
+    uint32_t mismatches = 0;     // Restore: bytes still different after the last verify
+
+    bool startBackup(const ParamRange* ranges, int n) {
+        if(busy() || !live.setRanges(ranges, n)) return false;
+        restoring = false;
+        begin();
+        return true;
+    }
+
+    // `reference` is copied; the controller must hold the same ranges
+    bool startRestore(const ParamImage& reference) {
+        if(busy()) return false;
+        ref = reference;
+        if(!live.setRanges(ref.ranges, ref.numRanges)) return false;
+        restoring = true;
+        begin();
+        return true;
+    }
+
+    void abort() {
+        if(busy()) current = FAILED;
+    }
+
+    bool busy() const { return current == READING || current == WRITING || current == VERIFYING; }
+    Phase phase() const { return current; }
+
+    // 0..100 within the current phase
+    int progress() const {
+        if(current == WRITING) return numSpans ? 100 * nextWrite / numSpans : 100;
+        if(current != READING && current != VERIFYING) return current == DONE ? 100 : 0;
+        int total = 0, got = 0;
+        for(int i=0; i<numSpans; i++) {
+            total += spans[i].len;
+            for(int b=0; b<spans[i].len; b++) got += has(spans[i].offset + b);
+        }
+        return total ? 100 * got / total : 100;
+    }
+
+    // The controller's bytes as last read
+    const ParamImage& image() const { return live; }
+
+    // A notification that was not stream data. Read answers only: write
+    // acknowledgements come back without the Read flag.
+    void onPacket(const uint8_t* data, size_t len) {
+        if((current != READING && current != VERIFYING) || len < 3 || !(data[1] & 0x80)) return;
+        uint16_t address = ((data[1] & 0x1F) << 8) | data[0];
+        int room;
+        int off = live.offsetOf(address, &room);
+        if(off < 0) return;
+
+        int n = (int)len - 2;
+        if(n > room) n = room;
+        memcpy(live.bytes + off, data + 2, n);
+        for(int b=0; b<n; b++) mark(off + b);
+        if(data[1] & 0x40) multiResponses++;
+
+        // Retire the read this answers: complete, or ask for the rest now
+        for(int i=0; i<numSpans; i++) {
+            Span& s = spans[i];
+            if(s.state != INFLIGHT || off < s.offset || off >= s.offset + s.len) continue;
+            s.state = missing(s) ? TODO : COMPLETE;
+            s.tries = 0;
+            inflight--;
+            break;
+        }
+    }
+
+    // From loop(). Returns the phase after this step.
+    Phase service(uint32_t ms) {
+        switch(current) {
+            case READING:
+            case VERIFYING:
+                serviceReads(ms);
+                break;
+            case WRITING:
+                serviceWrites(ms);
+                break;
+            default:
+                break;
+        }
+        return current;
+    }
+
+private:
+    enum SpanState : uint8_t { TODO, INFLIGHT, COMPLETE };
+
+    struct Span {
+        uint16_t offset;    // Into the image
+        uint16_t len;
+        SpanState state;
+        uint8_t tries;
+        uint32_t sentMs;
+    };
+
+    ParamImage live;
+    ParamImage ref;
+    bool restoring = false;
+    Phase current = IDLE;
+    int pass = 0;
+
+    uint8_t have[PARAM_IMAGE_MAX / 8];
+    Span spans[MAX_SPANS];
+    int numSpans = 0;
+    int inflight = 0;
+    int nextWrite = 0;
+    uint32_t lastWrite = 0;
+
+    bool has(int off) const { return have[off >> 3] & (1 << (off & 7)); }
+    void mark(int off) { have[off >> 3] |= 1 << (off & 7); }
+    void unmark(int off) { have[off >> 3] &= ~(1 << (off & 7)); }
+
+    bool missing(const Span& s) const {
+        for(int b=0; b<s.len; b++) if(!has(s.offset + b)) return true;
+        return false;
+    }
+
+    void begin() {
+        reads = writes = timeouts = multiResponses = changedBytes = mismatches = 0;
+        memset(have, 0, sizeof(have));
+        pass = 0;
+
+        // Whole image in CHUNK pieces, none crossing a range boundary
+        numSpans = 0;
+        int base = 0;
+        for(int r=0; r<live.numRanges; r++) {
+            for(int o=0; o<live.ranges[r].length; o+=CHUNK) {
+                int n = live.ranges[r].length - o;
+                addSpan(base + o, n < CHUNK ? n : CHUNK);
+            }
+            base += live.ranges[r].length;
+        }
+        inflight = 0;
+        current = READING;
+    }
+
+    void addSpan(int offset, int len) {
+        if(numSpans >= MAX_SPANS) return;
+        spans[numSpans++] = Span{(uint16_t)offset, (uint16_t)len, TODO, 0, 0};
+    }
+
+    void serviceReads(uint32_t ms) {
+        bool pendingWork = false;
+        for(int i=0; i<numSpans; i++) {
+            Span& s = spans[i];
+            if(s.state == INFLIGHT && ms - s.sentMs >= TIMEOUT_MS) {
+                timeouts++;
+                inflight--;
+                s.state = TODO;
+                if(s.tries >= MAX_TRIES) {
+                    current = FAILED;
+                    return;
+                }
+            }
+            if(s.state == TODO && inflight < WINDOW) sendRead(s, ms);
+            if(s.state != COMPLETE) pendingWork = true;
+        }
+        if(!pendingWork) readsComplete(ms);
+    }
+
+    // Read the missing part of a span (first to last missing byte)
+    void sendRead(Span& s, uint32_t ms) {
+        int first = -1, last = -1;
+        for(int b=0; b<s.len; b++) {
+            if(has(s.offset + b)) continue;
+            if(first < 0) first = b;
+            last = b;
+        }
+        if(first < 0) {
+            s.state = COMPLETE;
+            return;
+        }
+        uint16_t address = live.addressAt(s.offset + first);
+        uint8_t cmd[3] = {
+            (uint8_t)(address & 0xFF),
+            (uint8_t)(((address >> 8) & 0x1F) | 0x80),
+            (uint8_t)(last - first + 1),
+        };
+        s.state = INFLIGHT;
+        s.tries++;
+        s.sentMs = ms;
+        inflight++;
+        reads++;
+        if(send) send(cmd, sizeof(cmd));
+    }
+
+    void readsComplete(uint32_t ms) {
+        if(!restoring) {
+            current = DONE;
+            return;
+        }
+
+        // First read: everything that differs. Verify: what is still wrong.
+        if(current == VERIFYING) pass++;
+        int diff = buildWrites();
+        if(current == READING) changedBytes = diff;
+        else mismatches = diff;
+
+        if(diff == 0) {
+            current = DONE;
+        } else if(pass >= MAX_PASSES) {
+            current = FAILED;
+        } else {
+            nextWrite = 0;
+            lastWrite = ms - WRITE_GAP_MS;
+            current = WRITING;
+        }
+    }
+
+    // Runs of bytes differing from the reference, merged across short gaps
+    // and split to CHUNK. Returns the differing byte count.
+    int buildWrites() {
+        numSpans = 0;
+        int diff = 0;
+        int base = 0;
+        for(int r=0; r<live.numRanges; r++) {
+            int end = base + live.ranges[r].length;
+            int runStart = -1, runEnd = -1;
+            for(int o=base; o<end; o++) {
+                if(live.bytes[o] == ref.bytes[o]) continue;
+                diff++;
+                if(runStart >= 0 && o - runEnd <= MERGE_GAP + 1 && o - runStart < CHUNK) {
+                    runEnd = o;
+                    continue;
+                }
+                if(runStart >= 0) addSpan(runStart, runEnd - runStart + 1);
+                runStart = runEnd = o;
+            }
+            if(runStart >= 0) addSpan(runStart, runEnd - runStart + 1);
+            base = end;
+        }
+        return diff;
+    }
+
+    void serviceWrites(uint32_t ms) {
+        if(ms - lastWrite < WRITE_GAP_MS) return;
+        if(nextWrite < numSpans) {
+            const Span& s = spans[nextWrite++];
+            uint16_t address = live.addressAt(s.offset);
+            uint8_t cmd[2 + CHUNK];
+            cmd[0] = address & 0xFF;
+            cmd[1] = (address >> 8) & 0x1F;
+            memcpy(cmd + 2, ref.bytes + s.offset, s.len);
+            lastWrite = ms;
+            writes++;
+            if(send) send(cmd, 2 + s.len);
+            return;
+        }
+
+        // All sent: read the written spans back
+        for(int i=0; i<numSpans; i++) {
+            for(int b=0; b<spans[i].len; b++) unmark(spans[i].offset + b);
+            spans[i].state = TODO;
+            spans[i].tries = 0;
+        }
+        inflight = 0;
+        current = VERIFYING;
+    }
+};
@@ -0,0 +1,127 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "Config.h"
+#include "TripLog.h"
+
+// Controller parameter image and its file format. Portable (no Arduino), so
+// images written on the display can be checked on the host.
+//
+// File, little endian:
+//   0  u16 magic "PI"      4  u8[6] controller MAC (NimBLE order)
+//   2  u8  version        10  u16 data length
+//   3  u8  range count    12  u32 CRC-32 of bytes 0..11 and everything after
+//  16  ranges, u16 start + u16 length each
+//      data, the ranges' bytes back to back
+
+#define PARAM_MAGIC       0x4950
+#define PARAM_VERSION     1
+#define PARAM_HEADER_SIZE 16
+#define PARAM_MAX_RANGES  8
+#define PARAM_IMAGE_MAX   1024
+#define PARAM_FILE_MAX    (PARAM_HEADER_SIZE + PARAM_MAX_RANGES * 4 + PARAM_IMAGE_MAX)
+
+struct ParamImage {
+    uint8_t mac[6];
+    uint8_t numRanges;
+    ParamRange ranges[PARAM_MAX_RANGES];
+    uint16_t size;                  // Sum of the range lengths
+    uint8_t bytes[PARAM_IMAGE_MAX];
+
+    // False if there are too many ranges or bytes
+    bool setRanges(const ParamRange* r, int n) {
+        numRanges = 0;
+        size = 0;
+        if(n > PARAM_MAX_RANGES) return false;
+        uint32_t total = 0;
+        for(int i=0; i<n; i++) total += r[i].length;
+        if(total > PARAM_IMAGE_MAX) return false;
+        for(int i=0; i<n; i++) ranges[i] = r[i];
+        numRanges = n;
+        size = total;
+        return true;
+    }
+
+    // Offset of an address in `bytes`, -1 if outside every range. `room` gets
+    // the bytes left in that range from there.
+    int offsetOf(uint16_t address, int* room = nullptr) const {
+        int base = 0;
+        for(int i=0; i<numRanges; i++) {
+            const ParamRange& r = ranges[i];
+            if(address >= r.start && address < r.start + r.length) {
+                if(room) *room = r.start + r.length - address;
+                return base + (address - r.start);
+            }
+            base += r.length;
+        }
+        return -1;
+    }
+
+    uint16_t addressAt(int offset) const {
+        for(int i=0; i<numRanges; i++) {
+            if(offset < ranges[i].length) return ranges[i].start + offset;
+            offset -= ranges[i].length;
+        }
+        return 0;
+    }
+
+    // Same ranges in the same order, so two images can be diffed byte by byte
+    bool sameLayout(const ParamImage& o) const {
+        if(numRanges != o.numRanges) return false;
+        for(int i=0; i<numRanges; i++) {
+            if(ranges[i].start != o.ranges[i].start || ranges[i].length != o.ranges[i].length) return false;
+        }
+        return true;
+    }
+};
+
+// Serialise into `out` (PARAM_FILE_MAX bytes). Returns the file length.
+inline size_t paramEncode(const ParamImage& img, uint8_t* out) {
+    out[0] = PARAM_MAGIC & 0xFF;
+    out[1] = PARAM_MAGIC >> 8;
+    out[2] = PARAM_VERSION;
+    out[3] = img.numRanges;
+    memcpy(out + 4, img.mac, 6);
+    out[10] = img.size & 0xFF;
+    out[11] = img.size >> 8;
+
+    size_t n = PARAM_HEADER_SIZE;
+    for(int i=0; i<img.numRanges; i++) {
+        out[n++] = img.ranges[i].start & 0xFF;
+        out[n++] = img.ranges[i].start >> 8;
+        out[n++] = img.ranges[i].length & 0xFF;
+        out[n++] = img.ranges[i].length >> 8;
+    }
+    memcpy(out + n, img.bytes, img.size);
+    n += img.size;
+
+    uint32_t crc = tripCrc32(out, 12);
+    crc = tripCrc32(out + PARAM_HEADER_SIZE, n - PARAM_HEADER_SIZE, crc);
+    for(int i=0; i<4; i++) out[12 + i] = crc >> (8 * i);
+    return n;
+}
+
+// Parse a file. False on a bad magic, version, layout or CRC.
+inline bool paramDecode(const uint8_t* p, size_t len, ParamImage& img) {
+    if(len < PARAM_HEADER_SIZE) return false;
+    if((p[0] | (p[1] << 8)) != PARAM_MAGIC || p[2] != PARAM_VERSION) return false;
+    int n = p[3];
+    uint16_t size = p[10] | (p[11] << 8);
+    if(n > PARAM_MAX_RANGES || len != PARAM_HEADER_SIZE + 4 * (size_t)n + size) return false;
+
+    uint32_t crc = tripCrc32(p, 12);
+    crc = tripCrc32(p + PARAM_HEADER_SIZE, len - PARAM_HEADER_SIZE, crc);
+    if(crc != ((uint32_t)p[12] | (p[13] << 8) | (p[14] << 16) | ((uint32_t)p[15] << 24))) return false;
+
+    ParamRange r[PARAM_MAX_RANGES];
+    const uint8_t* q = p + PARAM_HEADER_SIZE;
+    for(int i=0; i<n; i++, q += 4) {
+        r[i].start = q[0] | (q[1] << 8);
+        r[i].length = q[2] | (q[3] << 8);
+    }
+    if(!img.setRanges(r, n) || img.size != size) return false;
+    memcpy(img.mac, p + 4, 6);
+    memcpy(img.bytes, q, size);
+    return true;
+}
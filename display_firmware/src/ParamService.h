@@ -0,0 +1,183 @@
+#pragma once
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "ControllerSession.h"
+#include "Display.h"
+#include "ParamEngine.h"
+#include "SpscRing.h"
+
+#define PARAM_DIR         "/params"
+#define PARAM_FILE        PARAM_DIR "/backup.pim"
+#define PARAM_TMP_FILE    PARAM_DIR "/backup.tmp"
+#define PARAM_CONFIRM_MS  3000  // Second chord within this arms a restore
+
+// Target glue for ParamEngine: backs the controller's parameters up to
+// PARAM_FILE on LittleFS (mounted by the Recorder) and restores them from
+// it, e.g. onto a replacement controller. Progress and the outcome go to
+// the status line and Serial.
+//
+// Answers arrive in the notify callback and are queued to loop(), where
+// the engine runs; the stream and rendering carry on during a job.
+class ParamService {
+public:
+    void init(ControllerSession* link, DisplayManager* d) {
+        display = d;
+        engine.send = [link](const uint8_t* cmd, size_t len) { link->sendCommand(cmd, len); };
+        if(!LittleFS.exists(PARAM_DIR)) LittleFS.mkdir(PARAM_DIR);
+    }
+
+    // From the notify callback, for packets that are not stream data
+    void onPacket(const uint8_t* data, size_t length) {
+        if(!active || length > sizeof(Packet::data)) return;
+        Packet p;
+        p.len = length;
+        memcpy(p.data, data, length);
+        if(!inbox.push(p)) dropped++;
+    }
+
+    bool busy() const { return engine.busy(); }
+
+    void backup() {
+        if(!engine.startBackup(PARAM_RANGES, NUM_PARAM_RANGES)) return;
+        begin("Backup", false);
+    }
+
+    // Restore is destructive: the first call only asks for confirmation
+    void restore(const uint8_t* peerMac) {
+        uint32_t now = millis();
+        if(!armedAt || now - armedAt > PARAM_CONFIRM_MS) {
+            armedAt = now ? now : 1;
+            display->updateStatus("Restore? Repeat to confirm", TFT_ORANGE);
+            return;
+        }
+        armedAt = 0;
+
+        static ParamImage saved;
+        if(!load(saved)) {
+            display->updateStatus("No parameter backup", TFT_RED);
+            return;
+        }
+        if(memcmp(saved.mac, peerMac, 6) != 0) {
+            Serial.println("Params: restoring a backup from another controller");
+        }
+        if(engine.startRestore(saved)) begin("Restore", true);
+    }
+
+    // Connection lost mid-job
+    void abort() {
+        if(!engine.busy()) return;
+        engine.abort();
+        finish();
+    }
+
+    // From loop(): feed answers to the engine and step it
+    void service(const uint8_t* peerMac) {
+        if(!active) return;
+        Packet p;
+        while(inbox.pop(p)) engine.onPacket(p.data, p.len);
+        engine.service(millis());
+
+        if(engine.busy()) {
+            showProgress();
+            return;
+        }
+        if(engine.phase() == ParamEngine::DONE && !restoring) {
+            static ParamImage img;
+            img = engine.image();
+            memcpy(img.mac, peerMac, 6);
+            if(!save(img)) {
+                display->updateStatus("Backup not saved", TFT_RED);
+                active = false;
+                return;
+            }
+        }
+        finish();
+    }
+
+private:
+    struct Packet {
+        uint8_t len;
+        uint8_t data[23];
+    };
+
+    ParamEngine engine;
+    SpscRing<Packet, 32> inbox;
+    DisplayManager* display = nullptr;
+    volatile bool active = false;
+    bool restoring = false;
+    const char* job = "";
+    uint32_t armedAt = 0;
+    uint32_t startMs = 0;
+    int shownProgress = -1;
+    ParamEngine::Phase shownPhase = ParamEngine::IDLE;
+    uint32_t dropped = 0;
+
+    void begin(const char* name, bool restore) {
+        job = name;
+        restoring = restore;
+        Packet p;
+        while(inbox.pop(p)) {}
+        dropped = 0;
+        shownProgress = -1;
+        shownPhase = ParamEngine::IDLE;
+        startMs = millis();
+        active = true;
+        Serial.printf("Params: %s started\n", name);
+    }
+
+    void showProgress() {
+        int pct = engine.progress();
+        if(pct / 10 == shownProgress / 10 && engine.phase() == shownPhase) return;
+        shownProgress = pct;
+        shownPhase = engine.phase();
+
+        static const char* const STEP[] = {"", "reading", "writing", "verifying"};
+        char text[32];
+        snprintf(text, sizeof(text), "%s %s %d%%", job, STEP[shownPhase], pct);
+        display->updateStatus(text, TFT_CYAN);
+    }
+
+    void finish() {
+        active = false;
+        bool ok = engine.phase() == ParamEngine::DONE;
+        Serial.printf("Params: %s %s in %lu ms: %lu reads (%lu multi), %lu timeouts, "
+                      "%lu writes, %lu changed, %lu mismatched, %lu dropped\n",
+                      job, ok ? "done" : "failed", (unsigned long)(millis() - startMs),
+                      (unsigned long)engine.reads, (unsigned long)engine.multiResponses,
+                      (unsigned long)engine.timeouts, (unsigned long)engine.writes,
+                      (unsigned long)engine.changedBytes, (unsigned long)engine.mismatches,
+                      (unsigned long)dropped);
+
+        char text[32];
+        if(!ok) {
+            snprintf(text, sizeof(text), "%s failed", job);
+        } else if(restoring) {
+            snprintf(text, sizeof(text), "Restored, %lu bytes changed", (unsigned long)engine.changedBytes);
+        } else {
+            snprintf(text, sizeof(text), "Backup saved");
+        }
+        display->updateStatus(text, ok ? TFT_GREEN : TFT_RED);
+    }
+
+    // Written to a temporary file first, so a power cut keeps the old backup
+    bool save(const ParamImage& img) {
+        static uint8_t buf[PARAM_FILE_MAX];
+        size_t n = paramEncode(img, buf);
+        File f = LittleFS.open(PARAM_TMP_FILE, FILE_WRITE);
+        if(!f) return false;
+        bool ok = f.write(buf, n) == n;
+        f.close();
+        if(!ok) return false;
+        LittleFS.remove(PARAM_FILE);
+        return LittleFS.rename(PARAM_TMP_FILE, PARAM_FILE);
+    }
+
+    bool load(ParamImage& img) {
+        static uint8_t buf[PARAM_FILE_MAX];
+        File f = LittleFS.open(PARAM_FILE, FILE_READ);
+        if(!f) return false;
+        size_t n = f.read(buf, sizeof(buf));
+        f.close();
+        return paramDecode(buf, n, img);
+    }
+};
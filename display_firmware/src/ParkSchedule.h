@@ -0,0 +1,45 @@
+#pragma once
+#include <stdint.h>
+
+#define PARK_CYCLE_MS    10000UL
+#define PARK_SCAN_S      1
+#define DEEP_AFTER_MS    (60UL * 60 * 1000)
+
+enum ParkStep : uint8_t {
+    PARK_WAIT,          // Burst scan running
+    PARK_SCAN,          // Start a PARK_SCAN_S burst
+    PARK_LIGHT_SLEEP,   // Burst over: light sleep until the next cycle
+    PARK_DEEP_SLEEP,    // Burst over, parked DEEP_AFTER_MS: deep sleep
+};
+
+// Scan / sleep schedule of the PARKED state (Power.h). Portable
+// (test/test_power).
+//
+// Every cycle starts with a scan burst, and sleep of either kind is only
+// chosen once the burst is over: a unit woken from deep sleep by the timer
+// counts as parked for DEEP_AFTER_MS already, and must still look for the
+// controller once before it goes back to sleep.
+class ParkSchedule {
+public:
+    void enter(uint32_t now, bool timerWake) {
+        parkedSince = timerWake ? now - DEEP_AFTER_MS : now;
+        bursting = false;
+    }
+
+    // `scanning`: the burst's scan has not stopped by itself yet
+    ParkStep step(uint32_t now, bool scanning) {
+        if(!bursting) {
+            bursting = true;
+            burstEnd = now + PARK_SCAN_S * 1000;
+            return PARK_SCAN;
+        }
+        if((int32_t)(now - burstEnd) < 0 || scanning) return PARK_WAIT;
+        bursting = false;
+        return now - parkedSince >= DEEP_AFTER_MS ? PARK_DEEP_SLEEP : PARK_LIGHT_SLEEP;
+    }
+
+private:
+    uint32_t parkedSince = 0;
+    uint32_t burstEnd = 0;
+    bool bursting = false;
+};
@@ -0,0 +1,74 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "ControllerSession.h"
+#include "Display.h"
+#include "RegisterPoller.h"
+#include "VehicleState.h"
+
+// Target glue for RegisterPoller: sends its reads through the session,
+// publishes the answers into VehicleState (so widgets, rules and the trip
+// log see polled registers like any other field) and reports changes of the
+// controller's error code on the status line and Serial.
+//
+// The error code is kept as the raw u32 besides its VehicleState slot,
+// which holds a float and so only the low 24 bits exactly.
+class PollService {
+public:
+    void init(ControllerSession* link, VehicleState* out, DisplayManager* d) {
+        state = out;
+        display = d;
+        poller.send = [link](const uint8_t* cmd, size_t len) { link->sendCommand(cmd, len); };
+    }
+
+    // Connected and the stream is configured
+    void start() {
+        errorCode.store(0);
+        shownCode = 0;
+        poller.start(millis());
+    }
+
+    void stop() {
+        poller.stop();
+    }
+
+    // From the notify callback, for packets that are not stream data
+    void onPacket(const uint8_t* data, size_t length) {
+        RegisterPoller::Result r;
+        if(!poller.onResponse(data, length, r)) return;
+        state->update(r.address, r.value);
+        if(r.address == ADDR_ERROR) errorCode.store((uint32_t)r.raw);
+    }
+
+    // From loop(): next read if one is due, fault report if the code changed
+    void service() {
+        poller.service(millis());
+
+        uint32_t code = errorCode.load();
+        if(code == shownCode) return;
+        shownCode = code;
+
+        char faults[28];
+        char text[32];
+        if(RegisterPoller::formatFaults(code, faults, sizeof(faults))) {
+            snprintf(text, sizeof(text), "FAULT %s", faults);
+            display->updateStatus(text, TFT_RED);
+        } else {
+            snprintf(text, sizeof(text), "Faults cleared");
+            display->updateStatus(text, TFT_GREEN);
+        }
+        Serial.printf("[%lu] Controller error code 0x%08lX: %s\n", millis(),
+                      (unsigned long)code, code ? faults : "none");
+    }
+
+    uint32_t faults() const { return errorCode.load(); }
+
+    const RegisterPoller& stats() const { return poller; }
+
+private:
+    RegisterPoller poller;
+    VehicleState* state = nullptr;
+    DisplayManager* display = nullptr;
+    std::atomic<uint32_t> errorCode{0};
+    uint32_t shownCode = 0;     // Last code reported, loop() only
+};
@@ -0,0 +1,338 @@
+#pragma once
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include <driver/gpio.h>
+#include <driver/ledc.h>
+#include <driver/rtc_io.h>
+#include <esp_sleep.h>
+#include <esp_pm.h>
+#include "Config.h"
+#include "BleClient.h"
+#include "ControllerSession.h"
+#include "PageLayers.h"
+#include "ParkSchedule.h"
+
+// Power management.
+//
+// States and what they switch:
+//
+//   ACTIVE     Controller streaming changing values, or input in the last
+//              INPUT_AWAKE_MS. Backlight at the user level, panel normal mode,
+//              fast scanning when not connected.
+//   STATIC     Connected but nothing on screen changed for STATIC_AFTER_MS.
+//              Backlight at 40 % of the user level, panel idle (8-colour) mode.
+//   SEARCHING  No controller. Backlight at 20 %, panel partial mode showing
+//              only the status line, scan duty cycle 60 ms / 1 s, automatic
+//              light sleep when the core is built with CONFIG_PM_ENABLE.
+//   PARKED     No controller and no input for PARK_AFTER_MS. Backlight off,
+//              panel in sleep mode, 1 s scan burst every PARK_CYCLE_MS with
+//              explicit light sleep in between (woken by timer or a button).
+//              After DEEP_AFTER_MS in PARKED the unit deep sleeps at the end of
+//              a burst and wakes on a button, or every DEEP_WAKE_MIN minutes
+//              for one more scan burst (ParkSchedule.h).
+//
+// Estimated current draw per state (3.3 V rail, and at the 12 V auxiliary
+// input through an ~85 % buck). Derived from ESP32-S3 / ST7789 datasheet
+// figures plus the backlight LEDs; measure the actual unit before relying on
+// them for battery sizing.
+//
+//   State       3.3 V rail   12 V input
+//   ACTIVE      ~160 mA      ~52 mA     (backlight ~60 mA at full)
+//   STATIC      ~115 mA      ~37 mA
+//   SEARCHING   ~45 mA       ~15 mA     (~30 mA without auto light sleep)
+//   PARKED      ~12 mA       ~4 mA      (scan bursts dominate)
+//   Deep sleep  ~0.3 mA      ~0.1 mA    (plus regulator quiescent current)
+//
+// At the 12 V input, a vehicle parked for a week therefore costs ~0.004 Ah
+// for the hour in PARKED, then ~0.003 Ah/day in deep sleep (0.1 mA, plus
+// the DEEP_WAKE_MIN scan bursts), ~0.03 Ah in all. Left on in ACTIVE it
+// would draw ~1.25 Ah/day, ~9 Ah over the week.
+
+#define INPUT_AWAKE_MS   15000UL
+#define STATIC_AFTER_MS  30000UL
+#define PARK_AFTER_MS    (5UL * 60 * 1000)
+#define ALERT_FLASH_MS   250UL
+#define DEEP_WAKE_MIN    15
+
+// ST7789 power commands
+#define ST7789_SLPIN   0x10
+#define ST7789_SLPOUT  0x11
+#define ST7789_PTLON   0x12
+#define ST7789_NORON   0x13
+#define ST7789_PTLAR   0x30
+#define ST7789_IDMOFF  0x38
+#define ST7789_IDMON   0x39
+
+// Backlight on LEDC with hardware fades. The timer runs from the RTC 8 MHz
+// clock, which stays up in light sleep, so a dimmed backlight does not flicker.
+class Backlight {
+public:
+    void init(uint8_t pin) {
+        this->pin = pin;
+        gpio_hold_dis((gpio_num_t)pin); // Held low through deep sleep (holdOff())
+        ledc_timer_config_t timer = {};
+        timer.speed_mode = LEDC_LOW_SPEED_MODE;
+        timer.duty_resolution = LEDC_TIMER_8_BIT;
+        timer.timer_num = LEDC_TIMER_0;
+        timer.freq_hz = 20000;
+        timer.clk_cfg = LEDC_USE_RTC8M_CLK;
+        ledc_timer_config(&timer);
+
+        ledc_channel_config_t channel = {};
+        channel.gpio_num = pin;
+        channel.speed_mode = LEDC_LOW_SPEED_MODE;
+        channel.channel = LEDC_CHANNEL_0;
+        channel.timer_sel = LEDC_TIMER_0;
+        channel.duty = 0;
+        ledc_channel_config(&channel);
+
+        ledc_fade_func_install(0);
+        esp_sleep_pd_config(ESP_PD_DOMAIN_RTC8M, ESP_PD_OPTION_ON);
+    }
+
+    // Fade to level (0-255) in ms, without blocking
+    void fadeTo(uint8_t level, uint32_t ms) {
+        target = level;
+        ledc_set_fade_with_time(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0, level, ms);
+        ledc_fade_start(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0, LEDC_FADE_NO_WAIT);
+    }
+
+    uint8_t level() const { return target; }
+
+    // Before deep sleep, which stops LEDC: the pin would float and the
+    // backlight driver could light up. Held low until the next init().
+    void holdOff() {
+        ledc_stop(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0, 0);
+        gpio_reset_pin((gpio_num_t)pin);
+        gpio_set_direction((gpio_num_t)pin, GPIO_MODE_OUTPUT);
+        gpio_set_level((gpio_num_t)pin, 0);
+        gpio_hold_en((gpio_num_t)pin);
+        gpio_deep_sleep_hold_en();
+    }
+
+private:
+    uint8_t pin = 0;
+    uint8_t target = 0;
+};
+
+enum PowerState : uint8_t {
+    PWR_ACTIVE,
+    PWR_STATIC,
+    PWR_SEARCHING,
+    PWR_PARKED,
+};
+
+class PowerManager {
+public:
+    void init(TFT_eSPI& display, BleClientManager& client, const ControllerSession& controller) {
+        tft = &display;
+        ble = &client;
+        session = &controller;
+        backlight.init(TFT_BL);
+
+        uint32_t now = millis();
+        lastInput = lastData = now;
+
+        // Woken from deep sleep by the timer: stay dark, scan once, sleep again
+        if(esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER) {
+            timerWake = true;
+            enter(PWR_PARKED, now);
+        } else {
+            enter(PWR_ACTIVE, now);
+        }
+    }
+
+    // Booted from a deep sleep timer wake (no splash, panel stays off)
+    bool wokeFromTimer() const { return timerWake; }
+
+    void onInput() {
+        lastInput = millis();
+        timerWake = false;
+    }
+
+    // Something on screen changed
+    void onData() {
+        lastData = millis();
+    }
+
+    void toggleBrightness() {
+        userLevel = (userLevel == 255) ? 50 : 255;
+        if(current == PWR_ACTIVE || current == PWR_STATIC) backlight.fadeTo(levelFor(current), 200);
+    }
+
+    // Alarm flashing (see RuleService): the backlight blinks at ALERT_FLASH_MS
+    // and the display stays ACTIVE while it is on
+    void setAlert(bool on) {
+        if(on == alert) return;
+        alert = on;
+        if(!on) backlight.fadeTo(levelFor(current), 100);
+    }
+
+    PowerState state() const { return current; }
+
+    // Evaluate transitions; in PARKED this also runs the scan/sleep cycle
+    void service() {
+        uint32_t now = millis();
+        PowerState next;
+        if(alert) lastData = now;
+        uint32_t activity = max(lastInput, lastData);
+
+        if(now - lastInput < INPUT_AWAKE_MS && !timerWake) {
+            next = PWR_ACTIVE;
+        } else if(session->isConnected()) {
+            next = (now - lastData < STATIC_AFTER_MS) ? PWR_ACTIVE : PWR_STATIC;
+        } else if(now - activity >= PARK_AFTER_MS || timerWake) {
+            next = PWR_PARKED;
+        } else {
+            next = PWR_SEARCHING;
+        }
+
+        if(next != current) enter(next, now);
+        if(current == PWR_PARKED) parkedCycle(now);
+
+        if(alert && current != PWR_PARKED && now - lastFlash >= ALERT_FLASH_MS) {
+            lastFlash = now;
+            flashOn = !flashOn;
+            backlight.fadeTo(flashOn ? 255 : 0, 20);
+        }
+    }
+
+private:
+    TFT_eSPI* tft = nullptr;
+    BleClientManager* ble = nullptr;      // Scanning
+    const ControllerSession* session = nullptr; // Link state, any transport
+    Backlight backlight;
+    PowerState current = PWR_ACTIVE;
+    uint8_t userLevel = 255;
+    bool timerWake = false;
+    bool panelAsleep = false;
+    bool alert = false;
+    bool flashOn = false;
+    uint32_t lastFlash = 0;
+
+    uint32_t lastInput = 0;
+    uint32_t lastData = 0;
+    ParkSchedule park;
+
+    // Backlight level of a state, from the user level
+    uint8_t levelFor(PowerState s) const {
+        switch(s) {
+            case PWR_ACTIVE:    return userLevel;
+            case PWR_STATIC:    return userLevel * 2 / 5;
+            case PWR_SEARCHING: return userLevel / 5;
+            default:            return 0;
+        }
+    }
+
+    void command(uint8_t cmd) {
+        tft->writecommand(cmd);
+    }
+
+    void setPanelMode(bool idle, bool partial) {
+        if(panelAsleep) {
+            command(ST7789_SLPOUT);
+            TRACE_BEGIN(TR_DELAY, 120);
+            delay(120); // Required before the next command after sleep out
+            TRACE_END(TR_DELAY, 0);
+            panelAsleep = false;
+        }
+        if(partial) {
+            // Only the status line rows keep refreshing
+            command(ST7789_PTLAR);
+            tft->writedata(STATUS_Y >> 8);
+            tft->writedata(STATUS_Y & 0xFF);
+            tft->writedata((TFT_HEIGHT - 1) >> 8);
+            tft->writedata((TFT_HEIGHT - 1) & 0xFF);
+            command(ST7789_PTLON);
+        } else {
+            command(ST7789_NORON);
+        }
+        command(idle ? ST7789_IDMON : ST7789_IDMOFF);
+    }
+
+    void setAutoLightSleep(bool enable) {
+#if CONFIG_PM_ENABLE
+        esp_pm_config_esp32s3_t pm = {};
+        pm.max_freq_mhz = 240;
+        pm.min_freq_mhz = 40;
+        pm.light_sleep_enable = enable;
+        esp_pm_configure(&pm);
+#else
+        (void)enable; // Prebuilt core without PM: only PARKED sleeps, explicitly
+#endif
+    }
+
+    void enter(PowerState next, uint32_t now) {
+        Serial.printf("Power: %d -> %d\n", current, next);
+        current = next;
+
+        switch(next) {
+            case PWR_ACTIVE:
+                setPanelMode(false, false);
+                backlight.fadeTo(levelFor(next), 300);
+                setAutoLightSleep(false);
+                ble->setScanDuty(SCAN_FAST);
+                break;
+
+            case PWR_STATIC:
+                setPanelMode(true, false);
+                backlight.fadeTo(levelFor(next), 1000);
+                setAutoLightSleep(false); // Connected, as in ACTIVE; SEARCHING may have turned it on
+                ble->setScanDuty(SCAN_FAST);
+                break;
+
+            case PWR_SEARCHING:
+                setPanelMode(true, true);
+                backlight.fadeTo(levelFor(next), 1000);
+                setAutoLightSleep(true);
+                ble->setScanDuty(SCAN_DUTY);
+                break;
+
+            case PWR_PARKED:
+                park.enter(now, timerWake);
+                backlight.fadeTo(0, 1000);
+                command(ST7789_SLPIN);
+                panelAsleep = true;
+                if(ble->isScanning) ble->stopScan();
+                break;
+        }
+    }
+
+    // Scan burst, then light sleep until the next one
+    void parkedCycle(uint32_t now) {
+        if(session->isConnected() || ble->hasFound()) return; // Found: loop() connects first
+
+        ParkStep step = park.step(now, ble->isScanning);
+        if(step == PARK_WAIT) return;
+        if(step == PARK_SCAN) {
+            ble->setScanDuty(SCAN_BURST);
+            ble->startScan(PARK_SCAN_S);
+            return;
+        }
+
+        ble->stopScan();
+        if(step == PARK_DEEP_SLEEP) deepSleep();
+        for(uint8_t pin : {PIN_BTN_VIEW, PIN_BTN_BRIGHT, PIN_BTN_RECONNECT}) {
+            gpio_wakeup_enable((gpio_num_t)pin, GPIO_INTR_HIGH_LEVEL);
+        }
+        esp_sleep_enable_gpio_wakeup();
+        esp_sleep_enable_timer_wakeup((uint64_t)(PARK_CYCLE_MS - PARK_SCAN_S * 1000) * 1000);
+        esp_light_sleep_start();
+
+        if(esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO) onInput();
+    }
+
+    void deepSleep() {
+        Serial.println("Power: deep sleep");
+        Serial.flush();
+        uint64_t mask = 0;
+        for(uint8_t pin : {PIN_BTN_VIEW, PIN_BTN_BRIGHT, PIN_BTN_RECONNECT}) {
+            rtc_gpio_pulldown_en((gpio_num_t)pin);
+            mask |= 1ULL << pin;
+        }
+        esp_sleep_enable_ext1_wakeup(mask, ESP_EXT1_WAKEUP_ANY_HIGH);
+        esp_sleep_enable_timer_wakeup((uint64_t)DEEP_WAKE_MIN * 60 * 1000000ULL);
+        backlight.holdOff();
+        esp_deep_sleep_start();
+    }
+};
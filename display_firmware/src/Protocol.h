@@ -1,5 +1,6 @@
 #pragma once
-#include <Arduino.h>
+#include <stdint.h>
+#include <stddef.h>
 #include <vector>
 #include "Config.h"
 
@@ -53,10 +54,12 @@ public:
         uint16_t address;
         float value;
         bool valid;
+        int slot;     // Index in TARGET_FIELDS, -1 if not monitored
+        int32_t raw;  // Value on the wire, before calibration
     };
 
     static ParsedData parsePacket(const uint8_t* data, size_t length) {
-        ParsedData result = {0, 0, false};
+        ParsedData result = {0, 0, false, -1, 0};
         if(length < 3) return result;
 
         // Header: [AddrLow] [AddrHigh | Flags]
@@ -68,15 +71,9 @@ public:
         result.address = address;
 
         // Find config for this address
-        const DataFieldConfig* cfg = nullptr;
-        for(int i=0; i<NUM_FIELDS; i++) {
-            if(TARGET_FIELDS[i].address == address) {
-                cfg = &TARGET_FIELDS[i];
-                break;
-            }
-        }
-
-        if(!cfg) return result;
+        int idx = fieldIndex(address);
+        if(idx < 0 || idx >= NUM_FIELDS) return result;
+        const DataFieldConfig* cfg = &TARGET_FIELDS[idx];
         
         // payload starts at index 2
         // Check size
@@ -103,6 +100,8 @@ public:
         }
 
         // Calibrate: (Raw - B) / K
+        result.slot = idx;
+        result.raw = raw;
         result.value = (raw - cfg->b) / cfg->k;
         result.valid = true;
         
@@ -0,0 +1,157 @@
+#pragma once
+#include <stdint.h>
+#include <math.h>
+
+// Recursive least squares for y = a + b x with exponential forgetting.
+// O(1) per update. Doubles: x is cumulative (Wh, km) and updates are rare
+// (see RangeEstimator), so the soft-float cost on the ESP32 doesn't matter.
+struct Rls2 {
+    double a, b;            // Intercept, slope
+    double p00, p01, p11;   // Parameter covariance (up to noise scale)
+    double noise;           // Forgetting-weighted mean squared prediction error
+    double lambda;
+    uint32_t n;
+
+    void reset(double forget, double priorA, double priorB, double varA, double varB) {
+        a = priorA; b = priorB;
+        p00 = varA; p01 = 0; p11 = varB;
+        noise = 0;
+        lambda = forget;
+        n = 0;
+    }
+
+    void update(double x, double y) {
+        double px0 = p00 + p01 * x;
+        double px1 = p01 + p11 * x;
+        double denom = lambda + px0 + x * px1;
+        double k0 = px0 / denom, k1 = px1 / denom;
+        double err = y - (a + b * x);
+
+        a += k0 * err;
+        b += k1 * err;
+        p00 = (p00 - k0 * px0) / lambda;
+        p01 = (p01 - k0 * px1) / lambda;
+        p11 = (p11 - k1 * px1) / lambda;
+        noise = n == 0 ? err * err : lambda * noise + (1 - lambda) * err * err;
+        n++;
+    }
+
+    // Standard deviation of the slope estimate
+    double slopeSigma() const { return sqrt(noise * (p11 > 0 ? p11 : 0)); }
+};
+
+// Remaining range from two online fits, both O(1) per sample:
+//   pack:  SoC % against cumulative net Wh -> slope = -% per Wh. Slow
+//          forgetting: it learns the usable pack capacity over rides.
+//   usage: cumulative net Wh against km -> slope = Wh per km. Faster
+//          forgetting (~5 km memory): it follows terrain, load and riding.
+// range = SoC / (% per Wh x Wh per km), and the confidence band propagates
+// both slopes' standard deviations (first order, independent errors).
+//
+// Fits are fed at fixed steps of energy and distance rather than per sample,
+// so standing still or streaming faster does not reweight them.
+class RangeEstimator {
+public:
+    static constexpr double PACK_STEP_WH = 5.0;     // Pack fit update spacing
+    static constexpr double USAGE_STEP_KM = 0.05;   // Usage fit update spacing
+    static constexpr double PACK_FORGET = 0.9995;   // ~2000 updates = 10 kWh
+    static constexpr double USAGE_FORGET = 0.99;    // ~100 updates = 5 km
+    static const uint32_t MIN_PACK_UPDATES = 40;    // 200 Wh seen
+    static const uint32_t MIN_USAGE_UPDATES = 20;   // 1 km seen
+    static constexpr double BAND_SIGMAS = 2.0;
+
+    // Persisted learning, so the pack fit carries over between rides
+    struct State {
+        uint32_t version;
+        Rls2 pack;
+        Rls2 usage;
+        double packX;   // Last x fed to each fit, to continue the axes
+        double usageX;
+    };
+    static const uint32_t STATE_VERSION = 1;
+
+    struct Estimate {
+        bool valid;
+        float km;
+        float lowKm;
+        float highKm;
+    };
+
+    RangeEstimator() { reset(); }
+
+    void reset() {
+        st.version = STATE_VERSION;
+        // Weak priors: the first update dominates
+        st.pack.reset(PACK_FORGET, 100.0, 0.0, 1e4, 1.0);
+        st.usage.reset(USAGE_FORGET, 0.0, 0.0, 1e4, 1e4);
+        st.packX = st.usageX = 0;
+        rebase();
+    }
+
+    bool restore(const State& saved) {
+        if(saved.version != STATE_VERSION) return false;
+        st = saved;
+        rebase();
+        return true;
+    }
+
+    // The cumulative inputs restarted (new trip, reboot): re-anchor the axes
+    // on the next update. Intercepts adapt, learned slopes carry over.
+    void rebase() { started = false; }
+
+    const State& state() const { return st; }
+
+    // Latest SoC % (only once the controller reported one), and cumulative
+    // net Wh and km since any fixed origin.
+    // Returns true if a fit moved, i.e. estimate() may have changed.
+    bool update(float soc, double netWh, double km) {
+        bool changed = soc != lastSoc;
+        lastSoc = soc;
+        if(!started) {
+            started = true;
+            whOrigin = netWh - st.packX;
+            kmOrigin = km - st.usageX;
+            nextPackWh = netWh;
+            nextUsageKm = km;
+        }
+        if(netWh >= nextPackWh) {
+            st.packX = netWh - whOrigin;
+            st.pack.update(st.packX, soc);
+            nextPackWh = netWh + PACK_STEP_WH;
+            changed = true;
+        }
+        if(km >= nextUsageKm) {
+            st.usageX = km - kmOrigin;
+            st.usage.update(st.usageX, netWh - whOrigin);
+            nextUsageKm = km + USAGE_STEP_KM;
+            changed = true;
+        }
+        return changed;
+    }
+
+    Estimate estimate() const {
+        Estimate e = {false, 0, 0, 0};
+        double pctPerWh = -st.pack.b;
+        double whPerKm = st.usage.b;
+        if(st.pack.n < MIN_PACK_UPDATES || st.usage.n < MIN_USAGE_UPDATES) return e;
+        if(pctPerWh <= 0 || whPerKm <= 1.0) return e; // Not discharging on average
+
+        double range = lastSoc / (pctPerWh * whPerKm);
+        double relA = st.pack.slopeSigma() / pctPerWh;
+        double relB = st.usage.slopeSigma() / whPerKm;
+        double sigma = range * sqrt(relA * relA + relB * relB);
+
+        e.valid = true;
+        e.km = (float)range;
+        e.lowKm = (float)fmax(0.0, range - BAND_SIGMAS * sigma);
+        e.highKm = (float)(range + BAND_SIGMAS * sigma);
+        return e;
+    }
+
+private:
+    State st;
+    bool started = false;
+    float lastSoc = 0;
+    double whOrigin = 0, kmOrigin = 0;
+    double nextPackWh = 0, nextUsageKm = 0;
+};
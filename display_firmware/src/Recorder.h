@@ -0,0 +1,178 @@
+#pragma once
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "Config.h"
+#include "SpscRing.h"
+#include "TripLog.h"
+
+// Background trip recorder.
+//
+// The BLE notify callback pushes raw samples into a RAM ring and returns; a
+// low-priority task on core 0 drains the ring into TripLog blocks and appends
+// them to /trips/NNNNN.tlg on LittleFS. A new file starts per connection and
+// when a file reaches LOG_FILE_BYTES; the oldest files are deleted beyond
+// LOG_MAX_FILES.
+//
+// Budget, at 8 fields x 10 Hz = 80 samples/s and ~3 bytes per sample:
+//   Log rate      ~240 B/s, ~0.86 MB per riding hour, one 1 KB block per ~4 s
+//   Retention     LOG_MAX_FILES x LOG_FILE_BYTES = 1 MB, ~1.2 h of riding
+//   Space         The 1.4 MB data partition of the default table also holds
+//                 the packet trace (TRACE_FILE_BYTES, 128 KB) and the
+//                 parameter backup (a few KB, twice while it is replaced);
+//                 ~250 KB stay for LittleFS metadata and block rounding
+//   Flash wear    LittleFS levels wear over the whole partition (~350 x 4 KB
+//                 sectors). With ~4x write amplification for tail rewrites
+//                 and metadata, 1 MB/h costs ~1 erase per sector per 1.5 h;
+//                 at 100k cycles that is >100k riding hours.
+//   Stalls        Flash erase/program disables the cache for a few ms per
+//                 chunk. The ring holds RECORDER_RING samples (~12 s at 80/s),
+//                 so writes never push back on the BLE callback; overflow
+//                 drops samples and counts them in `dropped`.
+//   Power loss    Each block is flushed when written, so at most the block
+//                 being filled (BLOCK_MAX_AGE_MS of data) is lost.
+
+#define RECORDER_RING      1024
+#define BLOCK_MAX_AGE_MS   5000
+#define LOG_FILE_BYTES     (256UL * 1024)
+#define LOG_MAX_FILES      4
+#define LOG_DIR            "/trips"
+
+class TripRecorder {
+public:
+    // Statistics, read from loop() for diagnostics
+    uint32_t dropped = 0;
+    uint32_t blocksWritten = 0;
+    uint32_t bytesWritten = 0;
+    uint32_t maxWriteUs = 0;
+
+    bool init() {
+        if(!LittleFS.begin(true)) {
+            Serial.println("Recorder: LittleFS mount failed");
+            return false;
+        }
+        if(!LittleFS.exists(LOG_DIR)) LittleFS.mkdir(LOG_DIR);
+        scanFiles();
+
+        xTaskCreatePinnedToCore(recorderTask, "recorder", 4096, this, 1, &task, 0);
+        return true;
+    }
+
+    // Producer side, called from the BLE notify callback; never blocks
+    void push(int slot, int32_t raw) {
+        if(!task || slot < 0) return;
+        TripSample s = {(uint32_t)millis(), (uint8_t)slot, raw};
+        if(!ring.push(s)) {
+            dropped++;
+            return;
+        }
+        if(ring.size() == RECORDER_RING / 2) xTaskNotifyGive(task);
+    }
+
+    // Start a new file with the next sample (called on connect)
+    void startTrip() {
+        newTrip = true;
+        if(task) xTaskNotifyGive(task);
+    }
+
+    // Write out the partial block now (called on disconnect)
+    void flush() {
+        flushRequested = true;
+        if(task) xTaskNotifyGive(task);
+    }
+
+private:
+    SpscRing<TripSample, RECORDER_RING> ring;
+    TripBlockEncoder block;
+    TaskHandle_t task = nullptr;
+    File file;
+    uint32_t blockStart = 0;
+    volatile bool newTrip = false;
+    volatile bool flushRequested = false;
+
+    uint32_t oldestFile = 0; // Numbers of the files on flash, oldest..next
+    uint32_t nextFile = 0;
+
+    static void recorderTask(void* arg) {
+        TripRecorder* self = (TripRecorder*)arg;
+        for(;;) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+            self->drain();
+        }
+    }
+
+    void drain() {
+        // The next trip's samples must not share a block with the last trip's
+        if(newTrip) {
+            newTrip = false;
+            writeBlock();
+            if(file) file.close();
+        }
+
+        TripSample s;
+        while(ring.pop(s)) {
+            if(block.samples() == 0) blockStart = millis();
+            if(!block.add(s)) {
+                writeBlock();
+                blockStart = millis();
+                block.add(s);
+            }
+        }
+
+        if(block.samples() > 0 && (flushRequested || millis() - blockStart >= BLOCK_MAX_AGE_MS)) {
+            writeBlock();
+        }
+        flushRequested = false;
+    }
+
+    void writeBlock() {
+        if(block.samples() == 0) return;
+        size_t len = block.finish();
+
+        uint32_t t0 = micros();
+        if(!file || file.size() + len > LOG_FILE_BYTES) rotate();
+        if(file) {
+            file.write(block.data(), len);
+            file.flush();
+            blocksWritten++;
+            bytesWritten += len;
+        }
+        uint32_t dt = micros() - t0;
+        if(dt > maxWriteUs) maxWriteUs = dt;
+
+        block.reset();
+    }
+
+    static void pathFor(uint32_t n, char* out, size_t size) {
+        snprintf(out, size, LOG_DIR "/%05lu.tlg", (unsigned long)n);
+    }
+
+    void rotate() {
+        if(file) file.close();
+
+        char path[32];
+        pathFor(nextFile++, path, sizeof(path));
+        file = LittleFS.open(path, FILE_WRITE);
+
+        while(nextFile - oldestFile > LOG_MAX_FILES) {
+            pathFor(oldestFile++, path, sizeof(path));
+            LittleFS.remove(path);
+        }
+    }
+
+    // Find the range of file numbers already on flash
+    void scanFiles() {
+        File dir = LittleFS.open(LOG_DIR);
+        bool any = false;
+        uint32_t lo = 0, hi = 0;
+        for(File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+            uint32_t n = strtoul(f.name(), nullptr, 10);
+            if(!any || n < lo) lo = n;
+            if(!any || n > hi) hi = n;
+            any = true;
+        }
+        oldestFile = any ? lo : 0;
+        nextFile = any ? hi + 1 : 0;
+    }
+};
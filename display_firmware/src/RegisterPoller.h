@@ -0,0 +1,166 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <functional>
+#include "Config.h"
+
+// Background reads of registers that are not streamed (POLLED_REGISTERS).
+//
+// Each register is read with a plain read command, [AddrLow][AddrHigh|0x80]
+// [Size], every periodMs. At most one read is outstanding, and reads are
+// spaced by GAP_MS, so the poller adds a few small writes per second next
+// to the time-data upload and never queues behind it. A read that gets no
+// answer within TIMEOUT_MS is dropped and retried at its next period.
+//
+// service() runs in loop(); onResponse() runs in the BLE notify callback.
+// The outstanding read is an atomic, so either side may retire it.
+class RegisterPoller {
+public:
+    static const uint32_t TIMEOUT_MS = 300;
+    static const uint32_t GAP_MS = 50;
+
+    // Writes a command to the controller (without response)
+    typedef std::function<void(const uint8_t* cmd, size_t len)> SendFn;
+    SendFn send;
+
+    struct Result {
+        uint16_t address;
+        int index;      // Into POLLED_REGISTERS
+        int32_t raw;    // Sign-extended per the register's type
+        float value;    // (raw - b) / k
+    };
+
+    // Statistics
+    uint32_t reads = 0;
+    std::atomic<uint32_t> responses{0};
+    uint32_t timeouts = 0;
+
+    // Connected: spread the first reads over GAP_MS steps so they don't
+    // all fall due together
+    void start(uint32_t ms) {
+        for(int i=0; i<NUM_POLLED; i++) due[i] = ms + (i + 1) * GAP_MS;
+        pending.store(-1);
+        lastSend = ms;
+        running = true;
+    }
+
+    void stop() {
+        running = false;
+        pending.store(-1);
+    }
+
+    bool isRunning() const { return running; }
+
+    // From loop(): expire a lost read, then issue the most overdue one.
+    // Returns true if a read was sent.
+    bool service(uint32_t ms) {
+        if(!running || !send) return false;
+
+        int p = pending.load();
+        if(p >= 0) {
+            if(ms - lastSend < TIMEOUT_MS) return false;
+            if(!pending.compare_exchange_strong(p, -1)) return false; // Answered just now
+            timeouts++;
+        }
+        if(ms - lastSend < GAP_MS) return false;
+
+        int next = -1;
+        int32_t worst = 0;
+        for(int i=0; i<NUM_POLLED; i++) {
+            int32_t late = (int32_t)(ms - due[i]);
+            if(late >= 0 && (next < 0 || late > worst)) {
+                next = i;
+                worst = late;
+            }
+        }
+        if(next < 0) return false;
+
+        const PolledRegisterConfig& r = POLLED_REGISTERS[next];
+        uint8_t cmd[3] = {
+            (uint8_t)(r.address & 0xFF),
+            (uint8_t)(((r.address >> 8) & 0x1F) | 0x80),
+            r.size,
+        };
+        due[next] = ms + r.periodMs;
+        lastSend = ms;
+        pending.store(next);
+        reads++;
+        send(cmd, sizeof(cmd));
+        return true;
+    }
+
+    // From the notify callback, for packets the stream parser did not take.
+    // Returns true (and fills `out`) if it is a polled register's value.
+    // Answers arriving after their timeout are still used.
+    bool onResponse(const uint8_t* data, size_t len, Result& out) {
+        if(len < 3) return false;
+        uint16_t address = ((data[1] & 0x1F) << 8) | data[0];
+        int i = find(address);
+        if(i < 0) return false;
+        const PolledRegisterConfig& r = POLLED_REGISTERS[i];
+        if(len < 2 + (size_t)r.size) return false;
+
+        out.address = address;
+        out.index = i;
+        out.raw = decode(data + 2, r.size, r.isSigned);
+        out.value = (out.raw - r.b) / r.k;
+
+        int p = i;
+        pending.compare_exchange_strong(p, -1);
+        responses++;
+        return true;
+    }
+
+    // Active fault bits as "E3 E7 E12", as the app lists them ("Error bit N").
+    // Bits that don't fit are summarised as "+n". Returns the bit count.
+    static int formatFaults(uint32_t code, char* out, size_t n) {
+        if(n == 0) return 0;
+        out[0] = '\0';
+        size_t used = 0;
+        int total = 0, shown = 0;
+        for(int bit=0; bit<32; bit++) {
+            if(!(code & (1UL << bit))) continue;
+            total++;
+            char item[5];
+            int len = snprintf(item, sizeof(item), "%sE%d", shown ? " " : "", bit);
+            // Keep room for a " +nn" tail in case later bits don't fit
+            if(used + len + 4 < n) {
+                memcpy(out + used, item, len + 1);
+                used += len;
+                shown++;
+            }
+        }
+        if(shown < total) snprintf(out + used, n - used, "%s+%d", shown ? " " : "", total - shown);
+        return total;
+    }
+
+private:
+    uint32_t due[NUM_POLLED] = {};
+    uint32_t lastSend = 0;
+    std::atomic<int> pending{-1};   // POLLED_REGISTERS index awaiting an answer
+    bool running = false;
+
+    static int find(uint16_t address) {
+        for(int i=0; i<NUM_POLLED; i++) {
+            if(POLLED_REGISTERS[i].address == address) return i;
+        }
+        return -1;
+    }
+
+    // Little endian, as the stream
+    static int32_t decode(const uint8_t* p, uint8_t size, bool isSigned) {
+        switch(size) {
+            case 1: return isSigned ? (int32_t)(int8_t)p[0] : (int32_t)p[0];
+            case 2: {
+                uint16_t v = p[0] | (p[1] << 8);
+                return isSigned ? (int32_t)(int16_t)v : (int32_t)v;
+            }
+            default:
+                return (int32_t)((uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+                                 ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+        }
+    }
+};
@@ -0,0 +1,83 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include "Codec.h"
+#include "Config.h"
+
+// Batched sample notifications for phones connected to the display (see
+// RelayService.h). Portable, so the encoder and a reference decoder run on
+// the host (test/test_relay).
+//
+// One notification, little endian:
+//   0  u8   sequence, +1 per notification (a gap = a lost batch)
+//   1  u16  low 16 bits of the display's millis() when the batch was built
+//   3  samples to the end of the notification:
+//        u8      slot (see fieldIndex(); the schema characteristic maps
+//                slots to field addresses)
+//        varint  zigzag of the decoded value x RELAY_SCALE, rounded
+//
+// Values are absolute, so a phone can join at any time and a lost batch
+// costs only that batch. Only slots that changed since the last batch are
+// sent; a typical sample takes 3 bytes, so a 20-byte notification carries 5
+// and one at a 247-byte MTU the whole state.
+
+#define RELAY_HEADER_SIZE 3
+#define RELAY_SCALE       100.0f
+#define RELAY_SCHEMA_VERSION 1
+
+// Schema characteristic: u8 version, u8 slot count, then u16 address per slot
+#define RELAY_SCHEMA_SIZE (2 + 2 * NUM_SLOTS)
+
+inline size_t relaySchema(uint8_t* out) {
+    out[0] = RELAY_SCHEMA_VERSION;
+    out[1] = NUM_SLOTS;
+    size_t n = 2;
+    for(int s=0; s<NUM_SLOTS; s++) {
+        uint16_t a = fieldAddress(s);
+        out[n++] = a & 0xFF;
+        out[n++] = a >> 8;
+    }
+    return n;
+}
+
+// Encode slots from `pending` (bit per slot) into one notification of at
+// most `cap` bytes, lowest slot first. Bits of the slots written are
+// cleared; the rest wait for the next notification. `value(slot)` returns
+// the decoded value. Returns the length, 0 if nothing was pending.
+template<typename ValueFn>
+size_t relayEncode(uint32_t& pending, ValueFn value, uint8_t seq, uint16_t ms,
+                   uint8_t* out, size_t cap) {
+    if(!pending || cap < RELAY_HEADER_SIZE + 1 + codec::MAX_VARINT) return 0;
+    out[0] = seq;
+    out[1] = ms & 0xFF;
+    out[2] = ms >> 8;
+    size_t n = RELAY_HEADER_SIZE;
+    while(pending && n + 1 + codec::MAX_VARINT <= cap) {
+        int slot = __builtin_ctz(pending);
+        float scaled = value(slot) * RELAY_SCALE;
+        if(scaled > 2147483000.0f) scaled = 2147483000.0f;
+        if(scaled < -2147483000.0f) scaled = -2147483000.0f;
+        out[n++] = slot;
+        n += codec::putVarint(out + n, codec::zigzag((int32_t)lroundf(scaled)));
+        pending &= pending - 1;
+    }
+    return n;
+}
+
+// Reference decoder. Calls `sample(slot, value)` per sample; false on a
+// malformed notification (samples before the fault are still reported).
+template<typename SampleFn>
+bool relayDecode(const uint8_t* p, size_t len, uint8_t& seq, uint16_t& ms, SampleFn sample) {
+    if(len < RELAY_HEADER_SIZE) return false;
+    seq = p[0];
+    ms = p[1] | (p[2] << 8);
+    size_t pos = RELAY_HEADER_SIZE;
+    while(pos < len) {
+        uint8_t slot = p[pos++];
+        uint32_t v;
+        if(!codec::getVarint(p, len, pos, v)) return false;
+        sample(slot, codec::unzigzag(v) / RELAY_SCALE);
+    }
+    return true;
+}
@@ -0,0 +1,268 @@
+#pragma once
+#include <Arduino.h>
+#include <Preferences.h>
+#include <NimBLEDevice.h>
+#include <atomic>
+#include "ControllerSession.h"
+#include "RelayFrame.h"
+#include "SpscRing.h"
+#include "VehicleState.h"
+
+#define RELAY_RATE_MS_DEFAULT 100   // Batch period, 10 Hz
+#define RELAY_RATE_MS_MIN     20
+#define RELAY_RATE_MS_MAX     5000
+#define RELAY_MAX_BATCHES     4     // Notifications per period, the rest waits
+
+// GATT server for phones: the controller takes one connection, which the
+// display holds, so phones get the telemetry from the display instead.
+//
+// Changed slots are sent as batched notifications (RelayFrame.h) every
+// rate ms, built in loop() from VehicleState; the notify callback and the
+// renderer do no extra work for phones. A notification that can't be
+// queued (host buffers full) is not retried: its slots stay pending and go
+// with the next batch, so a slow phone sees fewer, fresher values instead
+// of slowing the controller link.
+//
+// Commands written to the CMD characteristic are forwarded to the
+// controller, and its non-stream answers go back on RESP. Writes to the
+// upload control and channel registers are refused: the display owns the
+// stream setup. CMD reaches controller parameters, so it only takes writes
+// over an authenticated, bonded link: the first write from a phone starts
+// passkey pairing, and loop() shows the code on the status line
+// (takePairingCode()). Telemetry needs no pairing; the rate register is
+// readable by anyone and, like CMD, only writable by a bonded phone.
+class RelayService {
+public:
+    void init(ControllerSession* link, const VehicleState* s) {
+        upstream = link;
+        state = s;
+
+        prefs.begin("relay", false);
+        setRate(prefs.getUShort("rate", RELAY_RATE_MS_DEFAULT));
+
+        NimBLEDevice::setMTU(247);
+        NimBLEDevice::setSecurityAuth(true, true, true); // Bonding, MITM protection, secure connections
+        NimBLEDevice::setSecurityIOCap(BLE_HS_IO_DISPLAY_ONLY);
+        server = NimBLEDevice::createServer();
+        server->setCallbacks(new ServerCallbacks(this));
+        server->advertiseOnDisconnect(true);
+
+        NimBLEService* svc = server->createService(RELAY_SERVICE_UUID);
+        data = svc->createCharacteristic(RELAY_DATA_UUID, NIMBLE_PROPERTY::NOTIFY);
+        data->setCallbacks(new DataCallbacks(this));
+        resp = svc->createCharacteristic(RELAY_RESP_UUID, NIMBLE_PROPERTY::NOTIFY);
+
+        static uint8_t schema[RELAY_SCHEMA_SIZE];
+        NimBLECharacteristic* schemaChar = svc->createCharacteristic(RELAY_SCHEMA_UUID, NIMBLE_PROPERTY::READ);
+        schemaChar->setValue(schema, relaySchema(schema));
+
+        rateChar = svc->createCharacteristic(RELAY_RATE_UUID, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE |
+                                                                  NIMBLE_PROPERTY::WRITE_ENC |
+                                                                  NIMBLE_PROPERTY::WRITE_AUTHEN);
+        rateChar->setValue(rateMs.load());
+        rateChar->setCallbacks(new RateCallbacks(this));
+
+        NimBLECharacteristic* cmd = svc->createCharacteristic(
+            RELAY_CMD_UUID, NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_NR | NIMBLE_PROPERTY::WRITE_ENC |
+                                NIMBLE_PROPERTY::WRITE_AUTHEN);
+        cmd->setCallbacks(new CommandCallbacks(this));
+
+        svc->start();
+        NimBLEAdvertising* adv = NimBLEDevice::getAdvertising();
+        adv->addServiceUUID(RELAY_SERVICE_UUID);
+        adv->start();
+    }
+
+    // From loop(), with the slots VehicleState reported dirty this pass
+    void onDirty(uint32_t dirty) {
+        if(!phones.load()) return;
+        for(int s=0; s<NUM_SLOTS; s++) {
+            if(!state->isValid(s)) dirty &= ~(1UL << s); // No value to send
+        }
+        pending |= dirty;
+    }
+
+    // From the notify callback: controller packets that are not stream data
+    void onUpstreamPacket(const uint8_t* p, size_t length) {
+        if(!phones.load() || length > sizeof(Packet::data)) return;
+        Packet pkt;
+        pkt.len = length;
+        memcpy(pkt.data, p, length);
+        if(!answers.push(pkt)) dropped++;
+    }
+
+    // From loop(): forward commands and answers, send the batch when due
+    void service() {
+        Packet pkt;
+        while(commands.pop(pkt)) {
+            if(upstream->sendCommand(pkt.data, pkt.len)) forwarded++;
+            else refused++;
+        }
+        while(answers.pop(pkt)) resp->notify(pkt.data, pkt.len, true);
+        if(rateChanged.exchange(false)) prefs.putUShort("rate", rateMs.load()); // NVS write, not on the host task
+
+        uint32_t now = millis();
+        if(!phones.load() || now - lastBatch < rateMs) return;
+        lastBatch = now;
+
+        // Whole state for a phone that just subscribed (everyone gets it)
+        if(resync.exchange(false)) {
+            for(int s=0; s<NUM_SLOTS; s++) if(state->isValid(s)) pending |= 1UL << s;
+        }
+
+        size_t cap = smallestMtu() - 3;
+        if(cap > sizeof(frame)) cap = sizeof(frame);
+        for(int i=0; i<RELAY_MAX_BATCHES && pending; i++) {
+            uint32_t left = pending;
+            size_t n = relayEncode(left, [this](int s) { return state->value(s); },
+                                   seq, (uint16_t)now, frame, cap);
+            notifyFailed = false;
+            if(n) data->notify(frame, n, true); // Reports through DataCallbacks::onStatus
+            if(!n || notifyFailed) {
+                busy++;
+                break; // Host buffers full: keep the slots for the next period
+            }
+            pending = left;
+            seq++;
+            batches++;
+        }
+    }
+
+    int connectedPhones() const { return phones.load(); }
+
+    // From loop(): passkey to show while a phone pairs, once; 0 = none
+    uint32_t takePairingCode() { return pairCode.exchange(0); }
+
+    // From loop(): 1 = a phone paired, 0 = pairing failed, -1 = nothing new
+    int takePairingResult() { return pairResult.exchange(-1); }
+
+    // Statistics
+    uint32_t batches = 0;
+    uint32_t busy = 0;       // Batches deferred because the host was full
+    uint32_t forwarded = 0;  // Phone commands sent to the controller
+    uint32_t refused = 0;    // Phone commands not sent (stream registers, no link)
+    uint32_t dropped = 0;    // Answers dropped, ring full
+
+private:
+    struct Packet {
+        uint8_t len;
+        uint8_t data[23];
+    };
+
+    ControllerSession* upstream = nullptr;
+    const VehicleState* state = nullptr;
+    Preferences prefs;
+    NimBLEServer* server = nullptr;
+    NimBLECharacteristic* data = nullptr;
+    NimBLECharacteristic* resp = nullptr;
+    NimBLECharacteristic* rateChar = nullptr;
+
+    SpscRing<Packet, 16> commands;  // NimBLE host task -> loop()
+    SpscRing<Packet, 16> answers;   // Notify callback -> loop()
+
+    std::atomic<int> phones{0};
+    std::atomic<bool> resync{false};
+    std::atomic<uint32_t> pairCode{0};
+    std::atomic<int> pairResult{-1};
+    std::atomic<bool> rateChanged{false};
+    bool notifyFailed = false;
+    std::atomic<uint16_t> rateMs{RELAY_RATE_MS_DEFAULT};
+    uint32_t pending = 0;
+    uint32_t lastBatch = 0;
+    uint8_t seq = 0;
+    uint8_t frame[244];
+
+    void setRate(uint16_t ms) {
+        if(ms < RELAY_RATE_MS_MIN) ms = RELAY_RATE_MS_MIN;
+        if(ms > RELAY_RATE_MS_MAX) ms = RELAY_RATE_MS_MAX;
+        rateMs = ms;
+    }
+
+    // Frames must fit every phone connected. A phone starts at 23 and may
+    // never negotiate more, so this asks each connection instead of tracking
+    // MTU changes.
+    uint16_t smallestMtu() const {
+        uint16_t smallest = 0xFFFF;
+        for(uint16_t conn : server->getPeerDevices()) {
+            uint16_t m = server->getPeerMTU(conn);
+            if(m < smallest) smallest = m;
+        }
+        return smallest < 23 || smallest == 0xFFFF ? 23 : smallest;
+    }
+
+    // Writes to 11 (upload control) or 12 (channels) would reconfigure the
+    // display's own stream
+    static bool allowed(const uint8_t* p, size_t len) {
+        if(len < 2) return false;
+        if(p[1] & 0x80) return len == 3; // Read command
+        uint16_t address = ((p[1] & 0x1F) << 8) | p[0];
+        return address != ADDR_CONTROL && address != ADDR_TIME_CHANNEL;
+    }
+
+    class ServerCallbacks : public NimBLEServerCallbacks {
+    public:
+        explicit ServerCallbacks(RelayService* r) : relay(r) {}
+        void onConnect(NimBLEServer* s, ble_gap_conn_desc* desc) override {
+            relay->phones++;
+            s->startAdvertising(); // Room for another phone
+        }
+        void onDisconnect(NimBLEServer* s) override { relay->phones--; }
+        // Display-only pairing: the phone's user types the code we show
+        uint32_t onPassKeyRequest() override {
+            uint32_t code = 100000 + esp_random() % 900000;
+            relay->pairCode = code;
+            return code;
+        }
+        void onAuthenticationComplete(ble_gap_conn_desc* desc) override {
+            relay->pairResult = desc->sec_state.authenticated && desc->sec_state.bonded ? 1 : 0;
+        }
+    private:
+        RelayService* relay;
+    };
+
+    class DataCallbacks : public NimBLECharacteristicCallbacks {
+    public:
+        explicit DataCallbacks(RelayService* r) : relay(r) {}
+        void onSubscribe(NimBLECharacteristic* c, ble_gap_conn_desc* desc, uint16_t subValue) override {
+            if(subValue) relay->resync = true;
+        }
+        // Called from within notify(), on the loop task
+        void onStatus(NimBLECharacteristic* c, Status s, int code) override {
+            if(s == Status::ERROR_GATT) relay->notifyFailed = true;
+        }
+    private:
+        RelayService* relay;
+    };
+
+    class RateCallbacks : public NimBLECharacteristicCallbacks {
+    public:
+        explicit RateCallbacks(RelayService* r) : relay(r) {}
+        void onWrite(NimBLECharacteristic* c) override {
+            NimBLEAttValue v = c->getValue();
+            if(v.length() != 2) return;
+            relay->setRate(v.data()[0] | (v.data()[1] << 8));
+            c->setValue(relay->rateMs.load());
+            relay->rateChanged = true; // Saved from service()
+        }
+    private:
+        RelayService* relay;
+    };
+
+    class CommandCallbacks : public NimBLECharacteristicCallbacks {
+    public:
+        explicit CommandCallbacks(RelayService* r) : relay(r) {}
+        void onWrite(NimBLECharacteristic* c) override {
+            NimBLEAttValue v = c->getValue();
+            if(v.length() > sizeof(Packet::data) || !allowed(v.data(), v.length())) {
+                relay->refused++;
+                return;
+            }
+            Packet pkt;
+            pkt.len = v.length();
+            memcpy(pkt.data, v.data(), v.length());
+            if(!relay->commands.push(pkt)) relay->refused++;
+        }
+    private:
+        RelayService* relay;
+    };
+};
@@ -0,0 +1,149 @@
+#pragma once
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "TraceCapture.h"
+#include "TraceReplay.h"
+#include "Transport.h"
+
+#define REPLAY_BURST  256   // Records per tick at full speed, then yield
+
+// Replays the captured packet trace (TraceCapture.h) as the controller link,
+// to reproduce a field issue on the bench.
+//
+// Packets are delivered from a task on core 0, like BLE notifications from
+// the NimBLE host task, so the session, VehicleState, USB stream and
+// renderer run as they did on the ride. Speed 1 keeps the recorded
+// timing; speed 0 delivers as fast as the pipeline takes it, yielding a
+// tick every REPLAY_BURST records. Commands are accepted and dropped: the
+// stream setup completes, and the polled reads and answers in the trace
+// arrive as recorded. Link events in the trace are counted but keep the
+// link up, so loop() does not save and rescan in the middle.
+//
+// The link stays up after the last record, showing the final state;
+// report() prints throughput and stage times once the trace has played.
+// Replayed rides are not logged and not counted in the trip totals, range
+// fits or operating map: at full speed their time is compressed, and they
+// are not the rider's.
+class ReplayTransport : public Transport {
+public:
+    // Stage times, receive from the replay task, render from loop()
+    StageTime receive;          // Session: parse and the data callbacks
+    StageTime render;           // DisplayManager::render() per changed pass
+
+    // Play TRACE_PATH from the start at `speed`. False if there is no trace.
+    bool start(float speed) {
+        if(!LittleFS.exists(TRACE_PATH)) return false;
+        this->speed = speed;
+        if(!task) xTaskCreatePinnedToCore(replayTask, "replay", 4096, this, configMAX_PRIORITIES - 4, &task, 0);
+        done = false;
+        reported = false;
+        restart = true;
+        running = true;
+        return true;
+    }
+
+    float rate() const { return speed; }
+
+    bool connected() const override { return running; }
+
+    bool send(const uint8_t*, size_t) override { return running; }
+
+    void disconnect() override { running = false; }
+
+    // True once, after the last record went out
+    bool finished() {
+        if(!done || reported) return false;
+        reported = true;
+        return true;
+    }
+
+    void report() {
+        float s = (endUs - startUs) / 1e6f;
+        float traceS = replay.traceUs / 1e6f;
+        Serial.printf("Replay: %lu packets, %lu link events in %.2f s (trace %.2f s, x%.1f), %.0f packets/s%s\n",
+                      (unsigned long)replay.packets, (unsigned long)replay.linkEvents, s, traceS,
+                      s > 0 ? traceS / s : 0.0f, s > 0 ? replay.packets / s : 0.0f,
+                      replay.malformed ? ", stopped at a corrupt record" : "");
+        if(speed > 0) printStage("late", replay.lateness);
+        printStage("receive", receive);
+        printStage("render", render);
+    }
+
+private:
+    File file;
+    TraceReplay replay;
+    TaskHandle_t task = nullptr;
+    volatile float speed = 1;
+    volatile bool running = false;
+    volatile bool restart = false;
+    volatile bool done = false;
+    bool reported = false;
+    uint64_t startUs = 0;
+    uint64_t endUs = 0;
+
+    static void printStage(const char* name, const StageTime& t) {
+        Serial.printf("  %-8s %8lu x  avg %7.1f us  max %6lu us\n", name, (unsigned long)t.count,
+                      t.averageUs(), (unsigned long)t.maxUs);
+    }
+
+    static void replayTask(void* arg) {
+        ReplayTransport* self = (ReplayTransport*)arg;
+        for(;;) {
+            if(!self->running || self->done) {
+                vTaskDelay(pdMS_TO_TICKS(20));
+                continue;
+            }
+            if(self->restart) {
+                self->restart = false;
+                self->open();
+                continue;
+            }
+            self->fill();
+
+            uint64_t now = esp_timer_get_time();
+            self->replay.run(now, REPLAY_BURST, [self](const TraceRecord& r) {
+                if(!r.length) return;
+                uint64_t t0 = esp_timer_get_time();
+                self->deliver(r.data, r.length);
+                self->receive.add((uint32_t)(esp_timer_get_time() - t0));
+            });
+            if(self->replay.finished()) {
+                self->endUs = esp_timer_get_time();
+                if(self->file) self->file.close();
+                self->done = true;
+            }
+            vTaskDelay(1);
+        }
+    }
+
+    void open() {
+        if(file) file.close();
+        file = LittleFS.open(TRACE_PATH, FILE_READ);
+        uint8_t header[TRACE_HEADER_SIZE];
+        startUs = esp_timer_get_time();
+        receive = StageTime();
+        render = StageTime();
+        if(!file || file.read(header, sizeof(header)) != sizeof(header) ||
+           !replay.begin(header, sizeof(header), speed, startUs)) {
+            Serial.println("Replay: no readable trace at " TRACE_PATH);
+            endUs = startUs;
+            done = true;
+        }
+    }
+
+    // Top up the replay buffer from the file
+    void fill() {
+        uint8_t chunk[128];
+        while(file && replay.room() >= sizeof(chunk)) {
+            size_t n = file.read(chunk, sizeof(chunk));
+            replay.feed(chunk, n);
+            if(n < sizeof(chunk)) {
+                replay.end();
+                file.close();
+            }
+        }
+    }
+};
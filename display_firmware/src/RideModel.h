@@ -0,0 +1,187 @@
+#pragma once
+#include <stdint.h>
+#include <math.h>
+#include "Config.h"
+#include "ControllerEmulator.h"
+
+// Simulated ride for bench demos and load tests (SimTransport.h). Portable
+// (test/test_sim).
+//
+// A rider alternates accelerating, cruising, coasting, braking and
+// standing, with random durations and throttle levels. One physical model
+// derives everything else from that, so the fields move together the way
+// they do on a real bike:
+//   speed    drive force against drag, rolling resistance and brakes
+//   current  mechanical power / (voltage x efficiency), negative in regen
+//   voltage  open-circuit voltage from SoC, less the I x R sag
+//   SoC      integrated current over the pack capacity
+//   temps    first-order heating from current, cooling towards ambient
+// Values are written to a ControllerEmulator's registers through the field
+// calibrations, so they take the same wire path as a controller's.
+//
+// The model steps with whatever interval the caller uses, from a few us at
+// load-test rates to the 20 ms of the BLE link. Deterministic for a seed.
+class RideModel {
+public:
+    // Vehicle, roughly a 72 V scooter
+    static constexpr float MASS_KG = 130.0f;
+    static constexpr float MAX_FORCE_N = 350.0f;      // At the wheel, full throttle
+    static constexpr float MAX_POWER_W = 3500.0f;     // Force limit above base speed
+    static constexpr float MAX_SPEED_KMH = 65.0f;     // No drive force left (back EMF)
+    static constexpr float DRAG = 0.35f;              // N per (m/s)^2
+    static constexpr float ROLLING_N = 18.0f;
+    static constexpr float BRAKE_N = 700.0f;
+    static constexpr float REGEN_N = 150.0f;          // Share of braking the motor takes
+    static constexpr float EFFICIENCY = 0.85f;
+    static constexpr float RPM_PER_KMH = 83.0f;       // 5000 rpm at 60 km/h
+    static constexpr float PACK_AH = 30.0f;
+    static constexpr float PACK_OHMS = 0.08f;
+    static constexpr float AMBIENT_C = 25.0f;
+
+    enum Phase : uint8_t { STAND, ACCEL, CRUISE, COAST, BRAKE };
+
+    explicit RideModel(uint32_t seed = 1) : rng(seed ? seed : 1) {}
+
+    // Advance by dt seconds
+    void step(float dt) {
+        if(dt <= 0) return;
+        if(dt > 0.1f) dt = 0.1f; // Large gaps in coarse steps would overshoot
+        t += dt;
+
+        phaseLeft -= dt;
+        if(phaseLeft <= 0) nextPhase();
+
+        // Throttle eases towards the phase target, like a hand does
+        float target = phase == ACCEL ? throttleTarget : phase == CRUISE ? cruiseThrottle() : 0.0f;
+        throttle += (target - throttle) * fminf(1.0f, dt * 4.0f);
+
+        float v = speedKmh / 3.6f;
+        float drive = throttle * maxForce(v);
+        float brake = phase == BRAKE && v > 0.1f ? BRAKE_N * brakeLevel : 0.0f;
+        float resist = DRAG * v * v + (v > 0.05f ? ROLLING_N : 0.0f);
+        v += (drive - brake - resist) / MASS_KG * dt;
+        if(v < 0) v = 0;
+        speedKmh = v * 3.6f;
+
+        // Regen takes part of the braking force back into the pack
+        float regen = brake > 0 ? fminf(brake, REGEN_N) : 0.0f;
+        float mechW = drive * v - regen * v;
+        float ocv = 60.0f + 22.0f * soc;
+        float amps = mechW >= 0 ? mechW / (ocv * EFFICIENCY) : mechW * EFFICIENCY / ocv;
+        current = amps + noise(0.3f);
+        volts = ocv - current * PACK_OHMS + noise(0.05f);
+        soc -= current * dt / 3600.0f / PACK_AH;
+        if(soc < 0.05f) soc = 1.0f; // Long soak test: a fresh pack instead of a dead one
+        if(soc > 1.0f) soc = 1.0f;
+
+        // About +25 C (controller) and +40 C (motor) at a steady 30 A
+        controllerC += (current * current * 0.00028f - (controllerC - AMBIENT_C) * 0.01f) * dt;
+        motorC += (current * current * 0.00022f - (motorC - AMBIENT_C) * 0.005f) * dt;
+    }
+
+    // Decoded value of a field or polled register, as the display shows it
+    float value(uint16_t address) const {
+        switch(address) {
+            case 24:  return speedKmh;
+            case 26:  return floorf(soc * 100.0f);
+            case 105: return speedKmh * RPM_PER_KMH;
+            case 113: return volts;
+            case 115: return volts * current / 1000.0f;
+            case 119: return current;
+            case 220: return 0.85f + throttle * 3.35f;
+            case 222: return controllerC;
+            case ADDR_MOTOR_TEMP: return motorC;
+            case ADDR_PHASE_CURRENT: return phaseCurrent();
+            default:  return 0; // Error code: no faults
+        }
+    }
+
+    // Registers of every wire field and polled register, through their calibrations
+    void write(ControllerEmulator& emu) const {
+        for(int i=0; i<NUM_FIELDS; i++) {
+            const DataFieldConfig& f = TARGET_FIELDS[i];
+            emu.set(f.address, toRaw(value(f.address), f.k, f.b, f.size), f.size);
+        }
+        for(int i=0; i<NUM_POLLED; i++) {
+            const PolledRegisterConfig& r = POLLED_REGISTERS[i];
+            emu.set(r.address, toRaw(value(r.address), r.k, r.b, r.size), r.size);
+        }
+    }
+
+    Phase currentPhase() const { return phase; }
+    float seconds() const { return t; }
+
+private:
+    uint32_t rng;
+    float t = 0;
+    Phase phase = STAND;
+    float phaseLeft = 2.0f;
+    float throttleTarget = 0;
+    float brakeLevel = 0;
+    float throttle = 0;
+    float speedKmh = 0;
+    float current = 0;
+    float volts = 82.0f;
+    float soc = 1.0f;
+    float controllerC = AMBIENT_C;
+    float motorC = AMBIENT_C;
+
+    uint32_t next() {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng;
+    }
+    float uniform() { return (next() >> 8) * (1.0f / 16777216.0f); }
+    float between(float lo, float hi) { return lo + (hi - lo) * uniform(); }
+    float noise(float amplitude) { return (uniform() + uniform() - 1.0f) * amplitude; }
+
+    void nextPhase() {
+        switch(phase) {
+            case STAND:  phase = ACCEL; break;
+            case ACCEL:  phase = uniform() < 0.7f ? CRUISE : BRAKE; break;
+            case CRUISE: phase = uniform() < 0.5f ? COAST : ACCEL; break;
+            case COAST:  phase = uniform() < 0.6f ? BRAKE : ACCEL; break;
+            case BRAKE:  phase = speedKmh < 15.0f ? STAND : ACCEL; break;
+        }
+        switch(phase) {
+            case STAND:  phaseLeft = between(2, 8); break;
+            case ACCEL:  phaseLeft = between(3, 10); throttleTarget = between(0.4f, 1.0f); break;
+            case CRUISE: phaseLeft = between(5, 25); break;
+            case COAST:  phaseLeft = between(2, 6); break;
+            case BRAKE:  phaseLeft = between(2, 5); brakeLevel = between(0.3f, 1.0f); break;
+        }
+    }
+
+    // Enough to hold the speed reached
+    float cruiseThrottle() const {
+        float v = speedKmh / 3.6f;
+        float f = maxForce(v);
+        return f > 0 ? fminf((DRAG * v * v + ROLLING_N) / f, 1.0f) : 1.0f;
+    }
+
+    // Full-throttle force at v m/s: constant, then power limited, then
+    // fading out towards the top speed
+    static float maxForce(float v) {
+        float f = MAX_FORCE_N;
+        if(v > 1.0f && f * v > MAX_POWER_W) f = MAX_POWER_W / v;
+        float fade = 1.0f - v * 3.6f / MAX_SPEED_KMH;
+        return fade > 0 ? f * fminf(1.0f, fade * 4.0f) : 0.0f;
+    }
+
+    // Phase current rises above battery current at low speed (low duty)
+    float phaseCurrent() const {
+        float duty = fmaxf(speedKmh / 60.0f, 0.2f);
+        return current / fminf(duty, 1.0f);
+    }
+
+    // value = (raw - b) / k, saturated to the register width
+    static int32_t toRaw(float value, float k, float b, uint8_t size) {
+        float raw = roundf(value * k + b);
+        float lo = size == 1 ? -128.0f : size == 2 ? -32768.0f : -2147483000.0f;
+        float hi = size == 1 ? 255.0f : size == 2 ? 65535.0f : 2147483000.0f;
+        if(raw < lo) raw = lo;
+        if(raw > hi) raw = hi;
+        return (int32_t)raw;
+    }
+};
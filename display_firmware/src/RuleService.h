@@ -0,0 +1,98 @@
+#pragma once
+#include <Arduino.h>
+#include <Preferences.h>
+#include "Display.h"
+#include "Power.h"
+#include "Rules.h"
+#include "VehicleState.h"
+
+// Stored rule set. Plain data, saved as one blob under "rules"/"set".
+struct RuleSet {
+    uint32_t version;
+    uint32_t count;
+    Rule rules[MAX_RULES];
+};
+
+#define RULESET_VERSION 1
+
+// Target glue for RuleEngine: loads the rules from NVS (storing the built-in
+// set on first boot, so NVS is the one place to change them), evaluates the
+// slots that changed each loop pass and carries out the actions.
+//
+// Evaluation runs in loop() on VehicleState's dirty slots, not in the notify
+// callback: the actions touch the display and the backlight, which belong to
+// the loop task, and virtual fields are covered the same way as wire fields.
+// Samples that repeat the stored value are not re-evaluated; hold times
+// still expire on time through RuleEngine::service().
+class RuleService {
+public:
+    void init(DisplayManager* d, PowerManager* p) {
+        display = d;
+        power = p;
+        prefs.begin("rules", false);
+
+        static RuleSet set; // ~270 bytes, off the loop task's stack
+        if(prefs.getBytes("set", &set, sizeof(set)) == sizeof(set) &&
+           set.version == RULESET_VERSION && set.count <= MAX_RULES) {
+            engine.load(set.rules, set.count);
+        } else {
+            store(DEFAULT_RULES, NUM_DEFAULT_RULES);
+        }
+        Serial.printf("Rules: %d loaded\n", engine.size());
+    }
+
+    // Replace and persist the rule set
+    void store(const Rule* rules, int n) {
+        static RuleSet set;
+        set = RuleSet();
+        set.version = RULESET_VERSION;
+        set.count = n < MAX_RULES ? n : MAX_RULES;
+        for(uint32_t i=0; i<set.count; i++) set.rules[i] = rules[i];
+        prefs.putBytes("set", &set, sizeof(set));
+        engine.load(set.rules, set.count);
+        for(int s=0; s<VehicleState::MAX_SLOTS; s++) display->setFieldColor(s, 0);
+        power->setAlert(false);
+    }
+
+    // From loop(), before render: evaluate changed slots and act on the result
+    void service(const VehicleState& state, uint32_t dirty) {
+        uint32_t now = millis();
+        bool changed = engine.service(now);
+        for(uint32_t d = dirty; d; d &= d - 1) {
+            int slot = __builtin_ctz(d);
+            changed |= engine.evaluate(slot, state.value(slot), now);
+        }
+        if(!changed) return;
+
+        RuleEvent e;
+        while(engine.pollEvent(e)) {
+            const Rule& r = engine.rule(e.rule);
+            int slot = engine.slotOf(e.rule);
+            if(r.actions & RULE_COLOR) display->setFieldColor(slot, engine.colorFor(slot));
+            if(r.actions & RULE_LOG) log(r, e);
+        }
+        power->setAlert(engine.flashing());
+    }
+
+private:
+    RuleEngine engine;
+    DisplayManager* display = nullptr;
+    PowerManager* power = nullptr;
+    Preferences prefs;
+
+    void log(const Rule& r, const RuleEvent& e) {
+        const char* name = fieldName(fieldIndex(r.field));
+        char op = r.op == RULE_ABOVE ? '>' : '<';
+        Serial.printf("[%lu] Alarm %s: %s %c %g (%g)\n", (unsigned long)e.ms,
+                      e.active ? "on" : "off", name, op, r.threshold, e.value);
+
+        char text[32];
+        if(e.active) {
+            snprintf(text, sizeof(text), "ALARM %s %c %g", name, op, r.threshold);
+            display->updateStatus(text, TFT_RED);
+        } else {
+            snprintf(text, sizeof(text), "%s OK", name);
+            display->updateStatus(text, TFT_GREEN);
+        }
+    }
+};
@@ -0,0 +1,237 @@
+#pragma once
+#include <stdint.h>
+#include "Config.h"
+
+// Threshold / alarm rules on field values: wire, virtual or polled.
+//
+// Rules are indexed by field slot: each slot heads a chain through the rules
+// on that field, so a changed value evaluates only its own rules. A rule
+// fires when its condition has held for holdMs (debounce) and releases once
+// the value is back past the threshold by `hysteresis`. Rules still waiting
+// out their hold time are kept in a bitmask, so service() only looks at
+// those. Everything is fixed-size; nothing allocates after load().
+
+enum RuleOp : uint8_t {
+    RULE_ABOVE, // value > threshold, releases at <= threshold - hysteresis
+    RULE_BELOW, // value < threshold, releases at >= threshold + hysteresis
+};
+
+// Actions, combined as a bit mask
+#define RULE_COLOR 0x01 // Recolour widgets bound to the field
+#define RULE_FLASH 0x02 // Flash the backlight while active
+#define RULE_LOG   0x04 // Log activation and release (Serial, status line)
+
+// Persisted as-is (see RuleService), so plain data with a fixed layout
+struct Rule {
+    uint16_t field;      // Field address (any slot, see fieldIndex())
+    uint8_t op;          // RuleOp
+    uint8_t actions;     // RULE_* bits
+    float threshold;
+    float hysteresis;
+    uint16_t holdMs;     // Condition must hold this long before firing
+    uint16_t color;      // RULE_COLOR: widget colour while active (RGB565)
+};
+
+#define MAX_RULES 16
+
+// RGB565 red, as TFT_RED; this header builds without TFT_eSPI
+#define RULE_ALERT_COLOR 0xF800
+
+// Built-in set, used (and stored) when NVS holds none. SoC comes in whole
+// percent, so below 21 is red at 20 % and under.
+const Rule DEFAULT_RULES[] = {
+    // field          op          actions                          thresh  hyst   hold  color
+    {ADDR_SOC,      RULE_BELOW, RULE_COLOR,                        21.0f,  2.0f,  0,    RULE_ALERT_COLOR},
+    {ADDR_TEMP,     RULE_ABOVE, RULE_COLOR | RULE_FLASH | RULE_LOG, 80.0f, 5.0f,  2000, RULE_ALERT_COLOR},
+    {ADDR_VOLT,     RULE_BELOW, RULE_COLOR | RULE_LOG,             60.0f,  1.0f,  1000, RULE_ALERT_COLOR},
+    {ADDR_CURRENT,  RULE_ABOVE, RULE_COLOR | RULE_LOG,             150.0f, 10.0f, 1000, RULE_ALERT_COLOR},
+    {VF_PACK_R_REF, RULE_ABOVE, RULE_COLOR | RULE_LOG,             150.0f, 10.0f, 0,    RULE_ALERT_COLOR},
+};
+
+const int NUM_DEFAULT_RULES = sizeof(DEFAULT_RULES) / sizeof(DEFAULT_RULES[0]);
+
+// A rule fired or released
+struct RuleEvent {
+    uint8_t rule;
+    bool active;
+    float value;
+    uint32_t ms;
+};
+
+class RuleEngine {
+public:
+    static const int MAX_SLOT_COUNT = 32;
+    static const int EVENT_QUEUE = 16;
+
+    // Statistics
+    uint32_t evaluations = 0;   // Rule checks done by evaluate()
+    uint32_t eventsDropped = 0;
+
+    RuleEngine() { load(nullptr, 0); }
+
+    // Replace the rule set. Rules on unknown fields, and any past MAX_RULES,
+    // are skipped. Returns the number loaded.
+    int load(const Rule* set, int n) {
+        count = 0;
+        for(int s=0; s<MAX_SLOT_COUNT; s++) {
+            first[s] = -1;
+            slotColor[s] = 0;
+        }
+        for(int i=0; i<n && count<MAX_RULES; i++) {
+            int slot = fieldIndex(set[i].field);
+            if(slot < 0 || slot >= MAX_SLOT_COUNT) continue;
+            rules[count] = set[i];
+            ruleSlot[count] = slot;
+            state[count] = IDLE;
+            next[count] = -1;
+            // Append, so a slot's chain keeps the set's order (first = priority)
+            int8_t* link = &first[slot];
+            while(*link >= 0) link = &next[*link];
+            *link = count;
+            count++;
+        }
+        pending = 0;
+        flashCount = 0;
+        evHead = evTail = 0;
+        return count;
+    }
+
+    // A slot's value changed. Returns true if a rule fired or released.
+    bool evaluate(int slot, float value, uint32_t ms) {
+        if(slot < 0 || slot >= MAX_SLOT_COUNT) return false;
+        bool changed = false;
+        for(int8_t i = first[slot]; i >= 0; i = next[i]) {
+            evaluations++;
+            changed |= step(i, value, ms);
+        }
+        return changed;
+    }
+
+    // Fire rules whose condition held through their hold time without the
+    // value changing since. Returns true if any fired.
+    bool service(uint32_t ms) {
+        bool changed = false;
+        for(uint32_t p = pending; p; p &= p - 1) {
+            int i = __builtin_ctz(p);
+            if(ms - since[i] >= rules[i].holdMs) {
+                fire(i, lastValue[i], ms);
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    // Colour of the first active RULE_COLOR rule on the slot, 0 = none
+    uint16_t colorFor(int slot) const {
+        return (slot >= 0 && slot < MAX_SLOT_COUNT) ? slotColor[slot] : 0;
+    }
+
+    bool flashing() const { return flashCount > 0; }
+
+    bool isActive(int i) const { return state[i] == ACTIVE; }
+
+    bool pollEvent(RuleEvent& e) {
+        if(evTail == evHead) return false;
+        e = events[evTail];
+        evTail = (evTail + 1) % EVENT_QUEUE;
+        return true;
+    }
+
+    int size() const { return count; }
+    const Rule& rule(int i) const { return rules[i]; }
+    int slotOf(int i) const { return ruleSlot[i]; }
+
+private:
+    enum RuleState : uint8_t { IDLE, PENDING, ACTIVE };
+
+    Rule rules[MAX_RULES];
+    int8_t first[MAX_SLOT_COUNT];
+    int8_t next[MAX_RULES];
+    uint8_t ruleSlot[MAX_RULES];
+    RuleState state[MAX_RULES];
+    uint32_t since[MAX_RULES];
+    float lastValue[MAX_RULES];
+    int count = 0;
+
+    uint32_t pending = 0;               // Bit per PENDING rule
+    uint16_t slotColor[MAX_SLOT_COUNT];
+    int flashCount = 0;
+
+    RuleEvent events[EVENT_QUEUE];
+    int evHead = 0, evTail = 0;
+
+    static_assert(MAX_RULES <= 32, "pending is a 32-bit mask");
+    static_assert(MAX_RULES <= 127, "chains use int8_t links");
+
+    bool step(int i, float v, uint32_t ms) {
+        const Rule& r = rules[i];
+        bool above = r.op == RULE_ABOVE;
+        bool cond = above ? v > r.threshold : v < r.threshold;
+        lastValue[i] = v;
+
+        switch(state[i]) {
+            case IDLE:
+                if(!cond) return false;
+                if(r.holdMs == 0) {
+                    fire(i, v, ms);
+                    return true;
+                }
+                state[i] = PENDING;
+                since[i] = ms;
+                pending |= 1UL << i;
+                return false;
+
+            case PENDING:
+                if(!cond) {
+                    state[i] = IDLE;
+                    pending &= ~(1UL << i);
+                    return false;
+                }
+                if(ms - since[i] < r.holdMs) return false;
+                fire(i, v, ms);
+                return true;
+
+            case ACTIVE: {
+                bool release = above ? v <= r.threshold - r.hysteresis
+                                     : v >= r.threshold + r.hysteresis;
+                if(!release) return false;
+                state[i] = IDLE;
+                if(r.actions & RULE_FLASH) flashCount--;
+                if(r.actions & RULE_COLOR) recolor(ruleSlot[i]);
+                push(i, false, v, ms);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void fire(int i, float v, uint32_t ms) {
+        const Rule& r = rules[i];
+        state[i] = ACTIVE;
+        pending &= ~(1UL << i);
+        if(r.actions & RULE_FLASH) flashCount++;
+        if(r.actions & RULE_COLOR) recolor(ruleSlot[i]);
+        push(i, true, v, ms);
+    }
+
+    void recolor(int slot) {
+        slotColor[slot] = 0;
+        for(int8_t i = first[slot]; i >= 0; i = next[i]) {
+            if(state[i] == ACTIVE && (rules[i].actions & RULE_COLOR)) {
+                slotColor[slot] = rules[i].color;
+                return;
+            }
+        }
+    }
+
+    // Oldest events are kept; a full queue drops (and counts) new ones
+    void push(int i, bool active, float v, uint32_t ms) {
+        int n = (evHead + 1) % EVENT_QUEUE;
+        if(n == evTail) {
+            eventsDropped++;
+            return;
+        }
+        events[evHead] = RuleEvent{(uint8_t)i, active, v, ms};
+        evHead = n;
+    }
+};
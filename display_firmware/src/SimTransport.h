@@ -0,0 +1,108 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include "ControllerEmulator.h"
+#include "RideModel.h"
+#include "SpscRing.h"
+#include "Transport.h"
+
+#ifndef SIM_RATE_HZ
+#define SIM_RATE_HZ  50     // Upload rounds per second at start, about the BLE link
+#endif
+#define SIM_MAX_BURST 64    // Rounds per tick before the task counts itself behind
+
+// Simulated controller for bench demos and render/logging load tests: a
+// ControllerEmulator driven by a RideModel, in a task of its own.
+//
+// Its packets are delivered from that task like BLE notifications from the
+// NimBLE host task, on the same core, so the session, VehicleState, USB
+// stream and renderer run exactly as with a controller. The stream setup, polled reads and parameter jobs
+// talk to the emulator. Simulated rides are not logged and not counted in
+// the trip totals, range fits or operating map (main.cpp, onController()),
+// so a bench session leaves the rider's figures alone.
+//
+// The rate can be set far beyond what BLE carries. A task that can't keep
+// up skips rounds and counts them in `missed`: the highest rate without
+// misses is the sustainable rate of the pipeline up to the display.
+class SimTransport : public Transport {
+public:
+    std::atomic<uint32_t> rounds{0};
+    std::atomic<uint32_t> missed{0};
+
+    // Start, or change the rate of a running simulation
+    void start(uint32_t hz) {
+        rateHz = hz;
+        if(!task) xTaskCreatePinnedToCore(simTask, "sim", 4096, this, configMAX_PRIORITIES - 4, &task, 0);
+        if(!running) {
+            restart = true;
+            running = true;
+        }
+    }
+
+    uint32_t rate() const { return rateHz; }
+
+    bool connected() const override { return running; }
+
+    // Commands go to the emulator on the sim task
+    bool send(const uint8_t* data, size_t length) override {
+        if(!running || length > sizeof(Command::data)) return false;
+        Command c;
+        c.len = length;
+        memcpy(c.data, data, length);
+        return commands.push(c);
+    }
+
+    void disconnect() override { running = false; }
+
+private:
+    struct Command {
+        uint8_t len;
+        uint8_t data[23];
+    };
+
+    ControllerEmulator emu;
+    RideModel ride;
+    SpscRing<Command, 16> commands;  // loop() -> sim task
+    TaskHandle_t task = nullptr;
+    volatile uint32_t rateHz = SIM_RATE_HZ;
+    volatile bool running = false;
+    volatile bool restart = false;
+    uint64_t modelUs = 0;
+
+    static void simTask(void* arg) {
+        SimTransport* self = (SimTransport*)arg;
+        self->emu.out = [self](const uint8_t* data, size_t length) { self->deliver(data, length); };
+        self->emu.script = [self](uint64_t us, ControllerEmulator& e) {
+            self->ride.step((us - self->modelUs) * 1e-6f);
+            self->modelUs = us;
+            self->ride.write(e);
+        };
+
+        for(;;) {
+            if(!self->running) {
+                vTaskDelay(pdMS_TO_TICKS(20));
+                continue;
+            }
+            uint64_t now = esp_timer_get_time();
+            if(self->restart) {
+                self->restart = false;
+                self->ride = RideModel(esp_random());
+                self->modelUs = now;
+                Command c;
+                while(self->commands.pop(c)) {}
+            }
+
+            Command c;
+            while(self->commands.pop(c)) self->emu.onCommand(c.data, c.len);
+
+            self->emu.periodUs = 1000000 / self->rateHz;
+            uint32_t before = self->emu.missed;
+            self->rounds += self->emu.run(now, SIM_MAX_BURST);
+            self->missed += self->emu.missed - before;
+            vTaskDelay(1);
+        }
+    }
+};
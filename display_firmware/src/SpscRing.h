@@ -0,0 +1,38 @@
+#pragma once
+#include <stddef.h>
+#include <atomic>
+
+// Lock-free single-producer / single-consumer ring. N must be a power of two.
+// The producer (e.g. the BLE notify callback) never blocks: push() fails when
+// the consumer has fallen N entries behind.
+template<typename T, size_t N>
+class SpscRing {
+    static_assert((N & (N - 1)) == 0, "SpscRing size must be a power of two");
+public:
+    bool push(const T& v) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if(h - tail.load(std::memory_order_acquire) >= N) return false;
+        data[h & (N - 1)] = v;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& v) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if(t == head.load(std::memory_order_acquire)) return false;
+        v = data[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return N; }
+
+private:
+    T data[N];
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+};
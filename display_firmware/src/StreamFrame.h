@@ -0,0 +1,164 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Framed binary telemetry stream (USB CDC). Portable: the firmware encodes
+// with it, tools/stream_decode.cpp and test/test_stream parse with it.
+//
+// Frame:
+//   0xA5 0x5A  u8 type  u8 body length  body  u16 CRC-16/CCITT (type..body)
+//
+// Every body starts with u16 seq and u32 t_us (esp_timer, low 32 bits). seq
+// counts every frame the firmware produced, including ones dropped before
+// they reached USB, so a gap in seq is exactly the number lost.
+//
+//   STREAM_SAMPLE      seq t_us  u8 controller  u16 address  i32 raw
+//   STREAM_CONTROLLER  seq t_us  u8 controller  u8 mac[6]    (on connect)
+//   STREAM_STATS       seq t_us  u32 ring drops               (every second)
+//
+// All fields little endian. Raw is the value on the wire; calibrate with the
+// address's K and B from TARGET_FIELDS.
+
+#define STREAM_SYNC0        0xA5
+#define STREAM_SYNC1        0x5A
+#define STREAM_OVERHEAD     6     // Sync, type, length, CRC
+#define STREAM_MAX_BODY     32
+#define STREAM_MAX_FRAME    (STREAM_OVERHEAD + STREAM_MAX_BODY)
+
+enum StreamFrameType : uint8_t {
+    STREAM_SAMPLE = 1,
+    STREAM_CONTROLLER = 2,
+    STREAM_STATS = 3,
+};
+
+struct StreamFrame {
+    uint8_t type;
+    uint16_t seq;
+    uint32_t tUs;
+    uint8_t controller;   // SAMPLE, CONTROLLER
+    uint16_t address;     // SAMPLE
+    int32_t raw;          // SAMPLE
+    uint8_t mac[6];       // CONTROLLER
+    uint32_t dropped;     // STATS
+};
+
+inline uint16_t streamCrc16(const uint8_t* p, size_t n) {
+    uint16_t crc = 0xFFFF;
+    for(size_t i=0; i<n; i++) {
+        crc ^= (uint16_t)p[i] << 8;
+        for(int b=0; b<8; b++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+class StreamEncoder {
+public:
+    // Encode f into out (STREAM_MAX_FRAME bytes). Returns the frame length.
+    static size_t encode(const StreamFrame& f, uint8_t* out) {
+        size_t n = 4;
+        put16(out, n, f.seq);
+        put32(out, n, f.tUs);
+        switch(f.type) {
+            case STREAM_SAMPLE:
+                out[n++] = f.controller;
+                put16(out, n, f.address);
+                put32(out, n, (uint32_t)f.raw);
+                break;
+            case STREAM_CONTROLLER:
+                out[n++] = f.controller;
+                for(int i=0; i<6; i++) out[n++] = f.mac[i];
+                break;
+            case STREAM_STATS:
+                put32(out, n, f.dropped);
+                break;
+        }
+        out[0] = STREAM_SYNC0;
+        out[1] = STREAM_SYNC1;
+        out[2] = f.type;
+        out[3] = (uint8_t)(n - 4);
+        put16(out, n, streamCrc16(out + 2, n - 2));
+        return n;
+    }
+
+private:
+    static void put16(uint8_t* p, size_t& n, uint16_t v) { p[n++] = v; p[n++] = v >> 8; }
+    static void put32(uint8_t* p, size_t& n, uint32_t v) { put16(p, n, v); put16(p, n, v >> 16); }
+};
+
+// Incremental parser; resynchronises on the next sync pair after garbage or
+// a CRC failure (e.g. text printed on the same port).
+class StreamParser {
+public:
+    uint32_t crcErrors = 0;
+    uint32_t skippedBytes = 0;
+
+    // Feed one byte; returns true when f holds a complete, valid frame
+    bool feed(uint8_t b, StreamFrame& f) {
+        if(len == 0 && b != STREAM_SYNC0) { skippedBytes++; return false; }
+        if(len == 1 && b != STREAM_SYNC1) {
+            skippedBytes++;
+            len = (b == STREAM_SYNC0) ? 1 : 0;
+            if(len == 0) skippedBytes++;
+            return false;
+        }
+        buf[len++] = b;
+        if(len == 4 && buf[3] > STREAM_MAX_BODY) { resync(); return false; }
+        if(len < 4 || len < (size_t)buf[3] + STREAM_OVERHEAD) return false;
+
+        size_t body = buf[3];
+        uint16_t crc = buf[4 + body] | (buf[5 + body] << 8);
+        if(crc != streamCrc16(buf + 2, body + 2)) {
+            crcErrors++;
+            resync();
+            return false;
+        }
+        bool ok = decodeBody(f);
+        len = 0;
+        return ok;
+    }
+
+private:
+    uint8_t buf[STREAM_MAX_FRAME];
+    size_t len = 0;
+
+    // Drop the first sync byte and rescan what was buffered after it
+    void resync() {
+        uint8_t copy[STREAM_MAX_FRAME];
+        size_t n = len - 1;
+        for(size_t i=0; i<n; i++) copy[i] = buf[i + 1];
+        len = 0;
+        skippedBytes++;
+        StreamFrame unused;
+        for(size_t i=0; i<n; i++) feed(copy[i], unused);
+    }
+
+    bool decodeBody(StreamFrame& f) {
+        const uint8_t* p = buf + 4;
+        size_t body = buf[3];
+        f.type = buf[2];
+        if(body < 6) return false;
+        f.seq = get16(p);
+        f.tUs = get32(p + 2);
+        switch(f.type) {
+            case STREAM_SAMPLE:
+                if(body < 13) return false;
+                f.controller = p[6];
+                f.address = get16(p + 7);
+                f.raw = (int32_t)get32(p + 9);
+                return true;
+            case STREAM_CONTROLLER:
+                if(body < 13) return false;
+                f.controller = p[6];
+                for(int i=0; i<6; i++) f.mac[i] = p[7 + i];
+                return true;
+            case STREAM_STATS:
+                if(body < 10) return false;
+                f.dropped = get32(p + 6);
+                return true;
+        }
+        return false; // Unknown type: skip, newer firmware
+    }
+
+    static uint16_t get16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+    static uint32_t get32(const uint8_t* p) { return get16(p) | ((uint32_t)get16(p + 2) << 16); }
+};
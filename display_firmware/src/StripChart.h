@@ -0,0 +1,111 @@
+#pragma once
+#include <TFT_eSPI.h>
+#include "Layout.h"
+#include "History.h"
+#include "EventTrace.h"
+
+// ST7789 vertical scrolling
+#define ST7789_VSCRDEF 0x33 // Scroll area: top fixed, scroll height, bottom fixed
+#define ST7789_VSCSAD  0x37 // Scroll start address
+
+// Incremental strip chart using the panel's hardware scroll.
+// The ST7789 scrolls along its 320-line axis, which is vertical in portrait,
+// so time runs from top (oldest) to bottom (newest). Every history sample
+// writes one 240-pixel line into the frame memory row that is about to be
+// shown at the bottom of the scroll area and advances the scroll start by one:
+// the panel moves the plot, nothing already on screen is redrawn.
+class StripChart {
+public:
+    // Enter a chart page: define the scroll area and replay the history
+    void begin(TFT_eSPI& tft, const ChartDef* def, const History& history) {
+        chart = def;
+        head = 0;
+        for(int t=0; t<MAX_TRACES; t++) prevX[t] = -1;
+
+        setScrollArea(tft, chart->top, chart->height);
+
+        size_t n = history.field(0).size();
+        size_t first = (n > (size_t)chart->height) ? n - chart->height : 0;
+        for(size_t i=first; i<n; i++) {
+            writeLine(tft, history, n - 1 - i);
+        }
+        setScrollStart(tft, chart->top + head);
+    }
+
+    // Leave the chart page: restore an unscrolled full-screen mapping
+    void end(TFT_eSPI& tft) {
+        if(!chart) return;
+        setScrollArea(tft, 0, TFT_HEIGHT);
+        setScrollStart(tft, 0);
+        chart = nullptr;
+    }
+
+    // Append the newest history sample as one line
+    void append(TFT_eSPI& tft, const History& history) {
+        if(!chart) return;
+        writeLine(tft, history, 0);
+        setScrollStart(tft, chart->top + head);
+    }
+
+    bool active() const { return chart != nullptr; }
+
+private:
+    static const int MAX_TRACES = 4;
+    static const int GRID_STEP = 60;   // Vertical grid line every 60 px
+
+    const ChartDef* chart = nullptr;
+    int16_t head = 0;                  // Next line within the scroll area
+    int16_t prevX[MAX_TRACES];
+    uint16_t line[TFT_WIDTH];
+
+    static uint16_t swap(uint16_t c) { return (c >> 8) | (c << 8); }
+
+    // Render history sample `age` (0 = newest) into the next memory row
+    void writeLine(TFT_eSPI& tft, const History& history, size_t age) {
+        for(int x=0; x<TFT_WIDTH; x++) {
+            line[x] = (x % GRID_STEP == 0) ? swap(TFT_DARKGREY) : 0;
+        }
+
+        for(int t=0; t<chart->numTraces && t<MAX_TRACES; t++) {
+            const TraceDef& tr = chart->traces[t];
+            int slot = fieldIndex(tr.field);
+            float v = (slot >= 0) ? history.field(slot).back(age) : NAN;
+            if(isnan(v)) {
+                prevX[t] = -1;
+                continue;
+            }
+
+            int x = (int)((v - tr.min) * (TFT_WIDTH - 1) / (tr.max - tr.min));
+            x = constrain(x, 0, TFT_WIDTH - 1);
+
+            // Join to the previous sample so fast changes stay continuous
+            int from = (prevX[t] < 0) ? x : prevX[t];
+            int lo = min(from, x), hi = max(from, x);
+            for(int i=lo; i<=hi; i++) line[i] = swap(tr.color);
+            prevX[t] = x;
+        }
+
+        // Sprite-ordered pixels, so push without byte swapping
+        TRACE_BEGIN(TR_SPI, TFT_WIDTH / 16);
+        tft.pushImage(0, chart->top + head, TFT_WIDTH, 1, line);
+        TRACE_END(TR_SPI, 0);
+        head = (head + 1) % chart->height;
+    }
+
+    static void setScrollArea(TFT_eSPI& tft, int16_t top, int16_t height) {
+        int16_t bottom = TFT_HEIGHT - top - height;
+        tft.writecommand(ST7789_VSCRDEF);
+        tft.writedata(top >> 8);
+        tft.writedata(top & 0xFF);
+        tft.writedata(height >> 8);
+        tft.writedata(height & 0xFF);
+        tft.writedata(bottom >> 8);
+        tft.writedata(bottom & 0xFF);
+    }
+
+    static void setScrollStart(TFT_eSPI& tft, int16_t row) {
+        tft.writecommand(ST7789_VSCSAD);
+        tft.writedata(row >> 8);
+        tft.writedata(row & 0xFF);
+    }
+};
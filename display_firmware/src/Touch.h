@@ -0,0 +1,128 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+// Capacitive touch: CST328 register access and gesture recognition.
+// Nothing here depends on Arduino, so the driver and recogniser run on the
+// host against a mock I2C device (see test/test_touch). The interrupt and
+// task glue for the target lives in TouchInput.h.
+
+// Minimal I2C transport the driver needs
+class I2cBus {
+public:
+    virtual ~I2cBus() {}
+    // Write `wlen` bytes, then (repeated start) read `rlen` bytes
+    virtual bool writeRead(uint8_t addr, const uint8_t* w, size_t wlen, uint8_t* r, size_t rlen) = 0;
+    virtual bool write(uint8_t addr, const uint8_t* w, size_t wlen) = 0;
+};
+
+struct TouchPoint {
+    bool down;
+    uint16_t x;
+    uint16_t y;
+};
+
+// CST328 in normal (report) mode. 16-bit big-endian register addresses.
+// First finger record at 0xD000:
+//   [0] id << 4 | state (0x06 = pressed)   [1] X[11:4]   [2] Y[11:4]
+//   [3] X[3:0] << 4 | Y[3:0]               [4] pressure
+//   [5] finger count (low nibble)          [6] 0xAB
+// Writing 0 to the count register acknowledges the report.
+class Cst328 {
+public:
+    static const uint8_t I2C_ADDR = 0x1A;
+    static const uint16_t REG_POINT1 = 0xD000;
+    static const uint16_t REG_COUNT = 0xD005;
+    static const uint8_t STATE_PRESSED = 0x06;
+
+    explicit Cst328(I2cBus& b) : bus(b) {}
+
+    // Read the current report after an INT pulse. Returns false on a bus error.
+    bool read(TouchPoint& p) {
+        uint8_t reg[2] = {REG_POINT1 >> 8, REG_POINT1 & 0xFF};
+        uint8_t buf[7];
+        if(!bus.writeRead(I2C_ADDR, reg, 2, buf, sizeof(buf))) return false;
+
+        uint8_t count = buf[5] & 0x0F;
+        p.down = count > 0 && (buf[0] & 0x0F) == STATE_PRESSED;
+        p.x = (uint16_t)((buf[1] << 4) | (buf[3] >> 4));
+        p.y = (uint16_t)((buf[2] << 4) | (buf[3] & 0x0F));
+
+        uint8_t ack[3] = {REG_COUNT >> 8, REG_COUNT & 0xFF, 0};
+        return bus.write(I2C_ADDR, ack, 3);
+    }
+
+private:
+    I2cBus& bus;
+};
+
+enum TouchGestureType : uint8_t {
+    GESTURE_NONE,
+    GESTURE_TAP,
+    GESTURE_SWIPE_LEFT,
+    GESTURE_SWIPE_RIGHT,
+    GESTURE_LONG_PRESS,
+};
+
+// Single-finger gesture recogniser fed with touch reports and time.
+class TouchGestures {
+public:
+    static const int TAP_SLOP_PX = 12;      // Max movement for tap / long press
+    static const int SWIPE_MIN_PX = 50;     // Min horizontal travel for a swipe
+    static const uint32_t TAP_MAX_MS = 300;
+    static const uint32_t SWIPE_MAX_MS = 600;
+    static const uint32_t HOLD_MS = 800;      // Long press
+
+    // Feed one report; returns a gesture completed by it
+    TouchGestureType feed(const TouchPoint& p, uint32_t nowMs) {
+        if(p.down) {
+            if(!tracking) {
+                tracking = true;
+                longFired = false;
+                startX = p.x; startY = p.y;
+                startMs = nowMs;
+            }
+            lastX = p.x; lastY = p.y;
+            return poll(nowMs);
+        }
+
+        if(!tracking) return GESTURE_NONE;
+        tracking = false;
+        if(longFired) return GESTURE_NONE;
+
+        int dx = (int)lastX - startX;
+        int dy = (int)lastY - startY;
+        uint32_t dt = nowMs - startMs;
+
+        if(abs(dx) >= SWIPE_MIN_PX && abs(dx) > 2 * abs(dy) && dt <= SWIPE_MAX_MS) {
+            return dx < 0 ? GESTURE_SWIPE_LEFT : GESTURE_SWIPE_RIGHT;
+        }
+        if(abs(dx) <= TAP_SLOP_PX && abs(dy) <= TAP_SLOP_PX && dt <= TAP_MAX_MS) {
+            return GESTURE_TAP;
+        }
+        return GESTURE_NONE;
+    }
+
+    // Long press fires while the finger is still down
+    TouchGestureType poll(uint32_t nowMs) {
+        if(!tracking || longFired) return GESTURE_NONE;
+        if(abs((int)lastX - startX) > TAP_SLOP_PX || abs((int)lastY - startY) > TAP_SLOP_PX) {
+            return GESTURE_NONE;
+        }
+        if(nowMs - startMs >= HOLD_MS) {
+            longFired = true;
+            return GESTURE_LONG_PRESS;
+        }
+        return GESTURE_NONE;
+    }
+
+    bool isTracking() const { return tracking; }
+
+private:
+    bool tracking = false;
+    bool longFired = false;
+    uint16_t startX = 0, startY = 0;
+    uint16_t lastX = 0, lastY = 0;
+    uint32_t startMs = 0;
+};
@@ -0,0 +1,118 @@
+#pragma once
+#include <Arduino.h>
+#include <Wire.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "Config.h"
+#include "Events.h"
+#include "Touch.h"
+
+// Arduino Wire implementation of I2cBus
+class WireBus : public I2cBus {
+public:
+    explicit WireBus(TwoWire& w) : wire(w) {}
+
+    bool writeRead(uint8_t addr, const uint8_t* w, size_t wlen, uint8_t* r, size_t rlen) override {
+        wire.beginTransmission(addr);
+        wire.write(w, wlen);
+        if(wire.endTransmission(false) != 0) return false;
+        if(wire.requestFrom(addr, (uint8_t)rlen) != rlen) return false;
+        for(size_t i=0; i<rlen; i++) r[i] = wire.read();
+        return true;
+    }
+
+    bool write(uint8_t addr, const uint8_t* w, size_t wlen) override {
+        wire.beginTransmission(addr);
+        wire.write(w, wlen);
+        return wire.endTransmission() == 0;
+    }
+
+private:
+    TwoWire& wire;
+};
+
+// Touch panel input.
+// The controller's INT line only wakes a low-priority task on core 0; that
+// task does the I2C transfer and gesture recognition, so a slow bus never
+// stalls rendering (loop() on core 1) and is preempted by the BLE host.
+// Gestures are posted to the same EventQueue as the buttons, with BTN_TOUCH.
+class TouchInput {
+public:
+    TouchInput() : chip(bus) {}
+
+    void init(EventQueue* out) {
+        events = out;
+
+        // Hardware reset, then normal report mode
+        pinMode(PIN_TOUCH_RST, OUTPUT);
+        digitalWrite(PIN_TOUCH_RST, LOW);
+        delay(10);
+        digitalWrite(PIN_TOUCH_RST, HIGH);
+        delay(50);
+
+        Wire.begin(PIN_TOUCH_SDA, PIN_TOUCH_SCL, 400000);
+
+        xTaskCreatePinnedToCore(touchTask, "touch", 3072, this, 2, &task, 0);
+        pinMode(PIN_TOUCH_INT, INPUT_PULLUP);
+        attachInterruptArg(digitalPinToInterrupt(PIN_TOUCH_INT), intIsr, this, FALLING);
+    }
+
+private:
+    // While touched the controller reports continuously; silence means lift
+    static const uint32_t LIFT_TIMEOUT_MS = 200;
+    static const uint32_t TRACK_POLL_MS = 50;
+
+    WireBus bus{Wire};
+    Cst328 chip;
+    TouchGestures gestures;
+    EventQueue* events = nullptr;
+    TaskHandle_t task = nullptr;
+    volatile int64_t intUs = 0;
+    uint32_t lastReportMs = 0;
+
+    static void IRAM_ATTR intIsr(void* arg) {
+        TouchInput* self = (TouchInput*)arg;
+        self->intUs = esp_timer_get_time();
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(self->task, &woken);
+        if(woken) portYIELD_FROM_ISR();
+    }
+
+    static void touchTask(void* arg) {
+        TouchInput* self = (TouchInput*)arg;
+        for(;;) {
+            // Idle: sleep until INT. Tracking: also wake for long press / lost lift
+            TickType_t timeout = self->gestures.isTracking() ? pdMS_TO_TICKS(TRACK_POLL_MS) : portMAX_DELAY;
+            bool irq = ulTaskNotifyTake(pdTRUE, timeout) > 0;
+            uint32_t now = millis();
+            TouchGestureType g = GESTURE_NONE;
+
+            if(irq) {
+                TouchPoint p;
+                if(!self->chip.read(p)) continue;
+                self->lastReportMs = now;
+                g = self->gestures.feed(p, now);
+            } else if(now - self->lastReportMs > LIFT_TIMEOUT_MS) {
+                TouchPoint lifted = {false, 0, 0};
+                g = self->gestures.feed(lifted, now);
+            } else {
+                g = self->gestures.poll(now);
+            }
+
+            if(g != GESTURE_NONE) self->post(g);
+        }
+    }
+
+    void post(TouchGestureType g) {
+        AppEvent ev = {EV_TAP, BTN_TOUCH, intUs};
+        switch(g) {
+            case GESTURE_TAP:         ev.type = EV_TAP; break;
+            case GESTURE_SWIPE_LEFT:  ev.type = EV_SWIPE_LEFT; break;
+            case GESTURE_SWIPE_RIGHT: ev.type = EV_SWIPE_RIGHT; break;
+            case GESTURE_LONG_PRESS:  ev.type = EV_LONG_PRESS; break;
+            default: return;
+        }
+        events->post(ev);
+    }
+};
@@ -0,0 +1,211 @@
+#pragma once
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <atomic>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "PacketTrace.h"
+#include "SpscRing.h"
+
+// Packet trace capture, for replaying a field issue on the bench
+// (ReplayTransport.h) or the host (tools/trace_replay).
+//
+// Off by default; a double press of RECONNECT starts and stops it. Every
+// packet from the controller link is pushed with its arrival time into a
+// RAM ring from the transport's context, before parsing, so the trace holds
+// what arrived, malformed packets included. Packets longer than one BLE
+// notification (a UART link allows more) are cut to TRACE_MAX_PACKET.
+// A low-priority task on core 0 encodes the ring into TRACE_PATH on
+// LittleFS, replacing the last capture, and stops at TRACE_FILE_BYTES
+// (~40 s at 400 packets/s). Pull the file off the data partition like the
+// trip logs.
+//
+// Link changes while capturing are recorded as link events. loop() only
+// flags them with their time (onLink()); the capture task writes them in
+// order with the packets, so the ring keeps a single producer. Ring overflow
+// drops packets and counts them in `dropped`; a replay then runs without
+// them, so keep the count in mind when reading a trace.
+
+#define TRACE_RING        512
+#define TRACE_FILE_BYTES  (128UL * 1024)
+#define TRACE_PATH        "/trace.ptr"
+
+class TraceCapture {
+public:
+    // Statistics, read from loop()
+    uint32_t dropped = 0;
+    uint32_t packets = 0;
+    uint32_t bytesWritten = 0;
+
+    // After LittleFS is mounted (TripRecorder::init())
+    void init() {
+        xTaskCreatePinnedToCore(captureTask, "capture", 3072, this, 1, &task, 0);
+    }
+
+    void start() {
+        if(active) return;
+        startRequested = true;
+        active = true;
+        xTaskNotifyGive(task);
+    }
+
+    void stop() {
+        if(!active) return;
+        active = false;
+        xTaskNotifyGive(task);
+    }
+
+    bool isActive() const { return active; }
+
+    // Stopped by itself at TRACE_FILE_BYTES or on a full filesystem
+    bool full() const { return fileFull; }
+
+    // Producer side, from the transport's receive context; never blocks
+    void push(const uint8_t* data, size_t length) {
+        if(!active) return;
+        Entry e;
+        e.us = (uint32_t)esp_timer_get_time();
+        e.length = length < TRACE_MAX_PACKET ? length : TRACE_MAX_PACKET;
+        memcpy(e.data, data, e.length);
+        add(e);
+    }
+
+    // Link up or down, from loop()
+    void onLink(bool up) {
+        if(!active) return;
+        linkUs = (uint32_t)esp_timer_get_time();
+        linkEvent = up ? LINK_UP : LINK_DOWN;
+        xTaskNotifyGive(task);
+    }
+
+private:
+    struct Entry {
+        uint32_t us;
+        uint8_t length;
+        uint8_t data[TRACE_MAX_PACKET];
+    };
+
+    enum : uint8_t { LINK_NONE, LINK_DOWN, LINK_UP };
+
+    SpscRing<Entry, TRACE_RING> ring;
+    TaskHandle_t task = nullptr;
+    volatile bool active = false;
+    volatile bool startRequested = false;
+    volatile bool fileFull = false;
+    std::atomic<uint8_t> linkEvent{LINK_NONE};
+    std::atomic<uint32_t> linkUs{0};
+
+    // Capture task state
+    File file;
+    PacketTraceWriter writer;
+    uint64_t traceUs = 0;
+    uint32_t lastUs = 0;
+    uint8_t chunk[512];
+    size_t chunkLen = 0;
+
+    void add(const Entry& e) {
+        if(!ring.push(e)) {
+            dropped++;
+            return;
+        }
+        if(ring.size() == TRACE_RING / 2) xTaskNotifyGive(task);
+    }
+
+    static void captureTask(void* arg) {
+        TraceCapture* self = (TraceCapture*)arg;
+        for(;;) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(200));
+            self->drain();
+        }
+    }
+
+    void drain() {
+        if(startRequested) {
+            startRequested = false;
+            open();
+        }
+
+        // A link event goes before the first packet that arrived after it
+        uint8_t link = linkEvent.exchange(LINK_NONE);
+        uint32_t atUs = linkUs.load();
+        Entry e;
+        while(ring.pop(e)) {
+            if(!file) continue;
+            if(link != LINK_NONE && (int32_t)(e.us - atUs) >= 0) {
+                writeLink(atUs, link == LINK_UP);
+                link = LINK_NONE;
+            }
+            advance(e.us);
+            if(chunkLen + TRACE_MAX_RECORD > sizeof(chunk)) writeChunk();
+            chunkLen += writer.packet(chunk + chunkLen, traceUs, e.data, e.length);
+            packets++;
+        }
+        if(link != LINK_NONE && file) writeLink(atUs, link == LINK_UP);
+
+        if(!active && file) {
+            writeChunk();
+            file.close();
+            Serial.printf("Trace: %lu packets, %lu bytes, %lu dropped\n", (unsigned long)packets,
+                          (unsigned long)bytesWritten, (unsigned long)dropped);
+        } else if(chunkLen > 0) {
+            writeChunk(); // At least every 200 ms, so a crash loses little
+        }
+    }
+
+    // 32-bit arrival times; the difference survives their wrap. Events from
+    // just before the file opened count as time 0.
+    void advance(uint32_t us) {
+        int32_t dt = (int32_t)(us - lastUs);
+        if(dt > 0) {
+            traceUs += dt;
+            lastUs = us;
+        }
+    }
+
+    void writeLink(uint32_t us, bool up) {
+        advance(us);
+        if(chunkLen + TRACE_MAX_RECORD > sizeof(chunk)) writeChunk();
+        chunkLen += writer.link(chunk + chunkLen, traceUs, up);
+    }
+
+    void open() {
+        if(file) {
+            writeChunk();
+            file.close();
+        }
+        file = LittleFS.open(TRACE_PATH, FILE_WRITE);
+        packets = 0;
+        dropped = 0;
+        bytesWritten = 0;
+        fileFull = false;
+        if(!file) {
+            Serial.println("Trace: cannot create " TRACE_PATH);
+            active = false;
+            return;
+        }
+        lastUs = (uint32_t)esp_timer_get_time();
+        traceUs = 0;
+        chunkLen = writer.header(chunk, millis());
+    }
+
+    // Stops the capture at TRACE_FILE_BYTES, or when the filesystem is full
+    void writeChunk() {
+        if(!file || chunkLen == 0) return;
+        if(bytesWritten + chunkLen > TRACE_FILE_BYTES) {
+            fileFull = true;
+            active = false;
+            chunkLen = 0;
+            return;
+        }
+        size_t n = file.write(chunk, chunkLen);
+        file.flush();
+        bytesWritten += n;
+        if(n < chunkLen) {
+            Serial.println("Trace: filesystem full");
+            fileFull = true;
+            active = false;
+        }
+        chunkLen = 0;
+    }
+};
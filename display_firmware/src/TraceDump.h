@@ -0,0 +1,95 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <esp_pm.h>
+#include <esp_ipc.h>
+#include "EventTrace.h"
+
+#ifndef TRACE_STALL_MS
+#define TRACE_STALL_MS     50       // loop() pass that counts as a stutter
+#endif
+#define TRACE_DUMP_GAP_MS  10000    // At most one automatic dump this often
+
+// Prints the event trace (EventTrace.h) to Serial, by hand (double press
+// VIEW) or when a loop() pass stalls, so the events leading up to the
+// stutter are in the rings. Only built with TRACE_EVENTS.
+//
+// Each core's cycle counter runs on its own, so a dump starts with a sync
+// line per core pairing that core's counter with esp_timer; the converter
+// places both cores on one time line from them. While tracing, a PM lock
+// holds the CPU at its top clock, so cycles stay proportional to time
+// (dynamic frequency scaling would otherwise change the rate under us).
+class TraceDump {
+public:
+    uint32_t dumps = 0;
+    uint32_t stalls = 0;
+
+    void init() {
+#if CONFIG_PM_ENABLE
+        if(esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "trace", &lock) == 0) esp_pm_lock_acquire(lock);
+#endif
+    }
+
+    // End of a loop() pass that took `us`
+    void onPass(uint32_t us, uint32_t now) {
+        uint32_t ms = us / 1000;
+        if(dumped) {
+            dumped = false; // That pass printed a dump
+            return;
+        }
+        if(ms < TRACE_STALL_MS) return;
+        stalls++;
+        TRACE_INSTANT(TR_STALL, ms > 0xFFFF ? 0xFFFF : ms);
+        Serial.printf("Trace: loop() pass took %lu ms\n", (unsigned long)ms);
+        if(dumps && now - lastDump < TRACE_DUMP_GAP_MS) return;
+        dump();
+    }
+
+    // Freeze the rings, print them, start over. Serial at 115200 takes a few
+    // seconds for full rings; nothing is recorded meanwhile.
+    void dump() {
+        eventTrace.freeze();
+        dumps++;
+        char line[64];
+        tracedump::header(line, sizeof(line), getCpuFrequencyMhz());
+        Serial.println(line);
+        SyncPoint sync[EVENT_CORES];
+        takeSync(&sync[traceCore()]);
+        int other = traceCore() ^ 1;
+        esp_ipc_call_blocking(other, takeSync, &sync[other]);
+        for(int c=0; c<EVENT_CORES; c++) {
+            tracedump::sync(line, sizeof(line), c, sync[c].cycles, sync[c].us);
+            Serial.println(line);
+        }
+        for(int c=0; c<EVENT_CORES; c++) {
+            uint32_t n = eventTrace.count(c);
+            for(uint32_t i=0; i<n; i++) {
+                tracedump::event(line, sizeof(line), c, eventTrace.at(c, i));
+                Serial.println(line);
+            }
+            tracedump::end(line, sizeof(line), c, n, eventTrace.total(c));
+            Serial.println(line);
+        }
+        eventTrace.restart();
+        lastDump = millis();
+        dumped = true;
+    }
+
+private:
+    struct SyncPoint {
+        uint32_t cycles;
+        uint64_t us;
+    };
+
+#if CONFIG_PM_ENABLE
+    esp_pm_lock_handle_t lock = nullptr;
+#endif
+    uint32_t lastDump = 0;
+    bool dumped = false;
+
+    static void takeSync(void* arg) {
+        SyncPoint* s = (SyncPoint*)arg;
+        s->us = esp_timer_get_time();
+        s->cycles = traceCycles();
+    }
+};
@@ -0,0 +1,141 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "PacketTrace.h"
+
+// Time spent in one stage of the pipeline, per event
+struct StageTime {
+    uint32_t count = 0;
+    uint64_t totalUs = 0;
+    uint32_t maxUs = 0;
+
+    void add(uint32_t us) {
+        count++;
+        totalUs += us;
+        if(us > maxUs) maxUs = us;
+    }
+
+    float averageUs() const { return count ? (float)totalUs / count : 0; }
+};
+
+// Replay of a packet trace (PacketTrace.h) into whatever stands in for the
+// controller link: ReplayTransport on the device, tools/trace_replay on the
+// host. Portable (test/test_trace).
+//
+// The trace is fed in chunks as it is read from a file; run() hands out the
+// records that are due. At speed 1 a record is due when as much time has
+// passed since begin() as had passed since the capture started (2 = twice
+// as fast, ...), and `lateness` collects how far behind that delivery ran.
+// At speed 0 every buffered record is due at once, for measuring how fast
+// the pipeline can take a ride.
+class TraceReplay {
+public:
+    static const size_t BUFFER = 512;
+
+    // Statistics
+    uint32_t packets = 0;
+    uint32_t linkEvents = 0;
+    uint64_t bytes = 0;
+    bool malformed = false;     // Stopped at a corrupt record
+    StageTime lateness;         // Real time only
+    uint64_t traceUs = 0;       // Trace time of the last record delivered
+
+    // False if the header is not a trace
+    bool begin(const uint8_t* header, size_t length, float speed, uint64_t nowUs) {
+        *this = TraceReplay();
+        if(!reader.header(header, length)) return false;
+        this->speed = speed;
+        startUs = nowUs;
+        lastUs = nowUs;
+        started = true;
+        return true;
+    }
+
+    // Trace bytes after the header; returns how many fit in the buffer
+    size_t feed(const uint8_t* p, size_t n) {
+        if(pos > 0) {
+            memmove(buf, buf + pos, len - pos);
+            len -= pos;
+            pos = 0;
+        }
+        if(n > BUFFER - len) n = BUFFER - len;
+        memcpy(buf + len, p, n);
+        len += n;
+        return n;
+    }
+
+    size_t room() const { return BUFFER - (len - pos); }
+
+    // No more input: once the buffer runs dry, the replay is finished
+    void end() { inputDone = true; }
+
+    bool finished() const { return !started || malformed || (inputDone && !pending && pos == len); }
+
+    // Deliver the records due by nowUs, at most maxRecords, to
+    // out(const TraceRecord&). Returns how many went out.
+    template<typename F>
+    uint32_t run(uint64_t nowUs, uint32_t maxRecords, F&& out) {
+        uint32_t n = 0;
+        while(n < maxRecords && decode()) {
+            uint64_t due = dueAt(record);
+            if(speed > 0 && nowUs < due) break;
+            if(speed > 0) lateness.add((uint32_t)(nowUs - due));
+            pending = false;
+            traceUs = record.us;
+            if(record.length) {
+                packets++;
+                bytes += record.length;
+            } else {
+                linkEvents++;
+            }
+            out(record);
+            n++;
+        }
+        lastUs = nowUs;
+        return n;
+    }
+
+    // When the next record is due, nowUs of the last run() if it already
+    // is; UINT64_MAX with nothing buffered
+    uint64_t nextDue() {
+        if(!decode()) return UINT64_MAX;
+        uint64_t due = dueAt(record);
+        return speed > 0 && due > lastUs ? due : lastUs;
+    }
+
+    uint32_t captureStartMs() const { return reader.startMs; }
+    float rate() const { return speed; }
+
+private:
+    PacketTraceReader reader;
+    TraceRecord record;
+    bool pending = false;       // record decoded, not yet delivered
+    uint8_t buf[BUFFER];
+    size_t len = 0;
+    size_t pos = 0;
+    bool inputDone = false;
+    bool started = false;
+    float speed = 1;
+    uint64_t startUs = 0;
+    uint64_t lastUs = 0;
+
+    bool decode() {
+        if(pending) return true;
+        if(malformed) return false;
+        int n = reader.next(buf + pos, len - pos, record);
+        if(n < 0 || (n == 0 && inputDone && len > pos)) {
+            malformed = n < 0;  // A partial last record is a cut-short capture
+            if(n == 0) pos = len;
+            return false;
+        }
+        if(n == 0) return false;
+        pos += n;
+        pending = true;
+        return true;
+    }
+
+    uint64_t dueAt(const TraceRecord& r) const {
+        return startUs + (uint64_t)(r.us / (double)speed);
+    }
+};
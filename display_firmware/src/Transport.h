@@ -0,0 +1,53 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include "EventTrace.h"
+
+// Link to the controller, below ControllerSession.
+//
+// Implementations:
+//   BleClientManager   NimBLE central, the controller's FFE0 service
+//   UartTransport      UART, optionally RS485 half duplex
+//   LoopbackTransport  in-process ControllerEmulator, for host tests
+//   SimTransport       ControllerEmulator on a task of its own, for the bench
+//
+// A packet is one whole protocol message, [AddrLow][AddrHigh|flags][data];
+// a transport over a byte stream frames packets itself.
+class Transport {
+public:
+    typedef std::function<void(const uint8_t* data, size_t length)> ReceiveFn;
+
+    virtual ~Transport() {}
+
+    virtual bool connected() const = 0;
+
+    // The stream setup can go out. A link without a handshake (UartTransport)
+    // only counts as connected once the controller answers it.
+    virtual bool canSend() const { return connected(); }
+
+    // One command to the controller, without response. False if not sent.
+    virtual bool send(const uint8_t* data, size_t length) = 0;
+
+    virtual void disconnect() {}
+
+    // Controller identity: the BLE MAC, zeros on a wired link
+    virtual const uint8_t* peer() const {
+        static const uint8_t none[6] = {};
+        return none;
+    }
+
+    // Packets from the controller, delivered in the transport's own context
+    // (BLE host task, UART event task, LoopbackTransport::poll() caller)
+    void setReceiver(ReceiveFn fn) { receiver = fn; }
+
+protected:
+    void deliver(const uint8_t* data, size_t length) {
+        TRACE_BEGIN(TR_NOTIFY, length);
+        if(receiver) receiver(data, length);
+        TRACE_END(TR_NOTIFY, 0);
+    }
+
+private:
+    ReceiveFn receiver;
+};
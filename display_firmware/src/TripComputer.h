@@ -0,0 +1,153 @@
+#pragma once
+#include <stdint.h>
+#include "Config.h"
+
+// Incremental trip computer. Fed every decoded sample, O(1) per sample, no
+// history: each integrator keeps only its previous value and timestamp.
+//
+// Energy integrates Power (115, kW) with the trapezoid rule, split into used
+// (> 0) and regenerated (< 0) Wh. While no Power sample arrived for
+// SOURCE_STALE_MS it integrates Volt x Current (113 x 119) instead, so a
+// controller that doesn't stream 115 still gets an energy figure.
+// Distance integrates Speed (24, km/h); average speed is over moving time.
+// Gaps longer than MAX_GAP_MS (link lost, parked) are not integrated.
+
+// Persisted state. Plain data, saved as one blob.
+struct TripTotals {
+    uint32_t version;
+    double whUsed;
+    double whRegen;
+    double km;
+    uint32_t movingMs;
+    float peakKw;
+};
+
+#define TRIP_TOTALS_VERSION 1
+
+class TripComputer {
+public:
+    static const uint32_t MAX_GAP_MS = 2000;
+    static const uint32_t SOURCE_STALE_MS = 2000;
+    static constexpr float MOVING_KMH = 0.5f;
+
+    TripComputer() { reset(); }
+
+    void reset() {
+        totals = TripTotals();
+        totals.version = TRIP_TOTALS_VERSION;
+        power = Integrator();
+        viPower = Integrator();
+        speed = Integrator();
+        voltValid = false;
+        lastPowerMs = 0;
+        havePower = false;
+    }
+
+    // Continue from saved totals. Returns false (and resets) on a version mismatch.
+    bool restore(const TripTotals& saved) {
+        reset();
+        if(saved.version != TRIP_TOTALS_VERSION) return false;
+        totals = saved;
+        return true;
+    }
+
+    // One wire sample. Returns true if the trip figures changed.
+    bool onSample(uint16_t address, float value, uint32_t ms) {
+        switch(address) {
+            case ADDR_POWER:
+                havePower = true;
+                lastPowerMs = ms;
+                addEnergy(power, value, ms);
+                return true;
+
+            case ADDR_VOLT:
+                volt = value;
+                voltValid = true;
+                return false;
+
+            case ADDR_CURRENT:
+                if(!voltValid || (havePower && ms - lastPowerMs < SOURCE_STALE_MS)) return false;
+                addEnergy(viPower, volt * value / 1000.0f, ms);
+                return true;
+
+            case ADDR_SPEED: {
+                double hours;
+                float prev;
+                if(speed.step(value, ms, hours, prev)) {
+                    totals.km += (prev + value) * 0.5 * hours;
+                    if(prev >= MOVING_KMH || value >= MOVING_KMH) totals.movingMs += (uint32_t)(hours * 3600000.0);
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const TripTotals& get() const { return totals; }
+
+    double netWh() const { return totals.whUsed - totals.whRegen; }
+
+    float whPerKm() const {
+        return totals.km > 0.05 ? (float)(netWh() / totals.km) : 0.0f;
+    }
+
+    float avgSpeed() const {
+        return totals.movingMs > 0 ? (float)(totals.km / (totals.movingMs / 3600000.0)) : 0.0f;
+    }
+
+private:
+    // Previous sample of one integrated signal
+    struct Integrator {
+        float last = 0;
+        uint32_t lastMs = 0;
+        bool valid = false;
+
+        // Advance to (v, ms). True with the elapsed hours and previous value
+        // when the interval is integrable.
+        bool step(float v, uint32_t ms, double& hours, float& prev) {
+            bool ok = valid && ms - lastMs <= MAX_GAP_MS;
+            hours = (ms - lastMs) / 3600000.0;
+            prev = last;
+            last = v;
+            lastMs = ms;
+            valid = true;
+            return ok;
+        }
+    };
+
+    TripTotals totals;
+    Integrator power;
+    Integrator viPower;
+    Integrator speed;
+    float volt = 0;
+    bool voltValid = false;
+    bool havePower = false;
+    uint32_t lastPowerMs = 0;
+
+    void addEnergy(Integrator& src, float kw, uint32_t ms) {
+        if(kw > totals.peakKw) totals.peakKw = kw;
+
+        double hours;
+        float prev;
+        if(!src.step(kw, ms, hours, prev)) return;
+
+        // Trapezoid, split at the zero crossing so used and regen stay exact
+        double a = prev, b = kw;
+        double used, regen;
+        if(a >= 0 && b >= 0) {
+            used = (a + b) * 0.5 * hours;
+            regen = 0;
+        } else if(a <= 0 && b <= 0) {
+            used = 0;
+            regen = -(a + b) * 0.5 * hours;
+        } else {
+            double t0 = a / (a - b) * hours; // Time of the crossing
+            double pos = a > 0 ? a : b, neg = a > 0 ? b : a;
+            double tPos = a > 0 ? t0 : hours - t0;
+            used = pos * 0.5 * tPos;
+            regen = -neg * 0.5 * (hours - tPos);
+        }
+        totals.whUsed += used * 1000.0;
+        totals.whRegen += regen * 1000.0;
+    }
+};
@@ -0,0 +1,158 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "Codec.h"
+
+// Trip log block format. Portable (no Arduino), so the encoder and decoder run
+// on the host as well (see test/test_triplog).
+//
+// A log file is a sequence of self-contained blocks of at most
+// TRIPLOG_BLOCK_SIZE bytes. A torn or corrupt block fails its CRC and is
+// skipped without losing the blocks after it.
+//
+// Header, 16 bytes little endian:
+//   0  u16 magic "TL"      4  u32 timestamp of the first sample (ms)
+//   2  u8  version         8  u16 sample count
+//   3  u8  reserved       10  u16 payload length
+//                         12  u32 CRC-32 of bytes 0..11 and the payload
+//
+// Payload, per sample (coders from Codec.h, one pair per slot, reset at the
+// start of each block to the block timestamp and 0):
+//   u8      field slot (index in TARGET_FIELDS)
+//   varint  DeltaOfDelta of this slot's timestamps (ms)
+//   varint  DeltaValue of this slot's raw values
+//
+// Raw values are the integers on the wire, before calibration. A field
+// streamed at a steady rate with small changes takes 3 bytes instead of 9.
+
+#define TRIPLOG_MAGIC        0x4C54
+#define TRIPLOG_VERSION      2
+#define TRIPLOG_HEADER_SIZE  16
+#define TRIPLOG_BLOCK_SIZE   1024
+#define TRIPLOG_MAX_SAMPLE   (1 + 2 * codec::MAX_VARINT)
+#define TRIPLOG_MAX_SLOTS    32
+
+struct TripSample {
+    uint32_t ms;
+    uint8_t slot;
+    int32_t raw;
+};
+
+// Reflected CRC-32 (IEEE), nibble table
+inline uint32_t tripCrc32(const uint8_t* p, size_t n, uint32_t crc = 0) {
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    crc = ~crc;
+    for(size_t i=0; i<n; i++) {
+        crc = (crc >> 4) ^ table[(crc ^ p[i]) & 0x0F];
+        crc = (crc >> 4) ^ table[(crc ^ (p[i] >> 4)) & 0x0F];
+    }
+    return ~crc;
+}
+
+class TripBlockEncoder {
+public:
+    TripBlockEncoder() { reset(); }
+
+    void reset() {
+        len = TRIPLOG_HEADER_SIZE;
+        count = 0;
+    }
+
+    // False when the block has no room left; finish() it and add again
+    bool add(const TripSample& s) {
+        if(s.slot >= TRIPLOG_MAX_SLOTS) return true; // Not a logged field, drop
+        if(len + TRIPLOG_MAX_SAMPLE > TRIPLOG_BLOCK_SIZE) return false;
+        if(count == 0) {
+            baseMs = s.ms;
+            for(int i=0; i<TRIPLOG_MAX_SLOTS; i++) {
+                times[i].reset(baseMs);
+                values[i].reset();
+            }
+        }
+
+        buf[len++] = s.slot;
+        len += codec::putVarint(buf + len, times[s.slot].encode(s.ms));
+        len += codec::putVarint(buf + len, values[s.slot].encode(s.raw));
+        count++;
+        return true;
+    }
+
+    // Fill in the header. Returns the block length; data() is valid until reset()
+    size_t finish() {
+        put16(0, TRIPLOG_MAGIC);
+        buf[2] = TRIPLOG_VERSION;
+        buf[3] = 0;
+        put32(4, baseMs);
+        put16(8, count);
+        put16(10, (uint16_t)(len - TRIPLOG_HEADER_SIZE));
+        uint32_t crc = tripCrc32(buf, 12);
+        crc = tripCrc32(buf + TRIPLOG_HEADER_SIZE, len - TRIPLOG_HEADER_SIZE, crc);
+        put32(12, crc);
+        return len;
+    }
+
+    const uint8_t* data() const { return buf; }
+    uint16_t samples() const { return count; }
+    uint32_t firstMs() const { return baseMs; }
+
+private:
+    uint8_t buf[TRIPLOG_BLOCK_SIZE];
+    size_t len;
+    uint16_t count;
+    uint32_t baseMs = 0;
+    DeltaOfDelta times[TRIPLOG_MAX_SLOTS];
+    DeltaValue values[TRIPLOG_MAX_SLOTS];
+
+    void put16(size_t at, uint16_t v) { buf[at] = v; buf[at + 1] = v >> 8; }
+    void put32(size_t at, uint32_t v) { put16(at, v); put16(at + 2, v >> 16); }
+};
+
+class TripBlockDecoder {
+public:
+    // Total length of the block at p (header + payload), 0 if p is not a
+    // block header. Lets a reader step over a block whose CRC fails.
+    static size_t blockLength(const uint8_t* p, size_t avail) {
+        if(avail < TRIPLOG_HEADER_SIZE || get16(p) != TRIPLOG_MAGIC || p[2] != TRIPLOG_VERSION) return 0;
+        size_t total = TRIPLOG_HEADER_SIZE + get16(p + 10);
+        return total <= TRIPLOG_BLOCK_SIZE ? total : 0;
+    }
+
+    // Decode one block, calling out(const TripSample&) per sample.
+    // Returns the number of samples, or -1 if the block is malformed.
+    template<typename F>
+    static int decode(const uint8_t* p, size_t avail, F&& out) {
+        size_t total = blockLength(p, avail);
+        if(total == 0 || total > avail) return -1;
+
+        uint32_t crc = tripCrc32(p, 12);
+        crc = tripCrc32(p + TRIPLOG_HEADER_SIZE, total - TRIPLOG_HEADER_SIZE, crc);
+        if(crc != get32(p + 12)) return -1;
+
+        uint16_t count = get16(p + 8);
+        uint32_t base = get32(p + 4);
+        DeltaOfDelta times[TRIPLOG_MAX_SLOTS];
+        DeltaValue values[TRIPLOG_MAX_SLOTS];
+        for(int i=0; i<TRIPLOG_MAX_SLOTS; i++) times[i].reset(base);
+
+        TripSample s;
+        size_t pos = TRIPLOG_HEADER_SIZE;
+        for(uint16_t i=0; i<count; i++) {
+            uint32_t dt, dv;
+            if(pos >= total) return -1;
+            s.slot = p[pos++];
+            if(s.slot >= TRIPLOG_MAX_SLOTS) return -1;
+            if(!codec::getVarint(p, total, pos, dt) || !codec::getVarint(p, total, pos, dv)) return -1;
+            s.ms = times[s.slot].decode(dt);
+            s.raw = values[s.slot].decode(dv);
+            out(s);
+        }
+        return pos == total ? count : -1;
+    }
+
+private:
+    static uint16_t get16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+    static uint32_t get32(const uint8_t* p) { return get16(p) | ((uint32_t)get16(p + 2) << 16); }
+};
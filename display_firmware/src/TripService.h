@@ -0,0 +1,116 @@
+#pragma once
+#include <Arduino.h>
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include "Protocol.h"
+#include "RangeEstimator.h"
+#include "TripComputer.h"
+#include "VehicleState.h"
+
+// Every TRIP_SAVE_MS while the trip changes, plus on disconnect and reset.
+// The totals and range blobs rewrite ~9 NVS entries; the default 20 KB NVS
+// partition sees a page erase every ~15 minutes of riding, far inside its
+// endurance. A power cut loses at most TRIP_SAVE_MS of accumulation.
+#define TRIP_SAVE_MS 60000UL
+
+// Target glue for TripComputer and RangeEstimator: feeds them from the notify
+// callback, publishes the figures as virtual fields (VF_*) and keeps the
+// totals and the learned range fits in NVS.
+class TripService {
+public:
+    void init(VehicleState* out) {
+        state = out;
+        prefs.begin("trip", false);
+        TripTotals saved;
+        if(prefs.getBytes("totals", &saved, sizeof(saved)) == sizeof(saved)) {
+            computer.restore(saved);
+        }
+        RangeEstimator::State fits;
+        if(prefs.getBytes("range", &fits, sizeof(fits)) == sizeof(fits)) {
+            range.restore(fits);
+        }
+        publish();
+    }
+
+    // From the BLE notify callback
+    void onSample(const Protocol::ParsedData& data) {
+        bool rangeChanged = false;
+        RangeEstimator::Estimate est = {};
+        portENTER_CRITICAL(&lock);
+        bool changed = computer.onSample(data.address, data.value, millis());
+        if(data.address == ADDR_SOC) {
+            soc = data.value;
+            haveSoc = true;
+        }
+        if(haveSoc && (changed || data.address == ADDR_SOC)) {
+            rangeChanged = range.update(soc, computer.netWh(), computer.get().km);
+            if(rangeChanged) est = range.estimate();
+        }
+        portEXIT_CRITICAL(&lock);
+        if(changed) {
+            dirty = true;
+            publish();
+        }
+        if(rangeChanged && est.valid) {
+            state->update(VF_RANGE, est.km);
+            state->update(VF_RANGE_LO, est.lowKm);
+            state->update(VF_RANGE_HI, est.highKm);
+        } else if(rangeChanged) {
+            // No estimate any more (long regen descent): blank the old one
+            state->invalidate(VF_RANGE);
+            state->invalidate(VF_RANGE_LO);
+            state->invalidate(VF_RANGE_HI);
+        }
+    }
+
+    // From loop(): periodic save
+    void service() {
+        if(dirty && millis() - lastSave >= TRIP_SAVE_MS) save();
+    }
+
+    void save() {
+        portENTER_CRITICAL(&lock);
+        TripTotals snapshot = computer.get();
+        RangeEstimator::State fits = range.state();
+        portEXIT_CRITICAL(&lock);
+        prefs.putBytes("totals", &snapshot, sizeof(snapshot));
+        prefs.putBytes("range", &fits, sizeof(fits));
+        lastSave = millis();
+        dirty = false;
+    }
+
+    void reset() {
+        portENTER_CRITICAL(&lock);
+        computer.reset();
+        range.rebase(); // Net Wh and km restart; the learned fits stay
+        portEXIT_CRITICAL(&lock);
+        publish();
+        save();
+    }
+
+private:
+    TripComputer computer;
+    RangeEstimator range;
+    float soc = 0;
+    bool haveSoc = false;
+    VehicleState* state = nullptr;
+    Preferences prefs;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    volatile bool dirty = false;
+    uint32_t lastSave = 0;
+
+    void publish() {
+        portENTER_CRITICAL(&lock);
+        TripTotals t = computer.get();
+        float whKm = computer.whPerKm();
+        float avg = computer.avgSpeed();
+        portEXIT_CRITICAL(&lock);
+
+        state->update(VF_WH_USED, (float)t.whUsed);
+        state->update(VF_WH_REGEN, (float)t.whRegen);
+        state->update(VF_DISTANCE, (float)t.km);
+        state->update(VF_WH_PER_KM, whKm);
+        state->update(VF_AVG_SPEED, avg);
+        state->update(VF_PEAK_POWER, t.peakKw);
+    }
+};
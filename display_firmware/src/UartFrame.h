@@ -0,0 +1,77 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "StreamFrame.h"
+
+// Packet framing for UartTransport. Portable (test/test_session).
+//
+//   0xA5 0x5A  u8 length  packet  u16 CRC-16/CCITT (length..packet)
+//
+// Same sync bytes and CRC as the USB stream (StreamFrame.h). The parser
+// resynchronises on the next sync pair after noise or a bad CRC, which on
+// an RS485 bus can follow a bus turnaround.
+
+#define UART_MAX_PACKET 64
+#define UART_MAX_FRAME  (UART_MAX_PACKET + 5)
+
+// Returns the frame length, 0 if the packet is too long
+inline size_t uartEncode(const uint8_t* packet, size_t len, uint8_t* out) {
+    if(len > UART_MAX_PACKET) return 0;
+    out[0] = STREAM_SYNC0;
+    out[1] = STREAM_SYNC1;
+    out[2] = len;
+    memcpy(out + 3, packet, len);
+    uint16_t crc = streamCrc16(out + 2, len + 1);
+    out[3 + len] = crc & 0xFF;
+    out[4 + len] = crc >> 8;
+    return len + 5;
+}
+
+class UartParser {
+public:
+    uint32_t crcErrors = 0;
+
+    // Feed one byte. True when a packet is complete: see packet()/length().
+    bool push(uint8_t b) {
+        switch(state) {
+            case SYNC0:
+                if(b == STREAM_SYNC0) state = SYNC1;
+                return false;
+            case SYNC1:
+                state = b == STREAM_SYNC1 ? LENGTH : (b == STREAM_SYNC0 ? SYNC1 : SYNC0);
+                return false;
+            case LENGTH:
+                if(b > UART_MAX_PACKET) {
+                    state = SYNC0;
+                    return false;
+                }
+                buf[0] = b;
+                got = 0;
+                state = BODY;
+                return false;
+            case BODY:
+                buf[1 + got++] = b;
+                if(got < buf[0] + 2) return false;
+                state = SYNC0;
+                {
+                    uint16_t crc = buf[1 + buf[0]] | (buf[2 + buf[0]] << 8);
+                    if(crc != streamCrc16(buf, buf[0] + 1)) {
+                        crcErrors++;
+                        return false;
+                    }
+                }
+                return true;
+        }
+        return false;
+    }
+
+    const uint8_t* packet() const { return buf + 1; }
+    size_t length() const { return buf[0]; }
+
+private:
+    enum State : uint8_t { SYNC0, SYNC1, LENGTH, BODY };
+    State state = SYNC0;
+    uint8_t buf[UART_MAX_PACKET + 3];  // Length, packet, CRC
+    int got = 0;
+};
@@ -0,0 +1,78 @@
+#pragma once
+#include <Arduino.h>
+#include "Transport.h"
+#include "UartFrame.h"
+
+// Wired controller port. RS485 when a driver-enable pin is given: the UART
+// drives DE itself in half-duplex mode, so send() never waits for the bus.
+#ifndef PIN_UART_RX
+#define PIN_UART_RX   17
+#endif
+#ifndef PIN_UART_TX
+#define PIN_UART_TX   18
+#endif
+#ifndef PIN_UART_DE
+#define PIN_UART_DE   -1  // RS485 driver enable, -1 = plain UART
+#endif
+#ifndef UART_BAUD
+#define UART_BAUD     115200
+#endif
+#define UART_LINK_TIMEOUT_MS 3000
+#define UART_PROBE_MS        5000   // Stream setup retry while nothing answers
+
+// UART transport, framed per UartFrame.h. There is no handshake: the stream
+// setup goes out as soon as the port is open (canSend()), and the link only
+// counts as connected while packets arrive, at most UART_LINK_TIMEOUT_MS
+// apart. A controller that is off or unplugged is a link that is down, so
+// the unit can park; startLink() repeats the setup every UART_PROBE_MS.
+class UartTransport : public Transport {
+public:
+    explicit UartTransport(HardwareSerial& p = Serial1) : port(p) {}
+
+    void begin() {
+        if(open) return;
+        port.setRxBufferSize(1024);
+        port.begin(UART_BAUD, SERIAL_8N1, PIN_UART_RX, PIN_UART_TX);
+        if(PIN_UART_DE >= 0) {
+            port.setPins(-1, -1, -1, PIN_UART_DE); // RTS drives DE
+            port.setMode(UART_MODE_RS485_HALF_DUPLEX);
+        }
+        // Runs in the UART driver's event task, like a BLE notify callback
+        port.onReceive([this]() { pump(); });
+        open = true;
+    }
+
+    bool connected() const override { return open && heard && millis() - lastRx < UART_LINK_TIMEOUT_MS; }
+
+    bool canSend() const override { return open; }
+
+    bool send(const uint8_t* data, size_t length) override {
+        uint8_t frame[UART_MAX_FRAME];
+        size_t n = uartEncode(data, length, frame);
+        return n && open && port.write(frame, n) == n;
+    }
+
+    void disconnect() override {
+        open = false;
+        heard = false;
+        port.end();
+    }
+
+    uint32_t crcErrors() const { return parser.crcErrors; }
+
+private:
+    HardwareSerial& port;
+    UartParser parser;
+    volatile bool open = false;
+    volatile bool heard = false;
+    volatile uint32_t lastRx = 0;   // millis() of the last packet
+
+    void pump() {
+        while(port.available() > 0) {
+            if(!parser.push((uint8_t)port.read())) continue;
+            lastRx = millis();
+            heard = true;
+            deliver(parser.packet(), parser.length());
+        }
+    }
+};
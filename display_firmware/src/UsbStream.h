@@ -0,0 +1,158 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "Protocol.h"
+#include "SpscRing.h"
+#include "StreamFrame.h"
+
+// Native USB port. With CDC-on-boot the same port carries the Serial debug
+// prints; the host parser skips them (see StreamParser), at the cost of some
+// CRC errors in its statistics.
+#if ARDUINO_USB_CDC_ON_BOOT
+#define STREAM_PORT Serial
+#else
+#define STREAM_PORT USBSerial
+#endif
+
+#define STREAM_RING        512
+#define STREAM_STATS_MS    1000
+
+// Full-rate binary telemetry over USB, off by default.
+// Toggled at runtime by the VIEW+BRIGHT chord, or by the host writing 'B'
+// (binary on) / 'T' (off) to the port. The notify callback only formats a
+// frame into a ring; a writer task on core 0 moves whole frames to the USB
+// FIFO and drops (and counts) frames that don't fit instead of blocking.
+//
+// Sequence numbers are assigned by the writer as frames go out, and advanced
+// past every frame lost on the way (ring overflow, full FIFO), so the host
+// sees both kinds of loss as gaps while frames stay in order.
+class UsbStream {
+public:
+    // Frames produced but never sent: ring overflow or USB FIFO full
+    std::atomic<uint32_t> dropped{0};
+    uint32_t sent = 0;
+
+    void init() {
+#if !ARDUINO_USB_CDC_ON_BOOT
+        STREAM_PORT.begin();
+#endif
+        STREAM_PORT.setTxTimeoutMs(0); // Never block on a host that isn't reading
+        xTaskCreatePinnedToCore(writerTask, "usbstream", 3072, this, 1, &task, 0);
+    }
+
+    void setEnabled(bool on) {
+        if(on && !enabled) announce = true;
+        enabled = on;
+        Serial.printf("USB stream %s\n", on ? "on" : "off");
+    }
+
+    bool isEnabled() const { return enabled; }
+
+    // New controller connection, from loop() once the link is up and before
+    // configure() starts its stream: push() sees the new number from the
+    // first sample on (on a UART link, which is up only once it streams,
+    // from the next one). The MAC is stored before `announce` is raised, so the
+    // writer task never sends a half-written one.
+    void onConnect(const uint8_t mac[6]) {
+        for(int i=0; i<6; i++) controllerMac[i] = mac[i];
+        controller++;
+        announce = true;
+    }
+
+    // Producer side, from the BLE notify callback
+    void push(const Protocol::ParsedData& data) {
+        if(!enabled) return;
+        StreamFrame f = {};
+        f.type = STREAM_SAMPLE;
+        f.tUs = (uint32_t)esp_timer_get_time();
+        f.controller = controller;
+        f.address = data.address;
+        f.raw = data.raw;
+        if(!ring.push(f)) {
+            ringDrops++;
+            return;
+        }
+        if(ring.size() == STREAM_RING / 4) xTaskNotifyGive(task);
+    }
+
+private:
+    SpscRing<StreamFrame, STREAM_RING> ring;
+    TaskHandle_t task = nullptr;
+    volatile bool enabled = false;
+    std::atomic<bool> announce{false};
+    volatile uint8_t controller = 0;
+    uint8_t controllerMac[6] = {};
+    std::atomic<uint32_t> ringDrops{0};
+
+    // Writer task state
+    uint16_t seq = 0;
+    uint32_t ringDropsSeen = 0;
+    uint32_t lastStats = 0;
+
+    StreamFrame frame(uint8_t type) {
+        StreamFrame f = {};
+        f.type = type;
+        f.tUs = (uint32_t)esp_timer_get_time();
+        return f;
+    }
+
+    static void writerTask(void* arg) {
+        UsbStream* self = (UsbStream*)arg;
+        for(;;) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+            self->pollCommands();
+            self->drain();
+        }
+    }
+
+    void pollCommands() {
+        while(STREAM_PORT.available()) {
+            int c = STREAM_PORT.read();
+            if(c == 'B') setEnabled(true);
+            else if(c == 'T') setEnabled(false);
+        }
+    }
+
+    void drain() {
+        uint8_t buf[STREAM_MAX_FRAME];
+        if(enabled && announce.exchange(false)) {
+            StreamFrame c = frame(STREAM_CONTROLLER);
+            c.controller = controller;
+            for(int i=0; i<6; i++) c.mac[i] = controllerMac[i];
+            send(c, buf);
+        }
+
+        StreamFrame f;
+        while(ring.pop(f)) {
+            // Ring losses show up as a gap where they are noticed
+            uint32_t lost = ringDrops.load() - ringDropsSeen;
+            ringDropsSeen += lost;
+            dropped += lost;
+            seq += lost;
+            if(enabled) send(f, buf);
+        }
+
+        uint32_t now = millis();
+        if(enabled && now - lastStats >= STREAM_STATS_MS) {
+            lastStats = now;
+            StreamFrame s = frame(STREAM_STATS);
+            s.dropped = dropped.load();
+            send(s, buf);
+        }
+    }
+
+    // Whole frames only, so the host never sees a torn one
+    void send(StreamFrame& f, uint8_t* buf) {
+        f.seq = seq++;
+        size_t n = StreamEncoder::encode(f, buf);
+        if((size_t)STREAM_PORT.availableForWrite() < n) {
+            dropped++;
+            return;
+        }
+        STREAM_PORT.write(buf, n);
+        sent++;
+    }
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "Config.h"
+
+// Latest value of every monitored field.
+// Written from the BLE notify callback regardless of which page is on screen,
+// read by the renderer from loop(). Each field has a slot (see fieldIndex(),
+// virtual fields included) and a bit in the dirty mask.
+class VehicleState {
+public:
+    static const int MAX_SLOTS = 32; // One bit per slot in the dirty mask
+    static_assert(NUM_SLOTS <= MAX_SLOTS, "Too many fields for the dirty mask");
+
+    void update(uint16_t addr, float value) {
+        int slot = fieldIndex(addr);
+        if(slot < 0) return;
+
+        // Repeats of the shown value don't dirty the slot, so a stationary
+        // vehicle leaves the screen (and the power manager) idle
+        uint32_t bit = 1UL << slot;
+        if((validMask.load() & bit) && values[slot] == value) return;
+
+        // 32-bit aligned stores are atomic on the ESP32, the mask publishes them
+        values[slot] = value;
+        validMask.fetch_or(bit);
+        dirtyMask.fetch_or(bit);
+    }
+
+    // The value is no longer known: the slot turns invalid and dirty, and
+    // render() blanks the widgets that showed it
+    void invalidate(uint16_t addr) {
+        int slot = fieldIndex(addr);
+        if(slot < 0) return;
+        uint32_t bit = 1UL << slot;
+        if(validMask.fetch_and(~bit) & bit) dirtyMask.fetch_or(bit);
+    }
+
+    // Slots changed since the last call
+    uint32_t takeDirty() {
+        return dirtyMask.exchange(0);
+    }
+
+    bool isValid(int slot) const {
+        return slot >= 0 && (validMask.load() & (1UL << slot));
+    }
+
+    float value(int slot) const {
+        return values[slot];
+    }
+
+private:
+    float values[MAX_SLOTS] = {};
+    std::atomic<uint32_t> validMask{0};
+    std::atomic<uint32_t> dirtyMask{0};
+};
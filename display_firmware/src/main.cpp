@@ -1,17 +1,86 @@
 #include <Arduino.h>
 #include "BleClient.h"
+#include "ControllerSession.h"
+#if CONTROLLER_UART
+#include "UartTransport.h"
+#endif
+#include "SimTransport.h"
+#include "ReplayTransport.h"
+#include "TraceCapture.h"
 #include "Display.h"
 #include "Input.h"
+#include "TouchInput.h"
+#include "VehicleState.h"
+#include "History.h"
+#include "Power.h"
+#include "Recorder.h"
+#include "UsbStream.h"
+#include "TripService.h"
+#include "BatteryService.h"
+#include "MapService.h"
+#include "RuleService.h"
+#include "PollService.h"
+#include "ParamService.h"
+#include "RelayService.h"
+#if TRACE_EVENTS
+#include "TraceDump.h"
+#endif
+#if LATENCY_PROBE
+#include "LatencyService.h"
+#endif
 
 BleClientManager bleClient;
+ControllerSession session;
+#if CONTROLLER_UART
+UartTransport uart; // Wired controller instead of BLE; bleClient only serves phones then
+Transport* const controllerLink = &uart;
+#else
+Transport* const controllerLink = &bleClient;
+#endif
+SimTransport sim;
+ReplayTransport replay;
 DisplayManager display;
+VehicleState vehicle;
+History history;
 
-Button btnView(PIN_BTN_VIEW);
-Button btnBright(PIN_BTN_BRIGHT);
-Button btnReconnect(PIN_BTN_RECONNECT);
+EventQueue events;
+ButtonInput buttons;
+TouchInput touch;
+InputLatency inputLatency;
+PowerManager power;
+TripRecorder recorder;
+TraceCapture capture;
+UsbStream usbStream;
+TripService trip;
+BatteryService battery;
+MapService opmap;
+RuleService rules;
+PollService poll;
+ParamService params;
+RelayService relay;
+#if TRACE_EVENTS
+EventTrace eventTrace;
+TraceDump traceDump;
+#endif
+#if LATENCY_PROBE
+LatencyService latency;
+#endif
 
 bool wasConnected = false;
+Transport* connectedLink = nullptr; // Link wasConnected refers to
 unsigned long lastScan = 0;
+unsigned long rescanAt = 0; // Pending rescan after a disconnect, or UART probe (0 = none)
+
+// Bench simulation rates, stepped through by the three-button chord
+const uint32_t SIM_RATES[] = {SIM_RATE_HZ, 500, 2000, 10000};
+const int NUM_SIM_RATES = sizeof(SIM_RATES) / sizeof(SIM_RATES[0]);
+#define SIM_REPORT_MS 5000
+int simStep = -1;           // Index into SIM_RATES, -1 = real controller
+// Trace replay speeds, stepped through by double pressing BRIGHT
+const float REPLAY_SPEEDS[] = {1, 0}; // As recorded, as fast as possible
+const int NUM_REPLAY_SPEEDS = sizeof(REPLAY_SPEEDS) / sizeof(REPLAY_SPEEDS[0]);
+int replayStep = -1;        // Index into REPLAY_SPEEDS, -1 = not replaying
+uint32_t renders = 0;       // Passes that rendered changed values
 
 // Scan callback
 class AdvertisedDeviceCallbacks: public NimBLEAdvertisedDeviceCallbacks {
@@ -24,114 +93,433 @@ class AdvertisedDeviceCallbacks: public NimBLEAdvertisedDeviceCallbacks {
             if (name.find("cjpower") != std::string::npos) match = true;
             if (name.find("cj-power") != std::string::npos) match = true;
             
-            if (match) {
-                NimBLEDevice::getScan()->stop();
-                display.updateStatus("Connecting...", TFT_BLUE);
-                
-                if(bleClient.connectToServer(advertisedDevice)) {
-                    display.updateStatus("Connected!", TFT_GREEN);
-                    delay(500);
-                    display.updateStatus("Configuring...", TFT_ORANGE);
-                    bleClient.configureDataStream();
-                    display.updateStatus("Active", TFT_GREEN);
-                } else {
-                    display.updateStatus("Failed", TFT_RED);
-                    delay(1000);
-                    display.updateStatus("Scanning...", TFT_MAGENTA);
-                    NimBLEDevice::getScan()->start(0, BleClientManager::scanEndedCB);
-                }
-            }
+            if (match) bleClient.found(advertisedDevice); // loop() connects
         }
     }
 };
 
+// Look for (BLE) or reopen (UART) the controller link, or restart the simulation
+void startLink() {
+    if(session.link() == &sim) {
+        sim.start(sim.rate());
+        return;
+    }
+    if(session.link() == &replay) {
+        replay.start(replay.rate()); // From the beginning
+        return;
+    }
+#if CONTROLLER_UART
+    // No handshake: send the stream setup, the link is up once it streams
+    uart.begin();
+    display.updateStatus("Waiting for controller", TFT_MAGENTA);
+    session.configure(millis());
+    rescanAt = millis() + UART_PROBE_MS;
+#else
+    display.updateStatus("Scanning...", TFT_MAGENTA);
+    bleClient.startScan();
+#endif
+}
+
+// Next simulation rate, or back to the controller after the last one.
+// loop() sees the link change and sets the new one up.
+void cycleSimulation() {
+    simStep = simStep + 1 < NUM_SIM_RATES ? simStep + 1 : -1;
+    replayStep = -1;
+    if(simStep < 0) {
+        session.disconnect();
+        session.attach(controllerLink);
+        display.updateStatus("Simulation off", TFT_CYAN);
+        return;
+    }
+    if(session.link() != &sim) {
+        bleClient.stopScan();
+        session.disconnect();
+        session.attach(&sim);
+    }
+    sim.start(SIM_RATES[simStep]);
+    char text[32];
+    snprintf(text, sizeof(text), "Simulation %lu Hz", (unsigned long)sim.rate());
+    display.updateStatus(text, TFT_CYAN);
+}
+
+// Replay the captured trace as recorded, then as fast as possible, then back
+// to the controller. Each step starts the trace from the beginning.
+void cycleReplay() {
+    replayStep = replayStep + 1 < NUM_REPLAY_SPEEDS ? replayStep + 1 : -1;
+    simStep = -1;
+    if(replayStep >= 0 && capture.isActive()) {
+        display.updateStatus("Stop capture first", TFT_ORANGE);
+        replayStep = -1;
+        return;
+    }
+    if(replayStep < 0) {
+        session.disconnect();
+        session.attach(controllerLink);
+        display.updateStatus("Replay off", TFT_CYAN);
+        return;
+    }
+    if(session.link() != &replay) {
+        bleClient.stopScan();
+        session.disconnect();
+        session.attach(&replay);
+    }
+    if(!replay.start(REPLAY_SPEEDS[replayStep])) {
+        display.updateStatus("No trace", TFT_ORANGE);
+        return; // The next double press goes back to the controller
+    }
+    display.updateStatus(REPLAY_SPEEDS[replayStep] > 0 ? "Replay" : "Replay, full speed", TFT_CYAN);
+}
+
+// Capture what the controller link delivers, for replaying later
+void toggleCapture() {
+    if(capture.isActive()) {
+        capture.stop();
+        display.updateStatus("Capture off", TFT_CYAN);
+    } else if(session.link() == &replay) {
+        display.updateStatus("Replaying", TFT_ORANGE);
+    } else {
+        capture.start();
+        if(session.isConnected()) capture.onLink(true);
+        display.updateStatus("Capture on", TFT_CYAN);
+    }
+}
+
+// Replay done: throughput, stage times and the state it left on the display
+void reportReplay() {
+    replay.report();
+    Serial.printf("  %s page:", PAGES[display.page()].name);
+    for(int slot=0; slot<NUM_SLOTS; slot++) Serial.printf(" %s=%.2f", fieldName(slot), vehicle.value(slot));
+    Serial.println();
+    display.updateStatus("Replay done", TFT_CYAN);
+}
+
+// Per-period rates of the simulated pipeline. Sustained when no rounds
+// were missed.
+void reportSimulation() {
+    static uint32_t lastMs, lastRounds, lastMissed, lastSamples, lastRenders;
+    uint32_t now = millis();
+    if(now - lastMs < SIM_REPORT_MS) return;
+    float s = (now - lastMs) / 1000.0f;
+    uint32_t r = sim.rounds.load(), m = sim.missed.load(), n = session.samples.load();
+    Serial.printf("Sim %lu Hz: %.0f rounds/s, %lu missed, %.0f samples/s, %.0f renders/s%s\n",
+                  (unsigned long)sim.rate(), (r - lastRounds) / s, (unsigned long)(m - lastMissed),
+                  (n - lastSamples) / s, (renders - lastRenders) / s, m == lastMissed ? ", sustained" : "");
+    lastMs = now;
+    lastRounds = r;
+    lastMissed = m;
+    lastSamples = n;
+    lastRenders = renders;
+}
+
+// The rider's own controller, not a bench link (simulation, replay): only
+// its samples reach the trip log, trip totals, range fits and operating
+// map, which are persisted
+bool onController() {
+    return session.link() == controllerLink;
+}
+
 void setup() {
     Serial.begin(115200);
     
-    // Init Buttons
-    btnView.init();
-    btnBright.init();
-    btnReconnect.init();
-    
-    display.init();
-    
-    // Init Buttons
-    btnView.init();
-    btnBright.init();
-    btnReconnect.init();
+    // Init Buttons (interrupt driven, events arrive through the queue)
+    events.init();
+    buttons.init(&events);
+    touch.init(&events);
     
     display.init();
+    display.attachHistory(&history);
+    display.attachMap(&opmap.map());
+    power.init(display.tft, bleClient, session);
     
-    // Show Logo
-    display.showLogo();
-    delay(2000);
-    
-    // Show Button Help
-    display.showButtonHelp();
-    delay(3000);
+    // Woken from deep sleep only to look for the controller: no splash
+    if(!power.wokeFromTimer()) {
+        // Show Logo
+        display.showLogo();
+        delay(2000);
+
+        // Show Button Help
+        display.showButtonHelp();
+        delay(3000);
+    }
     
     // Clear and show status
-    display.tft.fillScreen(TFT_BLACK); // Access tft directly or add clear method
     display.drawStaticUI();
     display.updateStatus("Initializing BLE...", TFT_WHITE);
     
     bleClient.init();
+    session.attach(controllerLink);
+    relay.init(&session, &vehicle); // Phones connect while we scan
+    recorder.init();
+    capture.init();
+#if TRACE_EVENTS
+    traceDump.init();
+#endif
+#if LATENCY_PROBE
+    latency.init(&display);
+#endif
+    usbStream.init();
+    trip.init(&vehicle);
+    battery.init(&vehicle);
+    opmap.init(&vehicle);
+    rules.init(&display, &power);
+    poll.init(&session, &vehicle, &display);
+    params.init(&session, &display); // After recorder.init() mounts LittleFS
     
-    // Setup Data Callback
-    bleClient.onDataReceived = [](uint16_t addr, float val) {
-        switch(addr) {
-            case 24: display.updateSpeed(val); break;
-            case 26: display.updateSoC((int)val); break;
-            case 220: display.updateThrottle(val); break;
-            case 105: display.updateRPM((int)val); break;
-            case 113: display.updateVoltage(val); break;
-            case 115: display.updatePower(val); break;
-            case 119: display.updateCurrent(val); break;
-            case 222: display.updateTemp((int)val); break;
+    // Setup Data Callback: only store into the model and the trip log ring,
+    // loop() renders it. Bench links feed the display and USB stream only.
+    session.onDataReceived = [](const Protocol::ParsedData& data) {
+#if LATENCY_PROBE
+        latency.onSample(data); // Before the slot turns dirty
+#endif
+        vehicle.update(data.address, data.value);
+        usbStream.push(data);
+        if(onController()) {
+            recorder.push(data.slot, data.raw);
+            trip.onSample(data);
+            battery.onSample(data);
+            opmap.onSample(data);
         }
+        events.notifyData();
+    };
+    session.onOtherPacket = [](const uint8_t* data, size_t length) {
+        poll.onPacket(data, length);
+        params.onPacket(data, length);
+        relay.onUpstreamPacket(data, length);
+        events.notifyData();
+    };
+    session.onPacket = [](const uint8_t* data, size_t length) {
+#if LATENCY_PROBE
+        latency.onPacket();
+#endif
+        capture.push(data, length);
+    };
+    session.onStreaming = []() {
+        poll.start(); // Reads go out between stream packets from here on
+        display.updateStatus("Active", TFT_GREEN);
     };
 
+#if !CONTROLLER_UART
     NimBLEDevice::getScan()->setAdvertisedDeviceCallbacks(new AdvertisedDeviceCallbacks());
-    
-    display.updateStatus("Scanning...", TFT_MAGENTA);
-    bleClient.startScan();
+#endif
+#if CONTROLLER_SIM
+    cycleSimulation(); // Bench build: simulated controller from boot
+#else
+    startLink();
+#endif
 }
 
-void loop() {
-    // === Button Handling ===
-    if (btnView.checkPressed()) {
-        display.nextPage();
+void handleInput(const AppEvent& ev) {
+    TRACE_INSTANT(TR_BUTTON, ev.type << 8 | ev.buttons);
+    switch(ev.type) {
+        case EV_PRESS:
+            if(ev.buttons == BTN_VIEW) {
+                display.nextPage(vehicle);
+            } else if(ev.buttons == BTN_BRIGHT) {
+                power.toggleBrightness();
+            } else if(ev.buttons == BTN_RECONNECT) {
+                if(session.isConnected()) {
+                    // Long press forces a disconnect, see below
+                    display.updateStatus("Hold to reconnect", TFT_ORANGE);
+                } else {
+                    startLink();
+                }
+            }
+            break;
+
+        case EV_LONG_PRESS:
+            if(ev.buttons == BTN_VIEW) {
+#if LATENCY_PROBE
+                if(PAGES[display.page()].latency) {
+                    latency.reset(); // Start a new measurement instead
+                    break;
+                }
+#endif
+                display.showPage(0, vehicle); // Back to the grid
+            } else if(ev.buttons == BTN_BRIGHT) {
+                trip.reset();
+                battery.resetSags();
+                display.updateStatus("Trip reset", TFT_CYAN);
+            } else if(ev.buttons == BTN_RECONNECT && session.isConnected()) {
+                display.updateStatus("Reconnecting...", TFT_ORANGE);
+                session.disconnect();
+            } else if(ev.buttons == BTN_TOUCH) {
+                display.showPage(0, vehicle);
+            }
+            break;
+
+        case EV_CHORD:
+            // Chords arrive once, with every button that took part, and
+            // without presses of their own (Input.h). The three-button chord
+            // therefore never runs a two-button binding, or a press binding,
+            // on its way.
+            if(ev.buttons == (BTN_VIEW | BTN_BRIGHT | BTN_RECONNECT)) {
+                cycleSimulation();
+            } else if(ev.buttons == (BTN_VIEW | BTN_BRIGHT)) {
+                usbStream.setEnabled(!usbStream.isEnabled());
+                display.updateStatus(usbStream.isEnabled() ? "USB stream on" : "USB stream off", TFT_CYAN);
+            } else if(session.isStreaming() && !params.busy()) {
+                // Controller parameters to / from flash
+                if(ev.buttons == (BTN_VIEW | BTN_RECONNECT)) params.backup();
+                else if(ev.buttons == (BTN_BRIGHT | BTN_RECONNECT)) params.restore(session.link()->peer());
+            }
+            break;
+
+        case EV_SWIPE_LEFT:
+            display.nextPage(vehicle);
+            break;
+
+        case EV_SWIPE_RIGHT:
+            display.prevPage(vehicle);
+            break;
+
+        case EV_DOUBLE_PRESS:
+            // The two presses have run too: BRIGHT toggled twice, back as it was
+            if(ev.buttons == BTN_BRIGHT) cycleReplay();
+            else if(ev.buttons == BTN_RECONNECT) toggleCapture();
+#if TRACE_EVENTS
+            else if(ev.buttons == BTN_VIEW) traceDump.dump();
+#endif
+            else return;
+            break;
+
+        default:
+            return; // Release and taps are not bound yet
     }
-    
-    if (btnBright.checkPressed()) {
-        display.toggleBrightness();
+
+    inputLatency.record(ev.edgeUs);
+#if INPUT_LATENCY_LOG
+    Serial.printf("Input latency %lld us (avg %lld, max %lld)\n",
+                  inputLatency.last, inputLatency.average(), inputLatency.max);
+#endif
+}
+
+// Ticks until the next history sample is due (sooner while the stream is
+// being set up, whose steps are tens of ms apart)
+TickType_t ticksToNextSample() {
+    unsigned long next = (history.samples() ? history.lastSampleTime() : 0) + HISTORY_PERIOD_MS;
+    long wait = (long)(next - millis());
+    if(session.isSendingSetup() && wait > 10) wait = 10;
+    return wait > 0 ? pdMS_TO_TICKS(wait) : 0;
+}
+
+void loop() {
+    // === Wait for input, data or the next history tick ===
+    AppEvent ev;
+    TRACE_BEGIN(TR_WAIT, 0);
+    bool woken = events.wait(ev, ticksToNextSample());
+    TRACE_END(TR_WAIT, 0);
+#if TRACE_EVENTS
+    uint32_t passUs = micros();
+#endif
+    if(woken) {
+        if(ev.type != EV_DATA) {
+            // With the panel off the first input only wakes it
+            bool dark = power.state() == PWR_PARKED;
+            power.onInput();
+            if(!dark) handleInput(ev);
+        }
     }
-    
-    if (btnReconnect.checkPressed()) {
-        if(bleClient.isConnected) {
-            // If connected, do we disconnect? Or just rescan?
-            // Let's assume user wants to find a different device or fix connection
-             display.updateStatus("Reconnecting...", TFT_ORANGE);
-             // Currently BleClient doesn't have explicit disconnect method exposed but we can restart scan logic
-             // Ideally we should force disconnect 
+
+#if !CONTROLLER_UART
+    // === Controller found by the scan: connect here, not on the host task ===
+    if(bleClient.hasFound()) {
+        display.updateStatus("Connecting...", TFT_BLUE);
+        if(bleClient.connectFound()) {
+            display.updateStatus("Connected!", TFT_GREEN); // Stream set up below
         } else {
-             display.updateStatus("Scanning...", TFT_MAGENTA);
-             bleClient.startScan();
+            display.updateStatus("Failed", TFT_RED);
+            rescanAt = millis() + 1000;
         }
     }
+#endif
 
-    // Watchdog or Reconnect logic
-    if(!bleClient.isConnected && wasConnected) {
+    // === Link down (or switched): save, then look again. Up: set up the stream ===
+    if(wasConnected && (!session.isConnected() || session.link() != connectedLink)) {
         wasConnected = false;
+        TRACE_INSTANT(TR_LINK, 0);
+        capture.onLink(false);
+        poll.stop();
+        params.abort();
+        if(connectedLink == controllerLink) {
+            recorder.flush();
+            trip.save();
+            opmap.save();
+        }
         display.updateStatus("Disconnected", TFT_RED);
-        delay(2000);
-        display.updateStatus("Scanning...", TFT_MAGENTA);
-        bleClient.startScan();
+        rescanAt = millis() + 2000;
     }
-    
-    if(bleClient.isConnected) {
+    if(rescanAt && (long)(millis() - rescanAt) >= 0) {
+        rescanAt = 0;
+        startLink();
+    }
+
+    if(session.isConnected() && !wasConnected) {
         wasConnected = true;
+        connectedLink = session.link();
+        TRACE_INSTANT(TR_LINK, 1);
+        capture.onLink(true);
+        if(onController()) recorder.startTrip(); // Before the stream starts
+        usbStream.onConnect(session.link()->peer());
+        rescanAt = 0;
+        if(!session.isConfiguring()) { // UART: set up by startLink() already
+            display.updateStatus("Configuring...", TFT_ORANGE);
+            session.configure(millis() + 500); // Give the controller a moment after connecting
+        }
     }
-    
-    delay(50); // Faster loop for buttons
+    session.service(millis());
+
+    // === Polled registers: next read, fault report ===
+    poll.service();
+    if(session.isConnected()) params.service(session.link()->peer());
+
+    // === Render changed values ===
+    uint32_t dirty = vehicle.takeDirty();
+    if(dirty) power.onData();
+    relay.onDirty(dirty);
+    rules.service(vehicle, dirty); // Alarm colours apply in this same render
+    uint32_t renderUs = micros();
+    TRACE_BEGIN(TR_RENDER, __builtin_popcount(dirty));
+    display.render(vehicle, dirty);
+    TRACE_END(TR_RENDER, 0);
+    if(dirty) renders++;
+    if(session.link() == &sim) reportSimulation();
+    if(session.link() == &replay) {
+        if(dirty) replay.render.add(micros() - renderUs);
+        if(replay.finished()) reportReplay();
+    }
+
+    // === Batches to connected phones, pairing prompts ===
+    relay.service();
+    if(uint32_t code = relay.takePairingCode()) {
+        char text[32];
+        snprintf(text, sizeof(text), "Phone pair code %06lu", (unsigned long)code);
+        if(!PAGES[display.page()].showStatus) display.showPage(0, vehicle);
+        display.updateStatus(text, TFT_CYAN);
+    }
+    int paired = relay.takePairingResult();
+    if(paired >= 0) display.updateStatus(paired ? "Phone paired" : "Pairing failed", paired ? TFT_GREEN : TFT_RED);
+
+    // === Trend history ===
+    if(history.sample(vehicle, millis())) {
+        display.onHistorySample();
+    }
+
+    // === Operating map heatmap, latency table, if shown ===
+    display.refreshHeatmap();
+#if LATENCY_PROBE
+    display.refreshLatency();
+    latency.service();
+#endif
+
+    // === Trip totals, pack figures and operating map to NVS ===
+    trip.service();
+    battery.service();
+    opmap.service();
+
+    // === Backlight, panel mode, scan duty, sleep ===
+    power.service();
+
+#if TRACE_EVENTS
+    traceDump.onPass(micros() - passUs, millis());
+#endif
 }
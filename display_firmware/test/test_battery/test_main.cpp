@@ -0,0 +1,123 @@
+#include <unity.h>
+#include <math.h>
+#include "BatteryEstimator.h"
+
+static BatteryEstimator bat;
+
+void setUp() { bat.reset(); }
+void tearDown() {}
+
+static int32_t rawV(float v) { return (int32_t)lroundf(v * 10.0f); }
+static int32_t rawI(float a) { return (int32_t)lroundf(a * 10.0f); }
+
+// Synthetic pack: V = ocv - r * I plus uniform noise of +-noiseV, with the
+// current swinging between lo and hi amps. Volt then Current every 100 ms.
+static uint32_t drive(uint32_t ms, int pairs, float ocv, float r, float lo, float hi,
+                      float noiseV = 0.2f, uint32_t seed = 7) {
+    for(int i=0; i<pairs; i++, ms += 100) {
+        seed = seed * 1664525u + 1013904223u;
+        float n = noiseV * (((seed >> 8) & 0xFFFF) / 32768.0f - 1.0f);
+        float a = lo + (hi - lo) * 0.5f * (1.0f + sinf(i * 0.21f));
+        bat.onSample(ADDR_VOLT, rawV(ocv - r * a + n), ms);
+        bat.onSample(ADDR_CURRENT, rawI(a), ms + 20);
+    }
+    return ms;
+}
+
+void test_recovers_resistance_and_ocv() {
+    drive(0, 300, 72.0f, 0.08f, 5.0f, 120.0f);
+    const BatteryEstimator::Fit& f = bat.fit();
+    TEST_ASSERT_TRUE(f.valid);
+    TEST_ASSERT_FLOAT_WITHIN(0.004f, 0.08f, f.ohms);
+    TEST_ASSERT_FLOAT_WITHIN(0.3f, 72.0f, f.ocv);
+    TEST_ASSERT_TRUE(f.r2 > 0.9f);
+}
+
+void test_regen_current_is_part_of_the_fit() {
+    drive(0, 300, 84.0f, 0.05f, -60.0f, 80.0f);
+    TEST_ASSERT_TRUE(bat.fit().valid);
+    TEST_ASSERT_FLOAT_WITHIN(0.004f, 0.05f, bat.fit().ohms);
+    TEST_ASSERT_FLOAT_WITHIN(0.3f, 84.0f, bat.fit().ocv);
+}
+
+void test_constant_current_gives_no_fit() {
+    drive(0, 300, 72.0f, 0.08f, 40.0f, 40.0f);
+    TEST_ASSERT_FALSE(bat.fit().valid);
+}
+
+void test_keeps_last_fit_while_cruising() {
+    uint32_t ms = drive(0, 300, 72.0f, 0.08f, 5.0f, 120.0f);
+    drive(ms, 300, 72.0f, 0.08f, 30.0f, 30.0f);
+    TEST_ASSERT_TRUE(bat.fit().valid);
+    TEST_ASSERT_FLOAT_WITHIN(0.004f, 0.08f, bat.fit().ohms);
+}
+
+void test_window_follows_a_resistance_change() {
+    uint32_t ms = drive(0, 300, 72.0f, 0.05f, 5.0f, 120.0f);
+    drive(ms, BatteryEstimator::WINDOW, 72.0f, 0.12f, 5.0f, 120.0f, 0.2f, 99);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 0.12f, bat.fit().ohms);
+}
+
+void test_sliding_sums_match_a_fresh_window() {
+    // Long run, then the same last WINDOW pairs into a fresh estimator
+    drive(0, 5000, 72.0f, 0.08f, 0.0f, 150.0f, 0.3f, 3);
+    BatteryEstimator::Fit a = bat.fit();
+    bat.reset();
+    // Replay the last window with the noise it had
+    uint32_t seed = 3;
+    for(int i=0; i<5000; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        if(i < 5000 - BatteryEstimator::WINDOW) continue;
+        float n = 0.3f * (((seed >> 8) & 0xFFFF) / 32768.0f - 1.0f);
+        float c = 150.0f * 0.5f * (1.0f + sinf(i * 0.21f));
+        bat.onSample(ADDR_VOLT, rawV(72.0f - 0.08f * c + n), i * 100);
+        bat.onSample(ADDR_CURRENT, rawI(c), i * 100 + 20);
+    }
+    BatteryEstimator::Fit b = bat.fit();
+    TEST_ASSERT_TRUE(a.valid && b.valid);
+    TEST_ASSERT_FLOAT_WITHIN(1e-7f, b.ohms, a.ohms);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, b.ocv, a.ocv);
+}
+
+void test_stale_samples_do_not_pair() {
+    for(int i=0; i<100; i++) {
+        bat.onSample(ADDR_VOLT, rawV(72), i * 1000);
+        TEST_ASSERT_FALSE(bat.onSample(ADDR_CURRENT, rawI(10), i * 1000 + 500));
+    }
+    TEST_ASSERT_EQUAL(0, bat.pairs());
+}
+
+void test_sag_events_are_debounced() {
+    uint32_t ms = drive(0, 300, 72.0f, 0.08f, 5.0f, 60.0f, 0.0f);
+    TEST_ASSERT_TRUE(bat.fit().valid);
+
+    // 100 ms dip: too short
+    bat.onSample(ADDR_VOLT, rawV(62), ms);
+    bat.onSample(ADDR_VOLT, rawV(71), ms + 100);
+    TEST_ASSERT_EQUAL_UINT32(0, bat.sags().count);
+
+    // 1 s at 60 V: one event
+    ms += 1000;
+    for(int i=0; i<=10; i++) bat.onSample(ADDR_VOLT, rawV(60), ms + i * 100);
+    TEST_ASSERT_TRUE(bat.inSag());
+    bat.onSample(ADDR_VOLT, rawV(71), ms + 1100);
+    TEST_ASSERT_FALSE(bat.inSag());
+
+    TEST_ASSERT_EQUAL_UINT32(1, bat.sags().count);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 60.0f, bat.sags().minV);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 12.0f, bat.sags().worstV);
+    TEST_ASSERT_EQUAL_UINT32(1100, bat.sags().lastMs);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_recovers_resistance_and_ocv);
+    RUN_TEST(test_regen_current_is_part_of_the_fit);
+    RUN_TEST(test_constant_current_gives_no_fit);
+    RUN_TEST(test_keeps_last_fit_while_cruising);
+    RUN_TEST(test_window_follows_a_resistance_change);
+    RUN_TEST(test_sliding_sums_match_a_fresh_window);
+    RUN_TEST(test_stale_samples_do_not_pair);
+    RUN_TEST(test_sag_events_are_debounced);
+    return UNITY_END();
+}
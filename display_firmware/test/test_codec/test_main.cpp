@@ -0,0 +1,105 @@
+#include <unity.h>
+#include "Codec.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_zigzag_maps_small_magnitudes_to_small_codes() {
+    TEST_ASSERT_EQUAL_UINT32(0, codec::zigzag(0));
+    TEST_ASSERT_EQUAL_UINT32(1, codec::zigzag(-1));
+    TEST_ASSERT_EQUAL_UINT32(2, codec::zigzag(1));
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFF, codec::zigzag(INT32_MIN));
+    TEST_ASSERT_EQUAL_INT32(INT32_MIN, codec::unzigzag(0xFFFFFFFF));
+    TEST_ASSERT_EQUAL_INT32(INT32_MAX, codec::unzigzag(codec::zigzag(INT32_MAX)));
+}
+
+void test_varint_lengths_and_truncation() {
+    uint8_t buf[8];
+    TEST_ASSERT_EQUAL(1, codec::putVarint(buf, 127));
+    TEST_ASSERT_EQUAL(2, codec::putVarint(buf, 128));
+    TEST_ASSERT_EQUAL(5, codec::putVarint(buf, 0xFFFFFFFF));
+
+    size_t pos = 0;
+    uint32_t v;
+    TEST_ASSERT_TRUE(codec::getVarint(buf, 5, pos, v));
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFF, v);
+    pos = 0;
+    TEST_ASSERT_FALSE(codec::getVarint(buf, 4, pos, v));
+}
+
+void test_regular_timestamps_cost_one_byte() {
+    DeltaOfDelta enc, dec;
+    enc.reset(1000);
+    dec.reset(1000);
+    uint8_t buf[8];
+    for(uint32_t t=1100; t<3000; t+=100) {
+        uint32_t z = enc.encode(t);
+        if(t > 1100) {
+            TEST_ASSERT_EQUAL_UINT32(0, z);
+            TEST_ASSERT_EQUAL(1, codec::putVarint(buf, z));
+        }
+        TEST_ASSERT_EQUAL_UINT32(t, dec.decode(z));
+    }
+}
+
+void test_timestamps_survive_millis_wrap() {
+    DeltaOfDelta enc, dec;
+    uint32_t t = 0xFFFFFF00;
+    enc.reset(t);
+    dec.reset(t);
+    for(int i=0; i<10; i++) {
+        t += 50 + (i & 1);
+        TEST_ASSERT_EQUAL_UINT32(t, dec.decode(enc.encode(t)));
+    }
+}
+
+void test_delta_value_round_trip() {
+    const int32_t in[] = {0, 5, 4, 4, -3200, INT32_MAX, INT32_MIN, 17};
+    DeltaValue enc, dec;
+    for(int32_t v : in) TEST_ASSERT_EQUAL_INT32(v, dec.decode(enc.encode(v)));
+}
+
+void test_xor_round_trip_and_density() {
+    const uint32_t in[] = {812, 812, 812, 813, 812, 811, 811, 0x80000000, 0, 0xFFFFFFFF, 811};
+    const int n = sizeof(in) / sizeof(in[0]);
+    uint8_t buf[64] = {};
+
+    BitWriter w(buf, sizeof(buf));
+    XorValue enc;
+    for(int i=0; i<n; i++) TEST_ASSERT_TRUE(enc.encode(w, in[i]));
+
+    BitReader r(buf, w.bytes());
+    XorValue dec;
+    for(int i=0; i<n; i++) {
+        uint32_t v;
+        TEST_ASSERT_TRUE(dec.decode(r, v));
+        TEST_ASSERT_EQUAL_UINT32(in[i], v);
+    }
+
+    // Repeats are one bit each
+    BitWriter w2(buf, sizeof(buf));
+    XorValue rep;
+    rep.encode(w2, 500);
+    size_t first = w2.bitCount();
+    for(int i=0; i<100; i++) rep.encode(w2, 500);
+    TEST_ASSERT_EQUAL(first + 100, w2.bitCount());
+}
+
+void test_bit_writer_reports_full_buffer() {
+    uint8_t buf[2];
+    BitWriter w(buf, sizeof(buf));
+    TEST_ASSERT_TRUE(w.write(0xABC, 12));
+    TEST_ASSERT_FALSE(w.write(0x3F, 6));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_zigzag_maps_small_magnitudes_to_small_codes);
+    RUN_TEST(test_varint_lengths_and_truncation);
+    RUN_TEST(test_regular_timestamps_cost_one_byte);
+    RUN_TEST(test_timestamps_survive_millis_wrap);
+    RUN_TEST(test_delta_value_round_trip);
+    RUN_TEST(test_xor_round_trip_and_density);
+    RUN_TEST(test_bit_writer_reports_full_buffer);
+    return UNITY_END();
+}
@@ -0,0 +1,118 @@
+#include <unity.h>
+#define TRACE_EVENTS 1
+#include "ControllerSession.h"
+#include "EventTrace.h"
+
+EventTrace eventTrace;  // What main.cpp defines in a TRACE_EVENTS build
+
+static const uint8_t SPEED_PACKET[] = {24, 0, 0xC5, 0x01};   // Speed field, raw 453
+
+void setUp() { eventTrace.restart(); }
+void tearDown() {}
+
+void test_events_in_order() {
+    EventTrace t;
+    t.record(0, 100, TR_RENDER, TRACE_BEGIN_PHASE, 3);
+    t.record(1, 150, TR_NOTIFY, TRACE_INSTANT_PHASE, 20);
+    t.record(0, 200, TR_RENDER, TRACE_END_PHASE, 0);
+    TEST_ASSERT_EQUAL(2, t.count(0));
+    TEST_ASSERT_EQUAL(1, t.count(1));
+    TEST_ASSERT_EQUAL(100, t.at(0, 0).cycles);
+    TEST_ASSERT_EQUAL(TR_RENDER, t.at(0, 0).name());
+    TEST_ASSERT_EQUAL(TRACE_BEGIN_PHASE, t.at(0, 0).phase());
+    TEST_ASSERT_EQUAL(3, t.at(0, 0).arg);
+    TEST_ASSERT_EQUAL(TRACE_END_PHASE, t.at(0, 1).phase());
+    TEST_ASSERT_EQUAL(TR_NOTIFY, t.at(1, 0).name());
+}
+
+// A full ring keeps the latest EVENT_RING_SIZE events, oldest first
+void test_ring_wraps() {
+    EventTrace t;
+    for(uint32_t i=0; i<EVENT_RING_SIZE + 10; i++) t.record(0, i, TR_SPI, TRACE_INSTANT_PHASE, 0);
+    TEST_ASSERT_EQUAL(EVENT_RING_SIZE, t.count(0));
+    TEST_ASSERT_EQUAL(EVENT_RING_SIZE + 10, t.total(0));
+    TEST_ASSERT_EQUAL(10, t.at(0, 0).cycles);
+    TEST_ASSERT_EQUAL(EVENT_RING_SIZE + 9, t.at(0, EVENT_RING_SIZE - 1).cycles);
+}
+
+void test_freeze_and_restart() {
+    EventTrace t;
+    t.record(0, 1, TR_WAIT, TRACE_BEGIN_PHASE, 0);
+    t.freeze();
+    t.record(0, 2, TR_WAIT, TRACE_END_PHASE, 0);
+    TEST_ASSERT_EQUAL(1, t.count(0));
+    TEST_ASSERT_FALSE(t.isEnabled());
+    t.restart();
+    TEST_ASSERT_EQUAL(0, t.count(0));
+    t.record(0, 3, TR_WAIT, TRACE_BEGIN_PHASE, 0);
+    TEST_ASSERT_EQUAL(1, t.count(0));
+}
+
+// Every line the dump prints parses back to what went in, also after
+// other console output on the same line
+void test_dump_lines_round_trip() {
+    char line[64];
+    tracedump::header(line, sizeof(line), 240);
+    tracedump::Line l = tracedump::parse(line);
+    TEST_ASSERT_EQUAL('H', l.kind);
+    TEST_ASSERT_EQUAL(EVENT_DUMP_VERSION, l.a);
+    TEST_ASSERT_EQUAL(240, (int)l.b);
+
+    tracedump::sync(line, sizeof(line), 1, 0xFFFFFFF0, 123456789012ULL);
+    l = tracedump::parse(line);
+    TEST_ASSERT_EQUAL('S', l.kind);
+    TEST_ASSERT_EQUAL(1, l.core);
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFF0, l.a);
+    TEST_ASSERT_TRUE(l.b == 123456789012ULL);
+
+    TraceEvent e = {0xDEADBEEF, TR_WIDGET << 2 | TRACE_END_PHASE, 0xABCD};
+    char noisy[96] = "Power: 1 -> 0";
+    tracedump::event(noisy + strlen(noisy), sizeof(noisy) - strlen(noisy), 0, e);
+    l = tracedump::parse(noisy);
+    TEST_ASSERT_EQUAL('E', l.kind);
+    TEST_ASSERT_EQUAL_HEX32(e.cycles, l.event.cycles);
+    TEST_ASSERT_EQUAL(TR_WIDGET, l.event.name());
+    TEST_ASSERT_EQUAL(TRACE_END_PHASE, l.event.phase());
+    TEST_ASSERT_EQUAL_HEX16(0xABCD, l.event.arg);
+
+    tracedump::end(line, sizeof(line), 0, EVENT_RING_SIZE, 5000);
+    l = tracedump::parse(line);
+    TEST_ASSERT_EQUAL('Z', l.kind);
+    TEST_ASSERT_EQUAL(EVENT_RING_SIZE, l.a);
+    TEST_ASSERT_EQUAL(5000, (int)l.b);
+
+    TEST_ASSERT_EQUAL(0, tracedump::parse("Input latency 120 us").kind);
+    TEST_ASSERT_EQUAL(0, tracedump::parse("TR E 7 0 0 0").kind);  // No such core
+}
+
+// The macros in the link and session record a packet's notify and parse
+void test_session_traces_packets() {
+    struct Link : Transport {
+        bool connected() const override { return true; }
+        bool send(const uint8_t*, size_t) override { return true; }
+        void push(const uint8_t* d, size_t n) { deliver(d, n); }
+    } link;
+    ControllerSession session;
+    session.attach(&link);
+    link.push(SPEED_PACKET, sizeof(SPEED_PACKET));
+
+    TEST_ASSERT_EQUAL(4, eventTrace.count(0));
+    TEST_ASSERT_EQUAL(TR_NOTIFY, eventTrace.at(0, 0).name());
+    TEST_ASSERT_EQUAL(sizeof(SPEED_PACKET), eventTrace.at(0, 0).arg);
+    TEST_ASSERT_EQUAL(TR_PARSE, eventTrace.at(0, 1).name());
+    TEST_ASSERT_EQUAL(TR_PARSE, eventTrace.at(0, 2).name());
+    TEST_ASSERT_EQUAL(TRACE_END_PHASE, eventTrace.at(0, 2).phase());
+    TEST_ASSERT_NOT_EQUAL(0, eventTrace.at(0, 2).arg);   // A sample: slot + 1
+    TEST_ASSERT_EQUAL(TR_NOTIFY, eventTrace.at(0, 3).name());
+    TEST_ASSERT_TRUE(eventTrace.at(0, 3).cycles - eventTrace.at(0, 0).cycles < 0x80000000u);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_events_in_order);
+    RUN_TEST(test_ring_wraps);
+    RUN_TEST(test_freeze_and_restart);
+    RUN_TEST(test_dump_lines_round_trip);
+    RUN_TEST(test_session_traces_packets);
+    return UNITY_END();
+}
@@ -0,0 +1,133 @@
+#include <unity.h>
+#define LATENCY_PROBE 1
+#include "Display.h"
+
+static DisplayManager display;
+static VehicleState state;
+
+void setUp() {}
+void tearDown() {}
+
+void test_bins_cover_their_values() {
+    for(uint32_t us : {0u, 7u, 8u, 9u, 100u, 1023u, 1024u, 20000u, 1000000u}) {
+        int b = LatencyHistogram::binOf(us);
+        TEST_ASSERT_TRUE(LatencyHistogram::lowerUs(b) <= us);
+        TEST_ASSERT_TRUE(us < LatencyHistogram::lowerUs(b + 1));
+    }
+    // Quarter octaves: no bin from 8 us on is wider than a quarter of its start
+    for(int b=8; b<LATENCY_BINS - 1; b++) {
+        uint32_t lo = LatencyHistogram::lowerUs(b);
+        TEST_ASSERT_TRUE(LatencyHistogram::lowerUs(b + 1) - lo <= lo / 4);
+    }
+    TEST_ASSERT_EQUAL(LATENCY_BINS - 1, LatencyHistogram::binOf(UINT32_MAX));
+}
+
+void test_percentiles() {
+    LatencyHistogram h;
+    TEST_ASSERT_EQUAL(0, h.percentile(0.5f));
+    for(int i=0; i<98; i++) h.add(10000);
+    h.add(40000);
+    h.add(90000);
+    uint32_t p50 = h.percentile(0.5f);
+    TEST_ASSERT_TRUE(p50 >= 10000 && p50 < 12500);
+    uint32_t p99 = h.percentile(0.99f);
+    TEST_ASSERT_TRUE(p99 >= 40000 && p99 < 50000);
+    TEST_ASSERT_EQUAL(90000, h.percentile(1.0f));
+    TEST_ASSERT_EQUAL(90000, h.maxUs);
+    TEST_ASSERT_EQUAL(100, h.count);
+}
+
+// A pass measures the tags of dirty slots that get drawn and drops the rest
+void test_probe_passes() {
+    LatencyProbe p;
+    int edges = 0, level = 0;
+    static int* pEdges;
+    static int* pLevel;
+    pEdges = &edges;
+    pLevel = &level;
+    p.probeSlot = 0;
+    p.edge = [](bool high) {
+        (*pEdges)++;
+        *pLevel = high;
+    };
+
+    p.tag(0, 1000);
+    p.tag(0, 1500);     // Superseded: its value is the one drawn
+    p.tag(1, 2000);
+    p.tag(NUM_FIELDS, 2000);
+    TEST_ASSERT_EQUAL(1, level);
+
+    p.beginPass(1 << 0 | 1 << 1);
+    p.onShown(0, 4500);
+    p.onShown(0, 4600); // Second widget of the same field
+    p.endPass();        // Slot 1 not drawn
+    TEST_ASSERT_EQUAL(1, p.fields[0].count);
+    TEST_ASSERT_EQUAL(3000, p.fields[0].maxUs);
+    TEST_ASSERT_EQUAL(0, p.fields[1].count);
+    TEST_ASSERT_EQUAL(1, p.dropped);
+    TEST_ASSERT_EQUAL(0, level);
+    TEST_ASSERT_EQUAL(3, edges);
+
+    // A tag not dirty in this pass waits for its own
+    p.tag(2, 5000);
+    p.beginPass(0);
+    p.onShown(2, 6000);
+    p.endPass();
+    p.beginPass(1 << 2);
+    p.onShown(2, 7000);
+    p.endPass();
+    TEST_ASSERT_EQUAL(2000, p.fields[2].maxUs);
+}
+
+// Samples tagged on arrival are measured when render() draws their widgets
+void test_render_measures_drawn_widgets() {
+    static LatencyProbe probe;
+    display.attachLatency(&probe);
+    display.showPage(0, state);
+
+    int speed = fieldIndex(ADDR_SPEED);
+    probe.tag(speed, micros());
+    state.update(ADDR_SPEED, 42.0f);
+    display.render(state, state.takeDirty());
+    TEST_ASSERT_EQUAL(1, probe.fields[speed].count);
+
+    // Same value: nothing drawn, dropped
+    probe.tag(speed, micros());
+    state.update(ADDR_SPEED, 42.0f);
+    display.render(state, state.takeDirty() | 1UL << speed);
+    TEST_ASSERT_EQUAL(1, probe.fields[speed].count);
+    TEST_ASSERT_EQUAL(1, probe.dropped);
+
+    // The latency page shows the table; a refresh with new figures repaints rows
+    int page = NUM_PAGES - 1;
+    TEST_ASSERT_NOT_NULL(PAGES[page].latency);
+    display.showPage(page, state);
+    uint64_t before = display.tft.checksum();
+    probe.fields[speed].add(12000);
+    hostAdvanceMs(LATENCY_REFRESH_MS);
+    display.refreshLatency();
+    TEST_ASSERT_TRUE(display.tft.checksum() != before);
+    display.attachLatency(nullptr);
+}
+
+void test_format_ms() {
+    char s[12];
+    LatencyView::formatMs(s, sizeof(s), 12345, true);
+    TEST_ASSERT_EQUAL_STRING("12.3", s);
+    LatencyView::formatMs(s, sizeof(s), 80, true);
+    TEST_ASSERT_EQUAL_STRING("0.0", s);
+    LatencyView::formatMs(s, sizeof(s), 0, false);
+    TEST_ASSERT_EQUAL_STRING("-", s);
+}
+
+int main(int argc, char** argv) {
+    hostQuiet() = true;
+    display.init();
+    UNITY_BEGIN();
+    RUN_TEST(test_bins_cover_their_values);
+    RUN_TEST(test_percentiles);
+    RUN_TEST(test_probe_passes);
+    RUN_TEST(test_render_measures_drawn_widgets);
+    RUN_TEST(test_format_ms);
+    return UNITY_END();
+}
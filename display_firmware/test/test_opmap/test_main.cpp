@@ -0,0 +1,91 @@
+#include <unity.h>
+#include "OperatingMap.h"
+
+static OperatingMap opmap;
+
+void setUp() { opmap.reset(); }
+void tearDown() {}
+
+static uint32_t cell(float rpm, float kw) {
+    return opmap.get().cells[OperatingMap::powerBin(kw)][OperatingMap::rpmBin(rpm)];
+}
+
+void test_time_goes_to_the_current_cell() {
+    // 60 s at 3000 rpm / 2.5 kW, RPM and Power every 100 ms
+    for(uint32_t ms=0; ms<=60000; ms+=100) {
+        opmap.onSample(ADDR_RPM, 3000, ms);
+        opmap.onSample(ADDR_POWER, 2.5f, ms + 30);
+    }
+    TEST_ASSERT_UINT32_WITHIN(1, 600, cell(3000, 2.5f));
+    TEST_ASSERT_EQUAL_UINT32(opmap.get().total, cell(3000, 2.5f));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.0f, OperatingMap::ticksToMinutes(opmap.get().total));
+}
+
+void test_sub_tick_intervals_are_not_lost() {
+    // Samples every 7 ms: each interval is below one tick
+    for(uint32_t ms=0; ms<=7000; ms+=7) {
+        opmap.onSample(ADDR_RPM, 1200, ms);
+        opmap.onSample(ADDR_POWER, 0.5f, ms);
+    }
+    TEST_ASSERT_UINT32_WITHIN(1, 70, opmap.get().total);
+}
+
+void test_out_of_range_values_clamp_to_edge_cells() {
+    TEST_ASSERT_EQUAL(0, OperatingMap::rpmBin(-50));
+    TEST_ASSERT_EQUAL(OPMAP_RPM_BINS - 1, OperatingMap::rpmBin(20000));
+    TEST_ASSERT_EQUAL(0, OperatingMap::powerBin(-30.0f));
+    TEST_ASSERT_EQUAL(OPMAP_PWR_BINS - 1, OperatingMap::powerBin(99.0f));
+    TEST_ASSERT_EQUAL(4, OperatingMap::powerBin(0.0f));
+    TEST_ASSERT_EQUAL(3, OperatingMap::powerBin(-0.5f)); // Regen
+}
+
+void test_gaps_and_missing_fields_are_not_counted() {
+    for(uint32_t ms=0; ms<=5000; ms+=100) opmap.onSample(ADDR_RPM, 2000, ms);
+    TEST_ASSERT_EQUAL_UINT32(0, opmap.get().total); // No power yet
+
+    opmap.onSample(ADDR_POWER, 1.0f, 5000);
+    opmap.onSample(ADDR_RPM, 2000, 65000); // Link lost for a minute
+    TEST_ASSERT_EQUAL_UINT32(0, opmap.get().total);
+    opmap.onSample(ADDR_RPM, 2000, 66000);
+    TEST_ASSERT_EQUAL_UINT32(10, opmap.get().total);
+}
+
+void test_time_above_temperature_thresholds() {
+    // 10 s at 70 C, 10 s at 90 C, 10 s at 50 C
+    uint32_t ms = 0;
+    float temps[] = {70, 90, 50};
+    for(float t : temps) {
+        for(int i=0; i<100; i++, ms += 100) opmap.onSample(ADDR_TEMP, t, ms);
+    }
+    const OperatingTotals& tot = opmap.get();
+    TEST_ASSERT_UINT32_WITHIN(1, 200, tot.tempAbove[0]);
+    TEST_ASSERT_UINT32_WITHIN(1, 100, tot.tempAbove[1]);
+    TEST_ASSERT_EQUAL_UINT32(0, tot.tempAbove[2]);
+}
+
+void test_restore_continues_and_rejects_other_versions() {
+    for(uint32_t ms=0; ms<=1000; ms+=100) {
+        opmap.onSample(ADDR_RPM, 4000, ms);
+        opmap.onSample(ADDR_POWER, 6.0f, ms);
+    }
+    OperatingTotals saved = opmap.get();
+
+    OperatingMap other;
+    TEST_ASSERT_TRUE(other.restore(saved));
+    TEST_ASSERT_EQUAL_UINT32(saved.total, other.get().total);
+
+    saved.version++;
+    TEST_ASSERT_FALSE(other.restore(saved));
+    TEST_ASSERT_EQUAL_UINT32(0, other.get().total);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_time_goes_to_the_current_cell);
+    RUN_TEST(test_sub_tick_intervals_are_not_lost);
+    RUN_TEST(test_out_of_range_values_clamp_to_edge_cells);
+    RUN_TEST(test_gaps_and_missing_fields_are_not_counted);
+    RUN_TEST(test_time_above_temperature_thresholds);
+    RUN_TEST(test_restore_continues_and_rejects_other_versions);
+    return UNITY_END();
+}
@@ -0,0 +1,178 @@
+#include <unity.h>
+#include <vector>
+#include "ParamEngine.h"
+
+// Controller stand-in: byte-addressed memory answering read and write
+// commands one tick after they are sent
+struct FakeController {
+    uint8_t mem[8192];
+    bool multi = true;        // Answer multi-byte reads in one packet
+    int dropEvery = 0;        // Lose every Nth read (0 = none)
+    int stuckAt = -1;         // Address that ignores writes
+    int readCount = 0;
+    std::vector<std::vector<uint8_t>> outbox;
+
+    void onCommand(const uint8_t* cmd, size_t len) {
+        uint16_t address = ((cmd[1] & 0x1F) << 8) | cmd[0];
+        if(cmd[1] & 0x80) {
+            readCount++;
+            if(dropEvery && readCount % dropEvery == 0) return;
+            int n = multi ? cmd[2] : (cmd[2] < 2 ? cmd[2] : 2);
+            std::vector<uint8_t> pkt = {cmd[0], (uint8_t)(cmd[1] | 0x20 | (multi && n > 2 ? 0x40 : 0))};
+            for(int i=0; i<n; i++) pkt.push_back(mem[address + i]);
+            outbox.push_back(pkt);
+        } else {
+            for(size_t i=2; i<len; i++) {
+                if((int)(address + i - 2) != stuckAt) mem[address + i - 2] = cmd[i];
+            }
+            outbox.push_back({cmd[0], (uint8_t)(cmd[1] | 0x20)}); // Ack
+        }
+    }
+};
+
+static FakeController* ctl;
+static ParamEngine* engine;
+static const ParamRange RANGES[] = {{0x100, 0x100}, {0x300, 0x21}};
+
+void setUp() {
+    ctl = new FakeController();
+    for(int i=0; i<8192; i++) ctl->mem[i] = (uint8_t)(i * 7 + 3);
+    engine = new ParamEngine();
+    engine->send = [](const uint8_t* cmd, size_t len) { ctl->onCommand(cmd, len); };
+}
+void tearDown() {
+    delete engine;
+    delete ctl;
+}
+
+// Run until the job ends; returns the time it took
+static uint32_t run(uint32_t limitMs = 60000) {
+    uint32_t ms = 0;
+    while(engine->busy() && ms < limitMs) {
+        ms += 5;
+        std::vector<std::vector<uint8_t>> in;
+        in.swap(ctl->outbox);
+        for(auto& p : in) engine->onPacket(p.data(), p.size());
+        engine->service(ms);
+    }
+    return ms;
+}
+
+static bool imageMatches(const ParamImage& img) {
+    for(int o=0; o<img.size; o++) {
+        if(img.bytes[o] != ctl->mem[img.addressAt(o)]) return false;
+    }
+    return true;
+}
+
+void test_backup_with_multi_reads() {
+    TEST_ASSERT_TRUE(engine->startBackup(RANGES, 2));
+    run();
+    TEST_ASSERT_EQUAL(ParamEngine::DONE, engine->phase());
+    TEST_ASSERT_EQUAL(0x121, engine->image().size);
+    TEST_ASSERT_TRUE(imageMatches(engine->image()));
+    // 256 / 16 + 33 -> 16 + 3 reads, each a single multi answer
+    TEST_ASSERT_EQUAL_UINT32(19, engine->reads);
+    TEST_ASSERT_EQUAL_UINT32(0, engine->timeouts);
+}
+
+void test_reads_are_pipelined() {
+    // WINDOW reads in flight per tick: 19 reads take about 5 round trips
+    engine->startBackup(RANGES, 2);
+    uint32_t ms = run();
+    TEST_ASSERT_TRUE(ms <= 5 * 6);
+}
+
+void test_backup_with_single_register_answers() {
+    ctl->multi = false;
+    engine->startBackup(RANGES, 2);
+    run();
+    TEST_ASSERT_EQUAL(ParamEngine::DONE, engine->phase());
+    TEST_ASSERT_TRUE(imageMatches(engine->image()));
+    TEST_ASSERT_EQUAL_UINT32(0, engine->multiResponses);
+    TEST_ASSERT_EQUAL_UINT32(0, engine->timeouts);
+}
+
+void test_lost_reads_are_retried() {
+    ctl->dropEvery = 3;
+    engine->startBackup(RANGES, 2);
+    run();
+    TEST_ASSERT_EQUAL(ParamEngine::DONE, engine->phase());
+    TEST_ASSERT_TRUE(imageMatches(engine->image()));
+    TEST_ASSERT_TRUE(engine->timeouts > 0);
+}
+
+void test_silent_controller_fails() {
+    ctl->dropEvery = 1;
+    engine->startBackup(RANGES, 2);
+    run();
+    TEST_ASSERT_EQUAL(ParamEngine::FAILED, engine->phase());
+}
+
+void test_restore_writes_only_changed_bytes_and_verifies() {
+    engine->startBackup(RANGES, 2);
+    run();
+    static ParamImage reference;
+    reference = engine->image();
+
+    // Controller drifts: two separate changes, one pair close enough to merge
+    ctl->mem[0x110] ^= 0xFF;
+    ctl->mem[0x112] ^= 0xFF;
+    ctl->mem[0x310] ^= 0x01;
+
+    TEST_ASSERT_TRUE(engine->startRestore(reference));
+    run();
+    TEST_ASSERT_EQUAL(ParamEngine::DONE, engine->phase());
+    TEST_ASSERT_EQUAL_UINT32(3, engine->changedBytes);
+    TEST_ASSERT_EQUAL_UINT32(2, engine->writes);
+    TEST_ASSERT_EQUAL_UINT32(0, engine->mismatches);
+    TEST_ASSERT_TRUE(imageMatches(reference));
+}
+
+void test_restore_reports_bytes_that_do_not_stick() {
+    engine->startBackup(RANGES, 2);
+    run();
+    static ParamImage reference;
+    reference = engine->image();
+    ctl->mem[0x120] ^= 0xFF;
+    ctl->stuckAt = 0x120;
+
+    engine->startRestore(reference);
+    run();
+    TEST_ASSERT_EQUAL(ParamEngine::FAILED, engine->phase());
+    TEST_ASSERT_EQUAL_UINT32(1, engine->mismatches);
+    TEST_ASSERT_EQUAL_UINT32(ParamEngine::MAX_PASSES, engine->writes);
+}
+
+void test_image_file_round_trip() {
+    engine->startBackup(RANGES, 2);
+    run();
+    static ParamImage img, back;
+    img = engine->image();
+    memcpy(img.mac, "\x01\x02\x03\x04\x05\x06", 6);
+
+    static uint8_t file[PARAM_FILE_MAX];
+    size_t n = paramEncode(img, file);
+    TEST_ASSERT_EQUAL(PARAM_HEADER_SIZE + 2 * 4 + 0x121, n);
+    TEST_ASSERT_TRUE(paramDecode(file, n, back));
+    TEST_ASSERT_TRUE(back.sameLayout(img));
+    TEST_ASSERT_EQUAL_MEMORY(img.bytes, back.bytes, img.size);
+    TEST_ASSERT_EQUAL_MEMORY(img.mac, back.mac, 6);
+
+    file[PARAM_HEADER_SIZE + 20] ^= 1;
+    TEST_ASSERT_FALSE(paramDecode(file, n, back));
+    TEST_ASSERT_FALSE(paramDecode(file, n - 1, back));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_backup_with_multi_reads);
+    RUN_TEST(test_reads_are_pipelined);
+    RUN_TEST(test_backup_with_single_register_answers);
+    RUN_TEST(test_lost_reads_are_retried);
+    RUN_TEST(test_silent_controller_fails);
+    RUN_TEST(test_restore_writes_only_changed_bytes_and_verifies);
+    RUN_TEST(test_restore_reports_bytes_that_do_not_stick);
+    RUN_TEST(test_image_file_round_trip);
+    return UNITY_END();
+}
@@ -0,0 +1,136 @@
+#include <unity.h>
+#include <string.h>
+#include "RegisterPoller.h"
+
+static RegisterPoller* p;
+static uint8_t sent[16][3];
+static int numSent;
+
+void setUp() {
+    p = new RegisterPoller();
+    numSent = 0;
+    p->send = [](const uint8_t* cmd, size_t len) {
+        if(numSent < 16) memcpy(sent[numSent], cmd, 3);
+        numSent++;
+    };
+}
+void tearDown() { delete p; }
+
+static int indexOf(uint16_t address) {
+    for(int i=0; i<NUM_POLLED; i++) if(POLLED_REGISTERS[i].address == address) return i;
+    return -1;
+}
+
+// Answer the last read with `value` as its little-endian payload
+static bool answer(uint32_t value, RegisterPoller::Result& r) {
+    uint8_t pkt[6] = {sent[numSent - 1][0], (uint8_t)(sent[numSent - 1][1] | 0x20),
+                      (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+    return p->onResponse(pkt, 2 + sent[numSent - 1][2], r);
+}
+
+void test_read_command_format() {
+    p->start(0);
+    for(uint32_t t=0; t<=1000 && numSent == 0; t += 10) p->service(t);
+    TEST_ASSERT_EQUAL(1, numSent);
+    TEST_ASSERT_EQUAL_HEX8(ADDR_ERROR & 0xFF, sent[0][0]);
+    TEST_ASSERT_EQUAL_HEX8(0x80 | (ADDR_ERROR >> 8), sent[0][1]);
+    TEST_ASSERT_EQUAL_UINT8(4, sent[0][2]);
+}
+
+void test_one_read_outstanding() {
+    p->start(0);
+    for(uint32_t t=0; t<RegisterPoller::TIMEOUT_MS; t += 10) p->service(t);
+    TEST_ASSERT_EQUAL(1, numSent); // Others are due but wait for the answer
+
+    RegisterPoller::Result r;
+    TEST_ASSERT_TRUE(answer(0, r));
+    p->service(RegisterPoller::TIMEOUT_MS);
+    TEST_ASSERT_EQUAL(2, numSent);
+    TEST_ASSERT_EQUAL_UINT32(0, p->timeouts);
+}
+
+void test_lost_read_times_out_and_polling_continues() {
+    p->start(0);
+    uint32_t t = 0;
+    while(numSent == 0) p->service(t += 10);
+    uint32_t first = t;
+    for(; t < first + RegisterPoller::TIMEOUT_MS - 10; t += 10) p->service(t);
+    TEST_ASSERT_EQUAL(1, numSent);
+    p->service(first + RegisterPoller::TIMEOUT_MS);
+    TEST_ASSERT_EQUAL_UINT32(1, p->timeouts);
+    TEST_ASSERT_EQUAL(2, numSent);
+}
+
+void test_each_register_keeps_its_period() {
+    // Answer every read at once for 20 s and count reads per register
+    int count[NUM_POLLED] = {};
+    p->start(0);
+    for(uint32_t t=0; t<20000; t += 10) {
+        if(p->service(t)) {
+            count[indexOf(sent[0][0] | ((sent[0][1] & 0x1F) << 8))]++;
+            RegisterPoller::Result r;
+            numSent = 1;
+            answer(0, r);
+            numSent = 0;
+        }
+    }
+    for(int i=0; i<NUM_POLLED; i++) {
+        int expected = 20000 / POLLED_REGISTERS[i].periodMs;
+        TEST_ASSERT_INT_WITHIN(1, expected, count[i]);
+    }
+}
+
+void test_response_decoding() {
+    RegisterPoller::Result r;
+
+    // i8 motor temperature, B = 40
+    uint8_t temp[] = {ADDR_MOTOR_TEMP & 0xFF, 0xA0 | (ADDR_MOTOR_TEMP >> 8), 0xF6}; // -10
+    TEST_ASSERT_TRUE(p->onResponse(temp, sizeof(temp), r));
+    TEST_ASSERT_EQUAL_INT32(-10, r.raw);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, -50.0f, r.value);
+
+    // i16 phase current, K = 33.03
+    uint8_t phase[] = {ADDR_PHASE_CURRENT & 0xFF, 0xA0 | (ADDR_PHASE_CURRENT >> 8), 0x18, 0xFC}; // -1000
+    TEST_ASSERT_TRUE(p->onResponse(phase, sizeof(phase), r));
+    TEST_ASSERT_EQUAL_INT32(-1000, r.raw);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, -30.28f, r.value);
+
+    // u32 error code with the top bit set stays unsigned in the bit pattern
+    uint8_t err[] = {ADDR_ERROR & 0xFF, 0xA0 | (ADDR_ERROR >> 8), 0x08, 0x00, 0x00, 0x80};
+    TEST_ASSERT_TRUE(p->onResponse(err, sizeof(err), r));
+    TEST_ASSERT_EQUAL_HEX32(0x80000008, (uint32_t)r.raw);
+}
+
+void test_foreign_and_short_packets_are_ignored() {
+    RegisterPoller::Result r;
+    uint8_t ack[] = {ADDR_CONTROL, 0x20, 0x01};
+    TEST_ASSERT_FALSE(p->onResponse(ack, sizeof(ack), r));
+    uint8_t shortErr[] = {ADDR_ERROR & 0xFF, 0xA0, 0x01, 0x00};
+    TEST_ASSERT_FALSE(p->onResponse(shortErr, sizeof(shortErr), r));
+    TEST_ASSERT_EQUAL_UINT32(0, p->responses.load());
+}
+
+void test_fault_formatting() {
+    char text[28];
+    TEST_ASSERT_EQUAL(0, RegisterPoller::formatFaults(0, text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("", text);
+
+    TEST_ASSERT_EQUAL(3, RegisterPoller::formatFaults((1UL << 3) | (1UL << 7) | (1UL << 12), text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("E3 E7 E12", text);
+
+    // Everything set: as many as fit, then the rest counted
+    TEST_ASSERT_EQUAL(32, RegisterPoller::formatFaults(0xFFFFFFFF, text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("E0 E1 E2 E3 E4 E5 E6 E7 +24", text);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_read_command_format);
+    RUN_TEST(test_one_read_outstanding);
+    RUN_TEST(test_lost_read_times_out_and_polling_continues);
+    RUN_TEST(test_each_register_keeps_its_period);
+    RUN_TEST(test_response_decoding);
+    RUN_TEST(test_foreign_and_short_packets_are_ignored);
+    RUN_TEST(test_fault_formatting);
+    return UNITY_END();
+}
@@ -0,0 +1,50 @@
+#include <unity.h>
+#include "ParkSchedule.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Woken by the deep sleep timer: one full scan burst before sleeping again
+void test_timer_wake_scans_before_deep_sleep() {
+    ParkSchedule park;
+    uint32_t now = 5000;
+    park.enter(now, true);
+    TEST_ASSERT_EQUAL(PARK_SCAN, park.step(now, false));
+    TEST_ASSERT_EQUAL(PARK_WAIT, park.step(now + 10, true));
+    TEST_ASSERT_EQUAL(PARK_WAIT, park.step(now + PARK_SCAN_S * 1000 - 1, false));
+    TEST_ASSERT_EQUAL(PARK_WAIT, park.step(now + PARK_SCAN_S * 1000, true)); // Scan still stopping
+    TEST_ASSERT_EQUAL(PARK_DEEP_SLEEP, park.step(now + PARK_SCAN_S * 1000 + 5, false));
+}
+
+// Parked from use: light sleep between bursts until DEEP_AFTER_MS, then the
+// next burst still runs before the deep sleep
+void test_parked_cycles_then_deep_sleeps() {
+    ParkSchedule park;
+    uint32_t now = 0xFFFF0000;  // Across the millis() wrap
+    park.enter(now, false);
+    TEST_ASSERT_EQUAL(PARK_SCAN, park.step(now, false));
+    TEST_ASSERT_EQUAL(PARK_LIGHT_SLEEP, park.step(now + PARK_SCAN_S * 1000, false));
+
+    now += DEEP_AFTER_MS;
+    TEST_ASSERT_EQUAL(PARK_SCAN, park.step(now, false));
+    TEST_ASSERT_EQUAL(PARK_WAIT, park.step(now + 100, true));
+    TEST_ASSERT_EQUAL(PARK_DEEP_SLEEP, park.step(now + PARK_SCAN_S * 1000, false));
+}
+
+// Re-entering PARKED restarts the burst and the deep sleep timeout
+void test_enter_restarts_schedule() {
+    ParkSchedule park;
+    park.enter(0, true);
+    TEST_ASSERT_EQUAL(PARK_SCAN, park.step(0, false));
+    park.enter(100, false);
+    TEST_ASSERT_EQUAL(PARK_SCAN, park.step(100, false));
+    TEST_ASSERT_EQUAL(PARK_LIGHT_SLEEP, park.step(100 + PARK_SCAN_S * 1000, false));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_timer_wake_scans_before_deep_sleep);
+    RUN_TEST(test_parked_cycles_then_deep_sleeps);
+    RUN_TEST(test_enter_restarts_schedule);
+    return UNITY_END();
+}
@@ -0,0 +1,116 @@
+#include <unity.h>
+#include "RelayFrame.h"
+
+static float values[32];
+static float decoded[32];
+static uint32_t seen;
+
+void setUp() {
+    for(int i=0; i<32; i++) {
+        values[i] = 0;
+        decoded[i] = -999;
+    }
+    seen = 0;
+}
+void tearDown() {}
+
+static float valueOf(int slot) { return values[slot]; }
+
+static void collect(int slot, float v) {
+    decoded[slot] = v;
+    seen |= 1UL << slot;
+}
+
+void test_round_trip() {
+    values[0] = 45.3f;     // Speed
+    values[3] = 71.9f;     // Volt
+    values[5] = -12.4f;    // Current, regen
+    values[20] = 123456.78f;
+    uint32_t pending = (1UL << 0) | (1UL << 3) | (1UL << 5) | (1UL << 20);
+
+    uint8_t buf[64];
+    size_t n = relayEncode(pending, valueOf, 7, 0x1234, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_UINT32(0, pending);
+
+    uint8_t seq;
+    uint16_t ms;
+    TEST_ASSERT_TRUE(relayDecode(buf, n, seq, ms, collect));
+    TEST_ASSERT_EQUAL(7, seq);
+    TEST_ASSERT_EQUAL_HEX32(0x1234, ms);
+    TEST_ASSERT_EQUAL_HEX32((1UL << 0) | (1UL << 3) | (1UL << 5) | (1UL << 20), seen);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 45.3f, decoded[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 71.9f, decoded[3]);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, -12.4f, decoded[5]);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 123456.78f, decoded[20]);
+}
+
+void test_small_values_are_compact() {
+    // Typical telemetry: 3 bytes per sample
+    for(int i=0; i<5; i++) values[i] = 50.0f + i;
+    uint32_t pending = 0x1F;
+    uint8_t buf[64];
+    size_t n = relayEncode(pending, valueOf, 0, 0, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(RELAY_HEADER_SIZE + 5 * 3, n);
+}
+
+void test_full_notification_leaves_the_rest_pending() {
+    for(int i=0; i<20; i++) values[i] = 1000.0f + i;
+    uint32_t pending = (1UL << 20) - 1;
+
+    // 20-byte payload (default MTU): the rest waits for the next batch
+    uint8_t buf[20];
+    uint32_t all = 0;
+    int batches = 0;
+    while(pending) {
+        size_t n = relayEncode(pending, valueOf, batches, 0, buf, sizeof(buf));
+        TEST_ASSERT_TRUE(n > RELAY_HEADER_SIZE && n <= sizeof(buf));
+        uint8_t seq;
+        uint16_t ms;
+        seen = 0;
+        TEST_ASSERT_TRUE(relayDecode(buf, n, seq, ms, collect));
+        TEST_ASSERT_EQUAL_HEX32(0, all & seen); // Each slot once
+        all |= seen;
+        batches++;
+    }
+    TEST_ASSERT_EQUAL_HEX32((1UL << 20) - 1, all);
+    TEST_ASSERT_TRUE(batches >= 4);
+    for(int i=0; i<20; i++) TEST_ASSERT_FLOAT_WITHIN(0.005f, 1000.0f + i, decoded[i]);
+}
+
+void test_nothing_pending_sends_nothing() {
+    uint32_t pending = 0;
+    uint8_t buf[20];
+    TEST_ASSERT_EQUAL(0, relayEncode(pending, valueOf, 0, 0, buf, sizeof(buf)));
+}
+
+void test_truncated_notification_is_rejected() {
+    values[1] = 100000.0f; // Multi-byte varint
+    uint32_t pending = 2;
+    uint8_t buf[20];
+    size_t n = relayEncode(pending, valueOf, 0, 0, buf, sizeof(buf));
+    uint8_t seq;
+    uint16_t ms;
+    TEST_ASSERT_FALSE(relayDecode(buf, n - 1, seq, ms, collect));
+    TEST_ASSERT_FALSE(relayDecode(buf, 2, seq, ms, collect));
+}
+
+void test_schema_lists_every_slot() {
+    uint8_t buf[RELAY_SCHEMA_SIZE];
+    TEST_ASSERT_EQUAL(RELAY_SCHEMA_SIZE, relaySchema(buf));
+    TEST_ASSERT_EQUAL(NUM_SLOTS, buf[1]);
+    for(int s=0; s<NUM_SLOTS; s++) {
+        uint16_t a = buf[2 + 2 * s] | (buf[3 + 2 * s] << 8);
+        TEST_ASSERT_EQUAL(s, fieldIndex(a));
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_small_values_are_compact);
+    RUN_TEST(test_full_notification_leaves_the_rest_pending);
+    RUN_TEST(test_nothing_pending_sends_nothing);
+    RUN_TEST(test_truncated_notification_is_rejected);
+    RUN_TEST(test_schema_lists_every_slot);
+    return UNITY_END();
+}
@@ -0,0 +1,224 @@
+#include <unity.h>
+#define LATENCY_PROBE 1   // Latency page included
+#include "Display.h"
+
+// Golden images of every page, rendered from fixed data on the host
+// framebuffer (host/TFT_eSPI.h). A layout change shows up as a checksum
+// mismatch; the failing page is written to test/test_render/<page>.ppm so
+// it can be looked at, and the new checksum is printed for GOLDEN below.
+static const uint64_t GOLDEN[NUM_PAGES] = {
+    0x427e4c0fb92bd612ULL,  // Grid
+    0x19bcf14676c2049cULL,  // Speed
+    0xe67f2b691f23a3d8ULL,  // Chart
+    0x8bbd8086458af9c5ULL,  // Trip
+    0xb132bc883f3bacb7ULL,  // Pack
+    0x4ba877cc065360a0ULL,  // Map
+    0x2c551034947ba758ULL,  // Latency
+};
+
+static DisplayManager display;   // One panel for all tests, like the firmware
+static VehicleState state;
+static History history;
+static OperatingMap opmap;
+
+static float fixedValue(int slot) {
+    static const float WIRE[] = {45.3f, 87, 3760, 78.4f, 2.35f, 30.1f, 2.4f, 41};
+    if(slot < NUM_FIELDS) return WIRE[slot];
+    return 12.5f + slot * 7.25f;
+}
+
+static void fill(VehicleState& s) {
+    for(int slot=0; slot<NUM_SLOTS; slot++) s.update(fieldAddress(slot), fixedValue(slot));
+}
+
+// Chart x of a trace value, as StripChart computes it
+static int traceX(const TraceDef& tr, float v) {
+    return constrain((int)((v - tr.min) * (TFT_WIDTH - 1) / (tr.max - tr.min)), 0, TFT_WIDTH - 1);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_pages_match_goldens() {
+    int failed = 0;
+    for(int p=0; p<NUM_PAGES; p++) {
+        display.showPage(p, state);
+        uint64_t sum = display.tft.checksum();
+        if(sum == GOLDEN[p]) continue;
+        char path[64];
+        snprintf(path, sizeof(path), "test/test_render/%s.ppm", PAGES[p].name);
+        display.tft.writePPM(path);
+        printf("  page %d (%s): checksum 0x%016llxULL, written to %s\n",
+               p, PAGES[p].name, (unsigned long long)sum, path);
+        failed++;
+    }
+    TEST_ASSERT_EQUAL(0, failed);
+}
+
+// Same value again: nothing goes to the panel
+void test_unchanged_value_sends_nothing() {
+    display.showPage(0, state);
+    display.tft.resetStats();
+    display.render(state, 0xFFFFFFFF);
+    TEST_ASSERT_EQUAL_UINT32(0, display.tft.stats().bytes);
+}
+
+// Speed 45 -> 46: one atlas cell, nothing else
+void test_digit_change_pushes_one_cell() {
+    display.showPage(0, state);
+    VehicleState s;
+    fill(s);
+    s.update(24, 46.3f);
+    uint32_t blits = display.cellBlits;
+    display.tft.resetStats();
+    display.render(s, s.takeDirty());
+
+    const TftStats& st = display.tft.stats();
+    TEST_ASSERT_EQUAL_UINT32(1, st.windows);
+    TEST_ASSERT_EQUAL_UINT32(blits + 1, display.cellBlits);
+    TEST_ASSERT_EQUAL_UINT32(TFT_eSPI::WINDOW_BYTES + st.pixels * 2, st.bytes);
+    TEST_ASSERT_TRUE(st.pixels < 48 * 48); // One font 7 cell
+    display.render(state, 1UL << 0);    // Back to the fixed value
+}
+
+// A status line only touches its own rows
+void test_status_line_stays_in_its_area() {
+    display.showPage(0, state);
+    static uint16_t before[TFT_WIDTH * TFT_HEIGHT];
+    for(int y=0; y<TFT_HEIGHT; y++) {
+        for(int x=0; x<TFT_WIDTH; x++) before[y * TFT_WIDTH + x] = display.tft.readPixel(x, y);
+    }
+    display.updateStatus("Render test", TFT_GREEN);
+    // Bottom-centre datum on the last row: the text cell starts one font
+    // height up, a row above STATUS_Y
+    int top = TFT_HEIGHT - display.tft.fontHeight(2);
+    int changed = 0, outside = 0;
+    for(int y=0; y<TFT_HEIGHT; y++) {
+        for(int x=0; x<TFT_WIDTH; x++) {
+            if(display.tft.readPixel(x, y) == before[y * TFT_WIDTH + x]) continue;
+            changed++;
+            if(y < top) outside++;
+        }
+    }
+    TEST_ASSERT_TRUE(changed > 0);
+    TEST_ASSERT_EQUAL(0, outside);
+    display.updateStatus("", TFT_WHITE);
+}
+
+// Switching from a known page skips bands the two layers share
+void test_page_switch_skips_shared_bands() {
+    display.showPage(3, state);
+    display.tft.resetStats();
+    display.showPage(4, state);
+    uint64_t known = display.tft.stats().bytes;
+
+    display.showButtonHelp();  // Screen content unknown afterwards
+    display.tft.resetStats();
+    display.showPage(4, state);
+    uint64_t unknown = display.tft.stats().bytes;
+
+    TEST_ASSERT_TRUE(unknown >= (uint64_t)TFT_WIDTH * TFT_HEIGHT * 2);
+    TEST_ASSERT_TRUE(known < unknown);
+}
+
+// A history sample adds one line at the bottom of the scrolled chart
+void test_chart_appends_one_line() {
+    display.showPage(2, state);
+    VehicleState s;
+    fill(s);
+    s.update(24, 20.0f);
+    history.sample(s, history.lastSampleTime() + HISTORY_PERIOD_MS);
+
+    display.tft.resetStats();
+    display.onHistorySample();
+    TEST_ASSERT_EQUAL_UINT32(1, display.tft.stats().windows);
+    TEST_ASSERT_EQUAL_UINT32(TFT_WIDTH, display.tft.stats().pixels);
+
+    const ChartDef& c = TREND_CHART;
+    int bottom = c.top + c.height - 1;
+    TEST_ASSERT_EQUAL_HEX32(c.traces[0].color, display.tft.readPixel(traceX(c.traces[0], 20.0f), bottom));
+}
+
+// Leaving the latency page repaints the bands its table was drawn in
+void test_latency_table_cleared_on_switch() {
+    static LatencyProbe probe;
+    for(int f=0; f<NUM_FIELDS; f++) probe.fields[f].add(5000 + f * 1000);
+    display.attachLatency(&probe);
+    int latency = NUM_PAGES - 1;
+    TEST_ASSERT_NOT_NULL(PAGES[latency].latency);
+    display.showPage(latency, state);
+    display.showPage(0, state);
+    uint64_t switched = display.tft.checksum();
+
+    display.showButtonHelp();   // Screen unknown: full redraw
+    display.showPage(0, state);
+    TEST_ASSERT_EQUAL_HEX64(display.tft.checksum(), switched);
+    display.attachLatency(nullptr);
+}
+
+// A slot that turns invalid leaves its widget blank, not showing the old value
+void test_invalidated_slot_is_blanked() {
+    int speedPage = 1;
+    display.showPage(speedPage, state);
+    int w = -1;
+    for(int i=0; i<PAGES[speedPage].numWidgets; i++) if(PAGES[speedPage].widgets[i].field == VF_RANGE) w = i;
+    TEST_ASSERT_TRUE(w >= 0);
+    const WidgetDef& def = PAGES[speedPage].widgets[w];
+    auto lit = [&]() {
+        int n = 0;
+        for(int y=def.y; y<def.y + def.h; y++) {
+            for(int x=def.x; x<def.x + def.w; x++) n += display.tft.readPixel(x, y) != TFT_BLACK;
+        }
+        return n;
+    };
+    TEST_ASSERT_TRUE(lit() > 0);
+
+    VehicleState s;
+    fill(s);
+    s.takeDirty();
+    s.invalidate(VF_RANGE);
+    TEST_ASSERT_FALSE(s.isValid(fieldIndex(VF_RANGE)));
+    display.render(s, s.takeDirty());
+    TEST_ASSERT_EQUAL(0, lit());
+
+    s.update(VF_RANGE, fixedValue(fieldIndex(VF_RANGE)));
+    display.render(s, s.takeDirty());
+    TEST_ASSERT_TRUE(lit() > 0);
+    display.showPage(0, state);
+}
+
+int main(int argc, char** argv) {
+    hostQuiet() = true;
+    display.init();
+    fill(state);
+    state.takeDirty();
+
+    // A minute of history and a visited operating map
+    VehicleState s;
+    for(int i=0; i<240; i++) {
+        fill(s);
+        s.update(24, 30.0f + 20.0f * sinf(i * 0.05f));
+        s.update(115, 4.0f + 3.0f * sinf(i * 0.08f));
+        s.update(119, 50.0f + 40.0f * sinf(i * 0.08f));
+        history.sample(s, (unsigned long)i * HISTORY_PERIOD_MS);
+    }
+    static OperatingTotals totals;
+    totals.version = OPMAP_VERSION;
+    for(int p=0; p<OPMAP_PWR_BINS; p++) {
+        for(int r=0; r<OPMAP_RPM_BINS; r++) totals.cells[p][r] = (p * 7 + r * 3) % 11 * (r + 1) * 10;
+    }
+    opmap.restore(totals);
+    display.attachHistory(&history);
+    display.attachMap(&opmap);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_pages_match_goldens);
+    RUN_TEST(test_unchanged_value_sends_nothing);
+    RUN_TEST(test_digit_change_pushes_one_cell);
+    RUN_TEST(test_status_line_stays_in_its_area);
+    RUN_TEST(test_page_switch_skips_shared_bands);
+    RUN_TEST(test_chart_appends_one_line);
+    RUN_TEST(test_latency_table_cleared_on_switch);
+    RUN_TEST(test_invalidated_slot_is_blanked);
+    return UNITY_END();
+}
@@ -0,0 +1,114 @@
+#include <unity.h>
+#include "Rules.h"
+
+static RuleEngine engine;
+
+static const int TEMP = fieldIndex(ADDR_TEMP);
+static const int VOLT = fieldIndex(ADDR_VOLT);
+static const int SOC = fieldIndex(ADDR_SOC);
+
+void setUp() {
+    engine.load(DEFAULT_RULES, NUM_DEFAULT_RULES);
+    engine.evaluations = 0;
+}
+void tearDown() {}
+
+static int drain(RuleEvent* out, int max) {
+    int n = 0;
+    RuleEvent e;
+    while(engine.pollEvent(e)) if(n < max) out[n++] = e;
+    return n;
+}
+
+void test_defaults_load() {
+    TEST_ASSERT_EQUAL(NUM_DEFAULT_RULES, engine.size());
+}
+
+void test_only_the_fields_own_rules_are_evaluated() {
+    engine.evaluate(fieldIndex(ADDR_RPM), 5000, 0);  // No rules on RPM
+    TEST_ASSERT_EQUAL_UINT32(0, engine.evaluations);
+    engine.evaluate(TEMP, 50, 0);
+    TEST_ASSERT_EQUAL_UINT32(1, engine.evaluations);
+}
+
+void test_debounce_needs_the_hold_time() {
+    // Temp > 80 for 2 s: a 1.5 s excursion never fires
+    engine.evaluate(TEMP, 85, 0);
+    engine.service(1000);
+    engine.evaluate(TEMP, 70, 1500);
+    engine.service(3000);
+    TEST_ASSERT_FALSE(engine.isActive(1));
+
+    // Held: fires from service() even if the value never changes again
+    engine.evaluate(TEMP, 85, 5000);
+    TEST_ASSERT_FALSE(engine.service(6999));
+    TEST_ASSERT_TRUE(engine.service(7000));
+    TEST_ASSERT_TRUE(engine.isActive(1));
+    TEST_ASSERT_TRUE(engine.flashing());
+    TEST_ASSERT_EQUAL_HEX32(RULE_ALERT_COLOR, engine.colorFor(TEMP));
+
+    RuleEvent ev[4];
+    TEST_ASSERT_EQUAL(1, drain(ev, 4));
+    TEST_ASSERT_EQUAL(1, ev[0].rule);
+    TEST_ASSERT_TRUE(ev[0].active);
+    TEST_ASSERT_EQUAL_UINT32(7000, ev[0].ms);
+}
+
+void test_hysteresis_holds_until_released() {
+    engine.evaluate(SOC, 21, 0);
+    TEST_ASSERT_EQUAL_HEX32(0, engine.colorFor(SOC));
+    engine.evaluate(SOC, 20, 0); // No hold time: fires at once, red at 20 % as ever
+    TEST_ASSERT_EQUAL_HEX32(RULE_ALERT_COLOR, engine.colorFor(SOC));
+    engine.evaluate(SOC, 22, 100); // Above 21 but inside the 2 % band
+    TEST_ASSERT_EQUAL_HEX32(RULE_ALERT_COLOR, engine.colorFor(SOC));
+    engine.evaluate(SOC, 23, 200);
+    TEST_ASSERT_EQUAL_HEX32(0, engine.colorFor(SOC));
+
+    RuleEvent ev[4];
+    TEST_ASSERT_EQUAL(2, drain(ev, 4));
+    TEST_ASSERT_TRUE(ev[0].active);
+    TEST_ASSERT_FALSE(ev[1].active);
+}
+
+void test_first_active_rule_on_a_field_sets_the_colour() {
+    const Rule set[] = {
+        {ADDR_VOLT, RULE_BELOW, RULE_COLOR, 60.0f, 1.0f, 0, 0xF800},  // Red
+        {ADDR_VOLT, RULE_BELOW, RULE_COLOR, 66.0f, 1.0f, 0, 0xFDA0},  // Orange
+    };
+    engine.load(set, 2);
+    engine.evaluate(VOLT, 64, 0);
+    TEST_ASSERT_EQUAL_HEX32(0xFDA0, engine.colorFor(VOLT));
+    engine.evaluate(VOLT, 58, 10);
+    TEST_ASSERT_EQUAL_HEX32(0xF800, engine.colorFor(VOLT));
+    engine.evaluate(VOLT, 62, 20);
+    TEST_ASSERT_EQUAL_HEX32(0xFDA0, engine.colorFor(VOLT));
+}
+
+void test_rules_on_unknown_fields_are_skipped() {
+    const Rule set[] = {
+        {999,       RULE_ABOVE, RULE_LOG, 1.0f, 0.0f, 0, 0},
+        {ADDR_TEMP, RULE_ABOVE, RULE_LOG, 1.0f, 0.0f, 0, 0},
+    };
+    TEST_ASSERT_EQUAL(1, engine.load(set, 2));
+    TEST_ASSERT_EQUAL(ADDR_TEMP, engine.rule(0).field);
+}
+
+void test_full_event_queue_drops_new_events() {
+    for(int i=0; i<40; i++) engine.evaluate(SOC, (i & 1) ? 30.0f : 10.0f, i);
+    TEST_ASSERT_EQUAL_UINT32(40 - (RuleEngine::EVENT_QUEUE - 1), engine.eventsDropped);
+    RuleEvent ev[RuleEngine::EVENT_QUEUE];
+    TEST_ASSERT_EQUAL(RuleEngine::EVENT_QUEUE - 1, drain(ev, RuleEngine::EVENT_QUEUE));
+    TEST_ASSERT_EQUAL_UINT32(0, ev[0].ms);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_defaults_load);
+    RUN_TEST(test_only_the_fields_own_rules_are_evaluated);
+    RUN_TEST(test_debounce_needs_the_hold_time);
+    RUN_TEST(test_hysteresis_holds_until_released);
+    RUN_TEST(test_first_active_rule_on_a_field_sets_the_colour);
+    RUN_TEST(test_rules_on_unknown_fields_are_skipped);
+    RUN_TEST(test_full_event_queue_drops_new_events);
+    return UNITY_END();
+}
@@ -0,0 +1,234 @@
+#include <unity.h>
+#include "ControllerSession.h"
+#include "LoopbackTransport.h"
+#include "UartFrame.h"
+
+static ControllerEmulator* emu;
+static LoopbackTransport* link;
+static ControllerSession* session;
+static float last[NUM_FIELDS];
+static uint32_t dataCount;
+static uint32_t otherCount;
+static uint8_t other[20];
+static bool streamingCalled;
+
+void setUp() {
+    emu = new ControllerEmulator();
+    link = new LoopbackTransport(*emu);
+    session = new ControllerSession();
+    session->attach(link);
+    for(int i=0; i<NUM_FIELDS; i++) last[i] = -999;
+    dataCount = otherCount = 0;
+    streamingCalled = false;
+    session->onDataReceived = [](const Protocol::ParsedData& d) {
+        last[d.slot] = d.value;
+        dataCount++;
+    };
+    session->onOtherPacket = [](const uint8_t* p, size_t len) {
+        memcpy(other, p, len < sizeof(other) ? len : sizeof(other));
+        otherCount++;
+    };
+    session->onStreaming = []() { streamingCalled = true; };
+}
+
+void tearDown() {
+    delete session;
+    delete link;
+    delete emu;
+}
+
+// Step the session in 10 ms ticks until streaming or `maxMs` passed
+static uint32_t runSetup(uint32_t maxMs = 5000) {
+    uint32_t ms = 0;
+    for(; ms < maxMs && !session->isStreaming(); ms += 10) {
+        session->service(ms);
+        link->poll();
+    }
+    return ms;
+}
+
+void test_configure_sets_up_channels() {
+    link->connect();
+    session->configure(0);
+    TEST_ASSERT_TRUE(session->isConfiguring());
+    uint32_t took = runSetup();
+
+    TEST_ASSERT_TRUE(session->isStreaming());
+    TEST_ASSERT_TRUE(streamingCalled);
+    TEST_ASSERT_FALSE(session->isConfiguring());
+    TEST_ASSERT_TRUE(emu->uploading());
+    TEST_ASSERT_EQUAL(NUM_FIELDS, emu->channels());
+    for(int i=0; i<NUM_FIELDS; i++) TEST_ASSERT_EQUAL(TARGET_FIELDS[i].address, emu->channelAddress(i));
+
+    // Stop and clear gaps, one per channel, the extra wait before start
+    uint32_t expected = ControllerSession::STOP_GAP_MS + ControllerSession::CLEAR_GAP_MS
+                      + NUM_FIELDS * ControllerSession::CHANNEL_GAP_MS + ControllerSession::START_GAP_MS;
+    TEST_ASSERT_INT_WITHIN(20, expected, took);
+}
+
+void test_setup_waits_for_start_time() {
+    link->connect();
+    session->configure(500);
+    session->service(100);
+    TEST_ASSERT_EQUAL_UINT32(0, emu->commands);
+    session->service(500);
+    TEST_ASSERT_EQUAL_UINT32(1, emu->commands);
+}
+
+void test_samples_decode() {
+    link->connect();
+    session->configure(0);
+    runSetup();
+
+    emu->set(24, 453, 2);        // Speed 45.3
+    emu->set(119, -124, 2);      // Current -12.4, regen
+    emu->set(222, 65, 1);        // Temp 25
+    emu->round(0);
+    link->poll();
+
+    TEST_ASSERT_EQUAL_UINT32(NUM_FIELDS, dataCount);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 45.3f, last[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, -12.4f, last[5]);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 25.0f, last[7]);
+    TEST_ASSERT_EQUAL_UINT32(NUM_FIELDS, session->samples.load());
+}
+
+void test_read_answer_goes_to_other_packets() {
+    link->connect();
+    emu->set(ADDR_ERROR, 0x12345678, 4);
+    const uint8_t read[] = {ADDR_ERROR & 0xFF, (ADDR_ERROR >> 8) | 0x80, 4};
+    TEST_ASSERT_TRUE(session->sendCommand(read, sizeof(read)));
+    link->poll();
+
+    TEST_ASSERT_EQUAL_UINT32(0, dataCount);
+    TEST_ASSERT_EQUAL_UINT32(1, otherCount);
+    TEST_ASSERT_EQUAL_HEX8(ADDR_ERROR & 0xFF, other[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xA0, other[1] & 0xE0); // Read | Resp
+    TEST_ASSERT_EQUAL_HEX8(0x78, other[2]);
+    TEST_ASSERT_EQUAL_HEX8(0x12, other[5]);
+}
+
+void test_no_commands_without_link() {
+    const uint8_t read[] = {ADDR_ERROR & 0xFF, (ADDR_ERROR >> 8) | 0x80, 4};
+    TEST_ASSERT_FALSE(session->sendCommand(read, sizeof(read)));
+    TEST_ASSERT_EQUAL_UINT32(0, emu->commands);
+}
+
+void test_disconnect_aborts_setup() {
+    link->connect();
+    session->configure(0);
+    session->service(0);     // Stop sent
+    link->disconnect();
+    session->service(1000);
+    TEST_ASSERT_FALSE(session->isConfiguring());
+    TEST_ASSERT_FALSE(streamingCalled);
+
+    // Reconnect starts over
+    link->connect();
+    session->configure(2000);
+    uint32_t ms = 2000;
+    for(; ms < 5000 && !session->isStreaming(); ms += 10) session->service(ms);
+    TEST_ASSERT_TRUE(session->isStreaming());
+    TEST_ASSERT_EQUAL(NUM_FIELDS, emu->channels());
+}
+
+// Like UartTransport: commands go out before the controller is heard from
+struct SilentUntilAnswered : LoopbackTransport {
+    bool heard = false;
+    explicit SilentUntilAnswered(ControllerEmulator& e) : LoopbackTransport(e) {}
+    bool connected() const override { return heard; }
+    bool canSend() const override { return LoopbackTransport::connected(); }
+};
+
+void test_setup_without_handshake() {
+    SilentUntilAnswered quiet(*emu);
+    session->attach(&quiet);
+    quiet.connect();
+    session->configure(0);
+    uint32_t ms = 0;
+    for(; ms < 2000; ms += 10) session->service(ms);
+    TEST_ASSERT_TRUE(emu->uploading());
+    TEST_ASSERT_FALSE(session->isSendingSetup());
+    TEST_ASSERT_TRUE(session->isConfiguring());
+    TEST_ASSERT_FALSE(streamingCalled);
+
+    // The first packet brings the link up
+    emu->round(0);
+    quiet.poll();
+    quiet.heard = true;
+    session->service(ms);
+    TEST_ASSERT_TRUE(session->isStreaming());
+    TEST_ASSERT_TRUE(streamingCalled);
+    TEST_ASSERT_EQUAL_UINT32(NUM_FIELDS, dataCount);
+}
+
+void test_high_rate_without_loss() {
+    link->connect();
+    session->configure(0);
+    runSetup();
+
+    emu->periodUs = 1000; // 1000 rounds/s, well past the BLE link
+    emu->script = [](uint64_t us, ControllerEmulator& e) { e.set(24, (int32_t)(us / 1000), 2); };
+    uint64_t us = 0;
+    for(int i=0; i<10000; i++) {
+        us += 1000;
+        emu->run(us);
+        link->poll();
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, link->dropped);
+    TEST_ASSERT_EQUAL_UINT32(emu->rounds * NUM_FIELDS, dataCount);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, (us / 1000 % 65536) / 10.0f, last[0]);
+}
+
+void test_uart_frame_round_trip() {
+    const uint8_t pkt[] = {24, 0, 0xC5, 0x01};
+    uint8_t frame[UART_MAX_FRAME];
+    size_t n = uartEncode(pkt, sizeof(pkt), frame);
+    TEST_ASSERT_EQUAL(sizeof(pkt) + 5, n);
+
+    UartParser parser;
+    size_t done = 0;
+    for(size_t i=0; i<n; i++) done += parser.push(frame[i]);
+    TEST_ASSERT_EQUAL(1, done);
+    TEST_ASSERT_EQUAL(sizeof(pkt), parser.length());
+    TEST_ASSERT_EQUAL_MEMORY(pkt, parser.packet(), sizeof(pkt));
+
+    uint8_t big[UART_MAX_PACKET + 1] = {};
+    TEST_ASSERT_EQUAL(0, uartEncode(big, sizeof(big), frame));
+}
+
+void test_uart_resync_after_noise() {
+    const uint8_t a[] = {24, 0, 0x10, 0x00};
+    const uint8_t b[] = {222, 0, 65};
+    uint8_t fa[UART_MAX_FRAME], fb[UART_MAX_FRAME];
+    size_t na = uartEncode(a, sizeof(a), fa);
+    size_t nb = uartEncode(b, sizeof(b), fb);
+    fa[4] ^= 0x40; // Corrupt the first frame
+
+    const uint8_t noise[] = {0x00, 0xA5, 0xA5, 0x13};
+    UartParser parser;
+    int done = 0;
+    for(uint8_t x : noise) done += parser.push(x);
+    for(size_t i=0; i<na; i++) done += parser.push(fa[i]);
+    for(size_t i=0; i<nb; i++) done += parser.push(fb[i]);
+
+    TEST_ASSERT_EQUAL(1, done);
+    TEST_ASSERT_EQUAL_UINT32(1, parser.crcErrors);
+    TEST_ASSERT_EQUAL(sizeof(b), parser.length());
+    TEST_ASSERT_EQUAL_MEMORY(b, parser.packet(), sizeof(b));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_configure_sets_up_channels);
+    RUN_TEST(test_setup_waits_for_start_time);
+    RUN_TEST(test_samples_decode);
+    RUN_TEST(test_read_answer_goes_to_other_packets);
+    RUN_TEST(test_no_commands_without_link);
+    RUN_TEST(test_disconnect_aborts_setup);
+    RUN_TEST(test_setup_without_handshake);
+    RUN_TEST(test_high_rate_without_loss);
+    RUN_TEST(test_uart_frame_round_trip);
+    RUN_TEST(test_uart_resync_after_noise);
+    return UNITY_END();
+}
@@ -0,0 +1,136 @@
+#include <unity.h>
+#include "ControllerSession.h"
+#include "LoopbackTransport.h"
+#include "RideModel.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_deterministic_for_seed() {
+    RideModel a(42), b(42), c(43);
+    for(int i=0; i<30000; i++) {
+        a.step(0.02f);
+        b.step(0.02f);
+        c.step(0.02f);
+    }
+    TEST_ASSERT_EQUAL_FLOAT(a.value(24), b.value(24));
+    TEST_ASSERT_EQUAL_FLOAT(a.value(119), b.value(119));
+    TEST_ASSERT_TRUE(a.value(24) != c.value(24) || a.value(119) != c.value(119));
+}
+
+// Half an hour at the BLE rate: plausible ranges, stops, regen, drain
+void test_ride_is_plausible() {
+    RideModel ride(7);
+    float maxSpeed = 0, minCurrent = 0, maxCurrent = 0, maxTemp = 0;
+    float standing = 0;
+    float startSoc = ride.value(26);
+    for(int i=0; i<90000; i++) {
+        ride.step(0.02f);
+        float speed = ride.value(24);
+        TEST_ASSERT_TRUE(speed >= 0 && speed < 120);
+        TEST_ASSERT_TRUE(ride.value(113) > 55 && ride.value(113) < 90);
+        if(speed > maxSpeed) maxSpeed = speed;
+        if(speed < 0.5f) standing += 0.02f;
+        if(ride.value(119) < minCurrent) minCurrent = ride.value(119);
+        if(ride.value(119) > maxCurrent) maxCurrent = ride.value(119);
+        if(ride.value(ADDR_MOTOR_TEMP) > maxTemp) maxTemp = ride.value(ADDR_MOTOR_TEMP);
+    }
+    TEST_ASSERT_TRUE(maxSpeed > 30);
+    TEST_ASSERT_TRUE(standing > 10);
+    TEST_ASSERT_TRUE(minCurrent < -2);       // Regen while braking
+    TEST_ASSERT_TRUE(maxCurrent > 40);
+    TEST_ASSERT_TRUE(maxTemp > 30 && maxTemp < 80); // Warm, inside the i8 register
+    TEST_ASSERT_TRUE(ride.value(26) < startSoc);
+}
+
+void test_fields_are_correlated() {
+    RideModel ride(3);
+    for(int i=0; i<50000; i++) {
+        ride.step(0.02f);
+        float v = ride.value(113), a = ride.value(119);
+        TEST_ASSERT_FLOAT_WITHIN(1.0f, ride.value(24) * RideModel::RPM_PER_KMH, ride.value(105));
+        TEST_ASSERT_FLOAT_WITHIN(0.001f, v * a / 1000.0f, ride.value(115));
+        // Sag: the pack voltage falls as the current rises
+        if(a > 30) TEST_ASSERT_TRUE(v < 60.0f + 22.0f + 0.1f - a * RideModel::PACK_OHMS + 0.5f);
+    }
+}
+
+// Registers through the emulator and the session decode to the model's values
+void test_session_decodes_model() {
+    ControllerEmulator emu;
+    LoopbackTransport link(emu);
+    ControllerSession session;
+    session.attach(&link);
+    static float decoded[NUM_FIELDS];
+    session.onDataReceived = [](const Protocol::ParsedData& d) { decoded[d.slot] = d.value; };
+
+    link.connect();
+    session.configure(0);
+    for(uint32_t ms = 0; ms < 5000 && !session.isStreaming(); ms += 10) {
+        session.service(ms);
+        link.poll();
+    }
+    TEST_ASSERT_TRUE(session.isStreaming());
+
+    RideModel ride(11);
+    uint64_t last = 0;
+    emu.script = [&](uint64_t us, ControllerEmulator& e) {
+        ride.step((us - last) * 1e-6f);
+        last = us;
+        ride.write(e);
+    };
+    emu.periodUs = 2000;
+    for(uint64_t us = 0; us < 120000000ULL; us += 1000) {
+        emu.run(us);
+        link.poll();
+    }
+    for(int i=0; i<NUM_FIELDS; i++) {
+        const DataFieldConfig& f = TARGET_FIELDS[i];
+        TEST_ASSERT_FLOAT_WITHIN(0.51f / f.k + 0.001f, ride.value(f.address), decoded[i]);
+    }
+}
+
+void test_emulator_skips_when_behind() {
+    ControllerEmulator emu;
+    uint8_t start[] = {ADDR_CONTROL, 0, CMD_START_UPLOAD};
+    emu.onCommand(start, sizeof(start));
+    emu.periodUs = 1000;
+    emu.run(0);
+    TEST_ASSERT_EQUAL_UINT32(1, emu.rounds);
+
+    TEST_ASSERT_EQUAL_UINT32(10, emu.run(100000, 10));
+    TEST_ASSERT_EQUAL_UINT32(90, emu.missed);
+    TEST_ASSERT_EQUAL_UINT32(1, emu.run(101000, 10)); // Back on schedule
+    TEST_ASSERT_EQUAL_UINT32(90, emu.missed);
+}
+
+// Channel commands with a size the stream can't carry, or past the end of
+// memory, are ignored
+void test_emulator_rejects_bad_channels() {
+    ControllerEmulator emu;
+    size_t sent = 0;
+    emu.out = [&](const uint8_t*, size_t length) { sent += length; };
+    uint8_t bad[][5] = {
+        {ADDR_TIME_CHANNEL, 0, 24, 0, 200},
+        {ADDR_TIME_CHANNEL, 0, 24, 0, 3},
+        {ADDR_TIME_CHANNEL, 0, 0xFE, 0x1F, 4},
+    };
+    for(auto& cmd : bad) emu.onCommand(cmd, sizeof(cmd));
+    uint8_t good[] = {ADDR_TIME_CHANNEL, 0, 24, 0, 2};
+    emu.onCommand(good, sizeof(good));
+    uint8_t start[] = {ADDR_CONTROL, 0, CMD_START_UPLOAD};
+    emu.onCommand(start, sizeof(start));
+    emu.round(0);
+    TEST_ASSERT_EQUAL(2 + 2, sent);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_deterministic_for_seed);
+    RUN_TEST(test_ride_is_plausible);
+    RUN_TEST(test_fields_are_correlated);
+    RUN_TEST(test_session_decodes_model);
+    RUN_TEST(test_emulator_skips_when_behind);
+    RUN_TEST(test_emulator_rejects_bad_channels);
+    return UNITY_END();
+}
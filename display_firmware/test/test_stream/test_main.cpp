@@ -0,0 +1,116 @@
+#include <unity.h>
+#include <string.h>
+#include "StreamFrame.h"
+
+static StreamFrame sample(uint16_t seq, uint16_t address, int32_t raw) {
+    StreamFrame f = {};
+    f.type = STREAM_SAMPLE;
+    f.seq = seq;
+    f.tUs = 123456789;
+    f.controller = 2;
+    f.address = address;
+    f.raw = raw;
+    return f;
+}
+
+// Feed bytes, return the number of frames parsed; the last one lands in out
+static int feedAll(StreamParser& p, const uint8_t* data, size_t n, StreamFrame& out) {
+    int frames = 0;
+    for(size_t i=0; i<n; i++) {
+        if(p.feed(data[i], out)) frames++;
+    }
+    return frames;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_sample_round_trip() {
+    uint8_t buf[STREAM_MAX_FRAME];
+    size_t n = StreamEncoder::encode(sample(65535, 119, -1234), buf);
+    TEST_ASSERT_EQUAL(STREAM_OVERHEAD + 13, n);
+
+    StreamParser p;
+    StreamFrame f;
+    TEST_ASSERT_EQUAL(1, feedAll(p, buf, n, f));
+    TEST_ASSERT_EQUAL(STREAM_SAMPLE, f.type);
+    TEST_ASSERT_EQUAL_UINT32(65535, f.seq);
+    TEST_ASSERT_EQUAL_UINT32(123456789, f.tUs);
+    TEST_ASSERT_EQUAL(2, f.controller);
+    TEST_ASSERT_EQUAL(119, f.address);
+    TEST_ASSERT_EQUAL_INT32(-1234, f.raw);
+}
+
+void test_controller_and_stats_round_trip() {
+    uint8_t buf[2 * STREAM_MAX_FRAME];
+    StreamFrame c = {};
+    c.type = STREAM_CONTROLLER;
+    c.controller = 7;
+    const uint8_t mac[6] = {1, 2, 3, 4, 5, 6};
+    memcpy(c.mac, mac, 6);
+    StreamFrame s = {};
+    s.type = STREAM_STATS;
+    s.dropped = 42;
+    size_t n = StreamEncoder::encode(c, buf);
+    n += StreamEncoder::encode(s, buf + n);
+
+    StreamParser p;
+    StreamFrame f;
+    size_t i = 0;
+    while(!p.feed(buf[i++], f)) {}
+    TEST_ASSERT_EQUAL(STREAM_CONTROLLER, f.type);
+    TEST_ASSERT_EQUAL(7, f.controller);
+    TEST_ASSERT_EQUAL_MEMORY(mac, f.mac, 6);
+    TEST_ASSERT_EQUAL(1, feedAll(p, buf + i, n - i, f));
+    TEST_ASSERT_EQUAL(STREAM_STATS, f.type);
+    TEST_ASSERT_EQUAL_UINT32(42, f.dropped);
+}
+
+void test_resyncs_after_text_on_the_port() {
+    uint8_t buf[128];
+    const char* text = "USB stream on\n\xA5 stray";
+    size_t n = strlen(text);
+    memcpy(buf, text, n);
+    n += StreamEncoder::encode(sample(1, 24, 452), buf + n);
+    n += StreamEncoder::encode(sample(2, 26, 80), buf + n);
+
+    StreamParser p;
+    StreamFrame f;
+    TEST_ASSERT_EQUAL(2, feedAll(p, buf, n, f));
+    TEST_ASSERT_EQUAL_UINT32(2, f.seq);
+    TEST_ASSERT_EQUAL(strlen(text), p.skippedBytes);
+}
+
+void test_corrupt_frame_is_dropped_and_next_one_kept() {
+    uint8_t buf[2 * STREAM_MAX_FRAME];
+    size_t first = StreamEncoder::encode(sample(10, 24, 1), buf);
+    size_t n = first + StreamEncoder::encode(sample(11, 24, 2), buf + first);
+    buf[8] ^= 0x40;
+
+    StreamParser p;
+    StreamFrame f;
+    TEST_ASSERT_EQUAL(1, feedAll(p, buf, n, f));
+    TEST_ASSERT_EQUAL_UINT32(11, f.seq);
+    TEST_ASSERT_EQUAL(1, p.crcErrors);
+}
+
+void test_torn_frame_followed_by_full_frame() {
+    uint8_t buf[2 * STREAM_MAX_FRAME];
+    size_t torn = StreamEncoder::encode(sample(5, 24, 1), buf) - 4;
+    size_t n = torn + StreamEncoder::encode(sample(6, 24, 2), buf + torn);
+
+    StreamParser p;
+    StreamFrame f;
+    TEST_ASSERT_EQUAL(1, feedAll(p, buf, n, f));
+    TEST_ASSERT_EQUAL_UINT32(6, f.seq);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sample_round_trip);
+    RUN_TEST(test_controller_and_stats_round_trip);
+    RUN_TEST(test_resyncs_after_text_on_the_port);
+    RUN_TEST(test_corrupt_frame_is_dropped_and_next_one_kept);
+    RUN_TEST(test_torn_frame_followed_by_full_frame);
+    return UNITY_END();
+}
@@ -0,0 +1,125 @@
+#include <unity.h>
+#include "Touch.h"
+
+// Register-level stand-in for the CST328 on the I2C bus
+class MockCst328 : public I2cBus {
+public:
+    bool fail = false;
+    int acks = 0;
+    uint8_t regs[7] = {0, 0, 0, 0, 0, 0, 0xAB};
+
+    void setTouch(bool down, uint16_t x, uint16_t y) {
+        regs[0] = down ? (0x10 | Cst328::STATE_PRESSED) : 0x00;
+        regs[1] = x >> 4;
+        regs[2] = y >> 4;
+        regs[3] = ((x & 0x0F) << 4) | (y & 0x0F);
+        regs[4] = down ? 0x20 : 0;
+        regs[5] = down ? 1 : 0;
+    }
+
+    bool writeRead(uint8_t addr, const uint8_t* w, size_t wlen, uint8_t* r, size_t rlen) override {
+        if(fail || addr != Cst328::I2C_ADDR || wlen != 2) return false;
+        uint16_t reg = (w[0] << 8) | w[1];
+        if(reg != Cst328::REG_POINT1 || rlen > sizeof(regs)) return false;
+        for(size_t i=0; i<rlen; i++) r[i] = regs[i];
+        return true;
+    }
+
+    bool write(uint8_t addr, const uint8_t* w, size_t wlen) override {
+        if(fail || addr != Cst328::I2C_ADDR || wlen != 3) return false;
+        if(((w[0] << 8) | w[1]) == Cst328::REG_COUNT && w[2] == 0) acks++;
+        return true;
+    }
+};
+
+static MockCst328 mock;
+static Cst328 chip(mock);
+static TouchGestures gestures;
+
+void setUp() {
+    mock = MockCst328();
+    gestures = TouchGestures();
+}
+
+void tearDown() {}
+
+// One INT pulse: the driver reads the mock, the recogniser consumes the report
+static TouchGestureType report(bool down, uint16_t x, uint16_t y, uint32_t t) {
+    mock.setTouch(down, x, y);
+    TouchPoint p;
+    TEST_ASSERT_TRUE(chip.read(p));
+    return gestures.feed(p, t);
+}
+
+void test_read_decodes_12bit_coordinates_and_acks() {
+    mock.setTouch(true, 0x0EF, 0x13F); // 239, 319
+    TouchPoint p;
+    TEST_ASSERT_TRUE(chip.read(p));
+    TEST_ASSERT_TRUE(p.down);
+    TEST_ASSERT_EQUAL_UINT16(239, p.x);
+    TEST_ASSERT_EQUAL_UINT16(319, p.y);
+    TEST_ASSERT_EQUAL(1, mock.acks);
+}
+
+void test_release_report_is_up() {
+    mock.setTouch(false, 0, 0);
+    TouchPoint p;
+    TEST_ASSERT_TRUE(chip.read(p));
+    TEST_ASSERT_FALSE(p.down);
+}
+
+void test_bus_error_is_reported() {
+    mock.fail = true;
+    TouchPoint p;
+    TEST_ASSERT_FALSE(chip.read(p));
+}
+
+void test_tap() {
+    TEST_ASSERT_EQUAL(GESTURE_NONE, report(true, 120, 160, 0));
+    TEST_ASSERT_EQUAL(GESTURE_NONE, report(true, 123, 158, 40));
+    TEST_ASSERT_EQUAL(GESTURE_TAP, report(false, 0, 0, 120));
+}
+
+void test_swipe_left_and_right() {
+    report(true, 200, 150, 0);
+    report(true, 130, 155, 100);
+    report(true, 60, 160, 200);
+    TEST_ASSERT_EQUAL(GESTURE_SWIPE_LEFT, report(false, 0, 0, 220));
+
+    report(true, 40, 100, 1000);
+    report(true, 180, 110, 1250);
+    TEST_ASSERT_EQUAL(GESTURE_SWIPE_RIGHT, report(false, 0, 0, 1300));
+}
+
+void test_vertical_drag_is_not_a_swipe() {
+    report(true, 120, 40, 0);
+    report(true, 140, 260, 200);
+    TEST_ASSERT_EQUAL(GESTURE_NONE, report(false, 0, 0, 250));
+}
+
+void test_long_press_fires_once_while_held() {
+    report(true, 100, 100, 0);
+    TEST_ASSERT_EQUAL(GESTURE_NONE, gestures.poll(500));
+    TEST_ASSERT_EQUAL(GESTURE_LONG_PRESS, gestures.poll(850));
+    TEST_ASSERT_EQUAL(GESTURE_NONE, report(true, 102, 101, 900));
+    TEST_ASSERT_EQUAL(GESTURE_NONE, report(false, 0, 0, 1200));
+}
+
+void test_slow_swipe_is_ignored() {
+    report(true, 200, 150, 0);
+    report(true, 60, 150, 900);
+    TEST_ASSERT_EQUAL(GESTURE_NONE, report(false, 0, 0, 950));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_read_decodes_12bit_coordinates_and_acks);
+    RUN_TEST(test_release_report_is_up);
+    RUN_TEST(test_bus_error_is_reported);
+    RUN_TEST(test_tap);
+    RUN_TEST(test_swipe_left_and_right);
+    RUN_TEST(test_vertical_drag_is_not_a_swipe);
+    RUN_TEST(test_long_press_fires_once_while_held);
+    RUN_TEST(test_slow_swipe_is_ignored);
+    return UNITY_END();
+}
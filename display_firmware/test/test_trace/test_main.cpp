@@ -0,0 +1,197 @@
+#include <unity.h>
+#include <vector>
+#include "ControllerSession.h"
+#include "ControllerEmulator.h"
+#include "TraceReplay.h"
+
+static const uint8_t SPEED_PACKET[] = {24, 0, 0xC5, 0x01};   // Speed field, raw 453
+static const uint8_t READ_ANSWER[] = {0x10, 0xA0, 7, 0};      // Answer to a read
+
+// Header, link up, two packets, one read answer
+static std::vector<uint8_t> sampleTrace() {
+    PacketTraceWriter w;
+    std::vector<uint8_t> t(TRACE_HEADER_SIZE);
+    w.header(t.data(), 12345);
+    uint8_t rec[TRACE_MAX_RECORD];
+    t.insert(t.end(), rec, rec + w.link(rec, 0, true));
+    t.insert(t.end(), rec, rec + w.packet(rec, 100, SPEED_PACKET, sizeof(SPEED_PACKET)));
+    t.insert(t.end(), rec, rec + w.packet(rec, 20100, SPEED_PACKET, sizeof(SPEED_PACKET)));
+    t.insert(t.end(), rec, rec + w.packet(rec, 5000000, READ_ANSWER, sizeof(READ_ANSWER)));
+    return t;
+}
+
+// Every record, feeding `chunk` bytes at a time
+static std::vector<TraceRecord> replayAll(const std::vector<uint8_t>& t, size_t chunk, TraceReplay& r) {
+    std::vector<TraceRecord> out;
+    TEST_ASSERT_TRUE(r.begin(t.data(), t.size(), 0, 0));
+    size_t fed = TRACE_HEADER_SIZE;
+    while(!r.finished()) {
+        size_t n = fed + chunk < t.size() ? chunk : t.size() - fed;
+        fed += r.feed(t.data() + fed, n);
+        if(fed == t.size()) r.end();
+        r.run(0, UINT32_MAX, [&](const TraceRecord& rec) { out.push_back(rec); });
+    }
+    return out;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_round_trip() {
+    std::vector<uint8_t> t = sampleTrace();
+    PacketTraceReader reader;
+    TEST_ASSERT_TRUE(reader.header(t.data(), t.size()));
+    TEST_ASSERT_EQUAL_UINT32(12345, reader.startMs);
+
+    TraceRecord r;
+    size_t pos = TRACE_HEADER_SIZE;
+    int n = reader.next(&t[pos], t.size() - pos, r);
+    TEST_ASSERT_EQUAL(3, n);        // Time, 0, up
+    TEST_ASSERT_EQUAL(0, r.length);
+    TEST_ASSERT_TRUE(r.up);
+    pos += n;
+
+    pos += reader.next(&t[pos], t.size() - pos, r);
+    TEST_ASSERT_EQUAL(100, (int)r.us);
+    TEST_ASSERT_EQUAL(sizeof(SPEED_PACKET), r.length);
+    TEST_ASSERT_EQUAL_MEMORY(SPEED_PACKET, r.data, sizeof(SPEED_PACKET));
+
+    pos += reader.next(&t[pos], t.size() - pos, r);
+    TEST_ASSERT_EQUAL(20100, (int)r.us);
+    pos += reader.next(&t[pos], t.size() - pos, r);
+    TEST_ASSERT_EQUAL(5000000, (int)r.us);
+    TEST_ASSERT_EQUAL_MEMORY(READ_ANSWER, r.data, sizeof(READ_ANSWER));
+    TEST_ASSERT_EQUAL(t.size(), pos);
+}
+
+void test_partial_and_malformed_records() {
+    std::vector<uint8_t> t = sampleTrace();
+    PacketTraceReader reader;
+    reader.header(t.data(), t.size());
+    TraceRecord r;
+    size_t first = TRACE_HEADER_SIZE + 3;
+    reader.next(&t[TRACE_HEADER_SIZE], 3, r);
+    // Cut inside the packet: wait for more
+    TEST_ASSERT_EQUAL(0, reader.next(&t[first], 3, r));
+
+    uint8_t bad[] = {0x05, TRACE_MAX_PACKET + 1, 0, 0};
+    TEST_ASSERT_EQUAL(-1, reader.next(bad, sizeof(bad), r));
+    uint8_t wrong[TRACE_HEADER_SIZE] = {'X', 'X', TRACE_VERSION};
+    TEST_ASSERT_FALSE(reader.header(wrong, sizeof(wrong)));
+
+    PacketTraceWriter w;
+    uint8_t rec[TRACE_MAX_RECORD], big[TRACE_MAX_PACKET + 1] = {};
+    TEST_ASSERT_EQUAL(0, w.packet(rec, 0, big, sizeof(big)));
+    TEST_ASSERT_EQUAL(0, w.packet(rec, 0, big, 0));
+}
+
+// Records split across feed() calls come out whole
+void test_chunked_feed_gives_every_record() {
+    std::vector<uint8_t> t = sampleTrace();
+    for(size_t chunk : {1, 2, 5, 512}) {
+        TraceReplay r;
+        std::vector<TraceRecord> out = replayAll(t, chunk, r);
+        TEST_ASSERT_EQUAL(4, out.size());
+        TEST_ASSERT_EQUAL(3, r.packets);
+        TEST_ASSERT_EQUAL(1, r.linkEvents);
+        TEST_ASSERT_EQUAL(5000000, (int)r.traceUs);
+        TEST_ASSERT_FALSE(r.malformed);
+    }
+}
+
+// A capture cut off mid-record ends cleanly; a corrupt one stops
+void test_cut_short_and_corrupt_traces() {
+    std::vector<uint8_t> t = sampleTrace();
+    t.resize(t.size() - 2);
+    TraceReplay r;
+    TEST_ASSERT_EQUAL(3, replayAll(t, 64, r).size());
+    TEST_ASSERT_FALSE(r.malformed);
+
+    t = sampleTrace();
+    t[TRACE_HEADER_SIZE + 4] = 0xFF; // Length of the first packet
+    TraceReplay c;
+    TEST_ASSERT_EQUAL(1, replayAll(t, 64, c).size());
+    TEST_ASSERT_TRUE(c.malformed);
+    TEST_ASSERT_TRUE(c.finished());
+}
+
+// Speed 1 holds records until their time; speed 2 halves it
+void test_real_time_schedule() {
+    std::vector<uint8_t> t = sampleTrace();
+    TraceReplay r;
+    TEST_ASSERT_TRUE(r.begin(t.data(), t.size(), 1, 1000000));
+    r.feed(t.data() + TRACE_HEADER_SIZE, t.size() - TRACE_HEADER_SIZE);
+    r.end();
+    auto none = [](const TraceRecord&) {};
+
+    TEST_ASSERT_EQUAL(2, r.run(1000150, UINT32_MAX, none)); // Link, first packet
+    TEST_ASSERT_EQUAL(1020100, (int)r.nextDue());
+    TEST_ASSERT_EQUAL(0, r.run(1020099, UINT32_MAX, none));
+    TEST_ASSERT_EQUAL(1, r.run(1020300, UINT32_MAX, none));
+    TEST_ASSERT_EQUAL(200, r.lateness.maxUs);
+    TEST_ASSERT_FALSE(r.finished());
+    TEST_ASSERT_EQUAL(1, r.run(6000000, UINT32_MAX, none));
+    TEST_ASSERT_TRUE(r.finished());
+
+    TraceReplay fast;
+    fast.begin(t.data(), t.size(), 2, 0);
+    fast.feed(t.data() + TRACE_HEADER_SIZE, t.size() - TRACE_HEADER_SIZE);
+    fast.run(10050, UINT32_MAX, none);
+    TEST_ASSERT_EQUAL(2500000, (int)fast.nextDue());
+}
+
+// Emulator packets, traced and replayed into a session: same samples, same values
+void test_replay_through_session() {
+    ControllerEmulator emu;
+    PacketTraceWriter w;
+    std::vector<uint8_t> t(TRACE_HEADER_SIZE);
+    w.header(t.data(), 0);
+    uint64_t at = 0;
+    emu.out = [&](const uint8_t* data, size_t length) {
+        uint8_t rec[TRACE_MAX_RECORD];
+        t.insert(t.end(), rec, rec + w.packet(rec, at += 100, data, length));
+    };
+    for(int i=0; i<NUM_FIELDS; i++) {
+        auto cmd = Protocol::createChannelSetupCommand(TARGET_FIELDS[i].address, TARGET_FIELDS[i].size);
+        emu.onCommand(cmd.data(), cmd.size());
+    }
+    auto start = Protocol::createControlCommand(CMD_START_UPLOAD);
+    emu.onCommand(start.data(), start.size());
+    for(int round=0; round<50; round++) {
+        emu.set(TARGET_FIELDS[0].address, 100 + round, TARGET_FIELDS[0].size);
+        emu.round(round * 20000);
+    }
+
+    struct Link : Transport {
+        bool connected() const override { return true; }
+        bool send(const uint8_t*, size_t) override { return true; }
+        void push(const uint8_t* d, size_t n) { deliver(d, n); }
+    } link;
+    ControllerSession session;
+    session.attach(&link);
+    uint32_t seen = 0;
+    int32_t lastRaw = 0;
+    session.onPacket = [&](const uint8_t*, size_t) { seen++; };
+    session.onDataReceived = [&](const Protocol::ParsedData& d) {
+        if(d.slot == 0) lastRaw = d.raw;
+    };
+
+    TraceReplay r;
+    std::vector<TraceRecord> out = replayAll(t, 100, r);
+    for(const TraceRecord& rec : out) link.push(rec.data, rec.length);
+    TEST_ASSERT_EQUAL(50 * NUM_FIELDS, r.packets);
+    TEST_ASSERT_EQUAL(r.packets, seen);
+    TEST_ASSERT_EQUAL(r.packets, session.samples.load());
+    TEST_ASSERT_EQUAL(149, lastRaw);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_partial_and_malformed_records);
+    RUN_TEST(test_chunked_feed_gives_every_record);
+    RUN_TEST(test_cut_short_and_corrupt_traces);
+    RUN_TEST(test_real_time_schedule);
+    RUN_TEST(test_replay_through_session);
+    return UNITY_END();
+}
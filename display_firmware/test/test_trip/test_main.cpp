@@ -0,0 +1,85 @@
+#include <unity.h>
+#include "TripComputer.h"
+
+static TripComputer trip;
+
+void setUp() { trip.reset(); }
+void tearDown() {}
+
+void test_constant_power_integrates_to_wh() {
+    for(uint32_t ms=0; ms<=3600000; ms+=500) trip.onSample(ADDR_POWER, 10.0f, ms);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 10000.0, trip.get().whUsed);
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, 0.0, trip.get().whRegen);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 10.0f, trip.get().peakKw);
+}
+
+void test_zero_crossing_splits_used_and_regen() {
+    // 3.6 kW to -3.6 kW over 2 s: a 0.5 Wh triangle on each side of zero
+    trip.onSample(ADDR_POWER, 3.6f, 0);
+    trip.onSample(ADDR_POWER, -3.6f, 2000);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.5, trip.get().whUsed);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.5, trip.get().whRegen);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0, trip.netWh());
+}
+
+void test_gaps_are_not_integrated() {
+    trip.onSample(ADDR_POWER, 5.0f, 0);
+    trip.onSample(ADDR_POWER, 5.0f, 60000); // Link lost for a minute
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, 0.0, trip.get().whUsed);
+    trip.onSample(ADDR_POWER, 5.0f, 61000);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 5000.0 / 3600.0, trip.get().whUsed);
+}
+
+void test_volt_times_current_when_power_missing() {
+    trip.onSample(ADDR_VOLT, 72.0f, 0);
+    for(uint32_t ms=0; ms<=3600000; ms+=1000) trip.onSample(ADDR_CURRENT, 50.0f, ms);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 3600.0, trip.get().whUsed);
+}
+
+void test_power_field_wins_over_volt_current() {
+    trip.onSample(ADDR_VOLT, 72.0f, 0);
+    for(uint32_t ms=0; ms<=10000; ms+=100) {
+        trip.onSample(ADDR_POWER, 1.8f, ms);
+        trip.onSample(ADDR_CURRENT, 100.0f, ms + 50); // 7.2 kW if it were used
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, 1.8 * 10 / 3.6, trip.get().whUsed);
+}
+
+void test_distance_average_speed_and_efficiency() {
+    for(uint32_t ms=0; ms<=100000; ms+=100) {
+        trip.onSample(ADDR_SPEED, 36.0f, ms);
+        trip.onSample(ADDR_POWER, 3.6f, ms);
+    }
+    // Then stand still for 100 s: average speed ignores it
+    for(uint32_t ms=100100; ms<=200000; ms+=100) trip.onSample(ADDR_SPEED, 0.0f, ms);
+
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 1.0, trip.get().km);
+    TEST_ASSERT_FLOAT_WITHIN(0.1, 36.0f, trip.avgSpeed());
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 100.0f, trip.whPerKm());
+}
+
+void test_restore_checks_version() {
+    trip.onSample(ADDR_POWER, 1.0f, 0);
+    trip.onSample(ADDR_POWER, 1.0f, 1000);
+    TripTotals saved = trip.get();
+
+    TripComputer other;
+    TEST_ASSERT_TRUE(other.restore(saved));
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, saved.whUsed, other.get().whUsed);
+
+    saved.version = 99;
+    TEST_ASSERT_FALSE(other.restore(saved));
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, 0.0, other.get().whUsed);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_constant_power_integrates_to_wh);
+    RUN_TEST(test_zero_crossing_splits_used_and_regen);
+    RUN_TEST(test_gaps_are_not_integrated);
+    RUN_TEST(test_volt_times_current_when_power_missing);
+    RUN_TEST(test_power_field_wins_over_volt_current);
+    RUN_TEST(test_distance_average_speed_and_efficiency);
+    RUN_TEST(test_restore_checks_version);
+    return UNITY_END();
+}
@@ -0,0 +1,111 @@
+#include <unity.h>
+#include <vector>
+#include "TripLog.h"
+
+static std::vector<TripSample> decodeAll(const uint8_t* p, size_t len, int* result = nullptr) {
+    std::vector<TripSample> out;
+    int n = TripBlockDecoder::decode(p, len, [&](const TripSample& s) { out.push_back(s); });
+    if(result) *result = n;
+    return out;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_round_trip() {
+    TripBlockEncoder enc;
+    TripSample in[] = {
+        {1000, 0, 452},  {1000, 3, 812},  {1100, 0, 455},
+        {1100, 3, 809},  {1250, 4, -3200}, {1250, 7, 65},
+    };
+    for(auto& s : in) TEST_ASSERT_TRUE(enc.add(s));
+    size_t len = enc.finish();
+
+    int n;
+    auto out = decodeAll(enc.data(), len, &n);
+    TEST_ASSERT_EQUAL(6, n);
+    for(int i=0; i<6; i++) {
+        TEST_ASSERT_EQUAL_UINT32(in[i].ms, out[i].ms);
+        TEST_ASSERT_EQUAL(in[i].slot, out[i].slot);
+        TEST_ASSERT_EQUAL_INT32(in[i].raw, out[i].raw);
+    }
+}
+
+void test_small_changes_take_three_bytes() {
+    TripBlockEncoder enc;
+    for(int i=0; i<100; i++) {
+        enc.add({(uint32_t)(5000 + i * 12), (uint8_t)(i % 8), 300 + (i & 3)});
+    }
+    size_t len = enc.finish();
+    // First sample of each slot carries its absolute value
+    TEST_ASSERT_LESS_OR_EQUAL(TRIPLOG_HEADER_SIZE + 100 * 3 + 8 * 2, len);
+}
+
+void test_extreme_values_round_trip() {
+    TripBlockEncoder enc;
+    enc.add({0, 1, INT32_MIN});
+    enc.add({0xFFFFFFFF, 1, INT32_MAX});
+    enc.add({0xFFFFFFFF, 1, INT32_MIN});
+    size_t len = enc.finish();
+
+    auto out = decodeAll(enc.data(), len);
+    TEST_ASSERT_EQUAL(3, out.size());
+    TEST_ASSERT_EQUAL_INT32(INT32_MIN, out[0].raw);
+    TEST_ASSERT_EQUAL_INT32(INT32_MAX, out[1].raw);
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFF, out[2].ms);
+    TEST_ASSERT_EQUAL_INT32(INT32_MIN, out[2].raw);
+}
+
+void test_full_block_rejects_sample() {
+    TripBlockEncoder enc;
+    int added = 0;
+    while(enc.add({(uint32_t)added * 100000, 2, added * 100000})) added++;
+    size_t len = enc.finish();
+    TEST_ASSERT_LESS_OR_EQUAL(TRIPLOG_BLOCK_SIZE, len);
+
+    int n;
+    decodeAll(enc.data(), len, &n);
+    TEST_ASSERT_EQUAL(added, n);
+}
+
+void test_corruption_fails_crc() {
+    TripBlockEncoder enc;
+    enc.add({10, 0, 1});
+    enc.add({20, 0, 2});
+    size_t len = enc.finish();
+
+    std::vector<uint8_t> copy(enc.data(), enc.data() + len);
+    copy[len - 1] ^= 0x01;
+    int n;
+    decodeAll(copy.data(), len, &n);
+    TEST_ASSERT_EQUAL(-1, n);
+
+    // The length is still readable, so a reader can skip the bad block
+    TEST_ASSERT_EQUAL(len, TripBlockDecoder::blockLength(copy.data(), len));
+}
+
+void test_truncated_block_is_rejected() {
+    TripBlockEncoder enc;
+    enc.add({10, 0, 1});
+    size_t len = enc.finish();
+    int n;
+    decodeAll(enc.data(), len - 1, &n);
+    TEST_ASSERT_EQUAL(-1, n);
+}
+
+void test_crc32_check_value() {
+    const uint8_t msg[] = "123456789";
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, tripCrc32(msg, 9));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_small_changes_take_three_bytes);
+    RUN_TEST(test_extreme_values_round_trip);
+    RUN_TEST(test_full_block_rejects_sample);
+    RUN_TEST(test_corruption_fails_crc);
+    RUN_TEST(test_truncated_block_is_rejected);
+    RUN_TEST(test_crc32_check_value);
+    return UNITY_END();
+}
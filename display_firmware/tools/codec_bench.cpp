@@ -0,0 +1,241 @@
+// Host benchmark for the telemetry codecs in src/Codec.h.
+//
+// Build and run from display_firmware/:
+//   g++ -O2 -std=gnu++17 -I src tools/codec_bench.cpp -o codec_bench
+//   ./codec_bench /path/to/trips/*.tlg     recorded trip logs (Recorder.h)
+//   ./codec_bench                          synthetic 30 minute ride
+//
+// Reports, per encoding, bytes per sample, compression ratio against the raw
+// 9-byte sample (u32 ms, u8 slot, i32 raw) and encode/decode speed. Every
+// encoding is decoded and compared against the input.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+#include "Codec.h"
+#include "TripLog.h"
+
+typedef std::vector<TripSample> Trace;
+
+static const size_t RAW_SAMPLE_BYTES = 9;
+
+static bool loadTripLog(const char* path, Trace& out) {
+    FILE* f = fopen(path, "rb");
+    if(!f) {
+        perror(path);
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t n;
+    while((n = fread(chunk, 1, sizeof(chunk), f)) > 0) data.insert(data.end(), chunk, chunk + n);
+    fclose(f);
+
+    size_t pos = 0, bad = 0;
+    while(pos < data.size()) {
+        size_t len = TripBlockDecoder::blockLength(&data[pos], data.size() - pos);
+        if(len == 0) break; // Torn tail
+        if(TripBlockDecoder::decode(&data[pos], len, [&](const TripSample& s) { out.push_back(s); }) < 0) bad++;
+        pos += len;
+    }
+    if(bad) fprintf(stderr, "%s: %zu corrupt blocks skipped\n", path, bad);
+    return true;
+}
+
+// 8 fields at ~10 Hz with scheduling jitter: accelerate, cruise, brake, repeat
+static Trace synthesize(uint32_t seconds) {
+    Trace t;
+    srand(1);
+    double speed = 0, soc = 95, temp = 30;
+    for(uint32_t tick=0; tick<seconds * 10; tick++) {
+        double phase = fmod(tick / 10.0, 120.0);
+        double target = phase < 20 ? 45 : phase < 90 ? 40 + 5 * sin(tick / 50.0) : 0;
+        speed += (target - speed) * 0.05;
+        double current = (target - speed) * 8 + speed * 0.9 + (rand() % 5 - 2);
+        double volt = 72 - current * 0.05 - (95 - soc) * 0.1;
+        soc -= current > 0 ? current * 0.00002 : 0;
+        temp += (current * 0.002) - (temp - 30) * 0.001;
+
+        int32_t raw[8] = {
+            (int32_t)(speed * 10),            // Speed, K=10
+            (int32_t)soc,                     // SoC
+            (int32_t)(speed * 45),            // RPM
+            (int32_t)(volt * 10),             // Volt, K=10
+            (int32_t)(volt * current),        // Power, K=1000 (W)
+            (int32_t)(current * 10),          // Current, K=10
+            (int32_t)(target > 0 ? 2500 : 600) + rand() % 3,
+            (int32_t)temp + 40,               // Temp, B=40
+        };
+        uint32_t base = tick * 100;
+        for(uint8_t slot=0; slot<8; slot++) {
+            t.push_back({base + slot * 3 + (uint32_t)(rand() % 3), slot, raw[slot]});
+        }
+    }
+    return t;
+}
+
+struct Result {
+    size_t bytes;
+    double encodeNs;  // per sample
+    double decodeNs;
+    bool ok;
+};
+
+static double nsPerSample(const std::function<void()>& fn, size_t samples) {
+    int reps = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed;
+    do {
+        fn();
+        reps++;
+        elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    } while(elapsed < 2e8); // >= 0.2 s per measurement
+    return elapsed / reps / samples;
+}
+
+// The on-device trip log: interleaved samples in CRC'd blocks
+static Result benchTripLog(const Trace& in) {
+    std::vector<uint8_t> out;
+    auto encode = [&]() {
+        out.clear();
+        TripBlockEncoder enc;
+        for(const TripSample& s : in) {
+            if(!enc.add(s)) {
+                size_t len = enc.finish();
+                out.insert(out.end(), enc.data(), enc.data() + len);
+                enc.reset();
+                enc.add(s);
+            }
+        }
+        size_t len = enc.finish();
+        out.insert(out.end(), enc.data(), enc.data() + len);
+    };
+    Trace back;
+    auto decode = [&]() {
+        back.clear();
+        for(size_t pos=0; pos<out.size(); ) {
+            size_t len = TripBlockDecoder::blockLength(&out[pos], out.size() - pos);
+            TripBlockDecoder::decode(&out[pos], len, [&](const TripSample& s) { back.push_back(s); });
+            pos += len;
+        }
+    };
+
+    Result r;
+    r.encodeNs = nsPerSample(encode, in.size());
+    r.decodeNs = nsPerSample(decode, in.size());
+    r.bytes = out.size();
+    r.ok = back.size() == in.size();
+    for(size_t i=0; r.ok && i<in.size(); i++) {
+        r.ok = back[i].ms == in[i].ms && back[i].slot == in[i].slot && back[i].raw == in[i].raw;
+    }
+    return r;
+}
+
+// Columnar: one stream per field, DeltaOfDelta timestamps, then values as
+// DeltaValue varints (xor = false) or XorValue bits (xor = true)
+static Result benchColumns(const Trace& in, bool xorValues) {
+    std::vector<std::vector<uint32_t>> ms(TRIPLOG_MAX_SLOTS);
+    std::vector<std::vector<int32_t>> vals(TRIPLOG_MAX_SLOTS);
+    for(const TripSample& s : in) {
+        ms[s.slot].push_back(s.ms);
+        vals[s.slot].push_back(s.raw);
+    }
+
+    std::vector<std::vector<uint8_t>> tsOut(TRIPLOG_MAX_SLOTS), valOut(TRIPLOG_MAX_SLOTS);
+    size_t valBytes[TRIPLOG_MAX_SLOTS] = {};
+    auto encode = [&]() {
+        for(int f=0; f<TRIPLOG_MAX_SLOTS; f++) {
+            size_t n = ms[f].size();
+            tsOut[f].resize(n * codec::MAX_VARINT);
+            valOut[f].assign(n * codec::MAX_VARINT + 8, 0);
+            DeltaOfDelta t;
+            size_t len = 0;
+            for(size_t i=0; i<n; i++) len += codec::putVarint(&tsOut[f][len], t.encode(ms[f][i]));
+            tsOut[f].resize(len);
+
+            if(xorValues) {
+                BitWriter w(valOut[f].data(), valOut[f].size());
+                XorValue x;
+                for(size_t i=0; i<n; i++) x.encode(w, (uint32_t)vals[f][i]);
+                valBytes[f] = w.bytes();
+            } else {
+                DeltaValue d;
+                len = 0;
+                for(size_t i=0; i<n; i++) len += codec::putVarint(&valOut[f][len], d.encode(vals[f][i]));
+                valBytes[f] = len;
+            }
+        }
+    };
+
+    bool ok = true;
+    auto decode = [&]() {
+        ok = true;
+        for(int f=0; f<TRIPLOG_MAX_SLOTS; f++) {
+            size_t n = ms[f].size(), pos = 0, vpos = 0;
+            DeltaOfDelta t;
+            DeltaValue d;
+            XorValue x;
+            BitReader r(valOut[f].data(), valBytes[f]);
+            for(size_t i=0; i<n; i++) {
+                uint32_t z, v;
+                codec::getVarint(tsOut[f].data(), tsOut[f].size(), pos, z);
+                ok &= t.decode(z) == ms[f][i];
+                if(xorValues) {
+                    ok &= x.decode(r, v) && (int32_t)v == vals[f][i];
+                } else {
+                    codec::getVarint(valOut[f].data(), valBytes[f], vpos, z);
+                    ok &= d.decode(z) == vals[f][i];
+                }
+            }
+        }
+    };
+
+    Result r;
+    r.encodeNs = nsPerSample(encode, in.size());
+    r.decodeNs = nsPerSample(decode, in.size());
+    r.bytes = 0;
+    for(int f=0; f<TRIPLOG_MAX_SLOTS; f++) r.bytes += tsOut[f].size() + valBytes[f];
+    r.ok = ok;
+    return r;
+}
+
+static void report(const char* name, const Result& r, size_t samples) {
+    double rawMB = samples * RAW_SAMPLE_BYTES / 1e6;
+    printf("%-22s %10zu %7.2f %7.2fx %9.1f %9.1f %8.0f %8.0f  %s\n", name, r.bytes,
+           (double)r.bytes / samples, (double)samples * RAW_SAMPLE_BYTES / r.bytes,
+           r.encodeNs, r.decodeNs,
+           rawMB / (r.encodeNs * samples / 1e9), rawMB / (r.decodeNs * samples / 1e9),
+           r.ok ? "ok" : "MISMATCH");
+}
+
+int main(int argc, char** argv) {
+    Trace trace;
+    if(argc > 1) {
+        for(int i=1; i<argc; i++) {
+            if(!loadTripLog(argv[i], trace)) return 1;
+        }
+    } else {
+        trace = synthesize(30 * 60);
+        printf("No trip logs given, using a synthetic 30 minute ride\n");
+    }
+    if(trace.empty()) {
+        fprintf(stderr, "No samples\n");
+        return 1;
+    }
+
+    printf("%zu samples, %zu bytes raw\n\n", trace.size(), trace.size() * RAW_SAMPLE_BYTES);
+    printf("%-22s %10s %7s %8s %9s %9s %8s %8s\n", "encoding", "bytes", "B/smp", "ratio",
+           "enc ns", "dec ns", "enc MB/s", "dec MB/s");
+
+    Result tl = benchTripLog(trace);
+    Result delta = benchColumns(trace, false);
+    Result xr = benchColumns(trace, true);
+    report("triplog (blocks)", tl, trace.size());
+    report("columns dod+delta", delta, trace.size());
+    report("columns dod+xor", xr, trace.size());
+
+    return tl.ok && delta.ok && xr.ok ? 0 : 1;
+}
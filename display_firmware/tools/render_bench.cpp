@@ -0,0 +1,95 @@
+// Host render benchmark: DisplayManager drawing into the in-memory panel of
+// host/TFT_eSPI.h while a simulated ride (src/RideModel.h) moves the values.
+//
+// Build and run from display_firmware/:
+//   g++ -O2 -std=gnu++17 -I host -I src tools/render_bench.cpp -o render_bench
+//   ./render_bench              60 s of ride per page
+//   ./render_bench 600          600 s per page
+//
+// For each page, renders every 20 ms sample like loop() does and reports the
+// host CPU time per render, the pixels and SPI bytes sent per render, and
+// what those bytes cost on the panel's 80 MHz SPI bus. Then the full-screen
+// cost of switching to each page. Host time is only comparable between runs
+// on one machine; the byte counts are what the panel would receive.
+// Virtual fields (trip, range, pack) are not modelled and stay still, so
+// pages showing only those send nothing after the first render.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "Display.h"
+#include "RideModel.h"
+
+static const float SPI_HZ = 80e6f;
+static const uint32_t SAMPLE_MS = 20;       // BLE stream round
+
+static DisplayManager display;
+static History history;
+static OperatingMap opmap;
+
+static double spiUs(uint64_t bytes) { return bytes * 8 * 1e6 / SPI_HZ; }
+
+// Wire fields and polled registers from the model; virtual fields stay put
+static void apply(const RideModel& ride, VehicleState& state) {
+    for(int slot=0; slot<NUM_SLOTS; slot++) {
+        if(slot >= NUM_FIELDS && slot < FIRST_POLLED_SLOT) continue;
+        uint16_t addr = fieldAddress(slot);
+        state.update(addr, ride.value(addr));
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t seconds = argc > 1 ? atoi(argv[1]) : 60;
+    if(seconds == 0) seconds = 60;
+    hostQuiet() = true;
+
+    display.init();
+    display.attachHistory(&history);
+    display.attachMap(&opmap);
+
+    printf("%-8s %10s %10s %10s %12s %12s\n", "page", "renders", "us/render", "px/render", "bytes/render", "spi us/rndr");
+    for(int p=0; p<NUM_PAGES; p++) {
+        RideModel ride;
+        VehicleState state;
+        apply(ride, state);
+        state.takeDirty();
+        display.showPage(p, state);
+        display.tft.resetStats();
+
+        uint64_t renders = 0;
+        double ns = 0;
+        uint32_t samples = seconds * 1000 / SAMPLE_MS;
+        for(uint32_t i=1; i<=samples; i++) {
+            ride.step(SAMPLE_MS * 1e-3f);
+            apply(ride, state);
+            uint32_t dirty = state.takeDirty();
+            if(!dirty) continue;
+
+            auto t0 = std::chrono::steady_clock::now();
+            display.render(state, dirty);
+            if(history.sample(state, i * SAMPLE_MS)) display.onHistorySample();
+            display.refreshHeatmap();
+            ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+            renders++;
+        }
+
+        const TftStats& st = display.tft.stats();
+        double n = renders ? (double)renders : 1.0;
+        printf("%-8s %10llu %10.2f %10.0f %12.0f %12.1f\n", PAGES[p].name, (unsigned long long)renders,
+               ns / 1000 / n, st.pixels / n, st.bytes / n, spiUs(st.bytes) / n);
+    }
+
+    // Page switch from the previous page, as the VIEW button does it
+    printf("\n%-8s %12s %12s %10s\n", "switch", "bytes", "spi us", "windows");
+    VehicleState state;
+    apply(RideModel(), state);
+    display.showPage(NUM_PAGES - 1, state);
+    for(int p=0; p<NUM_PAGES; p++) {
+        display.tft.resetStats();
+        display.showPage(p, state);
+        const TftStats& st = display.tft.stats();
+        printf("%-8s %12llu %12.0f %10lu\n", PAGES[p].name, (unsigned long long)st.bytes,
+               spiUs(st.bytes), (unsigned long)st.windows);
+    }
+    return 0;
+}
@@ -0,0 +1,75 @@
+// Host load test for the controller link: ControllerSession over a
+// LoopbackTransport to a ControllerEmulator (src/ControllerEmulator.h).
+//
+// Build and run from display_firmware/:
+//   g++ -O2 -std=gnu++17 -I src tools/session_load.cpp -o session_load
+//   ./session_load              10 s of emulated time per rate
+//   ./session_load 60           60 s per rate
+//
+// The emulator plays a simulated ride (RideModel.h). For each upload rate,
+// reports the samples delivered to the session's data callback, those lost
+// in the transport queue, and the host CPU time per sample spent in the
+// model, parsing and dispatch. A lossless run at rates far above the BLE
+// link's ~50 rounds/s shows the session is not the limit.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "ControllerSession.h"
+#include "LoopbackTransport.h"
+#include "RideModel.h"
+
+static const uint32_t RATES[] = {50, 200, 1000, 5000, 20000};  // Rounds/s
+
+int main(int argc, char** argv) {
+    uint32_t seconds = argc > 1 ? atoi(argv[1]) : 10;
+    if(seconds == 0) seconds = 10;
+
+    printf("%10s %12s %12s %10s %12s\n", "rounds/s", "samples", "samples/s", "lost", "ns/sample");
+    for(uint32_t rate : RATES) {
+        ControllerEmulator emu;
+        LoopbackTransport link(emu);
+        ControllerSession session;
+        session.attach(&link);
+
+        volatile float sink = 0;
+        uint64_t delivered = 0;
+        session.onDataReceived = [&](const Protocol::ParsedData& d) {
+            sink = sink + d.value;
+            delivered++;
+        };
+
+        link.connect();
+        session.configure(0);
+        for(uint32_t ms = 0; !session.isStreaming() && ms < 10000; ms += 10) {
+            session.service(ms);
+            link.poll();
+        }
+        if(!session.isStreaming()) {
+            fprintf(stderr, "stream setup failed\n");
+            return 1;
+        }
+
+        emu.periodUs = 1000000 / rate;
+        RideModel ride;
+        uint64_t lastUs = 0;
+        emu.script = [&](uint64_t us, ControllerEmulator& e) {
+            ride.step((us - lastUs) * 1e-6f);
+            lastUs = us;
+            ride.write(e);
+        };
+
+        // Deliver every emulated millisecond, like the notify callback would
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t end = (uint64_t)seconds * 1000000;
+        for(uint64_t us = 1000; us <= end; us += 1000) {
+            emu.run(us);
+            link.poll();
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+
+        printf("%10lu %12llu %12.0f %10lu %12.1f\n", (unsigned long)rate, (unsigned long long)delivered,
+               delivered / (double)seconds, (unsigned long)link.dropped, delivered ? ns / delivered : 0.0);
+    }
+    return 0;
+}
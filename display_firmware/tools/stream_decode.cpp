@@ -0,0 +1,158 @@
+// Linux host decoder for the USB telemetry stream (src/UsbStream.h).
+//
+// Build from display_firmware/:
+//   g++ -O2 -std=gnu++17 -I src tools/stream_decode.cpp -o stream_decode
+//
+// Usage:
+//   stream_decode [-o out.csv | -b out.bin] [-n] /dev/ttyACM0
+//   stream_decode -o out.csv capture.raw       decode a saved raw capture
+//
+// On a tty the port is switched to raw mode and 'B' is sent to start the
+// stream ('T' on exit, unless -n). Without -o/-b, CSV goes to stdout.
+//
+// CSV columns: seq,t_us,controller,address,field,raw,value
+// Binary output is a sequence of packed little-endian records:
+//   u16 seq  u32 t_us  u8 controller  u16 address  i32 raw   (13 bytes)
+//
+// Lost frames (sequence gaps), CRC errors and the device's own drop count
+// are reported on stderr at exit (Ctrl-C).
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include "Config.h"
+#include "StreamFrame.h"
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int) { stopRequested = 1; }
+
+static bool makeRaw(int fd) {
+    termios tio;
+    if(tcgetattr(fd, &tio) != 0) return false;
+    cfmakeraw(&tio);
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    return tcsetattr(fd, TCSANOW, &tio) == 0;
+}
+
+static const DataFieldConfig* fieldFor(uint16_t address) {
+    int i = fieldIndex(address);
+    return (i < 0 || i >= NUM_FIELDS) ? nullptr : &TARGET_FIELDS[i];
+}
+
+int main(int argc, char** argv) {
+    const char* csvPath = nullptr;
+    const char* binPath = nullptr;
+    bool leaveRunning = false;
+    int opt;
+    while((opt = getopt(argc, argv, "o:b:n")) != -1) {
+        switch(opt) {
+            case 'o': csvPath = optarg; break;
+            case 'b': binPath = optarg; break;
+            case 'n': leaveRunning = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-o out.csv | -b out.bin] [-n] <port|capture>\n", argv[0]);
+                return 2;
+        }
+    }
+    if(optind >= argc) {
+        fprintf(stderr, "usage: %s [-o out.csv | -b out.bin] [-n] <port|capture>\n", argv[0]);
+        return 2;
+    }
+
+    int fd = open(argv[optind], O_RDWR | O_NOCTTY);
+    if(fd < 0) fd = open(argv[optind], O_RDONLY);
+    if(fd < 0) {
+        perror(argv[optind]);
+        return 1;
+    }
+    bool tty = isatty(fd);
+    if(tty) {
+        if(!makeRaw(fd)) perror("tcsetattr");
+        if(write(fd, "B", 1) != 1) perror("start stream");
+    }
+
+    FILE* out = stdout;
+    if(csvPath || binPath) {
+        out = fopen(csvPath ? csvPath : binPath, csvPath ? "w" : "wb");
+        if(!out) {
+            perror(csvPath ? csvPath : binPath);
+            return 1;
+        }
+    }
+    if(!binPath) fprintf(out, "seq,t_us,controller,address,field,raw,value\n");
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    StreamParser parser;
+    StreamFrame f;
+    bool haveSeq = false;
+    uint16_t nextSeq = 0;
+    uint64_t frames = 0, samples = 0, lost = 0;
+    uint32_t deviceDropped = 0;
+
+    uint8_t buf[4096];
+    while(!stopRequested) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if(n == 0 && !tty) break; // End of capture
+        if(n <= 0) {
+            if(n < 0 && errno != EINTR) perror("read");
+            if(n < 0 && errno != EINTR) break;
+            continue;
+        }
+
+        for(ssize_t i=0; i<n; i++) {
+            if(!parser.feed(buf[i], f)) continue;
+            frames++;
+            if(haveSeq && f.seq != nextSeq) lost += (uint16_t)(f.seq - nextSeq);
+            haveSeq = true;
+            nextSeq = f.seq + 1;
+
+            switch(f.type) {
+                case STREAM_SAMPLE: {
+                    samples++;
+                    if(binPath) {
+                        uint8_t rec[13] = {
+                            (uint8_t)f.seq, (uint8_t)(f.seq >> 8),
+                            (uint8_t)f.tUs, (uint8_t)(f.tUs >> 8), (uint8_t)(f.tUs >> 16), (uint8_t)(f.tUs >> 24),
+                            f.controller,
+                            (uint8_t)f.address, (uint8_t)(f.address >> 8),
+                            (uint8_t)f.raw, (uint8_t)(f.raw >> 8), (uint8_t)(f.raw >> 16), (uint8_t)(f.raw >> 24),
+                        };
+                        fwrite(rec, 1, sizeof(rec), out);
+                    } else {
+                        const DataFieldConfig* cfg = fieldFor(f.address);
+                        fprintf(out, "%u,%u,%u,%u,%s,%d,", f.seq, f.tUs, f.controller, f.address,
+                                cfg ? cfg->name : "", f.raw);
+                        if(cfg) fprintf(out, "%g", (f.raw - cfg->b) / cfg->k);
+                        fputc('\n', out);
+                    }
+                    break;
+                }
+                case STREAM_CONTROLLER:
+                    fprintf(stderr, "controller %u: %02X:%02X:%02X:%02X:%02X:%02X\n", f.controller,
+                            f.mac[5], f.mac[4], f.mac[3], f.mac[2], f.mac[1], f.mac[0]);
+                    break;
+                case STREAM_STATS:
+                    deviceDropped = f.dropped;
+                    break;
+            }
+        }
+    }
+
+    if(tty && !leaveRunning && write(fd, "T", 1) != 1) perror("stop stream");
+    close(fd);
+    if(out != stdout) fclose(out);
+
+    fprintf(stderr, "%llu frames, %llu samples, %llu lost (seq gaps), %u device drops, "
+            "%u CRC errors, %u bytes skipped\n",
+            (unsigned long long)frames, (unsigned long long)samples, (unsigned long long)lost,
+            deviceDropped, parser.crcErrors, parser.skippedBytes);
+    return 0;
+}
@@ -0,0 +1,143 @@
+// Converts an event trace dump (src/EventTrace.h, printed by TraceDump.h on
+// the Serial console) into Chrome trace JSON, for chrome://tracing or
+// ui.perfetto.dev.
+//
+// Build and run from display_firmware/:
+//   g++ -O2 -std=gnu++17 -I src tools/trace_chrome.cpp -o trace_chrome
+//   pio device monitor | tee console.log     then double press VIEW
+//   ./trace_chrome console.log > trace.json
+//
+// Other console output between the dump lines is skipped. Each core's
+// 32-bit cycle counts are unwrapped event to event and placed on the
+// esp_timer time line through the core's sync line, so both cores share one
+// time axis. Matching begin / end events become complete ("X") events with
+// the begin argument; instants become "i" events. With several dumps in the
+// log, each is converted, one after the other in time.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "EventTrace.h"
+
+struct Open {
+    uint16_t id;
+    uint16_t arg;
+    double us;
+};
+
+struct Core {
+    bool synced = false;
+    uint32_t syncCycles = 0;
+    uint64_t syncUs = 0;
+    bool started = false;
+    uint32_t lastCycles = 0;
+    int64_t cycles = 0;         // Unwrapped, relative to syncCycles
+    std::vector<Open> open;     // Begun, not ended, innermost last
+};
+
+static bool first = true;
+
+static void emit(const char* ph, int core, uint16_t id, double us, double dur, uint16_t arg) {
+    printf("%s\n{\"name\":\"%s\",\"ph\":\"%s\",\"pid\":1,\"tid\":%d,\"ts\":%.3f", first ? "" : ",",
+           traceName(id), ph, core, us);
+    if(dur >= 0) printf(",\"dur\":%.3f", dur);
+    if(ph[0] == 'i') printf(",\"s\":\"t\"");
+    printf(",\"args\":{\"arg\":%u}}", arg);
+    first = false;
+}
+
+int main(int argc, char** argv) {
+    FILE* in = argc > 1 ? fopen(argv[1], "r") : stdin;
+    if(!in) {
+        perror(argv[1]);
+        return 1;
+    }
+    Core cores[EVENT_CORES];
+    double mhz = 240;
+    unsigned long events = 0, skipped = 0, unmatched = 0, dumps = 0, lost = 0;
+    char line[256];
+
+    printf("{\"traceEvents\":[");
+    for(int c=0; c<EVENT_CORES; c++) {
+        printf("%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"core %d\"}}",
+               first ? "" : ",", c, c);
+        first = false;
+    }
+    while(fgets(line, sizeof(line), in)) {
+        tracedump::Line l = tracedump::parse(line);
+        Core& core = cores[l.core];
+        switch(l.kind) {
+            case 'H':
+                if(l.a != EVENT_DUMP_VERSION) fprintf(stderr, "dump version %lu, expected %d\n", (unsigned long)l.a,
+                                                      EVENT_DUMP_VERSION);
+                mhz = l.b ? (double)l.b : 240;
+                for(Core& c : cores) c = Core();
+                dumps++;
+                break;
+
+            case 'S':
+                core.synced = true;
+                core.syncCycles = l.a;
+                core.syncUs = l.b;
+                break;
+
+            case 'E': {
+                if(!core.synced) {
+                    skipped++;
+                    break;
+                }
+                // Signed 32-bit steps: events of a core are in order, and
+                // closer together than 2^31 cycles
+                if(!core.started) {
+                    core.cycles = (int32_t)(l.event.cycles - core.syncCycles);
+                    core.started = true;
+                } else {
+                    core.cycles += (int32_t)(l.event.cycles - core.lastCycles);
+                }
+                core.lastCycles = l.event.cycles;
+                double us = core.syncUs + core.cycles / mhz;
+                uint16_t id = l.event.name();
+                events++;
+
+                switch(l.event.phase()) {
+                    case TRACE_BEGIN_PHASE:
+                        core.open.push_back({id, l.event.arg, us});
+                        break;
+                    case TRACE_END_PHASE: {
+                        // The innermost open one of this id; the ring may have
+                        // dropped the begin of the oldest ones
+                        int i = (int)core.open.size() - 1;
+                        while(i >= 0 && core.open[i].id != id) i--;
+                        if(i < 0) {
+                            unmatched++;
+                            break;
+                        }
+                        emit("X", l.core, id, core.open[i].us, us - core.open[i].us, core.open[i].arg);
+                        core.open.erase(core.open.begin() + i);
+                        break;
+                    }
+                    default:
+                        emit("i", l.core, id, us, -1, l.event.arg);
+                        break;
+                }
+                break;
+            }
+
+            case 'Z':
+                if(l.b > l.a) lost += l.b - l.a;
+                unmatched += core.open.size();
+                core.open.clear();
+                break;
+
+            default:
+                skipped++;
+                break;
+        }
+    }
+    printf("\n]}\n");
+    if(in != stdin) fclose(in);
+
+    fprintf(stderr, "%lu dumps, %lu events (%lu overwritten in the rings), %lu unmatched, %lu other lines\n", dumps,
+            events, lost, unmatched, skipped);
+    return events ? 0 : 1;
+}
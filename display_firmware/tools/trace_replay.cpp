@@ -0,0 +1,226 @@
+// Host replay of a packet trace (src/PacketTrace.h) through the firmware's
+// pipeline: ControllerSession, VehicleState, the trip computer, operating
+// map and trip log encoder, and the display renderer on the in-memory panel
+// of host/TFT_eSPI.h.
+//
+// Build and run from display_firmware/:
+//   g++ -O2 -std=gnu++17 -I host -I src tools/trace_replay.cpp -o trace_replay
+//   ./trace_replay trace.ptr               as fast as possible
+//   ./trace_replay -r trace.ptr            in recorded time
+//   ./trace_replay -o end.ppm trace.ptr    also write the final screen
+//   ./trace_replay -g 60 ride.ptr          write a 60 s trace of a simulated ride
+//
+// Traces come from the device (TraceCapture.h, /trace.ptr on the data
+// partition). Reports throughput, the time per event of each stage and the
+// state the display was left in. Every stage sees trace time, not wall
+// time, so a trace ends in the same state at any replay speed; a trace
+// that shows an odd value or freeze on the bike shows it here too.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "ControllerSession.h"
+#include "Display.h"
+#include "OperatingMap.h"
+#include "RideModel.h"
+#include "TraceReplay.h"
+#include "TripComputer.h"
+#include "TripLog.h"
+
+// Stands in for the BLE client: packets go to the session's receiver
+class HostLink : public Transport {
+public:
+    bool connected() const override { return true; }
+    bool send(const uint8_t*, size_t) override { return true; }
+    void push(const uint8_t* data, size_t length) { deliver(data, length); }
+};
+
+static uint64_t nowUs() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static bool loadFile(const char* path, std::vector<uint8_t>& out) {
+    FILE* f = fopen(path, "rb");
+    if(!f) {
+        perror(path);
+        return false;
+    }
+    uint8_t chunk[4096];
+    size_t n;
+    while((n = fread(chunk, 1, sizeof(chunk), f)) > 0) out.insert(out.end(), chunk, chunk + n);
+    fclose(f);
+    return true;
+}
+
+// A ride from RideModel.h as the controller would upload it after setup
+static int generate(uint32_t seconds, const char* path) {
+    ControllerEmulator emu;
+    RideModel ride;
+    PacketTraceWriter writer;
+    std::vector<uint8_t> out(TRACE_HEADER_SIZE);
+    writer.header(out.data(), 0);
+
+    uint8_t rec[TRACE_MAX_RECORD];
+    out.insert(out.end(), rec, rec + writer.link(rec, 0, true));
+    uint64_t at = 0;
+    emu.out = [&](const uint8_t* data, size_t length) {
+        out.insert(out.end(), rec, rec + writer.packet(rec, at, data, length));
+        at += 150; // Notifications of one round arrive a connection event apart
+    };
+    for(int i=0; i<NUM_FIELDS; i++) {
+        auto cmd = Protocol::createChannelSetupCommand(TARGET_FIELDS[i].address, TARGET_FIELDS[i].size);
+        emu.onCommand(cmd.data(), cmd.size());
+    }
+    auto start = Protocol::createControlCommand(CMD_START_UPLOAD);
+    emu.onCommand(start.data(), start.size());
+
+    uint64_t lastUs = 0;
+    emu.script = [&](uint64_t us, ControllerEmulator& e) {
+        ride.step((us - lastUs) * 1e-6f);
+        lastUs = us;
+        ride.write(e);
+    };
+    for(uint64_t us = 0; us < (uint64_t)seconds * 1000000; us += emu.periodUs) {
+        at = us;
+        emu.round(us);
+    }
+
+    FILE* f = fopen(path, "wb");
+    if(!f || fwrite(out.data(), 1, out.size(), f) != out.size()) {
+        perror(path);
+        return 1;
+    }
+    fclose(f);
+    printf("%s: %lu rounds, %zu bytes\n", path, (unsigned long)emu.rounds, out.size());
+    return 0;
+}
+
+static void printStage(const char* name, const StageTime& t) {
+    printf("  %-9s %9lu x  avg %8.2f us  max %7lu us\n", name, (unsigned long)t.count, t.averageUs(),
+           (unsigned long)t.maxUs);
+}
+
+int main(int argc, char** argv) {
+    float speed = 0;
+    const char* ppm = nullptr;
+    int i = 1;
+    for(; i < argc && argv[i][0] == '-'; i++) {
+        if(!strcmp(argv[i], "-r")) speed = 1;
+        else if(!strcmp(argv[i], "-o") && i + 1 < argc) ppm = argv[++i];
+        else if(!strcmp(argv[i], "-g") && i + 2 < argc) return generate(atoi(argv[i + 1]), argv[i + 2]);
+        else break;
+    }
+    if(i != argc - 1) {
+        fprintf(stderr, "usage: %s [-r] [-o screen.ppm] trace.ptr | -g seconds out.ptr\n", argv[0]);
+        return 2;
+    }
+    std::vector<uint8_t> trace;
+    if(!loadFile(argv[i], trace)) return 1;
+
+    hostQuiet() = true;
+    static DisplayManager display;
+    static VehicleState vehicle;
+    static History history;
+    static OperatingMap opmap;
+    static TripComputer computer;
+    static TripBlockEncoder log;
+    display.init();
+    display.attachHistory(&history);
+    display.attachMap(&opmap);
+    display.showPage(0, vehicle);
+
+    HostLink link;
+    ControllerSession session;
+    session.attach(&link);
+
+    // Stage clocks: entry to the session, parsed, callbacks done
+    StageTime parse, pipeline, render;
+    uint64_t packetUs = 0;
+    uint32_t traceMs = 0, logBlocks = 0, logBytes = 0, others = 0;
+    session.onPacket = [&](const uint8_t*, size_t) { packetUs = nowUs(); };
+    session.onDataReceived = [&](const Protocol::ParsedData& d) {
+        uint64_t t0 = nowUs();
+        parse.add(t0 - packetUs);
+        vehicle.update(d.address, d.value);
+        if(d.slot >= 0 && !log.add({traceMs, (uint8_t)d.slot, d.raw})) {
+            logBytes += log.finish();
+            logBlocks++;
+            log.reset();
+            log.add({traceMs, (uint8_t)d.slot, d.raw});
+        }
+        if(computer.onSample(d.address, d.value, traceMs)) {
+            const TripTotals& t = computer.get();
+            vehicle.update(VF_WH_USED, (float)t.whUsed);
+            vehicle.update(VF_WH_REGEN, (float)t.whRegen);
+            vehicle.update(VF_DISTANCE, (float)t.km);
+            vehicle.update(VF_WH_PER_KM, computer.whPerKm());
+            vehicle.update(VF_AVG_SPEED, computer.avgSpeed());
+            vehicle.update(VF_PEAK_POWER, t.peakKw);
+        }
+        opmap.onSample(d.address, d.value, traceMs);
+        pipeline.add(nowUs() - t0);
+    };
+    session.onOtherPacket = [&](const uint8_t*, size_t) {
+        parse.add(nowUs() - packetUs);
+        others++;
+    };
+
+    TraceReplay replay;
+    uint64_t startUs = nowUs();
+    if(!replay.begin(trace.data(), trace.size(), speed, startUs)) {
+        fprintf(stderr, "%s: not a packet trace\n", argv[i]);
+        return 1;
+    }
+    size_t fed = TRACE_HEADER_SIZE;
+    while(!replay.finished()) {
+        fed += replay.feed(trace.data() + fed, trace.size() - fed);
+        if(fed == trace.size()) replay.end();
+
+        replay.run(nowUs(), UINT32_MAX, [&](const TraceRecord& r) {
+            traceMs = (uint32_t)(r.us / 1000);
+            if(r.length) link.push(r.data, r.length);
+
+            // loop(): render what changed, then the history tick
+            uint32_t dirty = vehicle.takeDirty();
+            uint64_t t0 = nowUs();
+            display.render(vehicle, dirty);
+            if(history.sample(vehicle, traceMs)) display.onHistorySample();
+            display.refreshHeatmap();
+            if(dirty) render.add(nowUs() - t0);
+        });
+
+        uint64_t due = replay.nextDue();
+        if(speed > 0 && due != UINT64_MAX && due > nowUs()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(due - nowUs()));
+        }
+    }
+    if(log.samples()) {
+        logBytes += log.finish();
+        logBlocks++;
+    }
+    double s = (nowUs() - startUs) / 1e6;
+    double traceS = replay.traceUs / 1e6;
+
+    printf("%s: %lu packets (%lu samples, %lu other), %lu link events%s\n", argv[i],
+           (unsigned long)replay.packets, (unsigned long)session.samples.load(), (unsigned long)others,
+           (unsigned long)replay.linkEvents, replay.malformed ? ", stopped at a corrupt record" : "");
+    printf("  trace %.2f s replayed in %.3f s (x%.1f), %.0f packets/s\n", traceS, s, s > 0 ? traceS / s : 0,
+           s > 0 ? replay.packets / s : 0);
+    printf("  trip log %lu blocks, %lu bytes\n", (unsigned long)logBlocks, (unsigned long)logBytes);
+    if(speed > 0) printStage("late", replay.lateness);
+    printStage("parse", parse);
+    printStage("pipeline", pipeline);
+    printStage("render", render);
+
+    printf("final state, %s page, screen 0x%016llx:\n", PAGES[display.page()].name,
+           (unsigned long long)display.tft.checksum());
+    for(int slot=0; slot<NUM_SLOTS; slot++) {
+        printf("  %-8s %10.2f %s\n", fieldName(slot), vehicle.value(slot), vehicle.isValid(slot) ? "" : "(none)");
+    }
+    if(ppm) display.tft.writePPM(ppm);
+    return replay.malformed ? 1 : 0;
+}